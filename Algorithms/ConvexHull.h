@@ -0,0 +1,86 @@
+/*
+
+Copyright (c) 2014, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#ifndef CONVEX_HULL_H
+#define CONVEX_HULL_H
+
+#include <osrm/Coordinate.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Computes the convex hull of a set of coordinates with Andrew's monotone chain. The hull is
+// returned counter-clockwise in the lon/lat plane, without repeating the first coordinate.
+// Coordinates on an edge of the hull are dropped.
+inline std::vector<FixedPointCoordinate> ConvexHull(std::vector<FixedPointCoordinate> coordinates)
+{
+    std::sort(coordinates.begin(),
+              coordinates.end(),
+              [](const FixedPointCoordinate &a, const FixedPointCoordinate &b)
+              { return (a.lon < b.lon) || (a.lon == b.lon && a.lat < b.lat); });
+    coordinates.erase(std::unique(coordinates.begin(), coordinates.end()), coordinates.end());
+    if (coordinates.size() < 3)
+    {
+        return coordinates;
+    }
+
+    // > 0 if o, a, b make a left turn, 64 bits hold the product of two fixed point differences
+    const auto cross = [](const FixedPointCoordinate &o,
+                          const FixedPointCoordinate &a,
+                          const FixedPointCoordinate &b)
+    {
+        return static_cast<int64_t>(a.lon - o.lon) * (b.lat - o.lat) -
+               static_cast<int64_t>(a.lat - o.lat) * (b.lon - o.lon);
+    };
+
+    std::vector<FixedPointCoordinate> hull(2 * coordinates.size());
+    std::size_t size = 0;
+    // lower hull
+    for (const FixedPointCoordinate &coordinate : coordinates)
+    {
+        while (size >= 2 && cross(hull[size - 2], hull[size - 1], coordinate) <= 0)
+        {
+            --size;
+        }
+        hull[size++] = coordinate;
+    }
+    // upper hull, the last coordinate already ends the lower one
+    const std::size_t lower_size = size + 1;
+    for (auto iter = coordinates.rbegin() + 1; iter != coordinates.rend(); ++iter)
+    {
+        while (size >= lower_size && cross(hull[size - 2], hull[size - 1], *iter) <= 0)
+        {
+            --size;
+        }
+        hull[size++] = *iter;
+    }
+    // the first coordinate closes the upper hull
+    hull.resize(size - 1);
+    return hull;
+}
+
+#endif // CONVEX_HULL_H
@@ -7,14 +7,30 @@
 
 #include <osrm/Coordinate.h>
 
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <memory>
 #include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 // Choosen by a fair W20 dice roll (this value is completely arbitrary)
 constexpr unsigned RANDOM_SEED = 13;
-constexpr int32_t WORLD_MIN_LAT = -90*COORDINATE_PRECISION;
-constexpr int32_t WORLD_MAX_LAT = 90*COORDINATE_PRECISION;
-constexpr int32_t WORLD_MIN_LON = -180*COORDINATE_PRECISION;
-constexpr int32_t WORLD_MAX_LON = 180*COORDINATE_PRECISION;
+static const int32_t WORLD_MIN_LAT = -90*COORDINATE_PRECISION;
+static const int32_t WORLD_MAX_LAT = 90*COORDINATE_PRECISION;
+static const int32_t WORLD_MIN_LON = -180*COORDINATE_PRECISION;
+static const int32_t WORLD_MAX_LON = 180*COORDINATE_PRECISION;
+// meters per degree of latitude
+static const double METERS_PER_DEGREE = 111320.;
 
 typedef EdgeBasedNode RTreeLeaf;
 typedef std::shared_ptr<std::vector<FixedPointCoordinate>> FixedPointCoordinateListPtr;
@@ -39,7 +55,8 @@ FixedPointCoordinateListPtr LoadCoordinates(const boost::filesystem::path& nodes
     return coords;
 }
 
-void Benchmark(BenchStaticRTree& rtree, unsigned num_queries)
+// Uniformly random coordinates on the whole world, most of them far away from any street
+std::vector<FixedPointCoordinate> GenerateWorldQueries(unsigned num_queries)
 {
     std::mt19937 g(RANDOM_SEED);
     std::uniform_int_distribution<> lat_udist(WORLD_MIN_LAT, WORLD_MAX_LAT);
@@ -51,68 +68,441 @@ void Benchmark(BenchStaticRTree& rtree, unsigned num_queries)
             FixedPointCoordinate(lat_udist(g), lon_udist(g))
         );
     }
+    return queries;
+}
 
-    const unsigned num_results = 5;
-    std::cout << "#### IncrementalFindPhantomNodeForCoordinate : " << num_results << " phantom nodes" << std::endl;
+// Coordinates of random nodes of the data set, moved by a normally distributed offset of
+// jitter meters in each direction, like the GPS positions that clients send
+std::vector<FixedPointCoordinate> GenerateNodeQueries(const std::vector<FixedPointCoordinate>& coords,
+                                                      unsigned num_queries,
+                                                      double jitter)
+{
+    std::mt19937 g(RANDOM_SEED);
+    std::uniform_int_distribution<std::size_t> node_udist(0, coords.size() - 1);
+    std::normal_distribution<double> offset_ndist(0., std::max(jitter, 0.));
+    std::vector<FixedPointCoordinate> queries;
+    for (unsigned i = 0; i < num_queries; i++)
+    {
+        FixedPointCoordinate query = coords[node_udist(g)];
+        if (0. < jitter)
+        {
+            const double lat = query.lat / COORDINATE_PRECISION;
+            const double lat_offset = offset_ndist(g) / METERS_PER_DEGREE;
+            const double lon_offset = offset_ndist(g) /
+                (METERS_PER_DEGREE * std::max(std::cos(lat * M_PI / 180.), 0.01));
+            const double lon = query.lon / COORDINATE_PRECISION;
+            query.lat = static_cast<int>(std::max(-90., std::min(90., lat + lat_offset)) *
+                                         COORDINATE_PRECISION);
+            query.lon = static_cast<int>(std::max(-180., std::min(180., lon + lon_offset)) *
+                                         COORDINATE_PRECISION);
+        }
+        queries.emplace_back(query);
+    }
+    return queries;
+}
 
-    TIMER_START(query_phantom);
-    std::vector<PhantomNode> resulting_phantom_node_vector;
-    for (const auto& q : queries)
+// Reads one "lat,lon" pair in degrees per line
+std::vector<FixedPointCoordinate> LoadQueries(const boost::filesystem::path& query_file)
+{
+    if (!boost::filesystem::exists(query_file))
     {
-        resulting_phantom_node_vector.clear();
-        rtree.IncrementalFindPhantomNodeForCoordinate(q, resulting_phantom_node_vector, 3, num_results);
-        resulting_phantom_node_vector.clear();
-        rtree.IncrementalFindPhantomNodeForCoordinate(q, resulting_phantom_node_vector, 17, num_results);
+        throw OSRMException("query file does not exist");
     }
-    TIMER_STOP(query_phantom);
+    boost::filesystem::ifstream query_stream(query_file);
+    std::vector<FixedPointCoordinate> queries;
+    std::string line;
+    while (std::getline(query_stream, line))
+    {
+        if (line.empty() || '#' == line[0])
+        {
+            continue;
+        }
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::istringstream line_stream(line);
+        double lat = 0., lon = 0.;
+        if (!(line_stream >> lat >> lon))
+        {
+            throw OSRMException("malformed line in query file: " + line);
+        }
+        queries.emplace_back(static_cast<int>(lat * COORDINATE_PRECISION),
+                             static_cast<int>(lon * COORDINATE_PRECISION));
+    }
+    return queries;
+}
 
-    std::cout << "Took " << TIMER_MSEC(query_phantom) << " msec for " << num_queries << " queries." << std::endl;
-    std::cout << TIMER_MSEC(query_phantom)/((double) num_queries) << " msec/query." << std::endl;
+struct QueryMeasurement
+{
+    double microseconds;
+    uint64_t visited_leaves;
+};
 
-    std::cout << "#### LocateClosestEndPointForCoordinate" << std::endl;
+struct QueryTypeResult
+{
+    std::string name;
+    unsigned num_threads;
+    double seconds;
+    std::vector<QueryMeasurement> measurements;
+};
+
+typedef std::function<void(BenchStaticRTree&, const FixedPointCoordinate&)> QueryFunction;
+
+// Answers every query once, with a thread per r-tree. Like the threads of a data facade, every
+// thread queries its own r-tree and all of them share one leaf cache.
+QueryTypeResult RunQueries(const std::string& name,
+                           const std::vector<std::unique_ptr<BenchStaticRTree>>& rtrees,
+                           const std::vector<FixedPointCoordinate>& queries,
+                           const QueryFunction& query_function)
+{
+    QueryTypeResult result;
+    result.name = name;
+    result.num_threads = rtrees.size();
+    result.measurements.resize(queries.size());
 
-    TIMER_START(query_endpoint);
-    FixedPointCoordinate result;
-    for (const auto& q : queries)
+    std::atomic<std::size_t> next_query(0);
+    const auto run_thread = [&](BenchStaticRTree& rtree)
     {
-        rtree.LocateClosestEndPointForCoordinate(q, result, 3);
+        std::size_t query;
+        while ((query = next_query++) < queries.size())
+        {
+            const uint64_t visited_leaves_before = rtree.GetNumberOfVisitedLeaves();
+            const auto start = std::chrono::steady_clock::now();
+            query_function(rtree, queries[query]);
+            const auto stop = std::chrono::steady_clock::now();
+            result.measurements[query].microseconds =
+                std::chrono::duration<double, std::micro>(stop - start).count();
+            result.measurements[query].visited_leaves =
+                rtree.GetNumberOfVisitedLeaves() - visited_leaves_before;
+        }
+    };
+
+    TIMER_START(queries);
+    std::vector<std::thread> threads;
+    for (const auto& rtree : rtrees)
+    {
+        threads.emplace_back(run_thread, std::ref(*rtree));
     }
-    TIMER_STOP(query_endpoint);
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    TIMER_STOP(queries);
+    result.seconds = std::chrono::duration<double>(queries_stop - queries_start).count();
+    return result;
+}
 
-    std::cout << "Took " << TIMER_MSEC(query_endpoint) << " msec for " << num_queries << " queries." << std::endl;
-    std::cout << TIMER_MSEC(query_endpoint)/((double) num_queries) << " msec/query." << std::endl;
+template <class T> T Percentile(const std::vector<T>& sorted_values, const double percentile)
+{
+    if (sorted_values.empty())
+    {
+        return T();
+    }
+    const std::size_t index = static_cast<std::size_t>(
+        std::ceil(percentile / 100. * sorted_values.size()));
+    return sorted_values[std::min(sorted_values.size() - 1, index == 0 ? 0 : index - 1)];
+}
+
+void PrintCSVHeader()
+{
+    std::cout << "query,threads,queries,seconds,queries_per_second,"
+                 "p50_us,p90_us,p99_us,p999_us,max_us,mean_leaves,p50_leaves,p99_leaves,max_leaves"
+              << std::endl;
+}
+
+void PrintResult(const QueryTypeResult& result, const bool csv)
+{
+    std::vector<double> latencies;
+    std::vector<uint64_t> visited_leaves;
+    for (const QueryMeasurement& measurement : result.measurements)
+    {
+        latencies.push_back(measurement.microseconds);
+        visited_leaves.push_back(measurement.visited_leaves);
+    }
+    std::sort(latencies.begin(), latencies.end());
+    std::sort(visited_leaves.begin(), visited_leaves.end());
+    const std::size_t num_queries = result.measurements.size();
+    double mean_leaves = 0.;
+    for (const uint64_t leaves : visited_leaves)
+    {
+        mean_leaves += leaves;
+    }
+    mean_leaves = num_queries ? mean_leaves / num_queries : 0.;
+    const double queries_per_second = 0. < result.seconds ? num_queries / result.seconds : 0.;
 
-    std::cout << "#### FindPhantomNodeForCoordinate" << std::endl;
+    if (csv)
+    {
+        std::cout << result.name << "," << result.num_threads << "," << num_queries << ","
+                  << result.seconds << "," << queries_per_second << ","
+                  << Percentile(latencies, 50) << "," << Percentile(latencies, 90) << ","
+                  << Percentile(latencies, 99) << "," << Percentile(latencies, 99.9) << ","
+                  << Percentile(latencies, 100) << "," << mean_leaves << ","
+                  << Percentile(visited_leaves, 50) << "," << Percentile(visited_leaves, 99) << ","
+                  << Percentile(visited_leaves, 100) << std::endl;
+        return;
+    }
+
+    std::cout << "#### " << result.name << std::endl;
+    std::cout << num_queries << " queries on " << result.num_threads << " threads in "
+              << result.seconds << " sec, " << queries_per_second << " queries/sec." << std::endl;
+    std::cout << "latency usec: p50 " << Percentile(latencies, 50) << ", p90 "
+              << Percentile(latencies, 90) << ", p99 " << Percentile(latencies, 99) << ", p99.9 "
+              << Percentile(latencies, 99.9) << ", max " << Percentile(latencies, 100) << std::endl;
+    std::cout << "leaves visited: mean " << mean_leaves << ", p50 " << Percentile(visited_leaves, 50)
+              << ", p99 " << Percentile(visited_leaves, 99) << ", max "
+              << Percentile(visited_leaves, 100) << std::endl;
+}
 
-    TIMER_START(query_phantomnode);
-    for (const auto& q : queries)
+void Benchmark(const std::vector<std::unique_ptr<BenchStaticRTree>>& rtrees,
+               const std::vector<FixedPointCoordinate>& queries,
+               const bool csv)
+{
+    const unsigned num_results = 5;
+    if (csv)
+    {
+        PrintCSVHeader();
+    }
+
+    const QueryFunction incremental_phantom_node = [](BenchStaticRTree& rtree, const FixedPointCoordinate& q)
+    {
+        std::vector<PhantomNode> resulting_phantom_node_vector;
+        rtree.IncrementalFindPhantomNodeForCoordinate(q, resulting_phantom_node_vector, 17, num_results);
+    };
+    PrintResult(RunQueries("IncrementalFindPhantomNodeForCoordinate", rtrees, queries, incremental_phantom_node), csv);
+
+    const QueryFunction closest_end_point = [](BenchStaticRTree& rtree, const FixedPointCoordinate& q)
+    {
+        FixedPointCoordinate result;
+        rtree.LocateClosestEndPointForCoordinate(q, result, 3);
+    };
+    PrintResult(RunQueries("LocateClosestEndPointForCoordinate", rtrees, queries, closest_end_point), csv);
+
+    const QueryFunction phantom_node = [](BenchStaticRTree& rtree, const FixedPointCoordinate& q)
     {
         PhantomNode phantom;
         rtree.FindPhantomNodeForCoordinate(q, phantom, 3);
+    };
+    PrintResult(RunQueries("FindPhantomNodeForCoordinate", rtrees, queries, phantom_node), csv);
+}
+
+// Times the leaf scan kernels against measuring every segment exactly and counts the queries
+// whose results differ from it
+void CompareKernels(BenchStaticRTree& rtree, const std::vector<FixedPointCoordinate>& queries)
+{
+    const unsigned num_queries = queries.size();
+    const unsigned num_results = 5;
+
+    std::vector<std::vector<PhantomNode>> exact_incremental_phantoms(num_queries);
+    std::vector<PhantomNode> exact_phantoms(num_queries);
+    for (const LeafScanKernel kernel : {LeafScanKernel::Exact,
+                                        LeafScanKernel::Scalar,
+                                        LeafScanKernel::SSE2,
+                                        LeafScanKernel::AVX2})
+    {
+        if (!IsLeafScanKernelSupported(kernel))
+        {
+            std::cout << "#### " << GetLeafScanKernelName(kernel) << " kernel not supported" << std::endl;
+            continue;
+        }
+        rtree.SetLeafScanKernel(kernel);
+        const bool is_exact = (LeafScanKernel::Exact == kernel);
+        unsigned mismatches = 0;
+
+        TIMER_START(query_phantom);
+        std::vector<PhantomNode> resulting_phantom_node_vector;
+        for (unsigned i = 0; i < num_queries; ++i)
+        {
+            resulting_phantom_node_vector.clear();
+            rtree.IncrementalFindPhantomNodeForCoordinate(queries[i], resulting_phantom_node_vector, 17, num_results);
+            if (is_exact)
+            {
+                exact_incremental_phantoms[i] = resulting_phantom_node_vector;
+            }
+            else if (exact_incremental_phantoms[i] != resulting_phantom_node_vector)
+            {
+                ++mismatches;
+            }
+        }
+        TIMER_STOP(query_phantom);
+
+        TIMER_START(query_phantomnode);
+        for (unsigned i = 0; i < num_queries; ++i)
+        {
+            PhantomNode phantom;
+            rtree.FindPhantomNodeForCoordinate(queries[i], phantom, 3);
+            if (is_exact)
+            {
+                exact_phantoms[i] = phantom;
+            }
+            else if (!(exact_phantoms[i] == phantom))
+            {
+                ++mismatches;
+            }
+        }
+        TIMER_STOP(query_phantomnode);
+
+        std::cout << "#### " << GetLeafScanKernelName(kernel) << " kernel" << std::endl;
+        std::cout << "IncrementalFindPhantomNodeForCoordinate: "
+                  << TIMER_MSEC(query_phantom)/((double) num_queries) << " msec/query." << std::endl;
+        std::cout << "FindPhantomNodeForCoordinate: "
+                  << TIMER_MSEC(query_phantomnode)/((double) num_queries) << " msec/query." << std::endl;
+        if (!is_exact)
+        {
+            std::cout << mismatches << " results differ from the exact scan." << std::endl;
+        }
     }
-    TIMER_STOP(query_phantomnode);
+}
 
-    std::cout << "Took " << TIMER_MSEC(query_phantomnode) << " msec for " << num_queries << " queries." << std::endl;
-    std::cout << TIMER_MSEC(query_phantomnode)/((double) num_queries) << " msec/query." << std::endl;
+// Prints how much the nodes of each level cover and overlap, to compare packings
+void PrintLevelStatistics(const BenchStaticRTree& rtree, const bool csv)
+{
+    if (csv)
+    {
+        std::cout << "level,nodes,coverage,overlap" << std::endl;
+    }
+    else
+    {
+        std::cout << "#### level statistics" << std::endl;
+    }
+    for (const auto& level_statistics : rtree.GetLevelStatistics())
+    {
+        if (csv)
+        {
+            std::cout << level_statistics.level << "," << level_statistics.number_of_nodes << ","
+                      << level_statistics.coverage << "," << level_statistics.overlap << std::endl;
+            continue;
+        }
+        std::cout << "level " << level_statistics.level << ": " << level_statistics.number_of_nodes
+                  << " nodes, coverage " << level_statistics.coverage << ", overlap "
+                  << level_statistics.overlap << std::endl;
+    }
 }
 
 int main(int argc, char** argv)
 {
-    if (argc < 4)
+    boost::filesystem::path ram_index_path, file_index_path, segment_data_path, nodes_path,
+        query_file_path;
+    std::string mode, sample, format;
+    unsigned num_queries = 0, num_threads = 0, leaf_cache_size = 0;
+    double jitter = 0.;
+
+    boost::program_options::options_description options("Options");
+    options.add_options()("help,h", "Show this help message")(
+        "mode,m",
+        boost::program_options::value<std::string>(&mode)->default_value("bench"),
+        "bench: time the queries, compare: compare the leaf scan kernels, "
+        "stats: print the coverage and overlap of each level")(
+        "sample,s",
+        boost::program_options::value<std::string>(&sample)->default_value("nodes"),
+        "Where queries are drawn from, nodes: coordinates of the data set, "
+        "world: anywhere on the globe")(
+        "jitter,j",
+        boost::program_options::value<double>(&jitter)->default_value(0.),
+        "Standard deviation in meters by which sampled nodes are moved")(
+        "query-file,f",
+        boost::program_options::value<boost::filesystem::path>(&query_file_path),
+        "Read queries from a file of lat,lon lines instead of sampling them")(
+        "segments",
+        boost::program_options::value<boost::filesystem::path>(&segment_data_path),
+        "The .segments file, next to the .fileIndex file by default")(
+        "queries,q",
+        boost::program_options::value<unsigned>(&num_queries)->default_value(10000),
+        "Number of sampled queries")(
+        "threads,t",
+        boost::program_options::value<unsigned>(&num_threads)->default_value(1),
+        "Number of threads querying at once")(
+        "leaf-cache",
+        boost::program_options::value<unsigned>(&leaf_cache_size)->default_value(0),
+        "Megabytes of r-tree leaves cached for all threads")(
+        "format",
+        boost::program_options::value<std::string>(&format)->default_value("text"),
+        "Output format, text or csv");
+
+    boost::program_options::options_description hidden_options("Hidden options");
+    hidden_options.add_options()(
+        "ramindex", boost::program_options::value<boost::filesystem::path>(&ram_index_path))(
+        "fileindex", boost::program_options::value<boost::filesystem::path>(&file_index_path))(
+        "nodes", boost::program_options::value<boost::filesystem::path>(&nodes_path));
+
+    boost::program_options::positional_options_description positional_options;
+    positional_options.add("ramindex", 1).add("fileindex", 1).add("nodes", 1);
+
+    boost::program_options::options_description cmdline_options;
+    cmdline_options.add(options).add(hidden_options);
+
+    boost::program_options::variables_map option_variables;
+    try
+    {
+        boost::program_options::store(boost::program_options::command_line_parser(argc, argv)
+                                          .options(cmdline_options)
+                                          .positional(positional_options)
+                                          .run(),
+                                      option_variables);
+        boost::program_options::notify(option_variables);
+    }
+    catch (const boost::program_options::error& e)
     {
-        std::cout << "./rtree-bench file.ramIndex file.fileIndx file.nodes" << std::endl;
+        std::cout << e.what() << std::endl;
         return 1;
     }
 
-    const char* ramPath  = argv[1];
-    const char* filePath = argv[2];
-    const char* nodesPath = argv[3];
+    if (option_variables.count("help") || !option_variables.count("nodes"))
+    {
+        std::cout << "./rtree-bench file.ramIndex file.fileIndx file.nodes [options]" << std::endl
+                  << options << std::endl;
+        return 1;
+    }
+    if ((mode != "bench" && mode != "compare" && mode != "stats") ||
+        (sample != "nodes" && sample != "world") || (format != "text" && format != "csv"))
+    {
+        std::cout << "unknown mode, sample or format" << std::endl;
+        return 1;
+    }
+    const bool csv = (format == "csv");
+    if (segment_data_path.empty())
+    {
+        segment_data_path = boost::filesystem::path(file_index_path).replace_extension(".segments");
+    }
+
+    auto coords = LoadCoordinates(nodes_path);
 
-    auto coords = LoadCoordinates(nodesPath);
+    std::vector<FixedPointCoordinate> queries;
+    if (option_variables.count("query-file"))
+    {
+        queries = LoadQueries(query_file_path);
+    }
+    else if (sample == "world" || coords->empty())
+    {
+        queries = GenerateWorldQueries(num_queries);
+    }
+    else
+    {
+        queries = GenerateNodeQueries(*coords, num_queries, jitter);
+    }
 
-    BenchStaticRTree rtree(ramPath, filePath, coords);
+    std::shared_ptr<BenchStaticRTree::LeafCache> leaf_cache;
+    if (0 < leaf_cache_size)
+    {
+        leaf_cache = std::make_shared<BenchStaticRTree::LeafCache>(
+            static_cast<std::size_t>(leaf_cache_size) << 20);
+    }
+    std::vector<std::unique_ptr<BenchStaticRTree>> rtrees;
+    for (unsigned i = 0; i < std::max(num_threads, 1u); ++i)
+    {
+        rtrees.emplace_back(new BenchStaticRTree(
+            ram_index_path, file_index_path, segment_data_path, coords, leaf_cache));
+    }
 
-    Benchmark(rtree, 10000);
+    if (mode == "compare")
+    {
+        CompareKernels(*rtrees.front(), queries);
+    }
+    else if (mode == "stats")
+    {
+        PrintLevelStatistics(*rtrees.front(), csv);
+    }
+    else
+    {
+        Benchmark(rtrees, queries, csv);
+    }
 
     return 0;
 }
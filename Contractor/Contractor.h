@@ -30,18 +30,22 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "../DataStructures/BinaryHeap.h"
 #include "../DataStructures/DeallocatingVector.h"
-#include "../DataStructures/DynamicGraph.h"
+#include "../DataStructures/CompactDynamicGraph.h"
 #include "../DataStructures/Percent.h"
 #include "../DataStructures/QueryEdge.h"
 #include "../DataStructures/Range.h"
 #include "../DataStructures/XORFastHash.h"
 #include "../DataStructures/XORFastHashStorage.h"
+#include "../Util/FingerPrint.h"
+#include "../Util/OSRMException.h"
 #include "../Util/SimpleLogger.h"
 #include "../Util/StringUtil.h"
 #include "../Util/TimingUtil.h"
 #include "../typedefs.h"
 
 #include <boost/assert.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
 
 #include <stxxl/vector>
 
@@ -49,10 +53,29 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <tbb/parallel_for.h>
 #include <tbb/parallel_sort.h>
 
+#include <cstdint>
+
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <limits>
+#include <memory>
 #include <vector>
 
+// How the priorities of the neighbours of contracted nodes are refreshed after a round.
+// Eager evaluates all of them right away. Lazy only marks them and evaluates a marked node
+// once it is about to be picked for contraction.
+enum class PriorityUpdate
+{
+    Eager,
+    Lazy
+};
+
+inline const char *GetPriorityUpdateName(const PriorityUpdate update)
+{
+    return PriorityUpdate::Eager == update ? "eager" : "lazy";
+}
+
 class Contractor
 {
 
@@ -83,6 +106,8 @@ class Contractor
         bool backward : 1;
         bool is_original_via_node_ID : 1;
     } data;
+    // together with the 32 bit target an edge takes up 16 bytes in the contraction graph
+    static_assert(sizeof(ContractorEdgeData) == 12, "ContractorEdgeData is not packed");
 
     struct ContractorHeapData
     {
@@ -92,7 +117,7 @@ class Contractor
         ContractorHeapData(short h, bool t) : hop(h), target(t) {}
     };
 
-    typedef DynamicGraph<ContractorEdgeData> ContractorGraph;
+    typedef CompactDynamicGraph<ContractorEdgeData> ContractorGraph;
     //    typedef BinaryHeap< NodeID, NodeID, int, ContractorHeapData, ArrayStorage<NodeID, NodeID>
     //    > ContractorHeap;
     typedef BinaryHeap<NodeID, NodeID, int, ContractorHeapData, XORFastHashStorage<NodeID, NodeID>>
@@ -104,6 +129,7 @@ class Contractor
         ContractorHeap heap;
         std::vector<ContractorEdge> inserted_edges;
         std::vector<NodeID> neighbours;
+        uint64_t settled_nodes = 0;
         ContractorThreadData(NodeID nodes) : heap(nodes) {}
     };
 
@@ -133,6 +159,35 @@ class Contractor
         bool is_independent : 1;
     };
 
+    // statistics of one round of Run(), degrees are taken before the round
+    struct ContractionRound
+    {
+        NodeID remaining_nodes;
+        NodeID independent_nodes;
+        uint64_t inserted_shortcuts;
+        float average_degree;
+        unsigned max_degree;
+        uint64_t contract_settled_nodes;
+        uint64_t update_settled_nodes;
+        double flush_msec;
+        double independent_msec;
+        double contract_msec;
+        double insert_msec;
+        double update_msec;
+    };
+
+    // state of Run() between two rounds as it is restored from a checkpoint
+    struct ContractionState
+    {
+        NodeID number_of_nodes;
+        NodeID number_of_contracted_nodes;
+        bool flushed_contractor;
+        std::vector<RemainingNodeData> remaining_nodes;
+        std::vector<float> node_priorities;
+        std::vector<NodePriorityData> node_data;
+        std::vector<char> is_dirty;
+    };
+
 
     struct ThreadDataContainer
     {
@@ -150,6 +205,16 @@ class Contractor
             return ref.get();
         }
 
+        inline uint64_t GetSettledNodes() const
+        {
+            uint64_t settled_nodes = 0;
+            for (const auto &thread_data : data)
+            {
+                settled_nodes += thread_data->settled_nodes;
+            }
+            return settled_nodes;
+        }
+
         int number_of_nodes;
         typedef tbb::enumerable_thread_specific<std::shared_ptr<ContractorThreadData>> EnumerableThreadData;
         EnumerableThreadData data;
@@ -284,8 +349,50 @@ class Contractor
         std::cout << "contractor finished initalization" << std::endl;
     }
 
+    // Continues a contraction from a checkpoint of a previous run on the same graph.
+    // The checksum identifies the edge-based graph the checkpoint was taken from.
+    Contractor(const boost::filesystem::path &checkpoint_path, const unsigned graph_checksum)
+    {
+        ReadCheckpoint(checkpoint_path, graph_checksum);
+    }
+
     ~Contractor() { }
 
+    // Lets Run() save its progress every interval and right after the flush.
+    void EnableCheckpoints(const boost::filesystem::path &path,
+                           const unsigned graph_checksum,
+                           const std::chrono::seconds interval)
+    {
+        checkpoint_path = path;
+        checkpoint_graph_checksum = graph_checksum;
+        checkpoint_interval = interval;
+    }
+
+    void SetPriorityUpdate(const PriorityUpdate update) { priority_update = update; }
+
+    // Writes the statistics of every round of Run() as CSV, one line per round.
+    void WriteRoundReport(const boost::filesystem::path &path) const
+    {
+        boost::filesystem::ofstream report_stream(path);
+        report_stream << "round,remaining_nodes,independent_nodes,inserted_shortcuts,"
+                         "average_degree,max_degree,contract_settled_nodes,update_settled_nodes,"
+                         "flush_msec,independent_msec,contract_msec,insert_msec,update_msec\n";
+        for (const auto i : osrm::irange<std::size_t>(0, contraction_rounds.size()))
+        {
+            const ContractionRound &round = contraction_rounds[i];
+            report_stream << i << ',' << round.remaining_nodes << ',' << round.independent_nodes
+                          << ',' << round.inserted_shortcuts << ',' << round.average_degree << ','
+                          << round.max_degree << ',' << round.contract_settled_nodes << ','
+                          << round.update_settled_nodes << ',' << round.flush_msec << ','
+                          << round.independent_msec << ',' << round.contract_msec << ','
+                          << round.insert_msec << ',' << round.update_msec << '\n';
+        }
+        if (!report_stream)
+        {
+            throw OSRMException("could not write contraction report " + path.string());
+        }
+    }
+
     void Run()
     {
         // for the preperation we can use a big grain size, which is much faster (probably cache)
@@ -299,46 +406,81 @@ class Contractor
         constexpr size_t NeighboursGrainSize  = 1;
         constexpr size_t DeleteGrainSize      = 1;
 
-        const NodeID number_of_nodes = contractor_graph->GetNumberOfNodes();
-        Percent p(number_of_nodes);
-
-        ThreadDataContainer thread_data_list(number_of_nodes);
-
+        NodeID number_of_nodes = contractor_graph->GetNumberOfNodes();
         NodeID number_of_contracted_nodes = 0;
-        std::vector<RemainingNodeData> remaining_nodes(number_of_nodes);
-        std::vector<float> node_priorities(number_of_nodes);
-        std::vector<NodePriorityData> node_data(number_of_nodes);
+        bool flushed_contractor = false;
+        std::vector<RemainingNodeData> remaining_nodes;
+        std::vector<float> node_priorities;
+        std::vector<NodePriorityData> node_data;
+        // only used with PriorityUpdate::Lazy, marks nodes with outdated priorities
+        std::vector<char> is_dirty;
 
+        ThreadDataContainer thread_data_list(contractor_graph->GetNumberOfNodes());
 
-        // initialize priorities in parallel
-        tbb::parallel_for(tbb::blocked_range<int>(0, number_of_nodes, InitGrainSize),
-            [&remaining_nodes](const tbb::blocked_range<int>& range)
-            {
-                for (int x = range.begin(); x != range.end(); ++x)
+        if (resumed_state)
+        {
+            number_of_nodes = resumed_state->number_of_nodes;
+            number_of_contracted_nodes = resumed_state->number_of_contracted_nodes;
+            flushed_contractor = resumed_state->flushed_contractor;
+            remaining_nodes.swap(resumed_state->remaining_nodes);
+            node_priorities.swap(resumed_state->node_priorities);
+            node_data.swap(resumed_state->node_data);
+            is_dirty.swap(resumed_state->is_dirty);
+            resumed_state.reset();
+
+            std::cout << "resuming with " << remaining_nodes.size() << " of " << number_of_nodes
+                      << " nodes left ..." << std::flush;
+        }
+        else
+        {
+            remaining_nodes.resize(number_of_nodes);
+            node_priorities.resize(number_of_nodes);
+            node_data.resize(number_of_nodes);
+            is_dirty.resize(number_of_nodes, false);
+
+            // initialize priorities in parallel
+            tbb::parallel_for(tbb::blocked_range<int>(0, number_of_nodes, InitGrainSize),
+                [&remaining_nodes](const tbb::blocked_range<int>& range)
                 {
-                    remaining_nodes[x].id = x;
+                    for (int x = range.begin(); x != range.end(); ++x)
+                    {
+                        remaining_nodes[x].id = x;
+                    }
                 }
-            }
-        );
+            );
 
 
-        std::cout << "initializing elimination PQ ..." << std::flush;
-        tbb::parallel_for(tbb::blocked_range<int>(0, number_of_nodes, PQGrainSize),
-            [this, &node_priorities, &node_data, &thread_data_list](const tbb::blocked_range<int>& range)
-            {
-                ContractorThreadData *data = thread_data_list.getThreadData();
-                for (int x = range.begin(); x != range.end(); ++x)
+            std::cout << "initializing elimination PQ ..." << std::flush;
+            tbb::parallel_for(tbb::blocked_range<int>(0, number_of_nodes, PQGrainSize),
+                [this, &node_priorities, &node_data, &thread_data_list](const tbb::blocked_range<int>& range)
                 {
-                    node_priorities[x] = this->EvaluateNodePriority(data, &node_data[x], x);
+                    ContractorThreadData *data = thread_data_list.getThreadData();
+                    for (int x = range.begin(); x != range.end(); ++x)
+                    {
+                        node_priorities[x] = this->EvaluateNodePriority(data, &node_data[x], x);
+                    }
                 }
-            }
-        );
-        std::cout << "ok" << std::endl << "preprocessing " << number_of_nodes << " nodes ..."
-                  << std::flush;
+            );
+            std::cout << "ok" << std::endl << "preprocessing " << number_of_nodes << " nodes ..."
+                      << std::flush;
+        }
+        Percent p(number_of_nodes);
 
-        bool flushed_contractor = false;
+        auto last_checkpoint = std::chrono::steady_clock::now();
+        bool checkpoint_due = false;
         while (number_of_nodes > 2 && number_of_contracted_nodes < number_of_nodes)
         {
+            ContractionRound round;
+            auto phase_start = std::chrono::steady_clock::now();
+            const auto finish_phase = [&phase_start]()
+            {
+                const auto phase_stop = std::chrono::steady_clock::now();
+                const double msec =
+                    std::chrono::duration<double, std::milli>(phase_stop - phase_start).count();
+                phase_start = phase_stop;
+                return msec;
+            };
+
             if (!flushed_contractor && (number_of_contracted_nodes > (number_of_nodes * 0.65)))
             {
                 DeallocatingVector<ContractorEdge> new_edge_set; // this one is not explicitely
@@ -351,6 +493,7 @@ class Contractor
 
                 // Create new priority array
                 std::vector<float> new_node_priority(remaining_nodes.size());
+                std::vector<char> new_is_dirty(remaining_nodes.size(), false);
                 // this map gives the old IDs from the new ones, necessary to get a consistent graph
                 // at the end of contraction
                 orig_node_id_to_new_id_map.resize(remaining_nodes.size());
@@ -367,6 +510,7 @@ class Contractor
                     new_node_id_from_orig_id_map[remaining_nodes[new_node_id].id] = new_node_id;
                     new_node_priority[new_node_id] =
                         node_priorities[remaining_nodes[new_node_id].id];
+                    new_is_dirty[new_node_id] = is_dirty[remaining_nodes[new_node_id].id];
                     remaining_nodes[new_node_id].id = new_node_id;
                 }
                 // walk over all nodes
@@ -411,6 +555,12 @@ class Contractor
                 // Delete old node_priorities vector
                 new_node_priority.clear();
                 new_node_priority.shrink_to_fit();
+                is_dirty.swap(new_is_dirty);
+                new_is_dirty.clear();
+                new_is_dirty.shrink_to_fit();
+                peak_graph_memory = std::max(peak_graph_memory,
+                                             contractor_graph->GetMemoryUsage() +
+                                                 new_edge_set.capacity() * sizeof(ContractorEdge));
                 // old Graph is removed
                 contractor_graph.reset();
 
@@ -422,12 +572,62 @@ class Contractor
                 new_edge_set.clear();
                 flushed_contractor = true;
 
+                // the flush is expensive, never redo it after a resume
+                checkpoint_due = true;
+
                 // INFO: MAKE SURE THIS IS THE LAST OPERATION OF THE FLUSH!
                 // reinitialize heaps and ThreadData objects with appropriate size
                 thread_data_list.number_of_nodes = contractor_graph->GetNumberOfNodes();
             }
+            round.flush_msec = finish_phase();
 
             const int last = (int)remaining_nodes.size();
+            uint64_t sum_of_degrees = 0;
+            round.max_degree = 0;
+            for (const RemainingNodeData &remaining : remaining_nodes)
+            {
+                const unsigned degree = contractor_graph->GetOutDegree(remaining.id);
+                sum_of_degrees += degree;
+                round.max_degree = std::max(round.max_degree, degree);
+            }
+            round.remaining_nodes = last;
+            round.average_degree = static_cast<float>(sum_of_degrees) / std::max(1, last);
+            round.inserted_shortcuts = number_of_inserted_shortcuts;
+            uint64_t settled_nodes = thread_data_list.GetSettledNodes();
+            round.update_settled_nodes = 0;
+
+            if (PriorityUpdate::Lazy == priority_update)
+            {
+                // refresh the outdated priorities of all nodes that could be picked now
+                tbb::parallel_for(tbb::blocked_range<int>(0, last, IndependentGrainSize),
+                    [this, &node_priorities, &remaining_nodes, &is_dirty, &thread_data_list](const tbb::blocked_range<int>& range)
+                    {
+                        ContractorThreadData *data = thread_data_list.getThreadData();
+                        for (int i = range.begin(); i != range.end(); ++i)
+                        {
+                            const NodeID node = remaining_nodes[i].id;
+                            remaining_nodes[i].is_independent =
+                                is_dirty[node] && this->IsNodeIndependent(node_priorities, data, node);
+                        }
+                    }
+                );
+                tbb::parallel_for(tbb::blocked_range<int>(0, last, IndependentGrainSize),
+                    [this, &node_priorities, &node_data, &remaining_nodes, &is_dirty, &thread_data_list](const tbb::blocked_range<int>& range)
+                    {
+                        ContractorThreadData *data = thread_data_list.getThreadData();
+                        for (int i = range.begin(); i != range.end(); ++i)
+                        {
+                            if (remaining_nodes[i].is_independent)
+                            {
+                                const NodeID node = remaining_nodes[i].id;
+                                node_priorities[node] =
+                                    this->EvaluateNodePriority(data, &node_data[node], node);
+                                is_dirty[node] = false;
+                            }
+                        }
+                    }
+                );
+            }
             tbb::parallel_for(tbb::blocked_range<int>(0, last, IndependentGrainSize),
                 [this, &node_priorities, &remaining_nodes, &thread_data_list](const tbb::blocked_range<int>& range)
                 {
@@ -447,6 +647,10 @@ class Contractor
                                                 [](RemainingNodeData node_data)
                                                 { return !node_data.is_independent; });
             const int first_independent_node = static_cast<int>(first - remaining_nodes.begin());
+            round.independent_nodes = last - first_independent_node;
+            round.independent_msec = finish_phase();
+            round.update_settled_nodes += thread_data_list.GetSettledNodes() - settled_nodes;
+            settled_nodes = thread_data_list.GetSettledNodes();
 
             // contract independent nodes
             tbb::parallel_for(tbb::blocked_range<int>(first_independent_node, last, ContractGrainSize),
@@ -481,6 +685,10 @@ class Contractor
                 }
             );
 
+            round.contract_msec = finish_phase();
+            round.contract_settled_nodes = thread_data_list.GetSettledNodes() - settled_nodes;
+            settled_nodes = thread_data_list.GetSettledNodes();
+
             // insert new edges
             for (auto& data : thread_data_list.data)
             {
@@ -501,55 +709,80 @@ class Contractor
                         }
                     }
                     contractor_graph->InsertEdge(edge.source, edge.target, edge.data);
+                    ++number_of_inserted_shortcuts;
                 }
                 data->inserted_edges.clear();
             }
 
-            tbb::parallel_for(tbb::blocked_range<int>(first_independent_node, last, NeighboursGrainSize),
-                [this, &remaining_nodes, &node_priorities, &node_data, &thread_data_list](const tbb::blocked_range<int>& range)
-                {
-                    ContractorThreadData *data = thread_data_list.getThreadData();
-                    for (int position = range.begin(); position != range.end(); ++position)
+            peak_graph_memory = std::max(peak_graph_memory, contractor_graph->GetMemoryUsage());
+            // blocks left behind by growing nodes are only partially reused, so squeeze
+            // the graph once they make up more than an eighth of its size
+            if (contractor_graph->GetNumberOfUnusedSlots() > contractor_graph->GetNumberOfEdges() / 8)
+            {
+                contractor_graph->Compact();
+                ++number_of_compactions;
+            }
+            round.inserted_shortcuts = number_of_inserted_shortcuts - round.inserted_shortcuts;
+            round.insert_msec = finish_phase();
+
+            if (PriorityUpdate::Eager == priority_update)
+            {
+                tbb::parallel_for(tbb::blocked_range<int>(first_independent_node, last, NeighboursGrainSize),
+                    [this, &remaining_nodes, &node_priorities, &node_data, &thread_data_list](const tbb::blocked_range<int>& range)
                     {
-                        NodeID x = remaining_nodes[position].id;
-                        this->UpdateNodeNeighbours(node_priorities, node_data, data, x);
+                        ContractorThreadData *data = thread_data_list.getThreadData();
+                        for (int position = range.begin(); position != range.end(); ++position)
+                        {
+                            NodeID x = remaining_nodes[position].id;
+                            this->UpdateNodeNeighbours(node_priorities, node_data, data, x);
+                        }
                     }
-                }
-            );
+                );
+            }
+            else
+            {
+                tbb::parallel_for(tbb::blocked_range<int>(first_independent_node, last, NeighboursGrainSize),
+                    [this, &remaining_nodes, &node_data, &is_dirty](const tbb::blocked_range<int>& range)
+                    {
+                        for (int position = range.begin(); position != range.end(); ++position)
+                        {
+                            NodeID x = remaining_nodes[position].id;
+                            this->MarkNodeNeighbours(node_data, is_dirty, x);
+                        }
+                    }
+                );
+            }
+
+            round.update_msec = finish_phase();
+            round.update_settled_nodes += thread_data_list.GetSettledNodes() - settled_nodes;
+            contraction_rounds.push_back(round);
 
             // remove contracted nodes from the pool
             number_of_contracted_nodes += last - first_independent_node;
             remaining_nodes.resize(first_independent_node);
             remaining_nodes.shrink_to_fit();
-            //            unsigned maxdegree = 0;
-            //            unsigned avgdegree = 0;
-            //            unsigned mindegree = UINT_MAX;
-            //            unsigned quaddegree = 0;
-            //
-            //            for(unsigned i = 0; i < remaining_nodes.size(); ++i) {
-            //                unsigned degree = contractor_graph->EndEdges(remaining_nodes[i].first)
-            //                -
-            //                contractor_graph->BeginEdges(remaining_nodes[i].first);
-            //                if(degree > maxdegree)
-            //                    maxdegree = degree;
-            //                if(degree < mindegree)
-            //                    mindegree = degree;
-            //
-            //                avgdegree += degree;
-            //                quaddegree += (degree*degree);
-            //            }
-            //
-            //            avgdegree /= std::max((unsigned)1,(unsigned)remaining_nodes.size() );
-            //            quaddegree /= std::max((unsigned)1,(unsigned)remaining_nodes.size() );
-            //
-            //            SimpleLogger().Write() << "rest: " << remaining_nodes.size() << ", max: "
-            //            << maxdegree << ", min: " << mindegree << ", avg: " << avgdegree << ",
-            //            quad: " << quaddegree;
 
+            if (!checkpoint_path.empty() &&
+                (checkpoint_due ||
+                 std::chrono::steady_clock::now() - last_checkpoint >= checkpoint_interval))
+            {
+                WriteCheckpoint(number_of_nodes, number_of_contracted_nodes, flushed_contractor,
+                                remaining_nodes, node_priorities, node_data, is_dirty);
+                last_checkpoint = std::chrono::steady_clock::now();
+                checkpoint_due = false;
+            }
             p.printStatus(number_of_contracted_nodes);
         }
 
         thread_data_list.data.clear();
+
+        SimpleLogger().Write() << "contraction graph peaked at "
+                               << peak_graph_memory / (1024 * 1024) << " MB, compacted "
+                               << number_of_compactions << " times";
+        SimpleLogger().Write() << "priority updates " << GetPriorityUpdateName(priority_update)
+                               << ": " << number_of_priority_evaluations
+                               << " node evaluations, " << number_of_inserted_shortcuts
+                               << " shortcuts inserted";
     }
 
     template <class Edge> inline void GetEdges(DeallocatingVector<Edge> &edges)
@@ -608,6 +841,135 @@ class Contractor
     }
 
   private:
+    template <typename T> static void WriteVector(std::ostream &out, const std::vector<T> &vector)
+    {
+        const uint64_t size = vector.size();
+        out.write((char *)&size, sizeof(uint64_t));
+        out.write((char *)vector.data(), sizeof(T) * size);
+    }
+
+    template <typename T> static void ReadVector(std::istream &in, std::vector<T> &vector)
+    {
+        uint64_t size = 0;
+        in.read((char *)&size, sizeof(uint64_t));
+        vector.resize(in ? size : 0);
+        in.read((char *)vector.data(), sizeof(T) * vector.size());
+    }
+
+    // Saves everything that is needed to continue after the current round. The file is
+    // written next to the old checkpoint and replaces it only once it is complete.
+    void WriteCheckpoint(const NodeID number_of_nodes,
+                         const NodeID number_of_contracted_nodes,
+                         const bool flushed_contractor,
+                         const std::vector<RemainingNodeData> &remaining_nodes,
+                         const std::vector<float> &node_priorities,
+                         const std::vector<NodePriorityData> &node_data,
+                         const std::vector<char> &is_dirty)
+    {
+        TIMER_START(checkpoint);
+        const boost::filesystem::path temporary_path = checkpoint_path.string() + ".tmp";
+        {
+            boost::filesystem::ofstream checkpoint_stream(temporary_path, std::ios::binary);
+            const FingerPrint fingerprint;
+            checkpoint_stream.write((char *)&fingerprint, sizeof(FingerPrint));
+            checkpoint_stream.write((char *)&checkpoint_graph_checksum, sizeof(unsigned));
+            checkpoint_stream.write((char *)&number_of_nodes, sizeof(NodeID));
+            checkpoint_stream.write((char *)&number_of_contracted_nodes, sizeof(NodeID));
+            checkpoint_stream.write((char *)&flushed_contractor, sizeof(bool));
+
+            WriteVector(checkpoint_stream, remaining_nodes);
+            WriteVector(checkpoint_stream, node_priorities);
+            WriteVector(checkpoint_stream, node_data);
+            WriteVector(checkpoint_stream, is_dirty);
+            WriteVector(checkpoint_stream, contraction_rounds);
+            WriteVector(checkpoint_stream, orig_node_id_to_new_id_map);
+            checkpoint_stream << fast_hash;
+            checkpoint_stream << *contractor_graph;
+
+            const uint64_t number_of_external_edges = external_edge_list.size();
+            checkpoint_stream.write((char *)&number_of_external_edges, sizeof(uint64_t));
+            std::vector<QueryEdge> buffer;
+            buffer.reserve(1 << 16);
+            for (const QueryEdge &edge : external_edge_list)
+            {
+                buffer.push_back(edge);
+                if (buffer.size() == buffer.capacity())
+                {
+                    checkpoint_stream.write((char *)buffer.data(), sizeof(QueryEdge) * buffer.size());
+                    buffer.clear();
+                }
+            }
+            checkpoint_stream.write((char *)buffer.data(), sizeof(QueryEdge) * buffer.size());
+
+            if (!checkpoint_stream)
+            {
+                throw OSRMException("could not write checkpoint " + temporary_path.string());
+            }
+        }
+        boost::filesystem::rename(temporary_path, checkpoint_path);
+        TIMER_STOP(checkpoint);
+        std::cout << " [checkpoint " << TIMER_SEC(checkpoint) << "s] " << std::flush;
+    }
+
+    void ReadCheckpoint(const boost::filesystem::path &path, const unsigned graph_checksum)
+    {
+        boost::filesystem::ifstream checkpoint_stream(path, std::ios::binary);
+        if (!checkpoint_stream)
+        {
+            throw OSRMException("could not open checkpoint " + path.string());
+        }
+
+        const FingerPrint fingerprint_orig;
+        FingerPrint fingerprint_loaded;
+        checkpoint_stream.read((char *)&fingerprint_loaded, sizeof(FingerPrint));
+        if (!fingerprint_loaded.TestPrepare(fingerprint_orig))
+        {
+            throw OSRMException("checkpoint " + path.string() + " was written by another version");
+        }
+        unsigned checksum_loaded = 0;
+        checkpoint_stream.read((char *)&checksum_loaded, sizeof(unsigned));
+        if (checksum_loaded != graph_checksum)
+        {
+            throw OSRMException("checkpoint " + path.string() + " belongs to a different graph");
+        }
+
+        resumed_state = std::unique_ptr<ContractionState>(new ContractionState());
+        checkpoint_stream.read((char *)&resumed_state->number_of_nodes, sizeof(NodeID));
+        checkpoint_stream.read((char *)&resumed_state->number_of_contracted_nodes, sizeof(NodeID));
+        checkpoint_stream.read((char *)&resumed_state->flushed_contractor, sizeof(bool));
+
+        ReadVector(checkpoint_stream, resumed_state->remaining_nodes);
+        ReadVector(checkpoint_stream, resumed_state->node_priorities);
+        ReadVector(checkpoint_stream, resumed_state->node_data);
+        ReadVector(checkpoint_stream, resumed_state->is_dirty);
+        ReadVector(checkpoint_stream, contraction_rounds);
+        ReadVector(checkpoint_stream, orig_node_id_to_new_id_map);
+        checkpoint_stream >> fast_hash;
+        contractor_graph = std::make_shared<ContractorGraph>(0);
+        checkpoint_stream >> *contractor_graph;
+
+        uint64_t number_of_external_edges = 0;
+        checkpoint_stream.read((char *)&number_of_external_edges, sizeof(uint64_t));
+        external_edge_list.clear();
+        std::vector<QueryEdge> buffer(1 << 16);
+        for (uint64_t first = 0; first < number_of_external_edges && checkpoint_stream;
+             first += buffer.size())
+        {
+            const uint64_t count =
+                std::min<uint64_t>(buffer.size(), number_of_external_edges - first);
+            checkpoint_stream.read((char *)buffer.data(), sizeof(QueryEdge) * count);
+            for (const auto i : osrm::irange<uint64_t>(0, count))
+            {
+                external_edge_list.push_back(buffer[i]);
+            }
+        }
+
+        if (!checkpoint_stream)
+        {
+            throw OSRMException("checkpoint " + path.string() + " is truncated");
+        }
+    }
+
     inline void Dijkstra(const int max_distance,
                          const unsigned number_of_targets,
                          const int maxNodes,
@@ -624,6 +986,7 @@ class Contractor
             const NodeID node = heap.DeleteMin();
             const int distance = heap.GetKey(node);
             const short current_hop = heap.GetData(node).hop + 1;
+            ++data->settled_nodes;
 
             if (++nodes > maxNodes)
             {
@@ -679,6 +1042,7 @@ class Contractor
                                       const NodeID node)
     {
         ContractionStats stats;
+        ++number_of_priority_evaluations;
 
         // perform simulated contraction
         ContractNode<true>(data, node, &stats);
@@ -885,6 +1249,25 @@ class Contractor
         return true;
     }
 
+    // raises the depth of all neighbours of a contracted node and marks their priorities
+    // as outdated. Independent nodes are more than two hops apart, so no two of them share
+    // a neighbour.
+    inline void MarkNodeNeighbours(std::vector<NodePriorityData> &node_data,
+                                   std::vector<char> &is_dirty,
+                                   const NodeID node)
+    {
+        for (auto e : contractor_graph->GetAdjacentEdgeRange(node))
+        {
+            const NodeID u = contractor_graph->GetTarget(e);
+            if (u == node)
+            {
+                continue;
+            }
+            is_dirty[u] = true;
+            node_data[u].depth = (std::max)(node_data[node].depth + 1, node_data[u].depth);
+        }
+    }
+
     inline bool IsNodeIndependent(
         const std::vector<float> &priorities,
         ContractorThreadData *const data,
@@ -968,7 +1351,19 @@ class Contractor
     std::vector<ContractorGraph::InputEdge> contracted_edge_list;
     stxxl::vector<QueryEdge> external_edge_list;
     std::vector<NodeID> orig_node_id_to_new_id_map;
+    std::size_t peak_graph_memory = 0;
+    unsigned number_of_compactions = 0;
     XORFastHash fast_hash;
+
+    boost::filesystem::path checkpoint_path;
+    unsigned checkpoint_graph_checksum = 0;
+    std::chrono::seconds checkpoint_interval = std::chrono::seconds(0);
+    std::unique_ptr<ContractionState> resumed_state;
+
+    PriorityUpdate priority_update = PriorityUpdate::Eager;
+    std::atomic<uint64_t> number_of_priority_evaluations{0};
+    uint64_t number_of_inserted_shortcuts = 0;
+    std::vector<ContractionRound> contraction_rounds;
 };
 
 #endif // CONTRACTOR_H
@@ -0,0 +1,228 @@
+/*
+
+Copyright (c) 2014, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#ifndef HUB_LABEL_BUILDER_H
+#define HUB_LABEL_BUILDER_H
+
+#include "NodeLevels.h"
+
+#include "../DataStructures/HubLabels.h"
+#include "../DataStructures/Range.h"
+#include "../Util/OSRMException.h"
+#include "../Util/SimpleLogger.h"
+#include "../Util/TimingUtil.h"
+#include "../typedefs.h"
+
+#include <boost/assert.hpp>
+
+#include <tbb/parallel_for.h>
+
+#include <cstdint>
+
+#include <algorithm>
+#include <ostream>
+#include <vector>
+
+/**
+ * Derives pruned hub labels from a contracted search graph.
+ *
+ * All edges of the search graph lead upwards in the contraction order, so the labels of a node
+ * follow from the labels of its upward neighbours. Nodes are processed top-down by their level,
+ * all nodes of one level are independent and labelled in parallel. An
+ * entry (h, d) is dropped when the labels already give a distance below d from the node to h.
+ */
+template <class GraphT> class HubLabelBuilder
+{
+    struct LabelEntry
+    {
+        LabelEntry(const NodeID hub, const EdgeWeight distance) : hub(hub), distance(distance) {}
+        bool operator<(const LabelEntry &other) const
+        {
+            return hub < other.hub || (hub == other.hub && distance < other.distance);
+        }
+        NodeID hub;
+        EdgeWeight distance;
+    };
+    typedef std::vector<LabelEntry> Label;
+
+  public:
+    explicit HubLabelBuilder(const GraphT &graph)
+        : graph(graph), forward_labels(graph.GetNumberOfNodes()),
+          backward_labels(graph.GetNumberOfNodes())
+    {
+    }
+
+    void Run()
+    {
+        TIMER_START(labelling);
+        const std::vector<std::vector<NodeID>> levels = ComputeNodeLevels(graph);
+        for (const std::vector<NodeID> &level : levels)
+        {
+            tbb::parallel_for(tbb::blocked_range<std::size_t>(0, level.size()),
+                              [this, &level](const tbb::blocked_range<std::size_t> &range)
+                              {
+                Label candidates;
+                for (std::size_t i = range.begin(); i != range.end(); ++i)
+                {
+                    BuildLabel<true>(level[i], candidates);
+                    BuildLabel<false>(level[i], candidates);
+                }
+            });
+        }
+        TIMER_STOP(labelling);
+
+        const uint64_t number_of_entries = GetNumberOfEntries();
+        SimpleLogger().Write() << "hub labels of " << levels.size() << " levels took "
+                               << TIMER_SEC(labelling) << " sec, "
+                               << (number_of_entries /
+                                   std::max(1., 2. * graph.GetNumberOfNodes()))
+                               << " entries per label";
+    }
+
+    uint64_t GetNumberOfEntries() const
+    {
+        uint64_t number_of_entries = 0;
+        for (const auto node : osrm::irange(0u, graph.GetNumberOfNodes()))
+        {
+            number_of_entries += forward_labels[node].size() + backward_labels[node].size();
+        }
+        return number_of_entries;
+    }
+
+    void Write(std::ostream &out, const unsigned check_sum) const
+    {
+        HubLabelFileHeader header;
+        header.check_sum = check_sum;
+        header.number_of_nodes = graph.GetNumberOfNodes();
+        header.number_of_entries = GetNumberOfEntries();
+        out.write((char *)&header, sizeof(HubLabelFileHeader));
+        for (const auto node : osrm::irange(0u, graph.GetNumberOfNodes()))
+        {
+            WriteLabel(out, forward_labels[node]);
+            WriteLabel(out, backward_labels[node]);
+        }
+    }
+
+    // Distance of a forward and a backward label, used for pruning and testing
+    static EdgeWeight Intersect(const Label &forward_label, const Label &backward_label)
+    {
+        EdgeWeight result = INVALID_EDGE_WEIGHT;
+        auto forward_iter = forward_label.begin();
+        auto backward_iter = backward_label.begin();
+        while (forward_iter != forward_label.end() && backward_iter != backward_label.end())
+        {
+            if (forward_iter->hub < backward_iter->hub)
+            {
+                ++forward_iter;
+            }
+            else if (backward_iter->hub < forward_iter->hub)
+            {
+                ++backward_iter;
+            }
+            else
+            {
+                result = std::min(result, forward_iter->distance + backward_iter->distance);
+                ++forward_iter;
+                ++backward_iter;
+            }
+        }
+        return result;
+    }
+
+    EdgeWeight GetDistance(const NodeID source, const NodeID target) const
+    {
+        return Intersect(forward_labels[source], backward_labels[target]);
+    }
+
+  private:
+    template <bool forward_direction> void BuildLabel(const NodeID node, Label &candidates)
+    {
+        candidates.clear();
+        candidates.emplace_back(node, 0);
+        for (const auto edge : graph.GetAdjacentEdgeRange(node))
+        {
+            const auto &data = graph.GetEdgeData(edge);
+            if (forward_direction ? data.forward : data.backward)
+            {
+                const Label &upward_label = forward_direction
+                                                ? forward_labels[graph.GetTarget(edge)]
+                                                : backward_labels[graph.GetTarget(edge)];
+                for (const LabelEntry &entry : upward_label)
+                {
+                    candidates.emplace_back(entry.hub, entry.distance + data.distance);
+                }
+            }
+        }
+        // keep the shortest distance of every hub
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(),
+                                     candidates.end(),
+                                     [](const LabelEntry &left, const LabelEntry &right)
+                                     {
+                             return left.hub == right.hub;
+                         }),
+                         candidates.end());
+
+        Label &label = forward_direction ? forward_labels[node] : backward_labels[node];
+        label.clear();
+        for (const LabelEntry &entry : candidates)
+        {
+            if (entry.hub == node)
+            {
+                label.push_back(entry);
+                continue;
+            }
+            // hubs lie on lower levels, their labels are final already
+            const EdgeWeight shortest_distance =
+                forward_direction ? Intersect(candidates, backward_labels[entry.hub])
+                                  : Intersect(forward_labels[entry.hub], candidates);
+            if (entry.distance <= shortest_distance)
+            {
+                label.push_back(entry);
+            }
+        }
+        label.shrink_to_fit();
+    }
+
+    static void WriteLabel(std::ostream &out, const Label &label)
+    {
+        WriteVarInt(out, label.size());
+        NodeID previous_hub = 0;
+        for (const LabelEntry &entry : label)
+        {
+            BOOST_ASSERT(entry.distance >= 0);
+            WriteVarInt(out, entry.hub - previous_hub);
+            WriteVarInt(out, entry.distance);
+            previous_hub = entry.hub;
+        }
+    }
+
+    const GraphT &graph;
+    std::vector<Label> forward_labels;
+    std::vector<Label> backward_labels;
+};
+
+#endif // HUB_LABEL_BUILDER_H
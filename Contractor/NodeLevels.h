@@ -0,0 +1,99 @@
+/*
+
+Copyright (c) 2014, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#ifndef NODE_LEVELS_H
+#define NODE_LEVELS_H
+
+#include "../DataStructures/Range.h"
+#include "../Util/OSRMException.h"
+#include "../typedefs.h"
+
+#include <numeric>
+#include <vector>
+
+// Groups the nodes of a contracted search graph by the length of the longest upward path
+// starting at them. Level 0 holds the nodes without upward edges, the upward neighbours of a
+// node are on lower levels. Concatenated, the levels order the nodes top-down.
+template <class GraphT> std::vector<std::vector<NodeID>> ComputeNodeLevels(const GraphT &graph)
+{
+    const unsigned number_of_nodes = graph.GetNumberOfNodes();
+    std::vector<unsigned> remaining_upward_edges(number_of_nodes, 0);
+    std::vector<unsigned> downward_offsets(number_of_nodes + 1, 0);
+    for (const auto node : osrm::irange(0u, number_of_nodes))
+    {
+        remaining_upward_edges[node] = graph.GetOutDegree(node);
+        for (const auto edge : graph.GetAdjacentEdgeRange(node))
+        {
+            ++downward_offsets[graph.GetTarget(edge) + 1];
+        }
+    }
+    std::partial_sum(downward_offsets.begin(), downward_offsets.end(), downward_offsets.begin());
+    std::vector<NodeID> downward_neighbours(downward_offsets.back());
+    std::vector<unsigned> insert_position(downward_offsets.begin(), downward_offsets.end() - 1);
+    for (const auto node : osrm::irange(0u, number_of_nodes))
+    {
+        for (const auto edge : graph.GetAdjacentEdgeRange(node))
+        {
+            downward_neighbours[insert_position[graph.GetTarget(edge)]++] = node;
+        }
+    }
+
+    std::vector<std::vector<NodeID>> levels(1);
+    for (const auto node : osrm::irange(0u, number_of_nodes))
+    {
+        if (0 == remaining_upward_edges[node])
+        {
+            levels[0].push_back(node);
+        }
+    }
+    unsigned number_of_levelled_nodes = 0;
+    while (!levels.back().empty())
+    {
+        number_of_levelled_nodes += levels.back().size();
+        std::vector<NodeID> next_level;
+        for (const NodeID node : levels.back())
+        {
+            for (const auto i : osrm::irange(downward_offsets[node], downward_offsets[node + 1]))
+            {
+                const NodeID lower_node = downward_neighbours[i];
+                if (0 == --remaining_upward_edges[lower_node])
+                {
+                    next_level.push_back(lower_node);
+                }
+            }
+        }
+        levels.emplace_back(std::move(next_level));
+    }
+    levels.pop_back();
+
+    if (number_of_levelled_nodes != number_of_nodes)
+    {
+        throw OSRMException("search graph is not contracted, its nodes have no levels");
+    }
+    return levels;
+}
+
+#endif // NODE_LEVELS_H
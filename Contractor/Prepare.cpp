@@ -28,6 +28,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Prepare.h"
 
 #include "Contractor.h"
+#include "HubLabelBuilder.h"
+#include "NodeLevels.h"
 
 #include "../Algorithms/IteratorBasedCRC32.h"
 #include "../DataStructures/BinaryHeap.h"
@@ -38,6 +40,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "../Util/GitDescription.h"
 #include "../Util/LuaUtil.h"
+#include "../Util/MachineInfo.h"
 #include "../Util/OSRMException.h"
 #include "../Util/SimpleLogger.h"
 #include "../Util/StringUtil.h"
@@ -45,9 +48,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../typedefs.h"
 
 #include <boost/filesystem/fstream.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 #include <boost/program_options.hpp>
 
 #include <tbb/task_scheduler_init.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
 #include <tbb/parallel_sort.h>
 
 #include <chrono>
@@ -56,7 +63,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <thread>
 #include <vector>
 
-Prepare::Prepare() : requested_num_threads(1) {}
+Prepare::Prepare()
+    : requested_num_threads(1), build_hub_labels(false), checkpoint_interval(0),
+      resume_contraction(false), write_contraction_report(false),
+      keep_edge_based(false), from_edge_based(false)
+{
+}
 
 Prepare::~Prepare() {}
 
@@ -76,7 +88,7 @@ int Prepare::Process(int argc, char *argv[])
         return 1;
     }
 
-    if (!boost::filesystem::is_regular_file(profile_path))
+    if (!from_edge_based && !boost::filesystem::is_regular_file(profile_path))
     {
         SimpleLogger().Write(logWARNING) << "Profile " << profile_path.string() << " not found!";
         return 1;
@@ -106,9 +118,6 @@ int Prepare::Process(int argc, char *argv[])
     LogPolicy::GetInstance().Unmute();
 
     FingerPrint fingerprint_orig;
-    CheckRestrictionsFile(fingerprint_orig);
-
-    boost::filesystem::ifstream input_stream(input_path, std::ios::in | std::ios::binary);
 
     node_filename = input_path.string() + ".nodes";
     edge_out = input_path.string() + ".edges";
@@ -116,83 +125,171 @@ int Prepare::Process(int argc, char *argv[])
     graph_out = input_path.string() + ".hsgr";
     rtree_nodes_path = input_path.string() + ".ramIndex";
     rtree_leafs_path = input_path.string() + ".fileIndex";
+    rtree_segments_path = input_path.string() + ".segments";
+    levels_path = input_path.string() + ".levels";
+    hub_labels_path = input_path.string() + ".hl";
+    checkpoint_path = input_path.string() + ".checkpoint";
+    contraction_report_path = input_path.string() + ".contraction.csv";
+    edge_based_graph_path = input_path.string() + ".ebg";
+
+    NodeID number_of_node_based_nodes = 0;
+    unsigned number_of_edge_based_nodes = 0;
+    unsigned node_based_edge_list_CRC32 = 0;
+    DeallocatingVector<EdgeBasedEdge> edge_based_edge_list;
+
+    if (from_edge_based)
+    {
+        if (!boost::filesystem::is_regular_file(edge_based_graph_path))
+        {
+            SimpleLogger().Write(logWARNING) << "Edge-based graph " << edge_based_graph_path
+                                             << " not found, run with --keep-edge-based first!";
+            return 1;
+        }
+        number_of_edge_based_nodes = ReadEdgeBasedGraph(fingerprint_orig,
+                                                        node_based_edge_list_CRC32,
+                                                        edge_based_edge_list);
+        TIMER_STOP(expansion);
+    }
+    else
+    {
+        // an edge-based graph of an earlier run would no longer match the files written below
+        if (!keep_edge_based && boost::filesystem::remove(edge_based_graph_path))
+        {
+            SimpleLogger().Write() << "removed stale edge-based graph " << edge_based_graph_path;
+        }
 
-    /*** Setup Scripting Environment ***/
-    // Create a new lua state
-    lua_State *lua_state = luaL_newstate();
+        /*** Setup Scripting Environment ***/
+        // Create a new lua state
+        lua_State *lua_state = luaL_newstate();
 
-    // Connect LuaBind to this lua state
-    luabind::open(lua_state);
+        // Connect LuaBind to this lua state
+        luabind::open(lua_state);
 
-    EdgeBasedGraphFactory::SpeedProfileProperties speed_profile;
+        EdgeBasedGraphFactory::SpeedProfileProperties speed_profile;
 
-    if (!SetupScriptingEnvironment(lua_state, speed_profile))
-    {
-        return 1;
-    }
+        if (!SetupScriptingEnvironment(lua_state, speed_profile))
+        {
+            return 1;
+        }
 
 #ifdef WIN32
 #pragma message("Memory consumption on Windows can be higher due to different bit packing")
 #else
-    static_assert(sizeof(ImportEdge) == 20,
-                  "changing ImportEdge type has influence on memory consumption!");
+        static_assert(sizeof(ImportEdge) == 20,
+                      "changing ImportEdge type has influence on memory consumption!");
 #endif
-    NodeID number_of_node_based_nodes =
-        readBinaryOSRMGraphFromStream(input_stream,
-                                      edge_list,
-                                      barrier_node_list,
-                                      traffic_light_list,
-                                      &internal_to_external_node_map,
-                                      restriction_list);
-    input_stream.close();
-
-    if (edge_list.empty())
-    {
-        SimpleLogger().Write(logWARNING) << "The input data is empty, exiting.";
-        return 1;
-    }
+        CheckRestrictionsFile(fingerprint_orig);
+
+        boost::filesystem::ifstream input_stream(input_path, std::ios::in | std::ios::binary);
+        number_of_node_based_nodes =
+            readBinaryOSRMGraphFromStream(input_stream,
+                                          edge_list,
+                                          barrier_node_list,
+                                          traffic_light_list,
+                                          &internal_to_external_node_map,
+                                          restriction_list);
+        input_stream.close();
+
+        if (edge_list.empty())
+        {
+            SimpleLogger().Write(logWARNING) << "The input data is empty, exiting.";
+            return 1;
+        }
 
-    SimpleLogger().Write() << restriction_list.size() << " restrictions, "
-                           << barrier_node_list.size() << " bollard nodes, "
-                           << traffic_light_list.size() << " traffic lights";
+        SimpleLogger().Write() << restriction_list.size() << " restrictions, "
+                               << barrier_node_list.size() << " bollard nodes, "
+                               << traffic_light_list.size() << " traffic lights";
 
-    std::vector<EdgeBasedNode> node_based_edge_list;
-    unsigned number_of_edge_based_nodes = 0;
-    DeallocatingVector<EdgeBasedEdge> edge_based_edge_list;
+        std::vector<EdgeBasedNode> node_based_edge_list;
 
-    // init node_based_edge_list, edge_based_edge_list by edgeList
-    number_of_edge_based_nodes = BuildEdgeExpandedGraph(lua_state,
-                                                        number_of_node_based_nodes,
-                                                        node_based_edge_list,
-                                                        edge_based_edge_list,
-                                                        speed_profile);
-    lua_close(lua_state);
+        // init node_based_edge_list, edge_based_edge_list by edgeList
+        number_of_edge_based_nodes = BuildEdgeExpandedGraph(lua_state,
+                                                            number_of_node_based_nodes,
+                                                            node_based_edge_list,
+                                                            edge_based_edge_list,
+                                                            speed_profile);
+        lua_close(lua_state);
 
-    TIMER_STOP(expansion);
+        TIMER_STOP(expansion);
 
-    BuildRTree(node_based_edge_list);
+        BuildRTree(node_based_edge_list);
 
-    IteratorbasedCRC32<std::vector<EdgeBasedNode>> crc32;
-    const unsigned node_based_edge_list_CRC32 =
-        crc32(node_based_edge_list.begin(), node_based_edge_list.end());
-    node_based_edge_list.clear();
-    node_based_edge_list.shrink_to_fit();
-    SimpleLogger().Write() << "CRC32: " << node_based_edge_list_CRC32;
+        IteratorbasedCRC32<std::vector<EdgeBasedNode>> crc32;
+        node_based_edge_list_CRC32 =
+            crc32(node_based_edge_list.begin(), node_based_edge_list.end());
+        node_based_edge_list.clear();
+        node_based_edge_list.shrink_to_fit();
+        SimpleLogger().Write() << "CRC32: " << node_based_edge_list_CRC32;
 
-    WriteNodeMapping();
+        WriteNodeMapping();
+        if (keep_edge_based)
+        {
+            WriteEdgeBasedGraph(fingerprint_orig,
+                                node_based_edge_list_CRC32,
+                                number_of_edge_based_nodes,
+                                edge_based_edge_list);
+        }
+    }
 
     /***
      * Contracting the edge-expanded graph
      */
 
-    SimpleLogger().Write() << "initializing contractor";
-    Contractor *contractor = new Contractor(number_of_edge_based_nodes, edge_based_edge_list);
+    // a checkpoint may only be resumed on exactly the same edge-expanded graph
+    const bool use_checkpoints = checkpoint_interval > 0 || resume_contraction;
+    std::size_t edge_based_graph_checksum = node_based_edge_list_CRC32;
+    if (use_checkpoints)
+    {
+        boost::hash_combine(edge_based_graph_checksum, number_of_edge_based_nodes);
+        for (const EdgeBasedEdge &edge : edge_based_edge_list)
+        {
+            boost::hash_combine(edge_based_graph_checksum, edge.source);
+            boost::hash_combine(edge_based_graph_checksum, edge.target);
+            boost::hash_combine(edge_based_graph_checksum, edge.edge_id);
+            boost::hash_combine(edge_based_graph_checksum, static_cast<int>(edge.weight));
+            boost::hash_combine(edge_based_graph_checksum, 2 * edge.forward + edge.backward);
+        }
+    }
+
+    Contractor *contractor = nullptr;
+    if (resume_contraction && boost::filesystem::exists(checkpoint_path))
+    {
+        SimpleLogger().Write() << "resuming contraction from " << checkpoint_path;
+        contractor = new Contractor(checkpoint_path,
+                                    static_cast<unsigned>(edge_based_graph_checksum));
+        edge_based_edge_list.clear();
+    }
+    else
+    {
+        if (resume_contraction)
+        {
+            SimpleLogger().Write(logWARNING) << "no checkpoint at " << checkpoint_path
+                                             << ", contracting from scratch";
+        }
+        SimpleLogger().Write() << "initializing contractor";
+        contractor = new Contractor(number_of_edge_based_nodes, edge_based_edge_list);
+    }
+    if (priority_update == GetPriorityUpdateName(PriorityUpdate::Lazy))
+    {
+        contractor->SetPriorityUpdate(PriorityUpdate::Lazy);
+    }
+    if (checkpoint_interval > 0)
+    {
+        contractor->EnableCheckpoints(checkpoint_path,
+                                      static_cast<unsigned>(edge_based_graph_checksum),
+                                      std::chrono::minutes(checkpoint_interval));
+    }
 
     TIMER_START(contraction);
     contractor->Run();
     TIMER_STOP(contraction);
 
     SimpleLogger().Write() << "Contraction took " << TIMER_SEC(contraction) << " sec";
+    if (write_contraction_report)
+    {
+        contractor->WriteRoundReport(contraction_report_path);
+        SimpleLogger().Write() << "wrote contraction report to " << contraction_report_path;
+    }
 
     DeallocatingVector<QueryEdge> contracted_edge_list;
     contractor->GetEdges(contracted_edge_list);
@@ -204,118 +301,41 @@ int Prepare::Process(int argc, char *argv[])
 
     tbb::parallel_sort(contracted_edge_list.begin(), contracted_edge_list.end());
     const unsigned contracted_edge_count = contracted_edge_list.size();
-    SimpleLogger().Write() << "Serializing compacted graph of " << contracted_edge_count
-                           << " edges";
-
-    boost::filesystem::ofstream hsgr_output_stream(graph_out, std::ios::binary);
-    hsgr_output_stream.write((char *)&fingerprint_orig, sizeof(FingerPrint));
-    const unsigned max_used_node_id = 1 + [&contracted_edge_list]
+    if (!WriteContractedGraph(fingerprint_orig,
+                              node_based_edge_list_CRC32,
+                              number_of_edge_based_nodes,
+                              contracted_edge_list))
     {
-        unsigned tmp_max = 0;
-        for (const QueryEdge &edge : contracted_edge_list)
-        {
-            BOOST_ASSERT(SPECIAL_NODEID != edge.source);
-            BOOST_ASSERT(SPECIAL_NODEID != edge.target);
-            tmp_max = std::max(tmp_max, edge.source);
-            tmp_max = std::max(tmp_max, edge.target);
-        }
-        return tmp_max;
-    }();
-
-    SimpleLogger().Write(logDEBUG) << "input graph has " << number_of_edge_based_nodes << " nodes";
-    SimpleLogger().Write(logDEBUG) << "contracted graph has " << max_used_node_id << " nodes";
-
-    std::vector<StaticGraph<EdgeData>::NodeArrayEntry> node_array;
-    node_array.resize(number_of_edge_based_nodes + 1);
-
-    SimpleLogger().Write() << "Building node array";
-    StaticGraph<EdgeData>::EdgeIterator edge = 0;
-    StaticGraph<EdgeData>::EdgeIterator position = 0;
-    StaticGraph<EdgeData>::EdgeIterator last_edge = edge;
-
-    // initializing 'first_edge'-field of nodes:
-    for (const auto node : osrm::irange(0u, max_used_node_id))
-    {
-        last_edge = edge;
-        while ((edge < contracted_edge_count) && (contracted_edge_list[edge].source == node))
-        {
-            ++edge;
-        }
-        node_array[node].first_edge = position; //=edge
-        position += edge - last_edge;           // remove
-    }
-
-    for (const auto sentinel_counter : osrm::irange<unsigned>(max_used_node_id, node_array.size()))
-    {
-        // sentinel element, guarded against underflow
-        node_array[sentinel_counter].first_edge = contracted_edge_count;
+        return 1;
     }
+    contracted_edge_list.clear();
 
-    SimpleLogger().Write() << "Serializing node array";
-
-    const unsigned node_array_size = node_array.size();
-    // serialize crc32, aka checksum
-    hsgr_output_stream.write((char *)&node_based_edge_list_CRC32, sizeof(unsigned));
-    // serialize number of nodes
-    hsgr_output_stream.write((char *)&node_array_size, sizeof(unsigned));
-    // serialize number of edges
-    hsgr_output_stream.write((char *)&contracted_edge_count, sizeof(unsigned));
-    // serialize all nodes
-    if (node_array_size > 0)
+    if (use_checkpoints && boost::filesystem::exists(checkpoint_path))
     {
-        hsgr_output_stream.write((char *)&node_array[0],
-                                 sizeof(StaticGraph<EdgeData>::NodeArrayEntry) * node_array_size);
+        boost::filesystem::remove(checkpoint_path);
     }
-    // serialize all edges
 
-    SimpleLogger().Write() << "Building edge array";
-    edge = 0;
-    int number_of_used_edges = 0;
-
-    StaticGraph<EdgeData>::EdgeArrayEntry current_edge;
-    for (const auto edge : osrm::irange<std::size_t>(0, contracted_edge_list.size()))
-    {
-        // no eigen loops
-        BOOST_ASSERT(contracted_edge_list[edge].source != contracted_edge_list[edge].target);
-        current_edge.target = contracted_edge_list[edge].target;
-        current_edge.data = contracted_edge_list[edge].data;
-
-        // every target needs to be valid
-        BOOST_ASSERT(current_edge.target < max_used_node_id);
-#ifndef NDEBUG
-        if (current_edge.data.distance <= 0)
-        {
-            SimpleLogger().Write(logWARNING) << "Edge: " << edge
-                                             << ",source: " << contracted_edge_list[edge].source
-                                             << ", target: " << contracted_edge_list[edge].target
-                                             << ", dist: " << current_edge.data.distance;
-
-            SimpleLogger().Write(logWARNING) << "Failed at adjacency list of node "
-                                             << contracted_edge_list[edge].source << "/"
-                                             << node_array.size() - 1;
-            return 1;
-        }
-#endif
-        hsgr_output_stream.write((char *)&current_edge,
-                                 sizeof(StaticGraph<EdgeData>::EdgeArrayEntry));
-
-        ++number_of_used_edges;
-    }
-    hsgr_output_stream.close();
+    BuildNodeLevelsAndHubLabels();
 
     TIMER_STOP(preparing);
 
     SimpleLogger().Write() << "Preprocessing : " << TIMER_SEC(preparing) << " seconds";
-    SimpleLogger().Write() << "Expansion  : " << (number_of_node_based_nodes / TIMER_SEC(expansion))
-                           << " nodes/sec and "
-                           << (number_of_edge_based_nodes / TIMER_SEC(expansion)) << " edges/sec";
+    if (!from_edge_based)
+    {
+        SimpleLogger().Write() << "Expansion  : "
+                               << (number_of_node_based_nodes / TIMER_SEC(expansion))
+                               << " nodes/sec and "
+                               << (number_of_edge_based_nodes / TIMER_SEC(expansion))
+                               << " edges/sec";
+    }
 
     SimpleLogger().Write() << "Contraction: "
                            << (number_of_edge_based_nodes / TIMER_SEC(contraction))
-                           << " nodes/sec and " << number_of_used_edges / TIMER_SEC(contraction)
+                           << " nodes/sec and " << contracted_edge_count / TIMER_SEC(contraction)
                            << " edges/sec";
+    SimpleLogger().Write() << "Peak memory: " << GetPeakResidentMemory() / (1024 * 1024)
+                           << " MB";
 
-    node_array.clear();
     SimpleLogger().Write() << "finished preprocessing";
 
     return 0;
@@ -351,7 +371,31 @@ bool Prepare::ParseArguments(int argc, char *argv[])
         "threads,t",
         boost::program_options::value<unsigned int>(&requested_num_threads)
             ->default_value(tbb::task_scheduler_init::default_num_threads()),
-        "Number of threads to use");
+        "Number of threads to use")(
+        "hub-labels",
+        boost::program_options::bool_switch(&build_hub_labels),
+        "Derive hub labels (.hl) from the contracted graph")(
+        "rtree-packing",
+        boost::program_options::value<std::string>(&rtree_packing)->default_value("hilbert"),
+        "Packing of the r-tree: hilbert or str (Sort-Tile-Recursive)")(
+        "checkpoint-interval",
+        boost::program_options::value<unsigned>(&checkpoint_interval)->default_value(0),
+        "Save the contraction progress every n minutes to .checkpoint, 0 disables it")(
+        "resume",
+        boost::program_options::bool_switch(&resume_contraction),
+        "Continue the contraction from the last checkpoint")(
+        "priority-updates",
+        boost::program_options::value<std::string>(&priority_update)->default_value("eager"),
+        "Neighbour priorities after a round: eager or lazy (when picked)")(
+        "contraction-report",
+        boost::program_options::bool_switch(&write_contraction_report),
+        "Write statistics of every contraction round to .contraction.csv")(
+        "keep-edge-based",
+        boost::program_options::bool_switch(&keep_edge_based),
+        "Save the edge-based graph to .ebg for later runs with --from-edge-based")(
+        "from-edge-based",
+        boost::program_options::bool_switch(&from_edge_based),
+        "Contract the edge-based graph (.ebg) of an earlier run, skip the expansion");
 
     // hidden options, will be allowed both on command line and in config file, but will not be
     // shown to the user
@@ -409,6 +453,20 @@ bool Prepare::ParseArguments(int argc, char *argv[])
         return false;
     }
 
+    if (rtree_packing != GetRTreePackingName(RTreePacking::Hilbert) &&
+        rtree_packing != GetRTreePackingName(RTreePacking::SortTileRecursive))
+    {
+        SimpleLogger().Write(logWARNING) << "unknown r-tree packing " << rtree_packing;
+        return false;
+    }
+
+    if (priority_update != GetPriorityUpdateName(PriorityUpdate::Eager) &&
+        priority_update != GetPriorityUpdateName(PriorityUpdate::Lazy))
+    {
+        SimpleLogger().Write(logWARNING) << "unknown priority updates " << priority_update;
+        return false;
+    }
+
     return true;
 }
 
@@ -551,13 +609,300 @@ void Prepare::WriteNodeMapping()
 /**
     \brief Building rtree-based nearest-neighbor data structure
 
-    Saves info to files: '.ramIndex' and '.fileIndex'.
+    Saves info to files: '.ramIndex', '.fileIndex' and '.segments'.
  */
 void Prepare::BuildRTree(std::vector<EdgeBasedNode> &node_based_edge_list)
 {
     SimpleLogger().Write() << "building r-tree ...";
+    const RTreePacking packing = rtree_packing == GetRTreePackingName(RTreePacking::Hilbert)
+                                     ? RTreePacking::Hilbert
+                                     : RTreePacking::SortTileRecursive;
     StaticRTree<EdgeBasedNode>(node_based_edge_list,
                                rtree_nodes_path.c_str(),
                                rtree_leafs_path.c_str(),
-                               internal_to_external_node_map);
+                               rtree_segments_path.c_str(),
+                               internal_to_external_node_map,
+                               packing);
+}
+
+/**
+    \brief Saving the edge-expanded graph to '.ebg' on --keep-edge-based for later runs with
+    --from-edge-based
+
+    The header is followed by the plain edge array, so the file can be mapped into memory.
+ */
+void Prepare::WriteEdgeBasedGraph(const FingerPrint &fingerprint,
+                                  const unsigned checksum,
+                                  const unsigned number_of_edge_based_nodes,
+                                  const DeallocatingVector<EdgeBasedEdge> &edge_based_edge_list)
+{
+    SimpleLogger().Write() << "writing edge-based graph ...";
+    const boost::filesystem::path temporary_path = edge_based_graph_path + ".tmp";
+    {
+        boost::filesystem::ofstream edge_based_graph_stream(temporary_path, std::ios::binary);
+        const uint64_t number_of_edges = edge_based_edge_list.size();
+        edge_based_graph_stream.write((char *)&fingerprint, sizeof(FingerPrint));
+        edge_based_graph_stream.write((char *)&checksum, sizeof(unsigned));
+        edge_based_graph_stream.write((char *)&number_of_edge_based_nodes, sizeof(unsigned));
+        edge_based_graph_stream.write((char *)&number_of_edges, sizeof(uint64_t));
+
+        std::vector<EdgeBasedEdge> buffer;
+        buffer.reserve(1 << 16);
+        for (const auto edge : osrm::irange<uint64_t>(0, number_of_edges))
+        {
+            buffer.push_back(edge_based_edge_list[edge]);
+            if (buffer.size() == buffer.capacity())
+            {
+                edge_based_graph_stream.write((char *)buffer.data(),
+                                              sizeof(EdgeBasedEdge) * buffer.size());
+                buffer.clear();
+            }
+        }
+        edge_based_graph_stream.write((char *)buffer.data(), sizeof(EdgeBasedEdge) * buffer.size());
+        if (!edge_based_graph_stream)
+        {
+            throw OSRMException("could not write " + temporary_path.string());
+        }
+    }
+    // a run that is interrupted while writing must not leave a truncated graph behind
+    boost::filesystem::rename(temporary_path, edge_based_graph_path);
+}
+
+/**
+    \brief Loading the edge-expanded graph saved by a previous run from '.ebg'
+
+    Returns the number of edge-based nodes and sets the checksum of the node-based edges.
+ */
+unsigned Prepare::ReadEdgeBasedGraph(const FingerPrint &fingerprint_orig,
+                                     unsigned &checksum,
+                                     DeallocatingVector<EdgeBasedEdge> &edge_based_edge_list)
+{
+    SimpleLogger().Write() << "loading edge-based graph from " << edge_based_graph_path;
+    const boost::iostreams::mapped_file_source edge_based_graph_file(edge_based_graph_path);
+    const char *position = edge_based_graph_file.data();
+    constexpr std::size_t header_size =
+        sizeof(FingerPrint) + 2 * sizeof(unsigned) + sizeof(uint64_t);
+    if (edge_based_graph_file.size() < header_size)
+    {
+        throw OSRMException(edge_based_graph_path + " is truncated");
+    }
+
+    FingerPrint fingerprint_loaded;
+    std::copy(position, position + sizeof(FingerPrint), (char *)&fingerprint_loaded);
+    position += sizeof(FingerPrint);
+    if (!fingerprint_loaded.TestPrepare(fingerprint_orig))
+    {
+        throw OSRMException(edge_based_graph_path + " was written by another version");
+    }
+    unsigned number_of_edge_based_nodes = 0;
+    uint64_t number_of_edges = 0;
+    std::copy(position, position + sizeof(unsigned), (char *)&checksum);
+    position += sizeof(unsigned);
+    std::copy(position, position + sizeof(unsigned), (char *)&number_of_edge_based_nodes);
+    position += sizeof(unsigned);
+    std::copy(position, position + sizeof(uint64_t), (char *)&number_of_edges);
+    position += sizeof(uint64_t);
+    if (edge_based_graph_file.size() != header_size + number_of_edges * sizeof(EdgeBasedEdge))
+    {
+        throw OSRMException(edge_based_graph_path + " is truncated");
+    }
+
+    const EdgeBasedEdge *first_edge = reinterpret_cast<const EdgeBasedEdge *>(position);
+    edge_based_edge_list.append(first_edge, first_edge + number_of_edges);
+    SimpleLogger().Write() << "CRC32: " << checksum;
+    return number_of_edge_based_nodes;
+}
+
+/**
+    \brief Writing the contracted graph to '.hsgr' in the layout of StaticGraph
+
+    The edges have to be sorted by source. Node and edge array are built in parallel and the
+    edge array is written in large blocks, followed by the CRC32 of every HSGR_EDGES_PER_CHECKSUM
+    edges. Returns false if an edge is invalid (debug builds).
+ */
+bool Prepare::WriteContractedGraph(const FingerPrint &fingerprint,
+                                   const unsigned checksum,
+                                   const unsigned number_of_nodes,
+                                   const DeallocatingVector<QueryEdge> &contracted_edge_list)
+{
+    constexpr unsigned EdgeGrainSize = 4096;
+    constexpr unsigned EdgeBufferSize = 1 << 20;
+    static_assert(0 == EdgeBufferSize % HSGR_EDGES_PER_CHECKSUM,
+                  "checksum blocks must not span edge buffers");
+
+    const unsigned contracted_edge_count = contracted_edge_list.size();
+    SimpleLogger().Write() << "Serializing compacted graph of " << contracted_edge_count
+                           << " edges";
+
+    const unsigned max_used_node_id = 1 + tbb::parallel_reduce(
+        tbb::blocked_range<unsigned>(0, contracted_edge_count, EdgeGrainSize), 0u,
+        [&contracted_edge_list](const tbb::blocked_range<unsigned> &range, unsigned tmp_max)
+        {
+            for (const auto edge : osrm::irange(range.begin(), range.end()))
+            {
+                BOOST_ASSERT(SPECIAL_NODEID != contracted_edge_list[edge].source);
+                BOOST_ASSERT(SPECIAL_NODEID != contracted_edge_list[edge].target);
+                tmp_max = std::max(tmp_max, contracted_edge_list[edge].source);
+                tmp_max = std::max(tmp_max, contracted_edge_list[edge].target);
+            }
+            return tmp_max;
+        },
+        [](const unsigned first_max, const unsigned second_max)
+        { return std::max(first_max, second_max); });
+
+    SimpleLogger().Write(logDEBUG) << "input graph has " << number_of_nodes << " nodes";
+    SimpleLogger().Write(logDEBUG) << "contracted graph has " << max_used_node_id << " nodes";
+
+#ifndef NDEBUG
+    for (const auto edge : osrm::irange(0u, contracted_edge_count))
+    {
+        // no eigen loops
+        BOOST_ASSERT(contracted_edge_list[edge].source != contracted_edge_list[edge].target);
+        // every target needs to be valid
+        BOOST_ASSERT(contracted_edge_list[edge].target < max_used_node_id);
+        if (contracted_edge_list[edge].data.distance <= 0)
+        {
+            SimpleLogger().Write(logWARNING) << "Edge: " << edge
+                                             << ",source: " << contracted_edge_list[edge].source
+                                             << ", target: " << contracted_edge_list[edge].target
+                                             << ", dist: " << contracted_edge_list[edge].data.distance;
+
+            SimpleLogger().Write(logWARNING) << "Failed at adjacency list of node "
+                                             << contracted_edge_list[edge].source << "/"
+                                             << number_of_nodes;
+            return false;
+        }
+    }
+#endif
+
+    SimpleLogger().Write() << "Building node array";
+    std::vector<StaticGraph<EdgeData>::NodeArrayEntry> node_array(number_of_nodes + 1);
+    // An adjacency list starts wherever the source changes. This edge is also the first edge
+    // of all nodes without edges in between, which yields the prefix sum over the degrees.
+    tbb::parallel_for(tbb::blocked_range<unsigned>(0, contracted_edge_count + 1, EdgeGrainSize),
+        [&contracted_edge_list, &node_array, contracted_edge_count](const tbb::blocked_range<unsigned> &range)
+        {
+            for (const auto edge : osrm::irange(range.begin(), range.end()))
+            {
+                const unsigned first_node =
+                    (0 == edge ? 0 : contracted_edge_list[edge - 1].source + 1);
+                const unsigned last_node = (edge < contracted_edge_count
+                                                ? contracted_edge_list[edge].source + 1
+                                                : static_cast<unsigned>(node_array.size()));
+                for (const auto node : osrm::irange(first_node, last_node))
+                {
+                    node_array[node].first_edge = edge;
+                }
+            }
+        }
+    );
+
+    SimpleLogger().Write() << "Serializing node array";
+    boost::filesystem::ofstream hsgr_output_stream(graph_out, std::ios::binary);
+    hsgr_output_stream.write((char *)&fingerprint, sizeof(FingerPrint));
+    const unsigned node_array_size = node_array.size();
+    // serialize crc32, aka checksum
+    hsgr_output_stream.write((char *)&checksum, sizeof(unsigned));
+    // serialize number of nodes
+    hsgr_output_stream.write((char *)&node_array_size, sizeof(unsigned));
+    // serialize number of edges
+    hsgr_output_stream.write((char *)&contracted_edge_count, sizeof(unsigned));
+    // serialize all nodes
+    hsgr_output_stream.write((char *)node_array.data(),
+                             sizeof(StaticGraph<EdgeData>::NodeArrayEntry) * node_array_size);
+
+    // serialize all edges, block by block, each checksum is computed by the thread that fills
+    // its edges
+    SimpleLogger().Write() << "Serializing edge array";
+    std::vector<StaticGraph<EdgeData>::EdgeArrayEntry> edge_buffer(
+        std::min(contracted_edge_count, EdgeBufferSize));
+    std::vector<unsigned> block_checksums(
+        (contracted_edge_count + HSGR_EDGES_PER_CHECKSUM - 1) / HSGR_EDGES_PER_CHECKSUM);
+    for (unsigned first_edge = 0; first_edge < contracted_edge_count;
+         first_edge += edge_buffer.size())
+    {
+        const unsigned number_of_edges =
+            std::min<unsigned>(edge_buffer.size(), contracted_edge_count - first_edge);
+        const unsigned number_of_blocks =
+            (number_of_edges + HSGR_EDGES_PER_CHECKSUM - 1) / HSGR_EDGES_PER_CHECKSUM;
+        tbb::parallel_for(tbb::blocked_range<unsigned>(0, number_of_blocks),
+            [&contracted_edge_list, &edge_buffer, &block_checksums, first_edge, number_of_edges](
+                const tbb::blocked_range<unsigned> &range)
+            {
+                for (const auto block : osrm::irange(range.begin(), range.end()))
+                {
+                    const unsigned first_block_edge = block * HSGR_EDGES_PER_CHECKSUM;
+                    const unsigned last_block_edge =
+                        std::min(first_block_edge + HSGR_EDGES_PER_CHECKSUM, number_of_edges);
+                    for (const auto i : osrm::irange(first_block_edge, last_block_edge))
+                    {
+                        edge_buffer[i].target = contracted_edge_list[first_edge + i].target;
+                        edge_buffer[i].data = contracted_edge_list[first_edge + i].data;
+                    }
+                    block_checksums[first_edge / HSGR_EDGES_PER_CHECKSUM + block] =
+                        computeHSGRBlockChecksum(&edge_buffer[first_block_edge],
+                                                 last_block_edge - first_block_edge);
+                }
+            }
+        );
+        hsgr_output_stream.write((char *)edge_buffer.data(),
+                                 sizeof(StaticGraph<EdgeData>::EdgeArrayEntry) * number_of_edges);
+    }
+
+    // serialize the checksums, readers of the graph stop at the end of the edge array
+    const unsigned edges_per_checksum = HSGR_EDGES_PER_CHECKSUM;
+    const unsigned number_of_checksums = block_checksums.size();
+    hsgr_output_stream.write((char *)&edges_per_checksum, sizeof(unsigned));
+    hsgr_output_stream.write((char *)&number_of_checksums, sizeof(unsigned));
+    hsgr_output_stream.write((char *)block_checksums.data(),
+                             sizeof(unsigned) * number_of_checksums);
+    hsgr_output_stream.close();
+    if (!hsgr_output_stream)
+    {
+        throw OSRMException("could not write " + graph_out);
+    }
+    return true;
+}
+
+/**
+    \brief Ordering the nodes of the contracted graph by level, deriving hub labels on request
+
+    Reads back the '.hsgr' and saves the node order to '.levels' and the labels to '.hl'.
+ */
+void Prepare::BuildNodeLevelsAndHubLabels()
+{
+    std::vector<StaticGraph<EdgeData>::NodeArrayEntry> node_list;
+    std::vector<StaticGraph<EdgeData>::EdgeArrayEntry> edge_list;
+    unsigned check_sum = 0;
+    readHSGRFromStream(graph_out, node_list, edge_list, &check_sum);
+    const StaticGraph<EdgeData> query_graph(node_list, edge_list);
+
+    SimpleLogger().Write() << "ordering nodes by level ...";
+    const std::vector<std::vector<NodeID>> levels = ComputeNodeLevels(query_graph);
+    const unsigned number_of_nodes = query_graph.GetNumberOfNodes();
+    boost::filesystem::ofstream levels_output_stream(levels_path, std::ios::binary);
+    levels_output_stream.write((char *)&check_sum, sizeof(unsigned));
+    levels_output_stream.write((char *)&number_of_nodes, sizeof(unsigned));
+    for (const std::vector<NodeID> &level : levels)
+    {
+        if (!level.empty())
+        {
+            levels_output_stream.write((char *)&level[0], level.size() * sizeof(NodeID));
+        }
+    }
+    levels_output_stream.close();
+    SimpleLogger().Write() << "search graph has " << levels.size() << " levels";
+
+    if (!build_hub_labels)
+    {
+        return;
+    }
+
+    SimpleLogger().Write() << "building hub labels ...";
+    HubLabelBuilder<StaticGraph<EdgeData>> hub_label_builder(query_graph);
+    hub_label_builder.Run();
+
+    boost::filesystem::ofstream hub_labels_output_stream(hub_labels_path, std::ios::binary);
+    hub_label_builder.Write(hub_labels_output_stream, check_sum);
+    hub_labels_output_stream.close();
 }
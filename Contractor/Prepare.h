@@ -40,6 +40,18 @@ class Prepare
                                        EdgeBasedGraphFactory::SpeedProfileProperties &speed_profile);
     void WriteNodeMapping();
     void BuildRTree(std::vector<EdgeBasedNode> &node_based_edge_list);
+    void WriteEdgeBasedGraph(const FingerPrint &fingerprint,
+                             const unsigned checksum,
+                             const unsigned number_of_edge_based_nodes,
+                             const DeallocatingVector<EdgeBasedEdge> &edge_based_edge_list);
+    unsigned ReadEdgeBasedGraph(const FingerPrint &fingerprint_orig,
+                                unsigned &checksum,
+                                DeallocatingVector<EdgeBasedEdge> &edge_based_edge_list);
+    bool WriteContractedGraph(const FingerPrint &fingerprint,
+                              const unsigned checksum,
+                              const unsigned number_of_nodes,
+                              const DeallocatingVector<QueryEdge> &contracted_edge_list);
+    void BuildNodeLevelsAndHubLabels();
 
   private:
     std::vector<NodeInfo> internal_to_external_node_map;
@@ -49,6 +61,14 @@ class Prepare
     std::vector<ImportEdge> edge_list;
 
     unsigned requested_num_threads;
+    bool build_hub_labels;
+    std::string rtree_packing;
+    unsigned checkpoint_interval;
+    bool resume_contraction;
+    std::string priority_update;
+    bool write_contraction_report;
+    bool keep_edge_based;
+    bool from_edge_based;
     boost::filesystem::path config_file_path;
     boost::filesystem::path input_path;
     boost::filesystem::path restrictions_path;
@@ -62,6 +82,12 @@ class Prepare
     std::string graph_out;
     std::string rtree_nodes_path;
     std::string rtree_leafs_path;
+    std::string rtree_segments_path;
+    std::string levels_path;
+    std::string hub_labels_path;
+    std::string checkpoint_path;
+    std::string contraction_report_path;
+    std::string edge_based_graph_path;
 };
 
 #endif // PREPARE_H
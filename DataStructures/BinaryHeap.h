@@ -28,6 +28,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef BINARY_HEAP_H
 #define BINARY_HEAP_H
 
+#include "ReusableHashTable.h"
+
 #include <boost/assert.hpp>
 
 #include <algorithm>
@@ -88,6 +90,31 @@ template <typename NodeID, typename Key> class UnorderedMapStorage
     std::unordered_map<NodeID, Key> nodes;
 };
 
+template <typename NodeID, typename Key> class ReusableHashStorage
+{
+  public:
+    explicit ReusableHashStorage(size_t) : nodes(1000) {}
+
+    Key &operator[](const NodeID node) { return nodes[node]; }
+
+    Key const &operator[](const NodeID node) const
+    {
+        const Key *key = nodes.Find(node);
+        BOOST_ASSERT(nullptr != key);
+        return *key;
+    }
+
+    // looks node up without inserting it, nullptr if it is not present
+    const Key *Find(const NodeID node) const { return nodes.Find(node); }
+
+    void Clear() { nodes.Clear(); }
+
+    std::size_t Capacity() const { return nodes.Capacity(); }
+
+  private:
+    ReusableHashTable<NodeID, Key> nodes;
+};
+
 template <typename NodeID,
           typename Key,
           typename Weight,
@@ -115,6 +142,13 @@ class BinaryHeap
 
     std::size_t Size() const { return (heap.size() - 1); }
 
+    // bytes reserved by the heap, only available for index storages that report their capacity
+    std::size_t Capacity() const
+    {
+        return inserted_nodes.capacity() * sizeof(HeapNode) +
+               heap.capacity() * sizeof(HeapElement) + node_index.Capacity();
+    }
+
     bool Empty() const { return 0 == Size(); }
 
     void Insert(NodeID node, Weight weight, const Data &data)
@@ -148,6 +182,12 @@ class BinaryHeap
         return inserted_nodes[index].weight;
     }
 
+    Weight const &GetKey(NodeID node) const
+    {
+        const Key index = node_index[node];
+        return inserted_nodes[index].weight;
+    }
+
     bool WasRemoved(const NodeID node)
     {
         BOOST_ASSERT(WasInserted(node));
@@ -165,6 +205,23 @@ class BinaryHeap
         return inserted_nodes[index].node == node;
     }
 
+    // does not touch the index storage, hence several threads may query a heap that nobody
+    // modifies. Only available for index storages that support lookups without insertion.
+    bool WasInserted(const NodeID node) const
+    {
+        const auto *stored_index = node_index.Find(node);
+        if (nullptr == stored_index)
+        {
+            return false;
+        }
+        const Key index = static_cast<Key>(*stored_index);
+        if (index >= static_cast<Key>(inserted_nodes.size()))
+        {
+            return false;
+        }
+        return inserted_nodes[index].node == node;
+    }
+
     NodeID Min() const
     {
         BOOST_ASSERT(heap.size() > 1);
@@ -0,0 +1,481 @@
+/*
+
+Copyright (c) 2014, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef COMPACT_DYNAMIC_GRAPH_H
+#define COMPACT_DYNAMIC_GRAPH_H
+
+#include "DeallocatingVector.h"
+#include "DynamicGraph.h"
+#include "Range.h"
+#include "../typedefs.h"
+
+#include <boost/assert.hpp>
+
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <vector>
+
+/*
+ * These pre-declarations are needed because parsing C++ is hard
+ * and otherwise the compiler gets confused.
+ */
+template <typename EdgeDataT> class CompactDynamicGraph;
+template <typename EdgeDataT>
+std::ostream &operator<<(std::ostream &out, const CompactDynamicGraph<EdgeDataT> &graph);
+template <typename EdgeDataT>
+std::istream &operator>>(std::istream &in, CompactDynamicGraph<EdgeDataT> &graph);
+
+// A DynamicGraph variant for graphs that grow by edge insertion, i.e. contraction.
+// Every node owns a block of edge slots in a single arena. Blocks are sized in
+// classes, and a block that is outgrown is recycled through a per-class free
+// list instead of being left behind as a hole.
+// Compact() moves all blocks back into a gap-free layout and releases the tail
+// of the arena. Edges of a node keep their insertion order until one is deleted.
+template <typename EdgeDataT> class CompactDynamicGraph
+{
+  public:
+    typedef EdgeDataT EdgeData;
+    typedef unsigned NodeIterator;
+    typedef unsigned EdgeIterator;
+    typedef osrm::range<EdgeIterator> EdgeRange;
+    typedef typename DynamicGraph<EdgeDataT>::InputEdge InputEdge;
+
+    friend std::ostream &operator<<<>(std::ostream &out, const CompactDynamicGraph &graph);
+    friend std::istream &operator>><>(std::istream &in, CompactDynamicGraph &graph);
+
+    // Constructs an empty graph with a given number of nodes.
+    explicit CompactDynamicGraph(const int32_t nodes)
+        : number_of_nodes(nodes), number_of_edges(0), number_of_free_slots(0)
+    {
+        node_list.resize(number_of_nodes);
+    }
+
+    // Builds the graph from a list of edges that is sorted by source. The initial
+    // layout has no slack, blocks are allocated on the first insertion into a node.
+    template <class ContainerT>
+    CompactDynamicGraph(const int32_t nodes, const ContainerT &graph)
+        : number_of_nodes(nodes), number_of_edges(static_cast<EdgeIterator>(graph.size())),
+          number_of_free_slots(0)
+    {
+        node_list.resize(number_of_nodes);
+        edge_list.resize(number_of_edges);
+        EdgeIterator edge = 0;
+        for (const auto node : osrm::irange(0u, number_of_nodes))
+        {
+            node_list[node].first_edge = edge;
+            while (edge < number_of_edges && graph[edge].source == node)
+            {
+                edge_list[edge].target = graph[edge].target;
+                edge_list[edge].data = graph[edge].data;
+                ++edge;
+            }
+            node_list[node].edges = edge - node_list[node].first_edge;
+            node_list[node].capacity = node_list[node].edges;
+        }
+        BOOST_ASSERT(edge == number_of_edges);
+    }
+
+    unsigned GetNumberOfNodes() const { return number_of_nodes; }
+
+    unsigned GetNumberOfEdges() const { return number_of_edges; }
+
+    unsigned GetOutDegree(const NodeIterator n) const { return node_list[n].edges; }
+
+    NodeIterator GetTarget(const EdgeIterator e) const { return NodeIterator(edge_list[e].target); }
+
+    void SetTarget(const EdgeIterator e, const NodeIterator n) { edge_list[e].target = n; }
+
+    EdgeDataT &GetEdgeData(const EdgeIterator e) { return edge_list[e].data; }
+
+    const EdgeDataT &GetEdgeData(const EdgeIterator e) const { return edge_list[e].data; }
+
+    EdgeIterator BeginEdges(const NodeIterator n) const
+    {
+        return EdgeIterator(node_list[n].first_edge);
+    }
+
+    EdgeIterator EndEdges(const NodeIterator n) const
+    {
+        return EdgeIterator(node_list[n].first_edge + node_list[n].edges);
+    }
+
+    EdgeRange GetAdjacentEdgeRange(const NodeIterator node) const
+    {
+        return osrm::irange(BeginEdges(node), EndEdges(node));
+    }
+
+    // adds an edge. Invalidates edge iterators for the source node. Not thread-safe.
+    EdgeIterator InsertEdge(const NodeIterator from, const NodeIterator to, const EdgeDataT &data)
+    {
+        Node &node = node_list[from];
+        if (node.edges == node.capacity)
+        {
+            Relocate(node);
+        }
+        Edge &edge = edge_list[node.first_edge + node.edges];
+        edge.target = to;
+        edge.data = data;
+        ++number_of_edges;
+        ++node.edges;
+        return EdgeIterator(node.first_edge + node.edges);
+    }
+
+    // removes an edge. Invalidates edge iterators for the source node
+    void DeleteEdge(const NodeIterator source, const EdgeIterator e)
+    {
+        Node &node = node_list[source];
+        BOOST_ASSERT(node.edges > 0);
+        --number_of_edges;
+        --node.edges;
+        // swap with last edge
+        edge_list[e] = edge_list[node.first_edge + node.edges];
+    }
+
+    // removes all edges (source,target). Safe to call concurrently for distinct sources.
+    int32_t DeleteEdgesTo(const NodeIterator source, const NodeIterator target)
+    {
+        int32_t deleted = 0;
+        for (EdgeIterator i = BeginEdges(source), iend = EndEdges(source); i < iend - deleted; ++i)
+        {
+            if (edge_list[i].target == target)
+            {
+                do
+                {
+                    deleted++;
+                    edge_list[i] = edge_list[iend - deleted];
+                } while (i < iend - deleted && edge_list[i].target == target);
+            }
+        }
+
+        number_of_edges -= deleted;
+        node_list[source].edges -= deleted;
+
+        return deleted;
+    }
+
+    // searches for a specific edge
+    EdgeIterator FindEdge(const NodeIterator from, const NodeIterator to) const
+    {
+        for (const auto i : osrm::irange(BeginEdges(from), EndEdges(from)))
+        {
+            if (to == edge_list[i].target)
+            {
+                return i;
+            }
+        }
+        return EndEdges(from);
+    }
+
+    // Moves all edges into a contiguous prefix of the arena, drops the slack of
+    // every node and frees the unused tail. Invalidates all edge iterators.
+    void Compact()
+    {
+        std::vector<NodeIterator> nodes_by_block;
+        nodes_by_block.reserve(number_of_nodes);
+        for (const auto node : osrm::irange(0u, number_of_nodes))
+        {
+            if (node_list[node].capacity > 0)
+            {
+                nodes_by_block.push_back(node);
+            }
+        }
+        std::sort(nodes_by_block.begin(), nodes_by_block.end(),
+                  [this](const NodeIterator a, const NodeIterator b)
+                  {
+                      return node_list[a].first_edge < node_list[b].first_edge;
+                  });
+
+        // blocks are moved front to back, so a move never overwrites a block that
+        // has not been moved yet
+        EdgeIterator position = 0;
+        for (const NodeIterator node : nodes_by_block)
+        {
+            Node &current = node_list[node];
+            BOOST_ASSERT(position <= current.first_edge);
+            if (position != current.first_edge)
+            {
+                for (const auto i : osrm::irange(0u, current.edges))
+                {
+                    edge_list[position + i] = edge_list[current.first_edge + i];
+                }
+            }
+            current.first_edge = position;
+            current.capacity = current.edges;
+            position += current.edges;
+        }
+        for (const auto node : osrm::irange(0u, number_of_nodes))
+        {
+            if (0 == node_list[node].capacity)
+            {
+                node_list[node].first_edge = position;
+            }
+        }
+        BOOST_ASSERT(position == number_of_edges);
+
+        edge_list.resize(position);
+        for (auto &free_list : free_blocks)
+        {
+            free_list.clear();
+            free_list.shrink_to_fit();
+        }
+        number_of_free_slots = 0;
+    }
+
+    // number of edge slots that are allocated in the arena but hold no edge
+    std::size_t GetNumberOfUnusedSlots() const { return edge_list.size() - number_of_edges; }
+
+    // number of edge slots in blocks that sit on a free list
+    std::size_t GetNumberOfFreeSlots() const { return number_of_free_slots; }
+
+    // bytes held by the node array, the edge arena and the free lists
+    std::size_t GetMemoryUsage() const
+    {
+        std::size_t free_list_bytes = 0;
+        for (const auto &free_list : free_blocks)
+        {
+            free_list_bytes += free_list.capacity() * sizeof(EdgeIterator);
+        }
+        return node_list.capacity() * sizeof(Node) + edge_list.capacity() * sizeof(Edge) +
+               free_list_bytes;
+    }
+
+  private:
+    // number of edges that are buffered while reading or writing a graph
+    static constexpr unsigned IO_BUFFER_SIZE = 1 << 16;
+
+    struct Node
+    {
+        Node() : first_edge(0), edges(0), capacity(0) {}
+        // index of the first edge slot
+        EdgeIterator first_edge;
+        // amount of edges
+        unsigned edges;
+        // amount of edge slots owned by the node
+        unsigned capacity;
+    };
+
+    struct Edge
+    {
+        NodeIterator target;
+        EdgeDataT data;
+    };
+
+    // size classes hold 1 to 8 slots exactly, then grow in steps of 1/8th of the
+    // next power of two: 10, 12, 14, 16, 20, 24, 28, 32, 40, ...
+    static constexpr unsigned NUMBER_OF_SIZE_CLASSES = 8 + 4 * 27;
+    // how many classes above the requested one are searched for a free block
+    static constexpr unsigned FREE_BLOCK_CLASS_TOLERANCE = 2;
+
+    static unsigned GetClassCapacity(const unsigned size_class)
+    {
+        if (size_class < 8)
+        {
+            return size_class + 1;
+        }
+        const unsigned step = size_class - 8;
+        return (10 + 2 * (step % 4)) << (step / 4);
+    }
+
+    // smallest class that holds at least the given number of slots
+    static unsigned GetSizeClass(const unsigned slots)
+    {
+        unsigned size_class = 0;
+        while (size_class + 1 < NUMBER_OF_SIZE_CLASSES && GetClassCapacity(size_class) < slots)
+        {
+            ++size_class;
+        }
+        BOOST_ASSERT(GetClassCapacity(size_class) >= slots);
+        return size_class;
+    }
+
+    // returns a block to the free list of the largest class that fits into it.
+    // Slots beyond the class capacity are lost until the next compaction.
+    void ReleaseBlock(const EdgeIterator first_edge, const unsigned capacity)
+    {
+        if (0 == capacity)
+        {
+            return;
+        }
+        unsigned size_class = GetSizeClass(capacity);
+        if (GetClassCapacity(size_class) > capacity)
+        {
+            --size_class;
+        }
+        free_blocks[size_class].push_back(first_edge);
+        number_of_free_slots += GetClassCapacity(size_class);
+    }
+
+    // moves the edges of a full node into a block with room for more edges
+    void Relocate(Node &node)
+    {
+        const unsigned size_class = GetSizeClass(node.edges + node.edges / 8 + 2);
+
+        // the block is the last one in the arena and can simply be extended
+        if (node.first_edge + node.capacity == edge_list.size())
+        {
+            const unsigned new_capacity = GetClassCapacity(size_class);
+            edge_list.resize(node.first_edge + new_capacity);
+            node.capacity = new_capacity;
+            return;
+        }
+
+        // a free block of the requested or a slightly larger class is taken as a whole
+        EdgeIterator new_first_edge = SPECIAL_EDGEID;
+        unsigned new_capacity = 0;
+        const unsigned last_class = std::min(size_class + FREE_BLOCK_CLASS_TOLERANCE,
+                                             NUMBER_OF_SIZE_CLASSES - 1);
+        for (unsigned current_class = size_class; current_class <= last_class; ++current_class)
+        {
+            if (!free_blocks[current_class].empty())
+            {
+                new_first_edge = free_blocks[current_class].back();
+                free_blocks[current_class].pop_back();
+                new_capacity = GetClassCapacity(current_class);
+                number_of_free_slots -= new_capacity;
+                break;
+            }
+        }
+        if (SPECIAL_EDGEID == new_first_edge)
+        {
+            new_first_edge = static_cast<EdgeIterator>(edge_list.size());
+            new_capacity = GetClassCapacity(size_class);
+            BOOST_ASSERT(edge_list.size() + new_capacity <
+                         std::numeric_limits<EdgeIterator>::max());
+            edge_list.resize(edge_list.size() + new_capacity);
+        }
+        for (const auto i : osrm::irange(0u, node.edges))
+        {
+            edge_list[new_first_edge + i] = edge_list[node.first_edge + i];
+        }
+        ReleaseBlock(node.first_edge, node.capacity);
+        node.first_edge = new_first_edge;
+        node.capacity = new_capacity;
+    }
+
+    NodeIterator number_of_nodes;
+    std::atomic_uint number_of_edges;
+    std::size_t number_of_free_slots;
+
+    std::vector<Node> node_list;
+    DeallocatingVector<Edge> edge_list;
+    std::array<std::vector<EdgeIterator>, NUMBER_OF_SIZE_CLASSES> free_blocks;
+};
+
+// Writes the graph without its slack. Reading it back yields a compacted graph.
+template <typename EdgeDataT>
+std::ostream &operator<<(std::ostream &out, const CompactDynamicGraph<EdgeDataT> &graph)
+{
+    typedef CompactDynamicGraph<EdgeDataT> GraphT;
+
+    const unsigned number_of_nodes = graph.number_of_nodes;
+    const unsigned number_of_edges = graph.number_of_edges;
+    out.write((char *)&number_of_nodes, sizeof(unsigned));
+    out.write((char *)&number_of_edges, sizeof(unsigned));
+
+    std::vector<unsigned> degrees(number_of_nodes);
+    for (const auto node : osrm::irange(0u, number_of_nodes))
+    {
+        degrees[node] = graph.node_list[node].edges;
+    }
+    out.write((char *)degrees.data(), sizeof(unsigned) * number_of_nodes);
+
+    std::vector<typename GraphT::Edge> buffer;
+    buffer.reserve(GraphT::IO_BUFFER_SIZE);
+    for (const auto node : osrm::irange(0u, number_of_nodes))
+    {
+        for (const auto edge : graph.GetAdjacentEdgeRange(node))
+        {
+            buffer.push_back(graph.edge_list[edge]);
+            if (buffer.size() == GraphT::IO_BUFFER_SIZE)
+            {
+                out.write((char *)buffer.data(), sizeof(typename GraphT::Edge) * buffer.size());
+                buffer.clear();
+            }
+        }
+    }
+    out.write((char *)buffer.data(), sizeof(typename GraphT::Edge) * buffer.size());
+
+    return out;
+}
+
+template <typename EdgeDataT>
+std::istream &operator>>(std::istream &in, CompactDynamicGraph<EdgeDataT> &graph)
+{
+    typedef CompactDynamicGraph<EdgeDataT> GraphT;
+
+    unsigned number_of_nodes = 0;
+    unsigned number_of_edges = 0;
+    in.read((char *)&number_of_nodes, sizeof(unsigned));
+    in.read((char *)&number_of_edges, sizeof(unsigned));
+
+    std::vector<unsigned> degrees(number_of_nodes);
+    in.read((char *)degrees.data(), sizeof(unsigned) * number_of_nodes);
+
+    graph.number_of_nodes = number_of_nodes;
+    graph.number_of_edges = number_of_edges;
+    graph.node_list.clear();
+    graph.node_list.resize(number_of_nodes);
+    unsigned position = 0;
+    for (const auto node : osrm::irange(0u, number_of_nodes))
+    {
+        graph.node_list[node].first_edge = position;
+        graph.node_list[node].edges = degrees[node];
+        graph.node_list[node].capacity = degrees[node];
+        position += degrees[node];
+    }
+    BOOST_ASSERT(!in || position == number_of_edges);
+
+    for (auto &free_list : graph.free_blocks)
+    {
+        free_list.clear();
+    }
+    graph.number_of_free_slots = 0;
+
+    graph.edge_list.clear();
+    graph.edge_list.resize(number_of_edges);
+    std::vector<typename GraphT::Edge> buffer(GraphT::IO_BUFFER_SIZE);
+    for (unsigned first = 0; first < number_of_edges && in; first += GraphT::IO_BUFFER_SIZE)
+    {
+        const unsigned count =
+            std::min(number_of_edges - first, static_cast<unsigned>(GraphT::IO_BUFFER_SIZE));
+        in.read((char *)buffer.data(), sizeof(typename GraphT::Edge) * count);
+        for (const auto i : osrm::irange(0u, count))
+        {
+            graph.edge_list[first + i] = buffer[i];
+        }
+    }
+
+    return in;
+}
+
+#endif // COMPACT_DYNAMIC_GRAPH_H
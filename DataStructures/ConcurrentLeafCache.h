@@ -0,0 +1,221 @@
+/*
+
+Copyright (c) 2014, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#ifndef CONCURRENT_LEAF_CACHE_H
+#define CONCURRENT_LEAF_CACHE_H
+
+#include "../Util/SimpleLogger.h"
+
+#include <boost/assert.hpp>
+
+#include <cstdint>
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Process-wide cache of r-tree leaves, shared by the r-trees of all threads. Leaves are spread
+// over shards by id, every shard evicts with the CLOCK algorithm and is locked only to look at
+// or change its slots, never while a leaf is read from disk. A leaf handed out stays valid for
+// as long as the caller holds on to it, even if it is evicted meanwhile.
+template <class LeafT> class ConcurrentLeafCache
+{
+  public:
+    typedef std::shared_ptr<const LeafT> LeafPtr;
+
+    struct Statistics
+    {
+        Statistics() : hits(0), misses(0), evictions(0), number_of_leaves(0), capacity(0) {}
+
+        double GetHitRate() const
+        {
+            return (0 == hits + misses) ? 0. : static_cast<double>(hits) / (hits + misses);
+        }
+
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        std::size_t number_of_leaves;
+        std::size_t capacity;
+    };
+
+    explicit ConcurrentLeafCache(const std::size_t byte_budget)
+    {
+        const std::size_t capacity = std::max<std::size_t>(1, byte_budget / sizeof(LeafT));
+        const std::size_t number_of_shards = std::min(NUMBER_OF_SHARDS, capacity);
+        for (std::size_t i = 0; i < number_of_shards; ++i)
+        {
+            // the first shards take the remainder
+            const std::size_t shard_capacity =
+                capacity / number_of_shards + (i < capacity % number_of_shards ? 1 : 0);
+            shards.emplace_back(new Shard(shard_capacity));
+        }
+        SimpleLogger().Write() << "caching up to " << capacity << " r-tree leaves ("
+                               << (capacity * sizeof(LeafT) >> 20) << " MB) in "
+                               << number_of_shards << " shards";
+    }
+
+    ConcurrentLeafCache(const ConcurrentLeafCache &) = delete;
+
+    // Returns the cached leaf, nullptr if it is not cached
+    LeafPtr Find(const uint32_t leaf_id)
+    {
+        Shard &shard = GetShard(leaf_id);
+        LeafPtr leaf;
+        bool report = false;
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            const auto iter = shard.slot_of_leaf.find(leaf_id);
+            if (iter != shard.slot_of_leaf.end())
+            {
+                Slot &slot = shard.slots[iter->second];
+                slot.referenced = true;
+                leaf = slot.leaf;
+                ++shard.hits;
+            }
+            else
+            {
+                ++shard.misses;
+            }
+            report = (0 == (shard.hits + shard.misses) % REPORT_INTERVAL);
+        }
+        if (report)
+        {
+            Report();
+        }
+        return leaf;
+    }
+
+    // Caches a leaf just read from disk. Returns the leaf that is cached under this id, which is
+    // another copy if some other thread inserted it first.
+    LeafPtr Insert(const uint32_t leaf_id, LeafPtr leaf)
+    {
+        BOOST_ASSERT(leaf);
+        Shard &shard = GetShard(leaf_id);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        const auto iter = shard.slot_of_leaf.find(leaf_id);
+        if (iter != shard.slot_of_leaf.end())
+        {
+            return shard.slots[iter->second].leaf;
+        }
+
+        uint32_t slot_index = static_cast<uint32_t>(shard.slots.size());
+        if (shard.slots.size() < shard.capacity)
+        {
+            shard.slots.emplace_back();
+        }
+        else
+        {
+            // advance the hand, giving every referenced leaf a second chance
+            while (shard.slots[shard.clock_hand].referenced)
+            {
+                shard.slots[shard.clock_hand].referenced = false;
+                shard.clock_hand = (shard.clock_hand + 1) % shard.capacity;
+            }
+            slot_index = shard.clock_hand;
+            shard.clock_hand = (shard.clock_hand + 1) % shard.capacity;
+            shard.slot_of_leaf.erase(shard.slots[slot_index].leaf_id);
+            ++shard.evictions;
+        }
+
+        Slot &slot = shard.slots[slot_index];
+        slot.leaf_id = leaf_id;
+        slot.referenced = false;
+        slot.leaf = std::move(leaf);
+        shard.slot_of_leaf.emplace(leaf_id, slot_index);
+        return slot.leaf;
+    }
+
+    Statistics GetStatistics() const
+    {
+        Statistics statistics;
+        for (const auto &shard : shards)
+        {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            statistics.hits += shard->hits;
+            statistics.misses += shard->misses;
+            statistics.evictions += shard->evictions;
+            statistics.number_of_leaves += shard->slots.size();
+            statistics.capacity += shard->capacity;
+        }
+        return statistics;
+    }
+
+  private:
+    static const std::size_t NUMBER_OF_SHARDS = 16;
+    // lookups of one shard between two log lines
+    static const uint64_t REPORT_INTERVAL = 1 << 16;
+
+    struct Slot
+    {
+        Slot() : leaf_id(std::numeric_limits<uint32_t>::max()), referenced(false) {}
+
+        uint32_t leaf_id;
+        bool referenced;
+        LeafPtr leaf;
+    };
+
+    struct Shard
+    {
+        explicit Shard(const std::size_t capacity)
+            : capacity(capacity), clock_hand(0), hits(0), misses(0), evictions(0)
+        {
+            slots.reserve(capacity);
+        }
+
+        mutable std::mutex mutex;
+        std::size_t capacity;
+        std::vector<Slot> slots;
+        std::unordered_map<uint32_t, uint32_t> slot_of_leaf;
+        uint32_t clock_hand;
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+    };
+
+    Shard &GetShard(const uint32_t leaf_id) { return *shards[leaf_id % shards.size()]; }
+
+    void Report() const
+    {
+        const Statistics statistics = GetStatistics();
+        SimpleLogger().Write() << "leaf cache: " << statistics.hits << " hits, "
+                               << statistics.misses << " misses ("
+                               << static_cast<int>(100 * statistics.GetHitRate()) << "% hit rate), "
+                               << statistics.evictions << " evictions, "
+                               << statistics.number_of_leaves << "/" << statistics.capacity
+                               << " leaves";
+    }
+
+    std::vector<std::unique_ptr<Shard>> shards;
+};
+
+template <class LeafT> const std::size_t ConcurrentLeafCache<LeafT>::NUMBER_OF_SHARDS;
+template <class LeafT> const uint64_t ConcurrentLeafCache<LeafT>::REPORT_INTERVAL;
+
+#endif // CONCURRENT_LEAF_CACHE_H
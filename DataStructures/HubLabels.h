@@ -0,0 +1,250 @@
+/*
+
+Copyright (c) 2014, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#ifndef HUB_LABELS_H
+#define HUB_LABELS_H
+
+#include "SharedMemoryVectorWrapper.h"
+#include "../Util/OSRMException.h"
+#include "../typedefs.h"
+
+#include <boost/assert.hpp>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <cstdint>
+
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+/**
+ * Hub labels of the contracted search graph.
+ *
+ * Every node has a forward label, the hubs it reaches by upward edges together with their
+ * distances, and a backward label, the hubs that reach it. The shortest distance from s to t is
+ * the minimum of forward(s)[h] + backward(t)[h] over all common hubs h. Hubs of a label are
+ * sorted by id and stored apart from their distances, so the intersection can compare four hubs
+ * of each label at a time.
+ *
+ * On disk (.hl) labels are delta and varint encoded:
+ *   HubLabelFileHeader
+ *   for each node: forward label, then backward label, each as
+ *     size, then (hub - previous hub, distance) for every entry
+ */
+struct HubLabelFileHeader
+{
+    unsigned check_sum; // of the .hsgr the labels were derived from
+    unsigned number_of_nodes;
+    uint64_t number_of_entries;
+};
+
+inline void WriteVarInt(std::ostream &out, unsigned value)
+{
+    while (value >= 0x80)
+    {
+        out.put(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.put(static_cast<char>(value));
+}
+
+inline unsigned ReadVarInt(std::istream &in)
+{
+    unsigned value = 0;
+    for (unsigned shift = 0; shift < 35; shift += 7)
+    {
+        const int byte = in.get();
+        if (std::istream::traits_type::eof() == byte)
+        {
+            throw OSRMException("hub label file truncated");
+        }
+        value |= static_cast<unsigned>(byte & 0x7f) << shift;
+        if (0 == (byte & 0x80))
+        {
+            return value;
+        }
+    }
+    throw OSRMException("hub label file corrupted");
+}
+
+// Decodes a label file body into flat arrays. offsets needs 2 * number_of_nodes + 1 entries,
+// hubs and distances number_of_entries each. Label i of node n is at index 2 * n + i.
+inline void ReadHubLabels(std::istream &in,
+                          const HubLabelFileHeader &header,
+                          unsigned *offsets,
+                          NodeID *hubs,
+                          EdgeWeight *distances)
+{
+    uint64_t position = 0;
+    for (unsigned label = 0; label < 2 * header.number_of_nodes; ++label)
+    {
+        offsets[label] = static_cast<unsigned>(position);
+        const unsigned size = ReadVarInt(in);
+        if (position + size > header.number_of_entries)
+        {
+            throw OSRMException("hub label file corrupted");
+        }
+        NodeID hub = 0;
+        for (unsigned i = 0; i < size; ++i, ++position)
+        {
+            hub += ReadVarInt(in);
+            hubs[position] = hub;
+            distances[position] = static_cast<EdgeWeight>(ReadVarInt(in));
+        }
+    }
+    if (position != header.number_of_entries)
+    {
+        throw OSRMException("hub label file corrupted");
+    }
+    offsets[2 * header.number_of_nodes] = static_cast<unsigned>(position);
+}
+
+// Shortest distance over the common hubs of two sorted labels, INVALID_EDGE_WEIGHT if none
+inline EdgeWeight IntersectHubLabels(const NodeID *forward_hubs,
+                                     const EdgeWeight *forward_distances,
+                                     const unsigned forward_size,
+                                     const NodeID *backward_hubs,
+                                     const EdgeWeight *backward_distances,
+                                     const unsigned backward_size)
+{
+    EdgeWeight result = INVALID_EDGE_WEIGHT;
+    unsigned i = 0, j = 0;
+#ifdef __SSE2__
+    // compare blocks of four hubs against all rotations of the other block. Common hubs are
+    // rare, so the few matching blocks are resolved in scalar code.
+    while (i + 4 <= forward_size && j + 4 <= backward_size)
+    {
+        const __m128i forward_block =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(forward_hubs + i));
+        const __m128i backward_block =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(backward_hubs + j));
+        const __m128i match = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi32(forward_block, backward_block),
+                         _mm_cmpeq_epi32(forward_block,
+                                         _mm_shuffle_epi32(backward_block, _MM_SHUFFLE(0, 3, 2, 1)))),
+            _mm_or_si128(_mm_cmpeq_epi32(forward_block,
+                                         _mm_shuffle_epi32(backward_block, _MM_SHUFFLE(1, 0, 3, 2))),
+                         _mm_cmpeq_epi32(forward_block,
+                                         _mm_shuffle_epi32(backward_block, _MM_SHUFFLE(2, 1, 0, 3)))));
+        if (0 != _mm_movemask_epi8(match))
+        {
+            for (unsigned k = i; k < i + 4; ++k)
+            {
+                for (unsigned l = j; l < j + 4; ++l)
+                {
+                    if (forward_hubs[k] == backward_hubs[l])
+                    {
+                        result = std::min(result, forward_distances[k] + backward_distances[l]);
+                    }
+                }
+            }
+        }
+        const NodeID last_forward_hub = forward_hubs[i + 3];
+        const NodeID last_backward_hub = backward_hubs[j + 3];
+        if (last_forward_hub <= last_backward_hub)
+        {
+            i += 4;
+        }
+        if (last_backward_hub <= last_forward_hub)
+        {
+            j += 4;
+        }
+    }
+#endif
+    while (i < forward_size && j < backward_size)
+    {
+        if (forward_hubs[i] < backward_hubs[j])
+        {
+            ++i;
+        }
+        else if (backward_hubs[j] < forward_hubs[i])
+        {
+            ++j;
+        }
+        else
+        {
+            result = std::min(result, forward_distances[i] + backward_distances[j]);
+            ++i;
+            ++j;
+        }
+    }
+    return result;
+}
+
+template <bool UseSharedMemory> class HubLabels
+{
+  public:
+    typedef typename ShM<unsigned, UseSharedMemory>::vector OffsetContainerT;
+    typedef typename ShM<NodeID, UseSharedMemory>::vector HubContainerT;
+    typedef typename ShM<EdgeWeight, UseSharedMemory>::vector DistanceContainerT;
+
+    HubLabels() {}
+
+    HubLabels(OffsetContainerT &external_offsets,
+              HubContainerT &external_hubs,
+              DistanceContainerT &external_distances)
+    {
+        offsets.swap(external_offsets);
+        hubs.swap(external_hubs);
+        distances.swap(external_distances);
+        BOOST_ASSERT(hubs.size() == distances.size());
+    }
+
+    bool empty() const { return offsets.empty(); }
+
+    unsigned GetNumberOfNodes() const { return empty() ? 0 : (offsets.size() - 1) / 2; }
+
+    EdgeWeight GetDistance(const NodeID source, const NodeID target) const
+    {
+        BOOST_ASSERT(source < GetNumberOfNodes());
+        BOOST_ASSERT(target < GetNumberOfNodes());
+        const unsigned forward_begin = offsets[2 * source];
+        const unsigned forward_end = offsets[2 * source + 1];
+        const unsigned backward_begin = offsets[2 * target + 1];
+        const unsigned backward_end = offsets[2 * target + 2];
+        if (forward_begin == forward_end || backward_begin == backward_end)
+        {
+            return INVALID_EDGE_WEIGHT;
+        }
+        return IntersectHubLabels(&hubs[forward_begin],
+                                  &distances[forward_begin],
+                                  forward_end - forward_begin,
+                                  &hubs[backward_begin],
+                                  &distances[backward_begin],
+                                  backward_end - backward_begin);
+    }
+
+  private:
+    OffsetContainerT offsets;
+    HubContainerT hubs;
+    DistanceContainerT distances;
+};
+
+#endif // HUB_LABELS_H
@@ -0,0 +1,108 @@
+/*
+
+Copyright (c) 2014, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef PATH_LENGTH_ACCUMULATOR_H
+#define PATH_LENGTH_ACCUMULATOR_H
+
+#include "RawRouteData.h"
+
+#include <osrm/Coordinate.h>
+
+#include <boost/assert.hpp>
+
+#include <utility>
+
+// Stands in for the std::vector<PathData> that path unpacking writes to, when only the length
+// of a route is of interest. Instead of storing the unpacked nodes it sums up the distances
+// between their coordinates, the same way DescriptionFactory computes the length of a route.
+// It remembers the last two elements, which is all the unpacking code looks at.
+template <class DataFacadeT> class PathLengthAccumulator
+{
+  public:
+    PathLengthAccumulator(const DataFacadeT *facade, const FixedPointCoordinate &start)
+        : facade(facade), previous_coordinate(start), length(0.), count(0)
+    {
+    }
+
+    // call before unpacking the next leg, the unpacking code expects an empty path per leg
+    void StartLeg() { count = 0; }
+
+    // adds a point that is not a graph node, e.g. the location of a phantom node
+    void AppendCoordinate(const FixedPointCoordinate &coordinate)
+    {
+        // accumulated segment by segment in float, just like SegmentInformation::length
+        const float segment_length =
+            FixedPointCoordinate::ApproximateEuclideanDistance(previous_coordinate, coordinate);
+        length += segment_length;
+        previous_coordinate = coordinate;
+    }
+
+    double GetLength() const { return length; }
+
+    bool empty() const { return 0 == count; }
+
+    std::size_t size() const { return count; }
+
+    template <typename... Args> void emplace_back(Args &&... args)
+    {
+        last_elements[0] = last_elements[1];
+        last_elements[1] = PathData(std::forward<Args>(args)...);
+        ++count;
+        AppendCoordinate(facade->GetCoordinateOfNode(last_elements[1].node));
+    }
+
+    // removing the last element is only ever done for a node that repeats its predecessor,
+    // which did not add any length
+    void pop_back()
+    {
+        BOOST_ASSERT(count >= 2);
+        BOOST_ASSERT(last_elements[0].node == last_elements[1].node);
+        last_elements[1] = last_elements[0];
+        --count;
+    }
+
+    PathData &back()
+    {
+        BOOST_ASSERT(!empty());
+        return last_elements[1];
+    }
+
+    const PathData &operator[](const std::size_t index) const
+    {
+        BOOST_ASSERT(index < count && index + 2 >= count);
+        return last_elements[index + 2 - count];
+    }
+
+  private:
+    const DataFacadeT *facade;
+    FixedPointCoordinate previous_coordinate;
+    double length;
+    std::size_t count;
+    PathData last_elements[2];
+};
+
+#endif // PATH_LENGTH_ACCUMULATOR_H
@@ -58,7 +58,8 @@ struct PathData
 struct RawRouteData
 {
     std::vector<std::vector<PathData>> unpacked_path_segments;
-    std::vector<PathData> unpacked_alternative;
+    // one entry per alternative, ordered by rank
+    std::vector<std::vector<PathData>> unpacked_alternatives;
     std::vector<PhantomNodes> segment_end_coordinates;
     std::vector<FixedPointCoordinate> raw_via_node_coordinates;
     std::vector<bool> source_traversed_in_reverse;
@@ -67,7 +68,7 @@ struct RawRouteData
     std::vector<bool> alt_target_traversed_in_reverse;
     unsigned check_sum;
     int shortest_path_length;
-    int alternative_path_length;
+    std::vector<int> alternative_path_lengths;
 
     bool is_via_leg(const std::size_t leg) const
     {
@@ -76,8 +77,7 @@ struct RawRouteData
 
     RawRouteData()
         : check_sum(SPECIAL_NODEID),
-          shortest_path_length(INVALID_EDGE_WEIGHT),
-          alternative_path_length(INVALID_EDGE_WEIGHT)
+          shortest_path_length(INVALID_EDGE_WEIGHT)
     {
     }
 };
@@ -0,0 +1,165 @@
+/*
+
+Copyright (c) 2014, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef REUSABLE_HASH_TABLE_H
+#define REUSABLE_HASH_TABLE_H
+
+#include <boost/assert.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Open addressing hash table keyed by node ids. Clearing is O(1): each cell remembers the
+// generation it was written in and cells of older generations count as empty. The cell
+// array only ever grows, so a table that is reused across queries stops allocating once it
+// has seen its largest search space.
+template <typename NodeID, typename Value> class ReusableHashTable
+{
+  private:
+    struct HashCell
+    {
+        HashCell() : node(std::numeric_limits<NodeID>::max()), generation(0), value() {}
+
+        NodeID node;
+        unsigned generation;
+        Value value;
+    };
+
+  public:
+    explicit ReusableHashTable(const std::size_t expected_size = 1024)
+        : number_of_elements(0), current_generation(1)
+    {
+        std::size_t capacity = 16;
+        while (capacity < 2 * expected_size)
+        {
+            capacity <<= 1;
+        }
+        cells.resize(capacity);
+    }
+
+    // Returns the value stored for node, default constructing it if the node is not present.
+    Value &operator[](const NodeID node)
+    {
+        std::size_t position = FindCell(node);
+        if (cells[position].generation != current_generation)
+        {
+            if (2 * (number_of_elements + 1) > cells.size())
+            {
+                Grow();
+                position = FindCell(node);
+            }
+            cells[position].node = node;
+            cells[position].generation = current_generation;
+            cells[position].value = Value();
+            ++number_of_elements;
+        }
+        return cells[position].value;
+    }
+
+    // Stores value only if node is not present yet, returns whether it was inserted.
+    bool Insert(const NodeID node, const Value &value)
+    {
+        if (Contains(node))
+        {
+            return false;
+        }
+        operator[](node) = value;
+        return true;
+    }
+
+    // Returns a pointer to the stored value or nullptr if node is not present.
+    const Value *Find(const NodeID node) const
+    {
+        const std::size_t position = FindCell(node);
+        if (cells[position].generation != current_generation)
+        {
+            return nullptr;
+        }
+        return &cells[position].value;
+    }
+
+    bool Contains(const NodeID node) const { return nullptr != Find(node); }
+
+    std::size_t Size() const { return number_of_elements; }
+
+    std::size_t Capacity() const { return cells.capacity() * sizeof(HashCell); }
+
+    void Clear()
+    {
+        number_of_elements = 0;
+        ++current_generation;
+        if (0 == current_generation)
+        {
+            // generation counter wrapped, stale cells would look alive again
+            for (HashCell &cell : cells)
+            {
+                cell.generation = 0;
+            }
+            current_generation = 1;
+        }
+    }
+
+  private:
+    inline std::size_t FindCell(const NodeID node) const
+    {
+        BOOST_ASSERT(0 == (cells.size() & (cells.size() - 1)));
+        const std::size_t mask = cells.size() - 1;
+        std::size_t position =
+            static_cast<std::size_t>((static_cast<uint64_t>(node) * 0x9E3779B97F4A7C15ULL) >> 32) &
+            mask;
+        while (cells[position].generation == current_generation && cells[position].node != node)
+        {
+            position = (position + 1) & mask;
+        }
+        return position;
+    }
+
+    void Grow()
+    {
+        std::vector<HashCell> old_cells(2 * cells.size());
+        old_cells.swap(cells);
+        const unsigned old_generation = current_generation;
+        current_generation = 1;
+        for (const HashCell &cell : old_cells)
+        {
+            if (cell.generation == old_generation)
+            {
+                const std::size_t position = FindCell(cell.node);
+                cells[position].node = cell.node;
+                cells[position].generation = current_generation;
+                cells[position].value = cell.value;
+            }
+        }
+    }
+
+    std::vector<HashCell> cells;
+    std::size_t number_of_elements;
+    unsigned current_generation;
+};
+
+#endif // REUSABLE_HASH_TABLE_H
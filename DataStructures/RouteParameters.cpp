@@ -32,8 +32,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <boost/fusion/include/at_c.hpp>
 
 RouteParameters::RouteParameters()
-    : zoom_level(18), print_instructions(false), alternate_route(true), geometry(true),
-      compression(true), deprecatedAPI(false), uturn_default(false), check_sum(-1)
+    : zoom_level(18), print_instructions(false), alternate_route(true),
+      number_of_alternatives(1), time_bound(0), number_of_results(0), radius(0), geometry(true), compression(true), deprecatedAPI(false),
+      uturn_default(false), check_sum(-1), timeout(0)
 {
 }
 
@@ -47,6 +48,32 @@ void RouteParameters::setZoomLevel(const short level)
 
 void RouteParameters::setAlternateRouteFlag(const bool flag) { alternate_route = flag; }
 
+void RouteParameters::setNumberOfAlternatives(const unsigned number)
+{
+    if (0 < number)
+    {
+        number_of_alternatives = number;
+    }
+}
+
+void RouteParameters::setTimeBound(const unsigned seconds) { time_bound = seconds; }
+
+void RouteParameters::setNumberOfResults(const unsigned number)
+{
+    if (0 < number)
+    {
+        number_of_results = number;
+    }
+}
+
+void RouteParameters::setRadius(const double meters)
+{
+    if (0 < meters)
+    {
+        radius = meters;
+    }
+}
+
 void RouteParameters::setUTurn(const bool flag)
 {
     uturns.resize(coordinates.size(), uturn_default);
@@ -71,6 +98,8 @@ void RouteParameters::setDeprecatedAPIFlag(const std::string &) { deprecatedAPI
 
 void RouteParameters::setChecksum(const unsigned sum) { check_sum = sum; }
 
+void RouteParameters::setTimeout(const unsigned milliseconds) { timeout = milliseconds; }
+
 void RouteParameters::setInstructionFlag(const bool flag) { print_instructions = flag; }
 
 void RouteParameters::setService(const std::string &service_string) { service = service_string; }
@@ -29,65 +29,119 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "BinaryHeap.h"
 
-void SearchEngineData::InitializeOrClearFirstThreadLocalStorage(const unsigned number_of_nodes)
+SearchEngineData::SearchWorkspacePtr SearchEngineData::workspace;
+
+SearchWorkspace::SearchWorkspace(const unsigned number_of_nodes)
+    : forward_heap1(number_of_nodes), reverse_heap1(number_of_nodes),
+      forward_heap2(number_of_nodes), reverse_heap2(number_of_nodes),
+      forward_heap3(number_of_nodes), reverse_heap3(number_of_nodes)
+#ifndef NDEBUG
+      ,
+      capacity_growth_count(0), last_footprint(0)
+#endif
 {
-    if (forwardHeap.get())
-    {
-        forwardHeap->Clear();
-    }
-    else
-    {
-        forwardHeap.reset(new QueryHeap(number_of_nodes));
-    }
+}
 
-    if (backwardHeap.get())
+void UnpackedPathCache::Clear()
+{
+    packed_edge_lengths.clear();
+    offsets.clear();
+    nodes.clear();
+    edge_lengths.clear();
+}
+
+void SearchWorkspace::PrepareLegs(const std::size_t number_of_legs)
+{
+    // never shrink, dropping a leg would release its storage
+    if (packed_legs1.size() < number_of_legs)
     {
-        backwardHeap->Clear();
+        packed_legs1.resize(number_of_legs);
+        packed_legs2.resize(number_of_legs);
     }
-    else
+    for (std::size_t leg = 0; leg < number_of_legs; ++leg)
     {
-        backwardHeap.reset(new QueryHeap(number_of_nodes));
+        packed_legs1[leg].clear();
+        packed_legs2[leg].clear();
     }
 }
 
-void SearchEngineData::InitializeOrClearSecondThreadLocalStorage(const unsigned number_of_nodes)
+std::size_t SearchWorkspace::CapacityGrowthCount()
 {
-    if (forwardHeap2.get())
+#ifndef NDEBUG
+    UpdateCapacityGrowthCount();
+    return capacity_growth_count;
+#else
+    return 0;
+#endif
+}
+
+std::size_t SearchWorkspace::Footprint() const
+{
+    std::size_t footprint = forward_heap1.Capacity() + reverse_heap1.Capacity() +
+                            forward_heap2.Capacity() + reverse_heap2.Capacity() +
+                            forward_heap3.Capacity() + reverse_heap3.Capacity();
+
+    footprint += (packed_legs1.capacity() + packed_legs2.capacity()) * sizeof(std::vector<NodeID>);
+    for (const std::vector<NodeID> &leg : packed_legs1)
     {
-        forwardHeap2->Clear();
+        footprint += leg.capacity() * sizeof(NodeID);
     }
-    else
+    for (const std::vector<NodeID> &leg : packed_legs2)
     {
-        forwardHeap2.reset(new QueryHeap(number_of_nodes));
+        footprint += leg.capacity() * sizeof(NodeID);
     }
 
-    if (backwardHeap2.get())
-    {
-        backwardHeap2->Clear();
-    }
-    else
+    footprint += (forward_search_space.capacity() + reverse_search_space.capacity() +
+                  unpack_stack.capacity()) *
+                 sizeof(SearchSpaceEdge);
+    footprint += ranked_candidates_list.capacity() * sizeof(RankedCandidateNode);
+    footprint += geometry_buffer.capacity() * sizeof(unsigned);
+    footprint += (temporary_packed_leg1.capacity() + temporary_packed_leg2.capacity() +
+                  via_node_candidate_list.capacity() + preselected_node_list.capacity() +
+                  packed_forward_path.capacity() + packed_reverse_path.capacity() +
+                  packed_alternate_path.capacity() + packed_s_v_path.capacity() +
+                  packed_v_t_path.capacity() + partially_unpacked_shortest_path.capacity() +
+                  partially_unpacked_via_path.capacity()) *
+                 sizeof(NodeID);
+    footprint += nodes_in_path.Capacity() + approximated_forward_sharing.Capacity() +
+                 approximated_reverse_sharing.Capacity() + nodes_in_alternatives.Capacity();
+
+    footprint += (shortest_path_cache.packed_edge_lengths.capacity() +
+                  shortest_path_cache.edge_lengths.capacity() +
+                  partially_unpacked_shortest_path_lengths.capacity()) *
+                 sizeof(int);
+    footprint += (shortest_path_cache.offsets.capacity() + selected_candidates.capacity()) *
+                 sizeof(std::size_t);
+    footprint += shortest_path_cache.nodes.capacity() * sizeof(NodeID);
+    footprint += tested_candidates.capacity() * sizeof(AlternativePathCandidate);
+    for (const AlternativePathCandidate &candidate : tested_candidates)
     {
-        backwardHeap2.reset(new QueryHeap(number_of_nodes));
+        footprint += candidate.packed_path.capacity() * sizeof(NodeID);
     }
+    return footprint;
 }
 
-void SearchEngineData::InitializeOrClearThirdThreadLocalStorage(const unsigned number_of_nodes)
+#ifndef NDEBUG
+void SearchWorkspace::UpdateCapacityGrowthCount()
 {
-    if (forwardHeap3.get())
+    // capacities never shrink, so any change since the last check is growth
+    const std::size_t footprint = Footprint();
+    if (footprint != last_footprint)
     {
-        forwardHeap3->Clear();
-    }
-    else
-    {
-        forwardHeap3.reset(new QueryHeap(number_of_nodes));
+        ++capacity_growth_count;
+        last_footprint = footprint;
     }
+}
+#endif
 
-    if (backwardHeap3.get())
-    {
-        backwardHeap3->Clear();
-    }
-    else
+SearchWorkspace &SearchEngineData::GetThreadLocalWorkspace(const unsigned number_of_nodes)
+{
+    if (!workspace.get())
     {
-        backwardHeap3.reset(new QueryHeap(number_of_nodes));
+        workspace.reset(new SearchWorkspace(number_of_nodes));
     }
+#ifndef NDEBUG
+    workspace->UpdateCapacityGrowthCount();
+#endif
+    return *workspace;
 }
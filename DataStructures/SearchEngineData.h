@@ -32,6 +32,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "../typedefs.h"
 #include "BinaryHeap.h"
+#include "ReusableHashTable.h"
+
+#include <utility>
+#include <vector>
 
 struct HeapData
 {
@@ -39,23 +43,130 @@ struct HeapData
     /* explicit */ HeapData(NodeID p) : parent(p) {}
 };
 
-struct SearchEngineData
+struct RankedCandidateNode
+{
+    RankedCandidateNode(const NodeID node, const int length, const int sharing)
+        : node(node), length(length), sharing(sharing)
+    {
+    }
+
+    NodeID node;
+    int length;
+    int sharing;
+
+    bool operator<(const RankedCandidateNode &other) const
+    {
+        return (2 * length + sharing) < (2 * other.length + other.sharing);
+    }
+};
+
+// T-test outcome of a via node candidate, written by whichever thread inspects the candidate
+struct AlternativePathCandidate
 {
-    typedef BinaryHeap<NodeID, NodeID, int, HeapData, UnorderedMapStorage<NodeID, int>> QueryHeap;
-    typedef boost::thread_specific_ptr<QueryHeap> SearchEngineHeapPtr;
+    AlternativePathCandidate() : length(INVALID_EDGE_WEIGHT), passes_t_test(false) {}
 
-    static SearchEngineHeapPtr forwardHeap;
-    static SearchEngineHeapPtr backwardHeap;
-    static SearchEngineHeapPtr forwardHeap2;
-    static SearchEngineHeapPtr backwardHeap2;
-    static SearchEngineHeapPtr forwardHeap3;
-    static SearchEngineHeapPtr backwardHeap3;
+    int length;
+    bool passes_t_test;
+    std::vector<NodeID> packed_path;
+};
+
+// The shortest path of an alternative route query unpacked edge by edge. It is built once per
+// query and then only read by the inspections of all via node candidates.
+struct UnpackedPathCache
+{
+    void Clear();
+
+    // length of every packed edge
+    std::vector<int> packed_edge_lengths;
+    // the unpacked nodes of packed edge i are nodes[offsets[i]] .. nodes[offsets[i + 1] - 1]
+    std::vector<std::size_t> offsets;
+    std::vector<NodeID> nodes;
+    // length of the edge to the next unpacked node, -1 for the last node of a packed edge
+    std::vector<int> edge_lengths;
+};
+
+// Everything a query needs as scratch space. One instance lives per worker thread and is
+// handed down explicitly through the routing algorithms, so a query touches thread local
+// storage exactly once. All members keep their capacity when cleared, hence a warmed up
+// workspace serves further queries without going to the allocator.
+struct SearchWorkspace
+{
+    typedef BinaryHeap<NodeID, NodeID, int, HeapData, ReusableHashStorage<NodeID, int>> QueryHeap;
+    typedef std::pair<NodeID, NodeID> SearchSpaceEdge;
 
-    void InitializeOrClearFirstThreadLocalStorage(const unsigned number_of_nodes);
+    explicit SearchWorkspace(const unsigned number_of_nodes);
+
+    // resizes both packed leg lists to hold at least number_of_legs empty legs
+    void PrepareLegs(const std::size_t number_of_legs);
+
+    // Debug aid, not an allocation counter: the number of acquisitions at which the summed
+    // capacities of the members were found to have grown since the previous one. Once warmed
+    // up by a workload this stays constant while the same workload is repeated. Allocations
+    // that leave the capacities unchanged, e.g. a vector freed and allocated again, are not
+    // seen. Always zero if built with NDEBUG, where the capacities are not tracked.
+    std::size_t CapacityGrowthCount();
+
+    QueryHeap forward_heap1;
+    QueryHeap reverse_heap1;
+    QueryHeap forward_heap2;
+    QueryHeap reverse_heap2;
+    QueryHeap forward_heap3;
+    QueryHeap reverse_heap3;
+
+    // ShortestPathRouting
+    std::vector<std::vector<NodeID>> packed_legs1;
+    std::vector<std::vector<NodeID>> packed_legs2;
+    std::vector<NodeID> temporary_packed_leg1;
+    std::vector<NodeID> temporary_packed_leg2;
+
+    // AlternativeRouting
+    std::vector<SearchSpaceEdge> forward_search_space;
+    std::vector<SearchSpaceEdge> reverse_search_space;
+    std::vector<NodeID> via_node_candidate_list;
+    std::vector<NodeID> preselected_node_list;
+    std::vector<RankedCandidateNode> ranked_candidates_list;
+    std::vector<NodeID> packed_forward_path;
+    std::vector<NodeID> packed_reverse_path;
+    std::vector<NodeID> packed_alternate_path;
+    std::vector<NodeID> packed_s_v_path;
+    std::vector<NodeID> packed_v_t_path;
+    std::vector<NodeID> partially_unpacked_shortest_path;
+    std::vector<NodeID> partially_unpacked_via_path;
+    ReusableHashTable<NodeID, bool> nodes_in_path;
+    ReusableHashTable<NodeID, int> approximated_forward_sharing;
+    ReusableHashTable<NodeID, int> approximated_reverse_sharing;
+    UnpackedPathCache shortest_path_cache;
+    std::vector<int> partially_unpacked_shortest_path_lengths;
+    std::vector<AlternativePathCandidate> tested_candidates;
+    std::vector<std::size_t> selected_candidates;
+    ReusableHashTable<NodeID, unsigned> nodes_in_alternatives;
+
+    // path unpacking
+    std::vector<SearchSpaceEdge> unpack_stack;
+    std::vector<unsigned> geometry_buffer;
+
+  private:
+    std::size_t Footprint() const;
+
+#ifndef NDEBUG
+    friend struct SearchEngineData;
+    void UpdateCapacityGrowthCount();
+
+    std::size_t capacity_growth_count;
+    std::size_t last_footprint;
+#endif
+};
+
+struct SearchEngineData
+{
+    typedef SearchWorkspace::QueryHeap QueryHeap;
+    typedef boost::thread_specific_ptr<SearchWorkspace> SearchWorkspacePtr;
 
-    void InitializeOrClearSecondThreadLocalStorage(const unsigned number_of_nodes);
+    static SearchWorkspacePtr workspace;
 
-    void InitializeOrClearThirdThreadLocalStorage(const unsigned number_of_nodes);
+    // Returns the calling thread's workspace, creating it on first use. Heaps are not cleared,
+    // every algorithm clears what it is about to use.
+    SearchWorkspace &GetThreadLocalWorkspace(const unsigned number_of_nodes);
 };
 
 #endif // SEARCH_ENGINE_DATA_H
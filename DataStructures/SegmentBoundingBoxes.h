@@ -0,0 +1,294 @@
+/*
+
+Copyright (c) 2014, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef SEGMENT_BOUNDING_BOXES_H
+#define SEGMENT_BOUNDING_BOXES_H
+
+#include <osrm/Coordinate.h>
+
+#include <boost/assert.hpp>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define OSRM_AVX2_LEAF_SCAN
+#endif
+
+#include <cmath>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+
+// How a leaf scan bounds the distance to its segments before measuring them exactly. Exact
+// measures every segment, the others compute lower bounds from bounding boxes and only measure
+// the segments that may come closer than what was found so far.
+enum class LeafScanKernel
+{
+    Exact,
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+inline bool IsLeafScanKernelSupported(const LeafScanKernel kernel)
+{
+    switch (kernel)
+    {
+    case LeafScanKernel::Exact:
+    case LeafScanKernel::Scalar:
+        return true;
+    case LeafScanKernel::SSE2:
+#ifdef __SSE2__
+        return true;
+#else
+        return false;
+#endif
+    case LeafScanKernel::AVX2:
+#ifdef OSRM_AVX2_LEAF_SCAN
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+inline LeafScanKernel GetFastestLeafScanKernel()
+{
+    static const LeafScanKernel fastest_kernel =
+        IsLeafScanKernelSupported(LeafScanKernel::AVX2)
+            ? LeafScanKernel::AVX2
+            : (IsLeafScanKernelSupported(LeafScanKernel::SSE2) ? LeafScanKernel::SSE2
+                                                                 : LeafScanKernel::Scalar);
+    return fastest_kernel;
+}
+
+inline const char *GetLeafScanKernelName(const LeafScanKernel kernel)
+{
+    switch (kernel)
+    {
+    case LeafScanKernel::Exact:
+        return "exact";
+    case LeafScanKernel::Scalar:
+        return "scalar";
+    case LeafScanKernel::SSE2:
+        return "sse2";
+    case LeafScanKernel::AVX2:
+        return "avx2";
+    }
+    return "unknown";
+}
+
+// Structure-of-arrays of the bounding boxes of the segments in an r-tree leaf, in fixed point
+// coordinates. The boxes are padded by a bit more than the rounding errors of the exact
+// perpendicular distance, so the bounds computed from them stay below it.
+template <uint32_t CAPACITY> struct SegmentBoundingBoxes
+{
+    SegmentBoundingBoxes() : number_of_segments(0), min_lat_of_all(0), max_lat_of_all(0) {}
+
+    void Initialize(const FixedPointCoordinate *sources,
+                    const FixedPointCoordinate *targets,
+                    const uint32_t segment_count)
+    {
+        BOOST_ASSERT(segment_count <= CAPACITY);
+        number_of_segments = segment_count;
+        min_lat_of_all = static_cast<int32_t>(90 * COORDINATE_PRECISION);
+        max_lat_of_all = static_cast<int32_t>(-90 * COORDINATE_PRECISION);
+        for (uint32_t i = 0; i < segment_count; ++i)
+        {
+            const FixedPointCoordinate &source = sources[i];
+            const FixedPointCoordinate &target = targets[i];
+            const int32_t lat_padding = std::abs(source.lat - target.lat) / 64 + 2;
+            const int32_t lon_padding = std::abs(source.lon - target.lon) / 64 + 2;
+            min_lat[i] = std::min(source.lat, target.lat) - lat_padding;
+            max_lat[i] = std::max(source.lat, target.lat) + lat_padding;
+            min_lon[i] = std::min(source.lon, target.lon) - lon_padding;
+            max_lon[i] = std::max(source.lon, target.lon) + lon_padding;
+            min_lat_of_all = std::min(min_lat_of_all, min_lat[i]);
+            max_lat_of_all = std::max(max_lat_of_all, max_lat[i]);
+        }
+    }
+
+    // Writes a lower bound on the distance in meters from location to every segment
+    void ComputeLowerBounds(const FixedPointCoordinate &location,
+                            const LeafScanKernel kernel,
+                            float *lower_bounds) const
+    {
+        BOOST_ASSERT(LeafScanKernel::Exact != kernel);
+        BOOST_ASSERT(IsLeafScanKernelSupported(kernel));
+        const float lon_scale = GetLongitudeScale(location);
+        // meters per fixed point unit of latitude, shrunk by the relative error of the float math
+        const float meters_per_unit =
+            6372797.560856f * 0.017453292519943295f / COORDINATE_PRECISION * 0.999f;
+        uint32_t first = 0;
+        switch (kernel)
+        {
+        case LeafScanKernel::AVX2:
+#ifdef OSRM_AVX2_LEAF_SCAN
+            first = ComputeLowerBoundsAVX2(location, lon_scale, meters_per_unit, lower_bounds);
+#endif
+            break;
+        case LeafScanKernel::SSE2:
+#ifdef __SSE2__
+            first = ComputeLowerBoundsSSE2(location, lon_scale, meters_per_unit, lower_bounds);
+#endif
+            break;
+        default:
+            break;
+        }
+        // the kernels leave the segments that do not fill a whole register to this
+        for (uint32_t i = first; i < number_of_segments; ++i)
+        {
+            const float lat_distance = static_cast<float>(
+                std::max(std::max(min_lat[i] - location.lat, location.lat - max_lat[i]), 0));
+            const float lon_distance = lon_scale * static_cast<float>(std::max(
+                                                       std::max(min_lon[i] - location.lon,
+                                                                location.lon - max_lon[i]),
+                                                       0));
+            lower_bounds[i] =
+                std::sqrt(lat_distance * lat_distance + lon_distance * lon_distance) *
+                    meters_per_unit -
+                ROUNDING_SLACK;
+        }
+    }
+
+    uint32_t number_of_segments;
+    int32_t min_lat_of_all;
+    int32_t max_lat_of_all;
+    std::array<int32_t, CAPACITY> min_lat;
+    std::array<int32_t, CAPACITY> max_lat;
+    std::array<int32_t, CAPACITY> min_lon;
+    std::array<int32_t, CAPACITY> max_lon;
+
+  private:
+    // absolute rounding error of the exact distance at large longitudes
+    static constexpr float ROUNDING_SLACK = 4.f;
+
+    // The exact distance scales longitudes by the cosine of the mean latitude of location and
+    // foot point, which is no smaller than at the extreme latitudes of location and leaf.
+    float GetLongitudeScale(const FixedPointCoordinate &location) const
+    {
+        const double RAD = 0.017453292519943295769236907684886 / COORDINATE_PRECISION;
+        const double max_lat = 90. * COORDINATE_PRECISION;
+        const double lowest_lat = std::max(-max_lat, std::min<double>(min_lat_of_all, location.lat));
+        const double highest_lat = std::min(max_lat, std::max<double>(max_lat_of_all, location.lat));
+        return static_cast<float>(
+            std::max(0., std::min(std::cos(lowest_lat * RAD), std::cos(highest_lat * RAD))));
+    }
+
+#ifdef __SSE2__
+    uint32_t ComputeLowerBoundsSSE2(const FixedPointCoordinate &location,
+                                    const float lon_scale,
+                                    const float meters_per_unit,
+                                    float *lower_bounds) const
+    {
+        const __m128i lat = _mm_set1_epi32(location.lat);
+        const __m128i lon = _mm_set1_epi32(location.lon);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 scale = _mm_set1_ps(lon_scale);
+        const __m128 unit = _mm_set1_ps(meters_per_unit);
+        const __m128 slack = _mm_set1_ps(ROUNDING_SLACK);
+        uint32_t i = 0;
+        for (; i + 4 <= number_of_segments; i += 4)
+        {
+            const __m128 lat_distance = _mm_max_ps(
+                _mm_max_ps(_mm_cvtepi32_ps(_mm_sub_epi32(Load128(min_lat, i), lat)),
+                           _mm_cvtepi32_ps(_mm_sub_epi32(lat, Load128(max_lat, i)))),
+                zero);
+            const __m128 lon_distance = _mm_mul_ps(
+                _mm_max_ps(
+                    _mm_max_ps(_mm_cvtepi32_ps(_mm_sub_epi32(Load128(min_lon, i), lon)),
+                               _mm_cvtepi32_ps(_mm_sub_epi32(lon, Load128(max_lon, i)))),
+                    zero),
+                scale);
+            const __m128 distance =
+                _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(lat_distance, lat_distance),
+                                       _mm_mul_ps(lon_distance, lon_distance)));
+            _mm_storeu_ps(lower_bounds + i,
+                          _mm_sub_ps(_mm_mul_ps(distance, unit), slack));
+        }
+        return i;
+    }
+
+    static __m128i Load128(const std::array<int32_t, CAPACITY> &values, const uint32_t i)
+    {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i *>(values.data() + i));
+    }
+#endif
+
+#ifdef OSRM_AVX2_LEAF_SCAN
+    __attribute__((target("avx2"))) uint32_t
+    ComputeLowerBoundsAVX2(const FixedPointCoordinate &location,
+                           const float lon_scale,
+                           const float meters_per_unit,
+                           float *lower_bounds) const
+    {
+        const __m256i lat = _mm256_set1_epi32(location.lat);
+        const __m256i lon = _mm256_set1_epi32(location.lon);
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 scale = _mm256_set1_ps(lon_scale);
+        const __m256 unit = _mm256_set1_ps(meters_per_unit);
+        const __m256 slack = _mm256_set1_ps(ROUNDING_SLACK);
+        uint32_t i = 0;
+        for (; i + 8 <= number_of_segments; i += 8)
+        {
+            const __m256 lat_distance = _mm256_max_ps(
+                _mm256_max_ps(
+                    _mm256_cvtepi32_ps(_mm256_sub_epi32(Load256(min_lat, i), lat)),
+                    _mm256_cvtepi32_ps(_mm256_sub_epi32(lat, Load256(max_lat, i)))),
+                zero);
+            const __m256 lon_distance = _mm256_mul_ps(
+                _mm256_max_ps(
+                    _mm256_max_ps(
+                        _mm256_cvtepi32_ps(_mm256_sub_epi32(Load256(min_lon, i), lon)),
+                        _mm256_cvtepi32_ps(_mm256_sub_epi32(lon, Load256(max_lon, i)))),
+                    zero),
+                scale);
+            const __m256 distance =
+                _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(lat_distance, lat_distance),
+                                             _mm256_mul_ps(lon_distance, lon_distance)));
+            _mm256_storeu_ps(lower_bounds + i,
+                             _mm256_sub_ps(_mm256_mul_ps(distance, unit), slack));
+        }
+        return i;
+    }
+
+    __attribute__((target("avx2"))) static __m256i
+    Load256(const std::array<int32_t, CAPACITY> &values, const uint32_t i)
+    {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values.data() + i));
+    }
+#endif
+};
+
+template <uint32_t CAPACITY> constexpr float SegmentBoundingBoxes<CAPACITY>::ROUNDING_SLACK;
+
+#endif // SEGMENT_BOUNDING_BOXES_H
@@ -28,16 +28,19 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef STATICRTREE_H
 #define STATICRTREE_H
 
+#include "ConcurrentLeafCache.h"
 #include "DeallocatingVector.h"
 #include "HilbertValue.h"
 #include "PhantomNodes.h"
 #include "QueryNode.h"
+#include "SegmentBoundingBoxes.h"
 #include "SharedMemoryFactory.h"
 #include "SharedMemoryVectorWrapper.h"
 
 #include "../Util/MercatorUtil.h"
 #include "../Util/NumericUtil.h"
 #include "../Util/OSRMException.h"
+#include "../Util/QueryDeadline.h"
 #include "../Util/SimpleLogger.h"
 #include "../Util/TimingUtil.h"
 #include "../typedefs.h"
@@ -48,19 +51,44 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
 #include <boost/thread.hpp>
-#include <boost/variant.hpp>
 
 #include <tbb/parallel_for.h>
 #include <tbb/parallel_sort.h>
 
 #include <algorithm>
 #include <array>
+#include <bitset>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
 #include <limits>
 #include <memory>
 #include <queue>
 #include <string>
+#include <tuple>
 #include <vector>
 
+// How the segments are grouped into leaves and the nodes into their parents. Hilbert packs runs
+// of the Hilbert curve through the centroids, SortTileRecursive cuts each level into vertical
+// slices by longitude and packs runs of each slice sorted by latitude.
+enum class RTreePacking
+{
+    Hilbert,
+    SortTileRecursive
+};
+
+inline const char *GetRTreePackingName(const RTreePacking packing)
+{
+    switch (packing)
+    {
+    case RTreePacking::Hilbert:
+        return "hilbert";
+    case RTreePacking::SortTileRecursive:
+        return "str";
+    }
+    return "unknown";
+}
+
 // Implements a static, i.e. packed, R-tree
 template <class EdgeDataT,
           class CoordinateListT = std::vector<FixedPointCoordinate>,
@@ -238,6 +266,26 @@ class StaticRTree
             return min_max_dist;
         }
 
+        // in squared fixed point units, empty rectangles have no area
+        inline double GetArea() const
+        {
+            if (min_lat > max_lat || min_lon > max_lon)
+            {
+                return 0.;
+            }
+            return (double(max_lat) - min_lat) * (double(max_lon) - min_lon);
+        }
+
+        inline double GetIntersectionArea(const RectangleInt2D &other) const
+        {
+            RectangleInt2D intersection;
+            intersection.min_lat = std::max(min_lat, other.min_lat);
+            intersection.max_lat = std::min(max_lat, other.max_lat);
+            intersection.min_lon = std::max(min_lon, other.min_lon);
+            intersection.max_lon = std::min(max_lon, other.max_lon);
+            return intersection.GetArea();
+        }
+
         inline bool Contains(const FixedPointCoordinate &location) const
         {
             const bool lats_contained = (location.lat >= min_lat) && (location.lat <= max_lat);
@@ -258,7 +306,7 @@ class StaticRTree
 
     struct TreeNode
     {
-        TreeNode() : child_count(0), child_is_on_disk(false) {}
+        TreeNode() : child_count(0), child_is_on_disk(false), children() {}
         RectangleT minimum_bounding_rectangle;
         uint32_t child_count : 31;
         bool child_is_on_disk : 1;
@@ -284,6 +332,13 @@ class StaticRTree
         }
     };
 
+    // A segment or tree node as Sort-Tile-Recursive packing orders it
+    struct TileEntry
+    {
+        FixedPointCoordinate center;
+        uint32_t index;
+    };
+
     struct LeafNode
     {
         LeafNode() : object_count(0), objects() {}
@@ -291,6 +346,61 @@ class StaticRTree
         std::array<EdgeDataT, LEAF_NODE_SIZE> objects;
     };
 
+    // Leaf record of the compact format. It is followed by a bitset of the segments in tiny
+    // components and by the source lats, source lons, target lats and target lons of the
+    // segments as offsets from the corner of the leaf, in two bytes each if they fit.
+    struct CompactLeafHeader
+    {
+        uint32_t object_count;
+        uint32_t coordinate_bytes;
+        int32_t min_lat;
+        int32_t min_lon;
+    };
+
+    // A leaf as queries scan it, with the bounding boxes of its segments laid out for the kernels.
+    // The other data of a segment is only read once it makes it into a result.
+    struct QueryLeaf
+    {
+        QueryLeaf() : object_count(0) {}
+        uint32_t object_count;
+        std::array<FixedPointCoordinate, LEAF_NODE_SIZE> sources;
+        std::array<FixedPointCoordinate, LEAF_NODE_SIZE> targets;
+        std::bitset<LEAF_NODE_SIZE> is_in_tiny_cc;
+        SegmentBoundingBoxes<LEAF_NODE_SIZE> bounding_boxes;
+    };
+
+  public:
+    // Leads the leaf file. Legacy leaf files start with the element count, which never equals
+    // the magic number, and hold a LeafNode per leaf. Versioned files keep the segments in a
+    // segment file of their own.
+    struct LeafFileHeader
+    {
+        uint64_t magic_number;
+        uint32_t version;
+        uint32_t leaf_node_size;
+        uint64_t element_count;
+    };
+
+    // How well the nodes of a level of the tree separate space, level 0 holds the root. Coverage
+    // sums the areas of the bounding rectangles of the nodes, overlap sums the areas that the
+    // rectangles of siblings share, both relative to the area of the root.
+    struct LevelStatistics
+    {
+        uint32_t level;
+        uint64_t number_of_nodes;
+        double coverage;
+        double overlap;
+    };
+
+    // "OSRMLEAF"
+    static constexpr uint64_t LEAF_FILE_MAGIC_NUMBER = 0x4641454c4d52534fULL;
+    static constexpr uint32_t LEAF_FILE_VERSION = 2;
+
+    typedef ConcurrentLeafCache<QueryLeaf> LeafCache;
+
+  private:
+    typedef typename LeafCache::LeafPtr LeafPtr;
+
     struct QueryCandidate
     {
         explicit QueryCandidate(const float dist, const uint32_t n_id)
@@ -307,172 +417,381 @@ class StaticRTree
         }
     };
 
-    typedef boost::variant<TreeNode, EdgeDataT> IncrementalQueryNodeType;
-    struct IncrementalQueryCandidate
+    // Leaves loaded during a batch of queries, replaced round-robin. Queries sorted by Hilbert
+    // value mostly need the leaves their predecessors loaded.
+    struct BatchLeafCache
+    {
+        static const uint32_t NUMBER_OF_LEAVES = 16;
+
+        BatchLeafCache() : next_slot(0) { leaf_ids.fill(UINT_MAX); }
+
+        std::array<uint32_t, NUMBER_OF_LEAVES> leaf_ids;
+        std::array<LeafPtr, NUMBER_OF_LEAVES> leaves;
+        uint32_t next_slot;
+    };
+
+    // a lower bound must exceed a distance by this much to rule out an EpsilonCompare tie with it
+    static constexpr float LOWER_BOUND_TIE_MARGIN = 1e-3f;
+
+    // A segment queued by an incremental search
+    struct QueuedSegment
     {
-        explicit IncrementalQueryCandidate(const float dist, const IncrementalQueryNodeType &node)
-            : min_dist(dist), node(node)
+        explicit QueuedSegment(const FixedPointCoordinate &source,
+                               const FixedPointCoordinate &target,
+                               const bool is_in_tiny_cc)
+            : source(source), target(target), is_in_tiny_cc(is_in_tiny_cc)
         {
         }
 
-        IncrementalQueryCandidate() : min_dist(std::numeric_limits<float>::max()) {}
+        FixedPointCoordinate source;
+        FixedPointCoordinate target;
+        bool is_in_tiny_cc;
+    };
+
+    // What an incremental search dequeues next, a tree node or a queued segment
+    struct IncrementalQueryCandidate
+    {
+        inline bool RepresentsTreeNode() const { return represents_tree_node; }
+
+        float min_dist;
+        bool represents_tree_node;
+        // id of the tree node or index into the queued segments
+        uint32_t index;
+        // position of the segment in the leaf file
+        uint64_t position;
+    };
 
-        inline bool operator<(const IncrementalQueryCandidate &other) const
+    // Priority queue of an incremental search with separate heaps of small entries for tree
+    // nodes and segments. Candidates are dequeued by distance, ties are broken by the position of
+    // segments in the leaf file and then by tree node id, so equally distant candidates are
+    // dequeued the same way no matter which other candidates were queued. Keeps its storage
+    // between searches.
+    class IncrementalQueryQueue
+    {
+        struct TreeNodeEntry
         {
-            // Attn: this is reversed order. std::pq is a max pq!
-            return other.min_dist < min_dist;
+            float min_dist;
+            uint32_t node_id;
+
+            inline bool operator<(const TreeNodeEntry &other) const
+            {
+                // Attn: this is reversed order. std heaps are max heaps!
+                if (other.min_dist != min_dist)
+                {
+                    return other.min_dist < min_dist;
+                }
+                return other.node_id < node_id;
+            }
+        };
+
+        struct SegmentEntry
+        {
+            float min_dist;
+            uint32_t segment_index;
+            uint64_t position;
+
+            inline bool operator<(const SegmentEntry &other) const
+            {
+                // Attn: this is reversed order. std heaps are max heaps!
+                if (other.min_dist != min_dist)
+                {
+                    return other.min_dist < min_dist;
+                }
+                return other.position < position;
+            }
+        };
+
+      public:
+        inline bool Empty() const { return tree_nodes.empty() && segments.empty(); }
+
+        inline void Clear()
+        {
+            tree_nodes.clear();
+            segments.clear();
+            queued_segments.clear();
         }
 
-        inline bool RepresentsTreeNode() const
+        inline void PushTreeNode(const float min_dist, const uint32_t node_id)
         {
-            return boost::apply_visitor(decide_type_visitor(), node);
+            tree_nodes.push_back({min_dist, node_id});
+            std::push_heap(tree_nodes.begin(), tree_nodes.end());
         }
 
-        float min_dist;
-        IncrementalQueryNodeType node;
+        inline void
+        PushSegment(const float min_dist, const QueuedSegment &segment, const uint64_t position)
+        {
+            segments.push_back({min_dist, static_cast<uint32_t>(queued_segments.size()), position});
+            std::push_heap(segments.begin(), segments.end());
+            queued_segments.push_back(segment);
+        }
 
-      private:
-        class decide_type_visitor : public boost::static_visitor<bool>
+        inline IncrementalQueryCandidate Pop()
         {
-          public:
-            bool operator()(const TreeNode &) const { return true; }
+            BOOST_ASSERT(!Empty());
+            // segments come before tree nodes at the same distance
+            if (tree_nodes.empty() ||
+                (!segments.empty() && segments.front().min_dist <= tree_nodes.front().min_dist))
+            {
+                const SegmentEntry entry = segments.front();
+                std::pop_heap(segments.begin(), segments.end());
+                segments.pop_back();
+                return {entry.min_dist, false, entry.segment_index, entry.position};
+            }
+            const TreeNodeEntry entry = tree_nodes.front();
+            std::pop_heap(tree_nodes.begin(), tree_nodes.end());
+            tree_nodes.pop_back();
+            return {entry.min_dist, true, entry.node_id, 0};
+        }
 
-            template<typename AnotherType>
-            bool operator()(const AnotherType &) const { return false; }
-        };
+        inline const QueuedSegment &GetSegment(const IncrementalQueryCandidate &candidate) const
+        {
+            BOOST_ASSERT(!candidate.RepresentsTreeNode());
+            return queued_segments[candidate.index];
+        }
+
+      private:
+        std::vector<TreeNodeEntry> tree_nodes;
+        std::vector<SegmentEntry> segments;
+        std::vector<QueuedSegment> queued_segments;
     };
 
     typename ShM<TreeNode, UseSharedMemory>::vector m_search_tree;
     uint64_t m_element_count;
     const std::string m_leaf_node_filename;
+    const std::string m_segment_data_filename;
     std::shared_ptr<CoordinateListT> m_coordinate_list;
     boost::filesystem::ifstream leaves_stream;
+    boost::filesystem::ifstream segments_stream;
+    std::shared_ptr<LeafCache> m_leaf_cache;
+    std::unique_ptr<BatchLeafCache> m_batch_leaf_cache;
+    // the leaf last handed out by LoadLeaf, kept alive while it is scanned
+    LeafPtr m_pinned_leaf;
+    LeafScanKernel m_leaf_scan_kernel = GetFastestLeafScanKernel();
+    // leaves handed out by LoadLeaf, whether they came from a cache or the disk
+    uint64_t m_number_of_visited_leaves = 0;
+    // lower bounds and indices of the segments of a leaf in the order they are measured
+    std::vector<std::pair<float, uint32_t>> m_scan_order;
+    IncrementalQueryQueue m_incremental_queue;
+    // offsets of the compact leaves in the leaf file followed by the end of the last leaf,
+    // empty if the file has the legacy format
+    std::vector<uint64_t> m_leaf_offsets;
+    std::vector<char> m_leaf_record;
+    std::unique_ptr<LeafNode> m_legacy_leaf;
 
   public:
     StaticRTree() = delete;
     StaticRTree(const StaticRTree &) = delete;
 
-    // Construct a packed Hilbert-R-Tree with Kamel-Faloutsos algorithm [1]
+    // Construct a packed Hilbert-R-Tree with Kamel-Faloutsos algorithm [1] or, on request, an
+    // R-tree packed with Sort-Tile-Recursive [4]
     explicit StaticRTree(std::vector<EdgeDataT> &input_data_vector,
                          const std::string tree_node_filename,
                          const std::string leaf_node_filename,
-                         const std::vector<NodeInfo> &coordinate_list)
-        : m_element_count(input_data_vector.size()), m_leaf_node_filename(leaf_node_filename)
+                         const std::string segment_data_filename,
+                         const std::vector<NodeInfo> &coordinate_list,
+                         const RTreePacking packing = RTreePacking::Hilbert)
+        : m_element_count(input_data_vector.size()), m_leaf_node_filename(leaf_node_filename),
+          m_segment_data_filename(segment_data_filename)
     {
         SimpleLogger().Write() << "constructing r-tree of " << m_element_count
                                << " edge elements build on-top of " << coordinate_list.size()
-                               << " coordinates";
+                               << " coordinates, packed by " << GetRTreePackingName(packing);
 
         TIMER_START(construction);
         std::vector<WrappedInputElement> input_wrapper_vector(m_element_count);
 
-        HilbertCode get_hilbert_number;
+        if (RTreePacking::Hilbert == packing)
+        {
+            HilbertCode get_hilbert_number;
 
-        // generate auxiliary vector of hilbert-values
-        tbb::parallel_for(
-            tbb::blocked_range<uint64_t>(0, m_element_count),
-            [&input_data_vector, &input_wrapper_vector, &get_hilbert_number, &coordinate_list](
-                const tbb::blocked_range<uint64_t> &range)
-            {
-                for (uint64_t element_counter = range.begin(); element_counter != range.end();
-                     ++element_counter)
+            // generate auxiliary vector of hilbert-values
+            tbb::parallel_for(
+                tbb::blocked_range<uint64_t>(0, m_element_count),
+                [&input_data_vector, &input_wrapper_vector, &get_hilbert_number, &coordinate_list](
+                    const tbb::blocked_range<uint64_t> &range)
                 {
-                    WrappedInputElement &current_wrapper = input_wrapper_vector[element_counter];
-                    current_wrapper.m_array_index = element_counter;
-
-                    EdgeDataT const &current_element = input_data_vector[element_counter];
+                    for (uint64_t element_counter = range.begin(); element_counter != range.end();
+                         ++element_counter)
+                    {
+                        WrappedInputElement &current_wrapper =
+                            input_wrapper_vector[element_counter];
+                        current_wrapper.m_array_index = element_counter;
 
-                    // Get Hilbert-Value for centroid in mercartor projection
-                    FixedPointCoordinate current_centroid = EdgeDataT::Centroid(
-                        FixedPointCoordinate(coordinate_list.at(current_element.u).lat,
-                                             coordinate_list.at(current_element.u).lon),
-                        FixedPointCoordinate(coordinate_list.at(current_element.v).lat,
-                                             coordinate_list.at(current_element.v).lon));
-                    current_centroid.lat =
-                        COORDINATE_PRECISION * lat2y(current_centroid.lat / COORDINATE_PRECISION);
+                        // Get Hilbert-Value for centroid in mercartor projection
+                        current_wrapper.m_hilbert_value = get_hilbert_number(GetProjectedCentroid(
+                            input_data_vector[element_counter], coordinate_list));
+                    }
+                });
 
-                    current_wrapper.m_hilbert_value = get_hilbert_number(current_centroid);
+            // sort the hilbert-value representatives
+            tbb::parallel_sort(input_wrapper_vector.begin(), input_wrapper_vector.end());
+        }
+        else
+        {
+            std::vector<TileEntry> tile_entries(m_element_count);
+            tbb::parallel_for(tbb::blocked_range<uint64_t>(0, m_element_count),
+                              [&input_data_vector, &tile_entries, &coordinate_list](
+                                  const tbb::blocked_range<uint64_t> &range)
+                              {
+                for (uint64_t element_counter = range.begin(); element_counter != range.end();
+                     ++element_counter)
+                {
+                    tile_entries[element_counter].center =
+                        GetProjectedCentroid(input_data_vector[element_counter], coordinate_list);
+                    tile_entries[element_counter].index = element_counter;
                 }
             });
+            SortTileRecursive(tile_entries, LEAF_NODE_SIZE);
+            for (uint64_t element_counter = 0; element_counter < m_element_count; ++element_counter)
+            {
+                input_wrapper_vector[element_counter].m_array_index =
+                    tile_entries[element_counter].index;
+            }
+        }
 
-        // open leaf file
+        // open leaf file, the offsets of the leaves are filled in once they are written
+        const uint64_t number_of_leaves = (m_element_count + LEAF_NODE_SIZE - 1) / LEAF_NODE_SIZE;
+        const LeafFileHeader leaf_file_header = {
+            LEAF_FILE_MAGIC_NUMBER, LEAF_FILE_VERSION, LEAF_NODE_SIZE, m_element_count};
+        std::vector<uint64_t> leaf_offsets;
+        leaf_offsets.reserve(number_of_leaves + 1);
+        const uint64_t first_leaf_offset =
+            sizeof(LeafFileHeader) + (number_of_leaves + 1) * sizeof(uint64_t);
         boost::filesystem::ofstream leaf_node_file(leaf_node_filename, std::ios::binary);
-        leaf_node_file.write((char *)&m_element_count, sizeof(uint64_t));
-
-        // sort the hilbert-value representatives
-        tbb::parallel_sort(input_wrapper_vector.begin(), input_wrapper_vector.end());
-        std::vector<TreeNode> tree_nodes_in_level;
-
-        // pack M elements into leaf node and write to leaf file
-        uint64_t processed_objects_count = 0;
-        while (processed_objects_count < m_element_count)
+        leaf_node_file.write((char *)&leaf_file_header, sizeof(LeafFileHeader));
+        leaf_node_file.seekp(first_leaf_offset);
+
+        // pack M elements into each leaf node, batches of leaves are built in parallel and
+        // written in one go
+        const uint64_t leaf_write_batch_size = 256;
+        std::vector<TreeNode> tree_nodes_in_level(number_of_leaves);
+        std::vector<std::vector<char>> leaf_records(
+            std::min(number_of_leaves, leaf_write_batch_size));
+        std::vector<char> write_buffer;
+        uint64_t current_leaf_offset = first_leaf_offset;
+        for (uint64_t batch_begin = 0; batch_begin < number_of_leaves;
+             batch_begin += leaf_write_batch_size)
         {
-
-            LeafNode current_leaf;
-            TreeNode current_node;
-            // SimpleLogger().Write() << "reading " << tree_size << " tree nodes in " <<
-            // (sizeof(TreeNode)*tree_size) << " bytes";
-            for (uint32_t current_element_index = 0; LEAF_NODE_SIZE > current_element_index;
-                 ++current_element_index)
-            {
-                if (m_element_count > (processed_objects_count + current_element_index))
+            const uint64_t batch_end =
+                std::min(batch_begin + leaf_write_batch_size, number_of_leaves);
+            tbb::parallel_for(
+                tbb::blocked_range<uint64_t>(batch_begin, batch_end),
+                [this,
+                 batch_begin,
+                 &input_data_vector,
+                 &input_wrapper_vector,
+                 &coordinate_list,
+                 &tree_nodes_in_level,
+                 &leaf_records](const tbb::blocked_range<uint64_t> &range)
                 {
-                    uint32_t index_of_next_object =
-                        input_wrapper_vector[processed_objects_count + current_element_index]
-                            .m_array_index;
-                    current_leaf.objects[current_element_index] =
-                        input_data_vector[index_of_next_object];
-                    ++current_leaf.object_count;
-                }
-            }
+                    std::unique_ptr<LeafNode> current_leaf(new LeafNode);
+                    for (uint64_t leaf_id = range.begin(); leaf_id != range.end(); ++leaf_id)
+                    {
+                        const uint64_t first_element = leaf_id * LEAF_NODE_SIZE;
+                        current_leaf->object_count = static_cast<uint32_t>(
+                            std::min<uint64_t>(LEAF_NODE_SIZE, m_element_count - first_element));
+                        for (uint32_t i = 0; i < current_leaf->object_count; ++i)
+                        {
+                            current_leaf->objects[i] =
+                                input_data_vector[input_wrapper_vector[first_element + i]
+                                                      .m_array_index];
+                        }
 
-            // generate tree node that resemble the objects in leaf and store it for next level
-            current_node.minimum_bounding_rectangle.InitializeMBRectangle(
-                current_leaf.objects, current_leaf.object_count, coordinate_list);
-            current_node.child_is_on_disk = true;
-            current_node.children[0] = tree_nodes_in_level.size();
-            tree_nodes_in_level.emplace_back(current_node);
+                        // generate tree node that resemble the objects in leaf and store it for
+                        // next level
+                        TreeNode &current_node = tree_nodes_in_level[leaf_id];
+                        current_node.minimum_bounding_rectangle.InitializeMBRectangle(
+                            current_leaf->objects, current_leaf->object_count, coordinate_list);
+                        current_node.child_is_on_disk = true;
+                        current_node.children[0] = leaf_id;
+
+                        EncodeCompactLeaf(*current_leaf,
+                                          current_node.minimum_bounding_rectangle,
+                                          coordinate_list,
+                                          leaf_records[leaf_id - batch_begin]);
+                    }
+                });
 
-            // write leaf_node to leaf node file
-            leaf_node_file.write((char *)&current_leaf, sizeof(current_leaf));
-            processed_objects_count += current_leaf.object_count;
+            // write leaf_nodes to leaf node file
+            write_buffer.clear();
+            for (uint64_t leaf_id = batch_begin; leaf_id < batch_end; ++leaf_id)
+            {
+                const std::vector<char> &leaf_record = leaf_records[leaf_id - batch_begin];
+                leaf_offsets.push_back(current_leaf_offset);
+                current_leaf_offset += leaf_record.size();
+                write_buffer.insert(write_buffer.end(), leaf_record.begin(), leaf_record.end());
+            }
+            leaf_node_file.write(write_buffer.data(), write_buffer.size());
         }
+        leaf_offsets.push_back(current_leaf_offset);
+
+        leaf_node_file.seekp(sizeof(LeafFileHeader));
+        leaf_node_file.write((char *)leaf_offsets.data(), leaf_offsets.size() * sizeof(uint64_t));
 
         // close leaf file
         leaf_node_file.close();
 
-        uint32_t processing_level = 0;
+        // the segments in the order of the leaves, read only for results
+        boost::filesystem::ofstream segment_data_file(segment_data_filename, std::ios::binary);
+        std::vector<EdgeDataT> segment_buffer;
+        segment_buffer.reserve(
+            std::min(m_element_count, leaf_write_batch_size * LEAF_NODE_SIZE));
+        for (const WrappedInputElement &wrapped_element : input_wrapper_vector)
+        {
+            segment_buffer.emplace_back(input_data_vector[wrapped_element.m_array_index]);
+            if (segment_buffer.size() == segment_buffer.capacity())
+            {
+                segment_data_file.write((char *)segment_buffer.data(),
+                                        segment_buffer.size() * sizeof(EdgeDataT));
+                segment_buffer.clear();
+            }
+        }
+        segment_data_file.write((char *)segment_buffer.data(),
+                                segment_buffer.size() * sizeof(EdgeDataT));
+        segment_data_file.close();
+
         while (1 < tree_nodes_in_level.size())
         {
-            std::vector<TreeNode> tree_nodes_in_next_level;
-            uint32_t processed_tree_nodes_in_level = 0;
-            while (processed_tree_nodes_in_level < tree_nodes_in_level.size())
+            if (RTreePacking::SortTileRecursive == packing)
             {
-                TreeNode parent_node;
-                // pack BRANCHING_FACTOR elements into tree_nodes each
-                for (uint32_t current_child_node_index = 0;
-                     BRANCHING_FACTOR > current_child_node_index;
-                     ++current_child_node_index)
+                SortTreeNodesByTiles(tree_nodes_in_level);
+            }
+
+            // pack BRANCHING_FACTOR consecutive tree nodes into each parent
+            const uint32_t number_of_children = tree_nodes_in_level.size();
+            const uint32_t number_of_parents =
+                (number_of_children + BRANCHING_FACTOR - 1) / BRANCHING_FACTOR;
+            const uint32_t first_child_id = m_search_tree.size();
+            m_search_tree.resize(first_child_id + number_of_children);
+            std::vector<TreeNode> tree_nodes_in_next_level(number_of_parents);
+            tbb::parallel_for(
+                tbb::blocked_range<uint32_t>(0, number_of_parents),
+                [this,
+                 number_of_children,
+                 first_child_id,
+                 &tree_nodes_in_level,
+                 &tree_nodes_in_next_level](const tbb::blocked_range<uint32_t> &range)
                 {
-                    if (processed_tree_nodes_in_level < tree_nodes_in_level.size())
+                    for (uint32_t parent_id = range.begin(); parent_id != range.end(); ++parent_id)
                     {
-                        TreeNode &current_child_node =
-                            tree_nodes_in_level[processed_tree_nodes_in_level];
-                        // add tree node to parent entry
-                        parent_node.children[current_child_node_index] = m_search_tree.size();
-                        m_search_tree.emplace_back(current_child_node);
-                        // merge MBRs
-                        parent_node.minimum_bounding_rectangle.MergeBoundingBoxes(
-                            current_child_node.minimum_bounding_rectangle);
-                        // increase counters
-                        ++parent_node.child_count;
-                        ++processed_tree_nodes_in_level;
+                        TreeNode &parent_node = tree_nodes_in_next_level[parent_id];
+                        const uint32_t first_child = parent_id * BRANCHING_FACTOR;
+                        const uint32_t last_child =
+                            std::min(first_child + BRANCHING_FACTOR, number_of_children);
+                        for (uint32_t child = first_child; child < last_child; ++child)
+                        {
+                            const TreeNode &current_child_node = tree_nodes_in_level[child];
+                            // add tree node to parent entry
+                            parent_node.children[child - first_child] = first_child_id + child;
+                            m_search_tree[first_child_id + child] = current_child_node;
+                            // merge MBRs
+                            parent_node.minimum_bounding_rectangle.MergeBoundingBoxes(
+                                current_child_node.minimum_bounding_rectangle);
+                        }
+                        parent_node.child_count = last_child - first_child;
                     }
-                }
-                tree_nodes_in_next_level.emplace_back(parent_node);
-            }
+                });
             tree_nodes_in_level.swap(tree_nodes_in_next_level);
-            ++processing_level;
         }
         BOOST_ASSERT_MSG(1 == tree_nodes_in_level.size(), "tree broken, more than one root node");
         // last remaining entry is the root node, store it
@@ -510,13 +829,24 @@ class StaticRTree
         TIMER_STOP(construction);
         SimpleLogger().Write() << "finished r-tree construction in " << TIMER_SEC(construction)
                                << " seconds";
+        for (const LevelStatistics &level_statistics : GetLevelStatistics())
+        {
+            SimpleLogger().Write() << "r-tree level " << level_statistics.level << ": "
+                                   << level_statistics.number_of_nodes << " nodes, coverage "
+                                   << level_statistics.coverage << ", overlap "
+                                   << level_statistics.overlap;
+        }
     }
 
-    // Read-only operation for queries
+    // Read-only operation for queries, the segment file is only needed by leaf files of the
+    // current version
     explicit StaticRTree(const boost::filesystem::path &node_file,
                          const boost::filesystem::path &leaf_file,
-                         const std::shared_ptr<CoordinateListT> coordinate_list)
-        : m_leaf_node_filename(leaf_file.string())
+                         const boost::filesystem::path &segment_file,
+                         const std::shared_ptr<CoordinateListT> coordinate_list,
+                         const std::shared_ptr<LeafCache> leaf_cache = nullptr)
+        : m_leaf_node_filename(leaf_file.string()), m_segment_data_filename(segment_file.string()),
+          m_leaf_cache(leaf_cache)
     {
         // open tree node file and load into RAM.
         m_coordinate_list = coordinate_list;
@@ -550,8 +880,7 @@ class StaticRTree
             throw OSRMException("mem index file is empty");
         }
 
-        leaves_stream.open(leaf_file, std::ios::binary);
-        leaves_stream.read((char *)&m_element_count, sizeof(uint64_t));
+        OpenLeafFile(leaf_file);
 
         // SimpleLogger().Write() << tree_size << " nodes in search tree";
         // SimpleLogger().Write() << m_element_count << " elements in leafs";
@@ -560,9 +889,12 @@ class StaticRTree
     explicit StaticRTree(TreeNode *tree_node_ptr,
                          const uint64_t number_of_nodes,
                          const boost::filesystem::path &leaf_file,
-                         std::shared_ptr<CoordinateListT> coordinate_list)
+                         const boost::filesystem::path &segment_file,
+                         std::shared_ptr<CoordinateListT> coordinate_list,
+                         const std::shared_ptr<LeafCache> leaf_cache = nullptr)
         : m_search_tree(tree_node_ptr, number_of_nodes), m_leaf_node_filename(leaf_file.string()),
-          m_coordinate_list(coordinate_list)
+          m_segment_data_filename(segment_file.string()), m_coordinate_list(coordinate_list),
+          m_leaf_cache(leaf_cache)
     {
         // open leaf node file and store thread specific pointer
         if (!boost::filesystem::exists(leaf_file))
@@ -574,14 +906,74 @@ class StaticRTree
             throw OSRMException("mem index file is empty");
         }
 
-        leaves_stream.open(leaf_file, std::ios::binary);
-        leaves_stream.read((char *)&m_element_count, sizeof(uint64_t));
+        OpenLeafFile(leaf_file);
 
         // SimpleLogger().Write() << tree_size << " nodes in search tree";
         // SimpleLogger().Write() << m_element_count << " elements in leafs";
     }
     // Read-only operation for queries
 
+    std::vector<LevelStatistics> GetLevelStatistics() const
+    {
+        std::vector<LevelStatistics> statistics;
+        if (m_search_tree.empty())
+        {
+            return statistics;
+        }
+        const double root_area = m_search_tree[0].minimum_bounding_rectangle.GetArea();
+        // a tree of a single point or line still reports its coverage
+        const double reference_area = 0. < root_area ? root_area : 1.;
+
+        std::vector<uint32_t> nodes_in_level(1, 0);
+        std::vector<uint32_t> nodes_in_next_level;
+        double overlap_in_level = 0.;
+        while (!nodes_in_level.empty())
+        {
+            LevelStatistics level_statistics;
+            level_statistics.level = statistics.size();
+            level_statistics.number_of_nodes = nodes_in_level.size();
+            level_statistics.coverage = 0.;
+            level_statistics.overlap = overlap_in_level / reference_area;
+
+            nodes_in_next_level.clear();
+            overlap_in_level = 0.;
+            for (const uint32_t node_id : nodes_in_level)
+            {
+                const TreeNode &tree_node = m_search_tree[node_id];
+                level_statistics.coverage += tree_node.minimum_bounding_rectangle.GetArea();
+                if (tree_node.child_is_on_disk)
+                {
+                    continue;
+                }
+                for (uint32_t i = 0; i < tree_node.child_count; ++i)
+                {
+                    const RectangleT &child_rectangle =
+                        m_search_tree[tree_node.children[i]].minimum_bounding_rectangle;
+                    for (uint32_t j = i + 1; j < tree_node.child_count; ++j)
+                    {
+                        overlap_in_level += child_rectangle.GetIntersectionArea(
+                            m_search_tree[tree_node.children[j]].minimum_bounding_rectangle);
+                    }
+                    nodes_in_next_level.push_back(tree_node.children[i]);
+                }
+            }
+            level_statistics.coverage /= reference_area;
+            statistics.push_back(level_statistics);
+            nodes_in_level.swap(nodes_in_next_level);
+        }
+        return statistics;
+    }
+
+    // Selects how leaves are scanned, the fastest kernel the cpu supports by default
+    void SetLeafScanKernel(const LeafScanKernel kernel)
+    {
+        BOOST_ASSERT(IsLeafScanKernelSupported(kernel));
+        m_leaf_scan_kernel = kernel;
+    }
+
+    // Counts the leaves the queries on this r-tree scanned so far
+    uint64_t GetNumberOfVisitedLeaves() const { return m_number_of_visited_leaves; }
+
     bool LocateClosestEndPointForCoordinate(const FixedPointCoordinate &input_coordinate,
                                             FixedPointCoordinate &result_coordinate,
                                             const unsigned zoom_level)
@@ -607,12 +999,12 @@ class StaticRTree
                 TreeNode &current_tree_node = m_search_tree[current_query_node.node_id];
                 if (current_tree_node.child_is_on_disk)
                 {
-                    LeafNode current_leaf_node;
-                    LoadLeafFromDisk(current_tree_node.children[0], current_leaf_node);
-                    for (uint32_t i = 0; i < current_leaf_node.object_count; ++i)
+                    QueryLeaf leaf_buffer;
+                    const QueryLeaf &current_leaf =
+                        LoadLeaf(current_tree_node.children[0], leaf_buffer);
+                    for (uint32_t i = 0; i < current_leaf.object_count; ++i)
                     {
-                        EdgeDataT const &current_edge = current_leaf_node.objects[i];
-                        if (ignore_tiny_components && current_edge.is_in_tiny_cc)
+                        if (ignore_tiny_components && current_leaf.is_in_tiny_cc[i])
                         {
                             continue;
                         }
@@ -621,27 +1013,27 @@ class StaticRTree
                             FixedPointCoordinate::ApproximateEuclideanDistance(
                                 input_coordinate.lat,
                                 input_coordinate.lon,
-                                m_coordinate_list->at(current_edge.u).lat,
-                                m_coordinate_list->at(current_edge.u).lon);
+                                current_leaf.sources[i].lat,
+                                current_leaf.sources[i].lon);
                         if (current_minimum_distance < min_dist)
                         {
                             // found a new minimum
                             min_dist = current_minimum_distance;
-                            result_coordinate = m_coordinate_list->at(current_edge.u);
+                            result_coordinate = current_leaf.sources[i];
                         }
 
                         current_minimum_distance =
                             FixedPointCoordinate::ApproximateEuclideanDistance(
                                 input_coordinate.lat,
                                 input_coordinate.lon,
-                                m_coordinate_list->at(current_edge.v).lat,
-                                m_coordinate_list->at(current_edge.v).lon);
+                                current_leaf.targets[i].lat,
+                                current_leaf.targets[i].lon);
 
                         if (current_minimum_distance < min_dist)
                         {
                             // found a new minimum
                             min_dist = current_minimum_distance;
-                            result_coordinate = m_coordinate_list->at(current_edge.v);
+                            result_coordinate = current_leaf.targets[i];
                         }
                     }
                 }
@@ -664,235 +1056,445 @@ class StaticRTree
                                             std::vector<PhantomNode> &result_phantom_node_vector,
                                             const unsigned zoom_level,
                                             const unsigned number_of_results,
+                                            const QueryDeadline &deadline = QueryDeadline(),
                                             const unsigned max_checked_segments = 4*LEAF_NODE_SIZE)
     {
-        // TIMER_START(samet);
-        // SimpleLogger().Write(logDEBUG) << "searching for " << number_of_results << " results";
-        std::vector<float> min_found_distances(number_of_results, std::numeric_limits<float>::max());
+        IncrementalSearch(input_coordinate,
+                          number_of_results,
+                          std::numeric_limits<float>::max(),
+                          deadline,
+                          max_checked_segments,
+                          [&result_phantom_node_vector](PhantomNode &phantom_node, const float, const bool)
+                          { result_phantom_node_vector.emplace_back(phantom_node); });
 
-        unsigned dequeues = 0;
-        unsigned inspected_mbrs = 0;
-        unsigned loaded_leafs = 0;
-        unsigned inspected_segments = 0;
-        unsigned pruned_elements = 0;
-        unsigned ignored_segments = 0;
-        unsigned ignored_mbrs = 0;
+        // if we found an element in either category, then we are good
+        return !result_phantom_node_vector.empty();
+    }
 
-        unsigned number_of_results_found_in_big_cc = 0;
-        unsigned number_of_results_found_in_tiny_cc = 0;
+    // Same as above, but only finds segments closer than max_distance meters. The results come
+    // with their distance, closest first. The search ends once number_of_results of them are
+    // in big components or no unexplored part of the tree is within max_distance. Results in
+    // tiny components are only kept if there are none in big components.
+    bool
+    IncrementalFindPhantomNodeForCoordinateWithDistance(const FixedPointCoordinate &input_coordinate,
+                                                        std::vector<std::pair<PhantomNode, double>> &result_phantom_node_vector,
+                                                        const unsigned zoom_level,
+                                                        const unsigned number_of_results,
+                                                        const float max_distance = std::numeric_limits<float>::max(),
+                                                        const QueryDeadline &deadline = QueryDeadline(),
+                                                        const unsigned max_checked_segments = 4*LEAF_NODE_SIZE)
+    {
+        // whether each of the results of this search lies in a tiny component
+        std::vector<bool> result_is_in_tiny_cc;
+        const std::size_t first_result = result_phantom_node_vector.size();
+
+        IncrementalSearch(input_coordinate,
+                          number_of_results,
+                          max_distance,
+                          deadline,
+                          max_checked_segments,
+                          [&](PhantomNode &phantom_node, const float distance, const bool is_in_tiny_cc)
+                          {
+                              result_phantom_node_vector.emplace_back(phantom_node, distance);
+                              result_is_in_tiny_cc.push_back(is_in_tiny_cc);
+                          });
+
+        // results in tiny components stand in for missing ones in big components only
+        const bool found_result_in_big_cc =
+            std::find(result_is_in_tiny_cc.begin(), result_is_in_tiny_cc.end(), false) !=
+            result_is_in_tiny_cc.end();
+        if (found_result_in_big_cc)
+        {
+            std::size_t number_of_kept_results = first_result;
+            for (std::size_t i = 0; i < result_is_in_tiny_cc.size(); ++i)
+            {
+                if (!result_is_in_tiny_cc[i])
+                {
+                    result_phantom_node_vector[number_of_kept_results++] =
+                        result_phantom_node_vector[first_result + i];
+                }
+            }
+            result_phantom_node_vector.resize(number_of_kept_results);
+        }
 
-        // initialize queue with root element
-        std::priority_queue<IncrementalQueryCandidate> traversal_queue;
-        traversal_queue.emplace(0.f, m_search_tree[0]);
+        return !result_phantom_node_vector.empty();
+    }
 
-        while (!traversal_queue.empty())
-        {
-            const IncrementalQueryCandidate current_query_node = traversal_queue.top();
-            traversal_queue.pop();
+    bool FindPhantomNodeForCoordinate(const FixedPointCoordinate &input_coordinate,
+                                      PhantomNode &result_phantom_node,
+                                      const unsigned zoom_level)
+    {
+        const bool ignore_tiny_components = (zoom_level <= 14);
+        uint64_t nearest_position = std::numeric_limits<uint64_t>::max();
+        FixedPointCoordinate nearest_source;
+        FixedPointCoordinate nearest_target;
+        FixedPointCoordinate nearest_location;
 
-            ++dequeues;
+        float min_dist = std::numeric_limits<float>::max();
+        float min_max_dist = std::numeric_limits<float>::max();
 
-            const float current_min_dist = min_found_distances[number_of_results-1];
+        std::priority_queue<QueryCandidate> traversal_queue;
+        traversal_queue.emplace(0.f, 0);
 
-            if (current_query_node.min_dist > current_min_dist)
-            {
-                ++pruned_elements;
-                continue;
-            }
+        while (!traversal_queue.empty())
+        {
+            const QueryCandidate current_query_node = traversal_queue.top();
+            traversal_queue.pop();
 
-            if (current_query_node.RepresentsTreeNode())
-            {
-                const TreeNode & current_tree_node = boost::get<TreeNode>(current_query_node.node);
+            const bool prune_downward = (current_query_node.min_dist > min_max_dist);
+            const bool prune_upward = (current_query_node.min_dist > min_dist);
+            if (!prune_downward && !prune_upward)
+            { // downward pruning
+                const TreeNode &current_tree_node = m_search_tree[current_query_node.node_id];
                 if (current_tree_node.child_is_on_disk)
                 {
-                    ++loaded_leafs;
-                    // SimpleLogger().Write(logDEBUG) << "loading leaf: " << current_tree_node.children[0] << " w/ mbr [" <<
-                    //     current_tree_node.minimum_bounding_rectangle.min_lat/COORDINATE_PRECISION << "," <<
-                    //     current_tree_node.minimum_bounding_rectangle.min_lon/COORDINATE_PRECISION << "," <<
-                    //     current_tree_node.minimum_bounding_rectangle.max_lat/COORDINATE_PRECISION << "-" <<
-                    //     current_tree_node.minimum_bounding_rectangle.max_lon/COORDINATE_PRECISION << "]";
-
-                    LeafNode current_leaf_node;
-                    LoadLeafFromDisk(current_tree_node.children[0], current_leaf_node);
-                    // Add all objects from leaf into queue
-                    for (uint32_t i = 0; i < current_leaf_node.object_count; ++i)
+                    QueryLeaf leaf_buffer;
+                    const QueryLeaf &current_leaf =
+                        LoadLeaf(current_tree_node.children[0], leaf_buffer);
+                    std::array<float, LEAF_NODE_SIZE> lower_bounds;
+                    ComputeLowerBounds(current_leaf, input_coordinate, lower_bounds);
+                    const float pruning_distance = MeasureMostPromisingSegment(
+                        current_leaf, input_coordinate, lower_bounds, ignore_tiny_components, min_dist);
+                    for (uint32_t i = 0; i < current_leaf.object_count; ++i)
                     {
-                        const auto &current_edge = current_leaf_node.objects[i];
-                        const float current_perpendicular_distance =
-                            FixedPointCoordinate::ComputePerpendicularDistance(
-                                m_coordinate_list->at(current_edge.u),
-                                m_coordinate_list->at(current_edge.v),
-                                input_coordinate);
-                        // distance must be non-negative
-                        BOOST_ASSERT(0. <= current_perpendicular_distance);
-
-                        if (current_perpendicular_distance < current_min_dist)
+                        if (ignore_tiny_components && current_leaf.is_in_tiny_cc[i])
                         {
-                            traversal_queue.emplace(current_perpendicular_distance, current_edge);
+                            continue;
                         }
-                        else
+                        // cannot come closer than the distance to beat
+                        if (lower_bounds[i] > pruning_distance + LOWER_BOUND_TIE_MARGIN)
                         {
-                            ++ignored_segments;
+                            continue;
                         }
-                    }
-                    // SimpleLogger().Write(logDEBUG) << "added " << current_leaf_node.object_count << " roads into queue of " << traversal_queue.size();
-                }
-                else
-                {
-                    ++inspected_mbrs;
-                    // explore inner node
-                    // SimpleLogger().Write(logDEBUG) << "explore inner node w/ mbr [" <<
-                    //     current_tree_node.minimum_bounding_rectangle.min_lat/COORDINATE_PRECISION << "," <<
-                    //     current_tree_node.minimum_bounding_rectangle.min_lon/COORDINATE_PRECISION << "," <<
-                    //     current_tree_node.minimum_bounding_rectangle.max_lat/COORDINATE_PRECISION << "-" <<
-                    //     current_tree_node.minimum_bounding_rectangle.max_lon/COORDINATE_PRECISION << "," << "]";
 
-                    // for each child mbr
-                    for (uint32_t i = 0; i < current_tree_node.child_count; ++i)
-                    {
-                        const int32_t child_id = current_tree_node.children[i];
-                        const TreeNode &child_tree_node = m_search_tree[child_id];
-                        const RectangleT &child_rectangle = child_tree_node.minimum_bounding_rectangle;
-                        const float lower_bound_to_element = child_rectangle.GetMinDist(input_coordinate);
+                        float current_ratio = 0.;
+                        FixedPointCoordinate nearest;
+                        const float current_perpendicular_distance =
+                            FixedPointCoordinate::ComputePerpendicularDistance(
+                                current_leaf.sources[i],
+                                current_leaf.targets[i],
+                                input_coordinate,
+                                nearest,
+                                current_ratio);
 
-                        // TODO - enough elements found, i.e. nearest distance > maximum distance?
-                        //        ie. some measure of 'confidence of accuracy'
+                        BOOST_ASSERT(0. <= current_perpendicular_distance);
 
-                        // check if it needs to be explored by mindist
-                        if (lower_bound_to_element < current_min_dist)
-                        {
-                            traversal_queue.emplace(lower_bound_to_element, child_tree_node);
-                        }
-                        else
-                        {
-                            ++ignored_mbrs;
+                        if ((current_perpendicular_distance < min_dist) &&
+                            !EpsilonCompare(current_perpendicular_distance, min_dist))
+                        { // found a new minimum
+                            min_dist = current_perpendicular_distance;
+                            nearest_position =
+                                uint64_t(current_tree_node.children[0]) * LEAF_NODE_SIZE + i;
+                            nearest_source = current_leaf.sources[i];
+                            nearest_target = current_leaf.targets[i];
+                            nearest_location = nearest;
                         }
                     }
-                    // SimpleLogger().Write(logDEBUG) << "added " << current_tree_node.child_count << " mbrs into queue of " << traversal_queue.size();
                 }
-            }
-            else
-            {
-                ++inspected_segments;
-                // inspecting an actual road segment
-                const EdgeDataT & current_segment = boost::get<EdgeDataT>(current_query_node.node);
-
-                // don't collect too many results from small components
-                if (number_of_results_found_in_big_cc == number_of_results && !current_segment.is_in_tiny_cc)
+                else
                 {
-                    continue;
+                    min_max_dist = ExploreTreeNode(current_tree_node,
+                                                   input_coordinate,
+                                                   min_dist,
+                                                   min_max_dist,
+                                                   traversal_queue);
                 }
+            }
+        }
 
-                // don't collect too many results from big components
-                if (number_of_results_found_in_tiny_cc == number_of_results && current_segment.is_in_tiny_cc)
-                {
-                    continue;
-                }
+        if (std::numeric_limits<uint64_t>::max() != nearest_position)
+        {
+            EdgeDataT nearest_edge;
+            LoadSegment(nearest_position, nearest_edge);
+            result_phantom_node = {nearest_edge.forward_edge_based_node_id,
+                                   nearest_edge.reverse_edge_based_node_id,
+                                   nearest_edge.name_id,
+                                   nearest_edge.forward_weight,
+                                   nearest_edge.reverse_weight,
+                                   nearest_edge.forward_offset,
+                                   nearest_edge.reverse_offset,
+                                   nearest_edge.packed_geometry_id,
+                                   nearest_location,
+                                   nearest_edge.fwd_segment_position};
 
-                // check if it is smaller than what we had before
-                float current_ratio = 0.;
-                FixedPointCoordinate foot_point_coordinate_on_segment;
-                const float current_perpendicular_distance =
-                    FixedPointCoordinate::ComputePerpendicularDistance(
-                        m_coordinate_list->at(current_segment.u),
-                        m_coordinate_list->at(current_segment.v),
-                        input_coordinate,
-                        foot_point_coordinate_on_segment,
-                        current_ratio);
+            // Hack to fix rounding errors and wandering via nodes.
+            FixUpRoundingIssue(input_coordinate, result_phantom_node);
 
-                BOOST_ASSERT(0. <= current_perpendicular_distance);
+            // set forward and reverse weights on the phantom node
+            SetForwardAndReverseWeightsOnPhantomNode(
+                nearest_source, nearest_target, result_phantom_node);
+        }
+        return result_phantom_node.location.isValid();
+    }
 
-                if ((current_perpendicular_distance < current_min_dist) &&
-                    !EpsilonCompare(current_perpendicular_distance, current_min_dist))
-                {
-                    // store phantom node in result vector
-                    result_phantom_node_vector.emplace_back(
-                        current_segment.forward_edge_based_node_id,
-                         current_segment.reverse_edge_based_node_id,
-                         current_segment.name_id,
-                         current_segment.forward_weight,
-                         current_segment.reverse_weight,
-                         current_segment.forward_offset,
-                         current_segment.reverse_offset,
-                         current_segment.packed_geometry_id,
-                         foot_point_coordinate_on_segment,
-                         current_segment.fwd_segment_position);
+    // Orders queries by the Hilbert value of their coordinate, like the leaves were packed
+    static void SortByHilbertValue(const std::vector<FixedPointCoordinate> &input_coordinates,
+                                   std::vector<uint32_t> &query_order)
+    {
+        HilbertCode get_hilbert_number;
+        std::vector<WrappedInputElement> wrapped_queries(input_coordinates.size());
+        for (uint32_t i = 0; i < input_coordinates.size(); ++i)
+        {
+            FixedPointCoordinate projected_coordinate = input_coordinates[i];
+            projected_coordinate.lat =
+                COORDINATE_PRECISION * lat2y(projected_coordinate.lat / COORDINATE_PRECISION);
+            wrapped_queries[i] = WrappedInputElement(get_hilbert_number(projected_coordinate), i);
+        }
+        std::stable_sort(wrapped_queries.begin(), wrapped_queries.end());
 
-                    // Hack to fix rounding errors and wandering via nodes.
-                    FixUpRoundingIssue(input_coordinate, result_phantom_node_vector.back());
+        query_order.resize(wrapped_queries.size());
+        for (uint32_t i = 0; i < wrapped_queries.size(); ++i)
+        {
+            query_order[i] = wrapped_queries[i].m_array_index;
+        }
+    }
 
-                    // set forward and reverse weights on the phantom node
-                    SetForwardAndReverseWeightsOnPhantomNode(current_segment,
-                                                             result_phantom_node_vector.back());
+    // Answers the queries input_coordinates[*query] for query in [query_begin, query_end) in
+    // this order. Every leaf is loaded once for all of them as long as it is still cached.
+    void IncrementalFindPhantomNodesForCoordinates(
+        const std::vector<FixedPointCoordinate> &input_coordinates,
+        const uint32_t *query_begin,
+        const uint32_t *query_end,
+        PhantomNodeArray &result_phantom_nodes,
+        const unsigned zoom_level,
+        const unsigned number_of_results,
+        const QueryDeadline &deadline = QueryDeadline())
+    {
+        BOOST_ASSERT(result_phantom_nodes.size() == input_coordinates.size());
+        RunBatch(query_begin,
+                 query_end,
+                 [&](const uint32_t query)
+                 {
+            IncrementalFindPhantomNodeForCoordinate(input_coordinates[query],
+                                                    result_phantom_nodes[query],
+                                                    zoom_level,
+                                                    number_of_results,
+                                                    deadline);
+        });
+    }
 
-                    // do we have results only in a small scc
-                    if (current_segment.is_in_tiny_cc)
-                    {
-                        ++number_of_results_found_in_tiny_cc;
-                    }
-                    else
-                    {
-                        // found an element in a large component
-                        min_found_distances[number_of_results_found_in_big_cc] = current_perpendicular_distance;
-                        ++number_of_results_found_in_big_cc;
-                        // SimpleLogger().Write(logDEBUG) << std::setprecision(8) << foot_point_coordinate_on_segment << " at " << current_perpendicular_distance;
-                    }
-                }
+    // Same as above for the single nearest phantom node of each coordinate
+    void FindPhantomNodesForCoordinates(const std::vector<FixedPointCoordinate> &input_coordinates,
+                                        const uint32_t *query_begin,
+                                        const uint32_t *query_end,
+                                        std::vector<PhantomNode> &result_phantom_nodes,
+                                        const unsigned zoom_level)
+    {
+        BOOST_ASSERT(result_phantom_nodes.size() == input_coordinates.size());
+        RunBatch(query_begin,
+                 query_end,
+                 [&](const uint32_t query)
+                 {
+            FindPhantomNodeForCoordinate(
+                input_coordinates[query], result_phantom_nodes[query], zoom_level);
+        });
+    }
+
+  private:
+    template <class QueryFunctionT>
+    inline void
+    RunBatch(const uint32_t *query_begin, const uint32_t *query_end, QueryFunctionT &&run_query)
+    {
+        m_batch_leaf_cache.reset(new BatchLeafCache());
+        try
+        {
+            for (const uint32_t *query = query_begin; query != query_end; ++query)
+            {
+                run_query(*query);
             }
+        }
+        catch (...)
+        {
+            m_batch_leaf_cache.reset();
+            throw;
+        }
+        m_batch_leaf_cache.reset();
+    }
 
-            // TODO add indicator to prune if maxdist > threshold
-            if (number_of_results == number_of_results_found_in_big_cc || inspected_segments >= max_checked_segments)
+    inline void SetForwardAndReverseWeightsOnPhantomNode(const FixedPointCoordinate &source,
+                                                         const FixedPointCoordinate &target,
+                                                         PhantomNode &result_phantom_node) const
+    {
+        const float distance_1 = FixedPointCoordinate::ApproximateEuclideanDistance(
+            source, result_phantom_node.location);
+        const float distance_2 = FixedPointCoordinate::ApproximateEuclideanDistance(source, target);
+        const float ratio = std::min(1.f, distance_1 / distance_2);
+
+        if (SPECIAL_NODEID != result_phantom_node.forward_node_id)
+        {
+            result_phantom_node.forward_weight *= ratio;
+        }
+        if (SPECIAL_NODEID != result_phantom_node.reverse_node_id)
+        {
+            result_phantom_node.reverse_weight *= (1.f - ratio);
+        }
+    }
+
+    // fixup locations if too close to inputs
+    inline void FixUpRoundingIssue(const FixedPointCoordinate &input_coordinate,
+                                  PhantomNode &result_phantom_node) const
+    {
+            if (1 == std::abs(input_coordinate.lon - result_phantom_node.location.lon))
+            {
+                result_phantom_node.location.lon = input_coordinate.lon;
+            }
+            if (1 == std::abs(input_coordinate.lat - result_phantom_node.location.lat))
+            {
+                result_phantom_node.location.lat = input_coordinate.lat;
+            }
+    }
+
+    // Lower bounds on the distances to the segments of leaf, all zero if they are measured exactly
+    inline void ComputeLowerBounds(const QueryLeaf &leaf,
+                                   const FixedPointCoordinate &location,
+                                   std::array<float, LEAF_NODE_SIZE> &lower_bounds) const
+    {
+        if (LeafScanKernel::Exact == m_leaf_scan_kernel)
+        {
+            std::fill_n(lower_bounds.begin(), leaf.object_count, 0.f);
+            return;
+        }
+        leaf.bounding_boxes.ComputeLowerBounds(location, m_leaf_scan_kernel, lower_bounds.data());
+    }
+
+    // Measures the segment with the smallest lower bound. Returns the distance a segment of the
+    // leaf has to beat to become the closest one.
+    inline float MeasureMostPromisingSegment(const QueryLeaf &leaf,
+                                             const FixedPointCoordinate &location,
+                                             const std::array<float, LEAF_NODE_SIZE> &lower_bounds,
+                                             const bool ignore_tiny_components,
+                                             const float min_dist) const
+    {
+        if (LeafScanKernel::Exact == m_leaf_scan_kernel)
+        {
+            return min_dist;
+        }
+        uint32_t most_promising_segment = UINT_MAX;
+        float smallest_lower_bound = min_dist;
+        for (uint32_t i = 0; i < leaf.object_count; ++i)
+        {
+            if ((!ignore_tiny_components || !leaf.is_in_tiny_cc[i]) &&
+                lower_bounds[i] < smallest_lower_bound)
             {
-                // SimpleLogger().Write(logDEBUG) << "flushing queue of " << traversal_queue.size() << " elements";
-                // work-around for traversal_queue.clear();
-                traversal_queue = std::priority_queue<IncrementalQueryCandidate>{};
+                most_promising_segment = i;
+                smallest_lower_bound = lower_bounds[i];
             }
         }
+        if (UINT_MAX == most_promising_segment)
+        {
+            return min_dist;
+        }
+        float ratio = 0.;
+        FixedPointCoordinate nearest;
+        return std::min(min_dist,
+                        FixedPointCoordinate::ComputePerpendicularDistance(
+                            leaf.sources[most_promising_segment],
+                            leaf.targets[most_promising_segment],
+                            location,
+                            nearest,
+                            ratio));
+    }
 
-        // for (const PhantomNode& result_node : result_phantom_node_vector)
-        // {
-        //     SimpleLogger().Write(logDEBUG) << std::setprecision(8) << "found location " << result_node.forward_node_id << " at " << result_node.location;
-        // }
-        // SimpleLogger().Write(logDEBUG) << "dequeues: " << dequeues;
-        // SimpleLogger().Write(logDEBUG) << "inspected_mbrs: " << inspected_mbrs;
-        // SimpleLogger().Write(logDEBUG) << "loaded_leafs: " << loaded_leafs;
-        // SimpleLogger().Write(logDEBUG) << "inspected_segments: " << inspected_segments;
-        // SimpleLogger().Write(logDEBUG) << "pruned_elements: " << pruned_elements;
-        // SimpleLogger().Write(logDEBUG) << "ignored_segments: " << ignored_segments;
-        // SimpleLogger().Write(logDEBUG) << "ignored_mbrs: " << ignored_mbrs;
+    // Queues the segments of a leaf of an incremental search, returns how many. The search ends
+    // before it dequeues a segment farther away than the number_of_results closest segments in
+    // big components queued so far, so segments whose lower bound exceeds that are not measured.
+    inline uint32_t QueueLeafSegments(const uint32_t leaf_id,
+                                      const QueryLeaf &leaf,
+                                      const FixedPointCoordinate &input_coordinate,
+                                      const float current_min_dist,
+                                      const unsigned number_of_results,
+                                      std::vector<float> &closest_queued_distances,
+                                      IncrementalQueryQueue &traversal_queue)
+    {
+        const auto get_final_distance = [&closest_queued_distances, number_of_results]()
+        {
+            return closest_queued_distances.size() < number_of_results
+                       ? std::numeric_limits<float>::max()
+                       : closest_queued_distances.front();
+        };
 
-        // SimpleLogger().Write(logDEBUG) << "number_of_results_found_in_big_cc: " << number_of_results_found_in_big_cc;
-        // SimpleLogger().Write(logDEBUG) << "number_of_results_found_in_tiny_cc: " << number_of_results_found_in_tiny_cc;
-        // TIMER_STOP(samet);
-        // SimpleLogger().Write() << "query took " << TIMER_MSEC(samet) << "ms";
+        std::array<float, LEAF_NODE_SIZE> lower_bounds;
+        ComputeLowerBounds(leaf, input_coordinate, lower_bounds);
+        m_scan_order.clear();
+        for (uint32_t i = 0; i < leaf.object_count; ++i)
+        {
+            if (lower_bounds[i] <= get_final_distance())
+            {
+                m_scan_order.emplace_back(lower_bounds[i], i);
+            }
+        }
+        // the closest segments first, they rule out most of the others
+        std::sort(m_scan_order.begin(), m_scan_order.end());
 
-        // if we found an element in either category, then we are good
-        return !result_phantom_node_vector.empty();
+        uint32_t queued_segments = 0;
+        for (const auto &scan_entry : m_scan_order)
+        {
+            if (scan_entry.first > get_final_distance())
+            {
+                break;
+            }
+            const uint32_t i = scan_entry.second;
+            const float current_perpendicular_distance =
+                FixedPointCoordinate::ComputePerpendicularDistance(
+                    leaf.sources[i], leaf.targets[i], input_coordinate);
+            // distance must be non-negative
+            BOOST_ASSERT(0. <= current_perpendicular_distance);
+
+            if (current_perpendicular_distance < current_min_dist)
+            {
+                traversal_queue.PushSegment(
+                    current_perpendicular_distance,
+                    QueuedSegment(leaf.sources[i], leaf.targets[i], leaf.is_in_tiny_cc[i]),
+                    uint64_t(leaf_id) * LEAF_NODE_SIZE + i);
+                ++queued_segments;
+                if (leaf.is_in_tiny_cc[i])
+                {
+                    continue;
+                }
+                if (closest_queued_distances.size() < number_of_results)
+                {
+                    closest_queued_distances.push_back(current_perpendicular_distance);
+                    std::push_heap(closest_queued_distances.begin(), closest_queued_distances.end());
+                }
+                else if (current_perpendicular_distance < closest_queued_distances.front())
+                {
+                    std::pop_heap(closest_queued_distances.begin(), closest_queued_distances.end());
+                    closest_queued_distances.back() = current_perpendicular_distance;
+                    std::push_heap(closest_queued_distances.begin(), closest_queued_distances.end());
+                }
+            }
+        }
+        return queued_segments;
     }
 
-    // implementation of the Hjaltason/Samet query [3], a BFS traversal of the tree
-    bool
-    IncrementalFindPhantomNodeForCoordinateWithDistance(const FixedPointCoordinate &input_coordinate,
-                                                        std::vector<std::pair<PhantomNode, double>> &result_phantom_node_vector,
-                                                        const unsigned zoom_level,
-                                                        const unsigned number_of_results,
-                                                        const unsigned max_checked_segments = 4*LEAF_NODE_SIZE)
+    // Incremental search shared by the public queries. Calls add_result(phantom_node, distance,
+    // is_in_tiny_cc) for every segment closer than the current bound and max_distance, in
+    // order of their lower bounds, until number_of_results of them are in big components.
+    template <class ResultHandlerT>
+    void IncrementalSearch(const FixedPointCoordinate &input_coordinate,
+                           const unsigned number_of_results,
+                           const float max_distance,
+                           const QueryDeadline &deadline,
+                           const unsigned max_checked_segments,
+                           ResultHandlerT &&add_result)
     {
-        std::vector<float> min_found_distances(number_of_results, std::numeric_limits<float>::max());
+        std::vector<float> min_found_distances(number_of_results, max_distance);
+        // heap of the smallest distances of queued segments in big components
+        std::vector<float> closest_queued_distances;
 
+        unsigned inspected_segments = 0;
         unsigned number_of_results_found_in_big_cc = 0;
         unsigned number_of_results_found_in_tiny_cc = 0;
 
-        unsigned inspected_segments = 0;
-
         // initialize queue with root element
-        std::priority_queue<IncrementalQueryCandidate> traversal_queue;
-        traversal_queue.emplace(0.f, m_search_tree[0]);
+        IncrementalQueryQueue &traversal_queue = m_incremental_queue;
+        traversal_queue.Clear();
+        traversal_queue.PushTreeNode(0.f, 0);
 
-        while (!traversal_queue.empty())
+        while (!traversal_queue.Empty())
         {
-            const IncrementalQueryCandidate current_query_node = traversal_queue.top();
-            traversal_queue.pop();
+            deadline.Check();
+            const IncrementalQueryCandidate current_query_node = traversal_queue.Pop();
 
             const float current_min_dist = min_found_distances[number_of_results-1];
 
@@ -903,28 +1505,20 @@ class StaticRTree
 
             if (current_query_node.RepresentsTreeNode())
             {
-                const TreeNode & current_tree_node = boost::get<TreeNode>(current_query_node.node);
+                const TreeNode &current_tree_node = m_search_tree[current_query_node.index];
                 if (current_tree_node.child_is_on_disk)
                 {
-                    LeafNode current_leaf_node;
-                    LoadLeafFromDisk(current_tree_node.children[0], current_leaf_node);
-                    // Add all objects from leaf into queue
-                    for (uint32_t i = 0; i < current_leaf_node.object_count; ++i)
-                    {
-                        const auto &current_edge = current_leaf_node.objects[i];
-                        const float current_perpendicular_distance =
-                            FixedPointCoordinate::ComputePerpendicularDistance(
-                                m_coordinate_list->at(current_edge.u),
-                                m_coordinate_list->at(current_edge.v),
-                                input_coordinate);
-                        // distance must be non-negative
-                        BOOST_ASSERT(0. <= current_perpendicular_distance);
-
-                        if (current_perpendicular_distance < current_min_dist)
-                        {
-                            traversal_queue.emplace(current_perpendicular_distance, current_edge);
-                        }
-                    }
+                    QueryLeaf leaf_buffer;
+                    const QueryLeaf &current_leaf =
+                        LoadLeaf(current_tree_node.children[0], leaf_buffer);
+                    // Add the objects from leaf into queue that may be dequeued
+                    QueueLeafSegments(current_tree_node.children[0],
+                                      current_leaf,
+                                      input_coordinate,
+                                      current_min_dist,
+                                      number_of_results,
+                                      closest_queued_distances,
+                                      traversal_queue);
                 }
                 else
                 {
@@ -936,23 +1530,19 @@ class StaticRTree
                         const RectangleT &child_rectangle = child_tree_node.minimum_bounding_rectangle;
                         const float lower_bound_to_element = child_rectangle.GetMinDist(input_coordinate);
 
-                        // TODO - enough elements found, i.e. nearest distance > maximum distance?
-                        //        ie. some measure of 'confidence of accuracy'
-
                         // check if it needs to be explored by mindist
                         if (lower_bound_to_element < current_min_dist)
                         {
-                            traversal_queue.emplace(lower_bound_to_element, child_tree_node);
+                            traversal_queue.PushTreeNode(lower_bound_to_element, child_id);
                         }
                     }
-                    // SimpleLogger().Write(logDEBUG) << "added " << current_tree_node.child_count << " mbrs into queue of " << traversal_queue.size();
                 }
             }
             else
             {
                 ++inspected_segments;
                 // inspecting an actual road segment
-                const EdgeDataT & current_segment = boost::get<EdgeDataT>(current_query_node.node);
+                const QueuedSegment &current_segment = traversal_queue.GetSegment(current_query_node);
 
                 // don't collect too many results from small components
                 if (number_of_results_found_in_big_cc == number_of_results && !current_segment.is_in_tiny_cc)
@@ -971,8 +1561,8 @@ class StaticRTree
                 FixedPointCoordinate foot_point_coordinate_on_segment;
                 const float current_perpendicular_distance =
                     FixedPointCoordinate::ComputePerpendicularDistance(
-                        m_coordinate_list->at(current_segment.u),
-                        m_coordinate_list->at(current_segment.v),
+                        current_segment.source,
+                        current_segment.target,
                         input_coordinate,
                         foot_point_coordinate_on_segment,
                         current_ratio);
@@ -982,26 +1572,29 @@ class StaticRTree
                 if ((current_perpendicular_distance < current_min_dist) &&
                     !EpsilonCompare(current_perpendicular_distance, current_min_dist))
                 {
-                    // store phantom node in result vector
-                    result_phantom_node_vector.emplace_back(
-                        current_segment.forward_edge_based_node_id,
-                        current_segment.reverse_edge_based_node_id,
-                        current_segment.name_id,
-                        current_segment.forward_weight,
-                        current_segment.reverse_weight,
-                        current_segment.forward_offset,
-                        current_segment.reverse_offset,
-                        current_segment.packed_geometry_id,
-                        foot_point_coordinate_on_segment,
-                        current_segment.fwd_segment_position,
-                        current_perpendicular_distance);
+                    EdgeDataT current_edge;
+                    LoadSegment(current_query_node.position, current_edge);
+                    PhantomNode phantom_node(current_edge.forward_edge_based_node_id,
+                                             current_edge.reverse_edge_based_node_id,
+                                             current_edge.name_id,
+                                             current_edge.forward_weight,
+                                             current_edge.reverse_weight,
+                                             current_edge.forward_offset,
+                                             current_edge.reverse_offset,
+                                             current_edge.packed_geometry_id,
+                                             foot_point_coordinate_on_segment,
+                                             current_edge.fwd_segment_position);
 
                     // Hack to fix rounding errors and wandering via nodes.
-                    FixUpRoundingIssue(input_coordinate, result_phantom_node_vector.back());
+                    FixUpRoundingIssue(input_coordinate, phantom_node);
 
                     // set forward and reverse weights on the phantom node
-                    SetForwardAndReverseWeightsOnPhantomNode(current_segment,
-                                                             result_phantom_node_vector.back());
+                    SetForwardAndReverseWeightsOnPhantomNode(current_segment.source,
+                                                             current_segment.target,
+                                                             phantom_node);
+                    add_result(phantom_node,
+                               current_perpendicular_distance,
+                               current_segment.is_in_tiny_cc);
 
                     // do we have results only in a small scc
                     if (current_segment.is_in_tiny_cc)
@@ -1013,145 +1606,15 @@ class StaticRTree
                         // found an element in a large component
                         min_found_distances[number_of_results_found_in_big_cc] = current_perpendicular_distance;
                         ++number_of_results_found_in_big_cc;
-                        // SimpleLogger().Write(logDEBUG) << std::setprecision(8) << foot_point_coordinate_on_segment << " at " << current_perpendicular_distance;
                     }
                 }
             }
 
-            // TODO add indicator to prune if maxdist > threshold
             if (number_of_results == number_of_results_found_in_big_cc || inspected_segments >= max_checked_segments)
             {
-                // SimpleLogger().Write(logDEBUG) << "flushing queue of " << traversal_queue.size() << " elements";
-                // work-around for traversal_queue.clear();
-                traversal_queue = std::priority_queue<IncrementalQueryCandidate>{};
+                traversal_queue.Clear();
             }
         }
-
-        return !result_phantom_node_vector.empty();
-    }
-
-
-
-    bool FindPhantomNodeForCoordinate(const FixedPointCoordinate &input_coordinate,
-                                      PhantomNode &result_phantom_node,
-                                      const unsigned zoom_level)
-    {
-        const bool ignore_tiny_components = (zoom_level <= 14);
-        EdgeDataT nearest_edge;
-
-        float min_dist = std::numeric_limits<float>::max();
-        float min_max_dist = std::numeric_limits<float>::max();
-
-        std::priority_queue<QueryCandidate> traversal_queue;
-        traversal_queue.emplace(0.f, 0);
-
-        while (!traversal_queue.empty())
-        {
-            const QueryCandidate current_query_node = traversal_queue.top();
-            traversal_queue.pop();
-
-            const bool prune_downward = (current_query_node.min_dist > min_max_dist);
-            const bool prune_upward = (current_query_node.min_dist > min_dist);
-            if (!prune_downward && !prune_upward)
-            { // downward pruning
-                const TreeNode &current_tree_node = m_search_tree[current_query_node.node_id];
-                if (current_tree_node.child_is_on_disk)
-                {
-                    LeafNode current_leaf_node;
-                    LoadLeafFromDisk(current_tree_node.children[0], current_leaf_node);
-                    for (uint32_t i = 0; i < current_leaf_node.object_count; ++i)
-                    {
-                        const EdgeDataT &current_edge = current_leaf_node.objects[i];
-                        if (ignore_tiny_components && current_edge.is_in_tiny_cc)
-                        {
-                            continue;
-                        }
-
-                        float current_ratio = 0.;
-                        FixedPointCoordinate nearest;
-                        const float current_perpendicular_distance =
-                            FixedPointCoordinate::ComputePerpendicularDistance(
-                                m_coordinate_list->at(current_edge.u),
-                                m_coordinate_list->at(current_edge.v),
-                                input_coordinate,
-                                nearest,
-                                current_ratio);
-
-                        BOOST_ASSERT(0. <= current_perpendicular_distance);
-
-                        if ((current_perpendicular_distance < min_dist) &&
-                            !EpsilonCompare(current_perpendicular_distance, min_dist))
-                        { // found a new minimum
-                            min_dist = current_perpendicular_distance;
-                            result_phantom_node = {current_edge.forward_edge_based_node_id,
-                                                   current_edge.reverse_edge_based_node_id,
-                                                   current_edge.name_id,
-                                                   current_edge.forward_weight,
-                                                   current_edge.reverse_weight,
-                                                   current_edge.forward_offset,
-                                                   current_edge.reverse_offset,
-                                                   current_edge.packed_geometry_id,
-                                                   nearest,
-                                                   current_edge.fwd_segment_position};
-                            nearest_edge = current_edge;
-                        }
-                    }
-                }
-                else
-                {
-                    min_max_dist = ExploreTreeNode(current_tree_node,
-                                                   input_coordinate,
-                                                   min_dist,
-                                                   min_max_dist,
-                                                   traversal_queue);
-                }
-            }
-        }
-
-        if (result_phantom_node.location.isValid())
-        {
-            // Hack to fix rounding errors and wandering via nodes.
-            FixUpRoundingIssue(input_coordinate, result_phantom_node);
-
-            // set forward and reverse weights on the phantom node
-            SetForwardAndReverseWeightsOnPhantomNode(nearest_edge, result_phantom_node);
-        }
-        return result_phantom_node.location.isValid();
-    }
-
-  private:
-
-    inline void SetForwardAndReverseWeightsOnPhantomNode(const EdgeDataT & nearest_edge,
-                                                         PhantomNode &result_phantom_node) const
-    {
-        const float distance_1 = FixedPointCoordinate::ApproximateEuclideanDistance(
-            m_coordinate_list->at(nearest_edge.u), result_phantom_node.location);
-        const float distance_2 = FixedPointCoordinate::ApproximateEuclideanDistance(
-            m_coordinate_list->at(nearest_edge.u), m_coordinate_list->at(nearest_edge.v));
-        const float ratio = std::min(1.f, distance_1 / distance_2);
-
-        if (SPECIAL_NODEID != result_phantom_node.forward_node_id)
-        {
-            result_phantom_node.forward_weight *= ratio;
-        }
-        if (SPECIAL_NODEID != result_phantom_node.reverse_node_id)
-        {
-            result_phantom_node.reverse_weight *= (1.f - ratio);
-        }
-    }
-
-    // fixup locations if too close to inputs
-    inline void FixUpRoundingIssue(const FixedPointCoordinate &input_coordinate,
-                                  PhantomNode &result_phantom_node) const
-    {
-            if (1 == std::abs(input_coordinate.lon - result_phantom_node.location.lon))
-            {
-                result_phantom_node.location.lon = input_coordinate.lon;
-            }
-            if (1 == std::abs(input_coordinate.lat - result_phantom_node.location.lat))
-            {
-                result_phantom_node.location.lat = input_coordinate.lat;
-            }
     }
 
     template <class QueueT>
@@ -1184,7 +1647,97 @@ class StaticRTree
         return new_min_max_dist;
     }
 
-    inline void LoadLeafFromDisk(const uint32_t leaf_id, LeafNode &result_node)
+    // Returns the leaf from the batch cache while a batch runs, then from the shared leaf
+    // cache. Without either the leaf is read into buffer. The result is valid until the next call.
+    inline const QueryLeaf &LoadLeaf(const uint32_t leaf_id, QueryLeaf &buffer)
+    {
+        ++m_number_of_visited_leaves;
+        if (!m_batch_leaf_cache && !m_leaf_cache)
+        {
+            LoadQueryLeaf(leaf_id, buffer);
+            return buffer;
+        }
+
+        if (m_batch_leaf_cache)
+        {
+            const BatchLeafCache &cache = *m_batch_leaf_cache;
+            for (uint32_t slot = 0; slot < BatchLeafCache::NUMBER_OF_LEAVES; ++slot)
+            {
+                if (leaf_id == cache.leaf_ids[slot])
+                {
+                    return *cache.leaves[slot];
+                }
+            }
+        }
+
+        LeafPtr leaf;
+        if (m_leaf_cache)
+        {
+            leaf = m_leaf_cache->Find(leaf_id);
+        }
+        if (!leaf)
+        {
+            std::shared_ptr<QueryLeaf> loaded_leaf = std::make_shared<QueryLeaf>();
+            LoadQueryLeaf(leaf_id, *loaded_leaf);
+            leaf = m_leaf_cache ? m_leaf_cache->Insert(leaf_id, std::move(loaded_leaf))
+                                : LeafPtr(std::move(loaded_leaf));
+        }
+
+        if (m_batch_leaf_cache)
+        {
+            BatchLeafCache &cache = *m_batch_leaf_cache;
+            cache.leaf_ids[cache.next_slot] = leaf_id;
+            cache.leaves[cache.next_slot] = leaf;
+            cache.next_slot = (cache.next_slot + 1) % BatchLeafCache::NUMBER_OF_LEAVES;
+        }
+        m_pinned_leaf = std::move(leaf);
+        return *m_pinned_leaf;
+    }
+
+    inline void OpenLeafFile(const boost::filesystem::path &leaf_file)
+    {
+        leaves_stream.open(leaf_file, std::ios::binary);
+        LeafFileHeader header;
+        leaves_stream.read((char *)&header.magic_number, sizeof(uint64_t));
+        if (LEAF_FILE_MAGIC_NUMBER != header.magic_number)
+        {
+            m_element_count = header.magic_number;
+            SimpleLogger().Write(logWARNING) << leaf_file.string()
+                                             << " has the legacy format, rerun osrm-prepare to "
+                                                "make nearest neighbor queries read less of it";
+            return;
+        }
+
+        leaves_stream.read((char *)&header.version, sizeof(LeafFileHeader) - sizeof(uint64_t));
+        if (LEAF_FILE_VERSION != header.version)
+        {
+            throw OSRMException("mem index file has an unknown version");
+        }
+        if (LEAF_NODE_SIZE != header.leaf_node_size)
+        {
+            throw OSRMException("mem index file was built for another leaf size");
+        }
+        m_element_count = header.element_count;
+        const uint64_t number_of_leaves = (m_element_count + LEAF_NODE_SIZE - 1) / LEAF_NODE_SIZE;
+        m_leaf_offsets.resize(number_of_leaves + 1);
+        leaves_stream.read((char *)m_leaf_offsets.data(), m_leaf_offsets.size() * sizeof(uint64_t));
+        if (!leaves_stream.good())
+        {
+            throw OSRMException("mem index file is truncated");
+        }
+        if (!boost::filesystem::exists(m_segment_data_filename))
+        {
+            throw OSRMException("segment data file does not exist");
+        }
+        if (boost::filesystem::file_size(m_segment_data_filename) !=
+            m_element_count * sizeof(EdgeDataT))
+        {
+            throw OSRMException("segment data file does not match the mem index file");
+        }
+        segments_stream.open(m_segment_data_filename, std::ios::binary);
+    }
+
+    inline void SeekLeafFile(const uint64_t seek_pos)
     {
         if (!leaves_stream.is_open())
         {
@@ -1195,14 +1748,252 @@ class StaticRTree
             leaves_stream.clear(std::ios::goodbit);
             SimpleLogger().Write(logDEBUG) << "Resetting stale filestream";
         }
-        const uint64_t seek_pos = sizeof(uint64_t) + leaf_id * sizeof(LeafNode);
         leaves_stream.seekg(seek_pos);
         BOOST_ASSERT_MSG(leaves_stream.good(),
                          "Seeking to position in leaf file failed.");
-        leaves_stream.read((char *)&result_node, sizeof(LeafNode));
+    }
+
+    inline void LoadQueryLeaf(const uint32_t leaf_id, QueryLeaf &result_leaf)
+    {
+        if (m_leaf_offsets.empty())
+        {
+            if (!m_legacy_leaf)
+            {
+                m_legacy_leaf.reset(new LeafNode());
+            }
+            const LeafNode &legacy_leaf = *m_legacy_leaf;
+            SeekLeafFile(sizeof(uint64_t) + leaf_id * sizeof(LeafNode));
+            leaves_stream.read((char *)m_legacy_leaf.get(), sizeof(LeafNode));
+            BOOST_ASSERT_MSG(leaves_stream.good(), "Reading from leaf file failed.");
+
+            result_leaf.object_count = legacy_leaf.object_count;
+            for (uint32_t i = 0; i < legacy_leaf.object_count; ++i)
+            {
+                result_leaf.sources[i] = m_coordinate_list->at(legacy_leaf.objects[i].u);
+                result_leaf.targets[i] = m_coordinate_list->at(legacy_leaf.objects[i].v);
+                result_leaf.is_in_tiny_cc[i] = legacy_leaf.objects[i].is_in_tiny_cc;
+            }
+        }
+        else
+        {
+            BOOST_ASSERT(leaf_id + 1 < m_leaf_offsets.size());
+            m_leaf_record.resize(m_leaf_offsets[leaf_id + 1] - m_leaf_offsets[leaf_id]);
+            SeekLeafFile(m_leaf_offsets[leaf_id]);
+            leaves_stream.read(m_leaf_record.data(), m_leaf_record.size());
+            BOOST_ASSERT_MSG(leaves_stream.good(), "Reading from leaf file failed.");
+            DecodeCompactLeaf(m_leaf_record.data(), result_leaf);
+        }
+        result_leaf.bounding_boxes.Initialize(
+            result_leaf.sources.data(), result_leaf.targets.data(), result_leaf.object_count);
+    }
+
+    // Reads the segment at position leaf_id * LEAF_NODE_SIZE + i of the segment file
+    inline void LoadSegment(const uint64_t position, EdgeDataT &result_segment)
+    {
+        if (!m_leaf_offsets.empty())
+        {
+            if (!segments_stream.good())
+            {
+                segments_stream.clear(std::ios::goodbit);
+                SimpleLogger().Write(logDEBUG) << "Resetting stale filestream";
+            }
+            segments_stream.seekg(position * sizeof(EdgeDataT));
+            segments_stream.read((char *)&result_segment, sizeof(EdgeDataT));
+            BOOST_ASSERT_MSG(segments_stream.good(), "Reading from segment file failed.");
+            return;
+        }
+        SeekLeafFile(sizeof(uint64_t) + position / LEAF_NODE_SIZE * sizeof(LeafNode) +
+                     offsetof(LeafNode, objects) + position % LEAF_NODE_SIZE * sizeof(EdgeDataT));
+        leaves_stream.read((char *)&result_segment, sizeof(EdgeDataT));
         BOOST_ASSERT_MSG(leaves_stream.good(), "Reading from leaf file failed.");
     }
 
+    // centroid of a segment with its latitude in mercator projection
+    static inline FixedPointCoordinate
+    GetProjectedCentroid(const EdgeDataT &element, const std::vector<NodeInfo> &coordinate_list)
+    {
+        FixedPointCoordinate centroid =
+            EdgeDataT::Centroid(FixedPointCoordinate(coordinate_list.at(element.u).lat,
+                                                     coordinate_list.at(element.u).lon),
+                                FixedPointCoordinate(coordinate_list.at(element.v).lat,
+                                                     coordinate_list.at(element.v).lon));
+        centroid.lat = COORDINATE_PRECISION * lat2y(centroid.lat / COORDINATE_PRECISION);
+        return centroid;
+    }
+
+    // Orders the entries so that each run of group_size entries forms a tile: the entries are cut
+    // into about sqrt(number of tiles) slices of whole tiles by longitude, each sorted by latitude.
+    // Ties are broken by index to keep the files reproducible.
+    static void SortTileRecursive(std::vector<TileEntry> &entries, const uint64_t group_size)
+    {
+        const uint64_t number_of_groups = (entries.size() + group_size - 1) / group_size;
+        const uint64_t number_of_slices =
+            static_cast<uint64_t>(std::ceil(std::sqrt(static_cast<double>(number_of_groups))));
+        if (number_of_slices < 1)
+        {
+            return;
+        }
+        const uint64_t slice_size =
+            (number_of_groups + number_of_slices - 1) / number_of_slices * group_size;
+
+        tbb::parallel_sort(entries.begin(),
+                           entries.end(),
+                           [](const TileEntry &lhs, const TileEntry &rhs)
+                           {
+            return std::tie(lhs.center.lon, lhs.center.lat, lhs.index) <
+                   std::tie(rhs.center.lon, rhs.center.lat, rhs.index);
+        });
+        tbb::parallel_for(tbb::blocked_range<uint64_t>(0, number_of_slices),
+                          [&entries, slice_size](const tbb::blocked_range<uint64_t> &range)
+                          {
+            for (uint64_t slice = range.begin(); slice != range.end(); ++slice)
+            {
+                const uint64_t slice_begin =
+                    std::min<uint64_t>(slice * slice_size, entries.size());
+                const uint64_t slice_end =
+                    std::min<uint64_t>(slice_begin + slice_size, entries.size());
+                std::sort(entries.begin() + slice_begin,
+                          entries.begin() + slice_end,
+                          [](const TileEntry &lhs, const TileEntry &rhs)
+                          {
+                    return std::tie(lhs.center.lat, lhs.center.lon, lhs.index) <
+                           std::tie(rhs.center.lat, rhs.center.lon, rhs.index);
+                });
+            }
+        });
+    }
+
+    // Reorders the nodes of a level so that runs of BRANCHING_FACTOR nodes are packed into a parent
+    static void SortTreeNodesByTiles(std::vector<TreeNode> &tree_nodes)
+    {
+        std::vector<TileEntry> tile_entries(tree_nodes.size());
+        for (uint32_t i = 0; i < tree_nodes.size(); ++i)
+        {
+            tile_entries[i].center = tree_nodes[i].minimum_bounding_rectangle.Centroid();
+            tile_entries[i].center.lat =
+                COORDINATE_PRECISION * lat2y(tile_entries[i].center.lat / COORDINATE_PRECISION);
+            tile_entries[i].index = i;
+        }
+        SortTileRecursive(tile_entries, BRANCHING_FACTOR);
+
+        std::vector<TreeNode> sorted_tree_nodes(tree_nodes.size());
+        for (uint32_t i = 0; i < tree_nodes.size(); ++i)
+        {
+            sorted_tree_nodes[i] = tree_nodes[tile_entries[i].index];
+        }
+        tree_nodes.swap(sorted_tree_nodes);
+    }
+
+    static inline uint32_t GetTinyComponentWords(const uint32_t object_count)
+    {
+        return (object_count + 31) / 32;
+    }
+
+    static void EncodeCompactLeaf(const LeafNode &leaf,
+                                  const RectangleT &bounding_rectangle,
+                                  const std::vector<NodeInfo> &coordinate_list,
+                                  std::vector<char> &record)
+    {
+        const uint32_t object_count = leaf.object_count;
+        CompactLeafHeader header;
+        header.object_count = object_count;
+        header.min_lat = bounding_rectangle.min_lat;
+        header.min_lon = bounding_rectangle.min_lon;
+        const int64_t span = std::max(int64_t(bounding_rectangle.max_lat) - bounding_rectangle.min_lat,
+                                      int64_t(bounding_rectangle.max_lon) - bounding_rectangle.min_lon);
+        header.coordinate_bytes =
+            span <= std::numeric_limits<uint16_t>::max() ? sizeof(uint16_t) : sizeof(uint32_t);
+
+        std::vector<uint32_t> tiny_component_words(GetTinyComponentWords(object_count), 0);
+        // source lats, source lons, target lats and target lons
+        std::vector<uint32_t> deltas(4 * object_count);
+        for (uint32_t i = 0; i < object_count; ++i)
+        {
+            const EdgeDataT &object = leaf.objects[i];
+            if (object.is_in_tiny_cc)
+            {
+                tiny_component_words[i / 32] |= 1u << (i % 32);
+            }
+            deltas[i] = coordinate_list.at(object.u).lat - header.min_lat;
+            deltas[object_count + i] = coordinate_list.at(object.u).lon - header.min_lon;
+            deltas[2 * object_count + i] = coordinate_list.at(object.v).lat - header.min_lat;
+            deltas[3 * object_count + i] = coordinate_list.at(object.v).lon - header.min_lon;
+        }
+
+        record.resize(sizeof(CompactLeafHeader) + tiny_component_words.size() * sizeof(uint32_t) +
+                      deltas.size() * header.coordinate_bytes);
+        char *position = record.data();
+        std::memcpy(position, &header, sizeof(CompactLeafHeader));
+        position += sizeof(CompactLeafHeader);
+        std::memcpy(position,
+                    tiny_component_words.data(),
+                    tiny_component_words.size() * sizeof(uint32_t));
+        position += tiny_component_words.size() * sizeof(uint32_t);
+        if (sizeof(uint16_t) == header.coordinate_bytes)
+        {
+            for (const uint32_t delta : deltas)
+            {
+                const uint16_t narrow_delta = static_cast<uint16_t>(delta);
+                std::memcpy(position, &narrow_delta, sizeof(uint16_t));
+                position += sizeof(uint16_t);
+            }
+        }
+        else
+        {
+            std::memcpy(position, deltas.data(), deltas.size() * sizeof(uint32_t));
+        }
+    }
+
+    template <class DeltaT>
+    static inline void DecodeCoordinates(const char *deltas,
+                                         const CompactLeafHeader &header,
+                                         QueryLeaf &result_leaf)
+    {
+        const uint32_t object_count = header.object_count;
+        const auto get_delta = [deltas](const uint32_t index)
+        {
+            DeltaT delta;
+            std::memcpy(&delta, deltas + index * sizeof(DeltaT), sizeof(DeltaT));
+            return static_cast<int32_t>(delta);
+        };
+        for (uint32_t i = 0; i < object_count; ++i)
+        {
+            result_leaf.sources[i].lat = header.min_lat + get_delta(i);
+            result_leaf.sources[i].lon = header.min_lon + get_delta(object_count + i);
+            result_leaf.targets[i].lat = header.min_lat + get_delta(2 * object_count + i);
+            result_leaf.targets[i].lon = header.min_lon + get_delta(3 * object_count + i);
+        }
+    }
+
+    static void DecodeCompactLeaf(const char *record, QueryLeaf &result_leaf)
+    {
+        CompactLeafHeader header;
+        std::memcpy(&header, record, sizeof(CompactLeafHeader));
+        BOOST_ASSERT(header.object_count <= LEAF_NODE_SIZE);
+        result_leaf.object_count = header.object_count;
+        record += sizeof(CompactLeafHeader);
+
+        for (uint32_t word = 0; word < GetTinyComponentWords(header.object_count); ++word)
+        {
+            uint32_t tiny_component_word;
+            std::memcpy(&tiny_component_word, record, sizeof(uint32_t));
+            record += sizeof(uint32_t);
+            for (uint32_t bit = 0; bit < 32 && word * 32 + bit < header.object_count; ++bit)
+            {
+                result_leaf.is_in_tiny_cc[word * 32 + bit] = (tiny_component_word >> bit) & 1;
+            }
+        }
+
+        if (sizeof(uint16_t) == header.coordinate_bytes)
+        {
+            DecodeCoordinates<uint16_t>(record, header, result_leaf);
+        }
+        else
+        {
+            DecodeCoordinates<uint32_t>(record, header, result_leaf);
+        }
+    }
+
     inline bool EdgesAreEquivalent(const FixedPointCoordinate &a,
                                    const FixedPointCoordinate &b,
                                    const FixedPointCoordinate &c,
@@ -1212,8 +2003,31 @@ class StaticRTree
     }
 };
 
+template <class EdgeDataT,
+          class CoordinateListT,
+          bool UseSharedMemory,
+          uint32_t BRANCHING_FACTOR,
+          uint32_t LEAF_NODE_SIZE>
+constexpr uint64_t StaticRTree<EdgeDataT,
+                               CoordinateListT,
+                               UseSharedMemory,
+                               BRANCHING_FACTOR,
+                               LEAF_NODE_SIZE>::LEAF_FILE_MAGIC_NUMBER;
+template <class EdgeDataT,
+          class CoordinateListT,
+          bool UseSharedMemory,
+          uint32_t BRANCHING_FACTOR,
+          uint32_t LEAF_NODE_SIZE>
+constexpr uint32_t StaticRTree<EdgeDataT,
+                               CoordinateListT,
+                               UseSharedMemory,
+                               BRANCHING_FACTOR,
+                               LEAF_NODE_SIZE>::LEAF_FILE_VERSION;
+
 //[1] "On Packing R-Trees"; I. Kamel, C. Faloutsos; 1993; DOI: 10.1145/170088.170403
 //[2] "Nearest Neighbor Queries", N. Roussopulos et al; 1995; DOI: 10.1145/223784.223794
 //[3] "Distance Browsing in Spatial Databases"; G. Hjaltason, H. Samet; 1999; ACM Trans. DB Sys
 // Vol.24 No.2, pp.265-318
+//[4] "STR: A Simple and Efficient Algorithm for R-Tree Packing"; S. Leutenegger, M. Lopez,
+// J. Edgington; 1997; DOI: 10.1109/ICDE.1997.582015
 #endif // STATICRTREE_H
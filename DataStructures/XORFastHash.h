@@ -29,6 +29,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define XOR_FAST_HASH_H
 
 #include <algorithm>
+#include <istream>
+#include <ostream>
 #include <vector>
 
 /*
@@ -54,6 +56,9 @@ class XORFastHash
     std::vector<unsigned short> table1;
     std::vector<unsigned short> table2;
 
+    friend std::ostream &operator<<(std::ostream &out, const XORFastHash &hash);
+    friend std::istream &operator>>(std::istream &in, XORFastHash &hash);
+
   public:
     XORFastHash()
     {
@@ -76,6 +81,21 @@ class XORFastHash
     }
 };
 
+// the tables are written as they are to reproduce the same hash values later on
+inline std::ostream &operator<<(std::ostream &out, const XORFastHash &hash)
+{
+    out.write((char *)hash.table1.data(), sizeof(unsigned short) * hash.table1.size());
+    out.write((char *)hash.table2.data(), sizeof(unsigned short) * hash.table2.size());
+    return out;
+}
+
+inline std::istream &operator>>(std::istream &in, XORFastHash &hash)
+{
+    in.read((char *)hash.table1.data(), sizeof(unsigned short) * hash.table1.size());
+    in.read((char *)hash.table2.data(), sizeof(unsigned short) * hash.table2.size());
+    return in;
+}
+
 class XORMiniHash
 { // 256 entries
     std::vector<unsigned char> table1;
@@ -0,0 +1,246 @@
+/*
+
+Copyright (c) 2014, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef BINARY_DESCRIPTOR_H
+#define BINARY_DESCRIPTOR_H
+
+#include "BaseDescriptor.h"
+#include "DescriptionFactory.h"
+#include "../DataStructures/Range.h"
+#include "../DataStructures/SegmentInformation.h"
+#include "../DataStructures/TurnInstructions.h"
+
+#include <osrm/BinaryResponse.h>
+
+#include <cmath>
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Renders the shortest route in the compact format documented in <osrm/BinaryResponse.h>
+template <class DataFacadeT> class BinaryDescriptor : public BaseDescriptor<DataFacadeT>
+{
+  private:
+    DataFacadeT *facade;
+    DescriptorConfig config;
+    DescriptionFactory description_factory;
+    std::unordered_map<unsigned, unsigned> name_index_of_name_id;
+    std::vector<unsigned> name_ids;
+
+    unsigned GetNameIndex(const unsigned name_id)
+    {
+        auto iter = name_index_of_name_id.find(name_id);
+        if (iter != name_index_of_name_id.end())
+        {
+            return iter->second;
+        }
+        const unsigned name_index = static_cast<unsigned>(name_ids.size());
+        name_index_of_name_id.emplace(name_id, name_index);
+        name_ids.push_back(name_id);
+        return name_index;
+    }
+
+    void AppendInstruction(std::vector<char> &output,
+                           const TurnInstruction turn_instruction,
+                           const unsigned roundabout_exit,
+                           const unsigned bearing,
+                           const unsigned name_id,
+                           const unsigned coordinate_index,
+                           const unsigned length,
+                           const unsigned duration)
+    {
+        osrm::binary::AppendUInt8(output, static_cast<uint8_t>(turn_instruction));
+        osrm::binary::AppendUInt8(output, static_cast<uint8_t>(roundabout_exit));
+        osrm::binary::AppendUInt16(output, static_cast<uint16_t>(bearing));
+        osrm::binary::AppendUInt32(output, GetNameIndex(name_id));
+        osrm::binary::AppendUInt32(output, coordinate_index);
+        osrm::binary::AppendUInt32(output, length);
+        osrm::binary::AppendUInt32(output, duration);
+    }
+
+    // mirrors the instruction list of the JSON descriptor, i.e. only necessary turns are
+    // reported and roundabouts are collapsed into a single instruction with an exit number
+    unsigned AppendInstructions(std::vector<char> &output)
+    {
+        unsigned number_of_instructions = 0;
+        unsigned necessary_segments_running_index = 0;
+        unsigned roundabout_exit = 0;
+        for (const SegmentInformation &segment : description_factory.path_description)
+        {
+            const TurnInstruction current_instruction = segment.turn_instruction;
+            if (TurnInstructionsClass::TurnIsNecessary(current_instruction))
+            {
+                if (TurnInstruction::EnterRoundAbout != current_instruction)
+                {
+                    const bool leaves_roundabout =
+                        (TurnInstruction::LeaveRoundAbout == current_instruction);
+                    AppendInstruction(output,
+                                      (leaves_roundabout ? TurnInstruction::EnterRoundAbout
+                                                         : current_instruction),
+                                      (leaves_roundabout ? roundabout_exit + 1 : 0),
+                                      static_cast<unsigned>(std::round(segment.bearing / 10.)),
+                                      segment.name_id,
+                                      necessary_segments_running_index,
+                                      static_cast<unsigned>(std::round(segment.length)),
+                                      static_cast<unsigned>(std::round(segment.duration / 10.)));
+                    ++number_of_instructions;
+                    if (leaves_roundabout)
+                    {
+                        roundabout_exit = 0;
+                    }
+                }
+            }
+            else if (TurnInstruction::StayOnRoundAbout == current_instruction)
+            {
+                ++roundabout_exit;
+            }
+            if (segment.necessary)
+            {
+                ++necessary_segments_running_index;
+            }
+        }
+        AppendInstruction(output,
+                          TurnInstruction::ReachedYourDestination,
+                          0,
+                          0,
+                          description_factory.summary.target_name_id,
+                          necessary_segments_running_index - 1,
+                          0,
+                          0);
+        return number_of_instructions + 1;
+    }
+
+  public:
+    explicit BinaryDescriptor(DataFacadeT *facade) : facade(facade) {}
+
+    void SetConfig(const DescriptorConfig &c) { config = c; }
+
+    // distance tables carry no geometry and are written as a raw row-major matrix
+    static void RunTable(const unsigned number_of_locations,
+                         const std::vector<EdgeWeight> &table,
+                         http::Reply &reply)
+    {
+        BOOST_ASSERT(table.size() == number_of_locations * number_of_locations);
+        osrm::binary::AppendHeader(reply.content, osrm::binary::TABLE_RESPONSE, 0);
+        osrm::binary::AppendUInt32(reply.content, number_of_locations);
+        reply.content.reserve(reply.content.size() + 4 * table.size());
+        for (const EdgeWeight weight : table)
+        {
+            osrm::binary::AppendInt32(reply.content, weight);
+        }
+    }
+
+    void Run(const RawRouteData &raw_route, http::Reply &reply)
+    {
+        if (INVALID_EDGE_WEIGHT == raw_route.shortest_path_length)
+        {
+            osrm::binary::AppendHeader(reply.content, osrm::binary::ROUTE_RESPONSE, 207);
+            return;
+        }
+        osrm::binary::AppendHeader(reply.content, osrm::binary::ROUTE_RESPONSE, 0);
+
+        BOOST_ASSERT(raw_route.unpacked_path_segments.size() ==
+                     raw_route.segment_end_coordinates.size());
+        description_factory.SetStartSegment(
+            raw_route.segment_end_coordinates.front().source_phantom,
+            raw_route.source_traversed_in_reverse.front());
+        for (const auto i : osrm::irange<std::size_t>(0, raw_route.unpacked_path_segments.size()))
+        {
+            for (const PathData &path_data : raw_route.unpacked_path_segments[i])
+            {
+                description_factory.AppendSegment(facade->GetCoordinateOfNode(path_data.node),
+                                                  path_data);
+            }
+            description_factory.SetEndSegment(raw_route.segment_end_coordinates[i].target_phantom,
+                                              raw_route.target_traversed_in_reverse[i],
+                                              raw_route.is_via_leg(i));
+        }
+        description_factory.Run(facade, config.zoom_level);
+        description_factory.BuildRouteSummary(description_factory.entireLength,
+                                              raw_route.shortest_path_length);
+
+        osrm::binary::AppendUInt32(reply.content, description_factory.summary.distance);
+        osrm::binary::AppendUInt32(reply.content, description_factory.summary.duration);
+
+        uint32_t number_of_coordinates = 0;
+        if (config.geometry)
+        {
+            number_of_coordinates = static_cast<uint32_t>(
+                std::count_if(description_factory.path_description.begin(),
+                              description_factory.path_description.end(),
+                              [](const SegmentInformation &segment)
+                              { return segment.necessary; }));
+        }
+        osrm::binary::AppendUInt32(reply.content, number_of_coordinates);
+        if (config.geometry)
+        {
+            FixedPointCoordinate last_coordinate(0, 0);
+            for (const SegmentInformation &segment : description_factory.path_description)
+            {
+                if (segment.necessary)
+                {
+                    osrm::binary::AppendZigZag(reply.content,
+                                               segment.location.lat - last_coordinate.lat);
+                    osrm::binary::AppendZigZag(reply.content,
+                                               segment.location.lon - last_coordinate.lon);
+                    last_coordinate = segment.location;
+                }
+            }
+        }
+
+        const std::vector<unsigned> &via_indices = description_factory.GetViaIndices();
+        osrm::binary::AppendUInt32(reply.content, static_cast<uint32_t>(via_indices.size()));
+        for (const unsigned via_index : via_indices)
+        {
+            osrm::binary::AppendUInt32(reply.content, via_index);
+        }
+
+        if (config.instructions)
+        {
+            std::vector<char> instructions;
+            const unsigned number_of_instructions = AppendInstructions(instructions);
+            osrm::binary::AppendUInt32(reply.content, number_of_instructions);
+            reply.content.insert(reply.content.end(), instructions.begin(), instructions.end());
+        }
+        else
+        {
+            osrm::binary::AppendUInt32(reply.content, 0);
+        }
+
+        osrm::binary::AppendUInt32(reply.content, static_cast<uint32_t>(name_ids.size()));
+        std::string name;
+        for (const unsigned name_id : name_ids)
+        {
+            facade->GetName(name_id, name);
+            osrm::binary::AppendString(reply.content, name);
+        }
+    }
+};
+
+#endif // BINARY_DESCRIPTOR_H
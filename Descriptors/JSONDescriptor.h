@@ -47,7 +47,7 @@ template <class DataFacadeT> class JSONDescriptor : public BaseDescriptor<DataFa
   private:
     DataFacadeT *facade;
     DescriptorConfig config;
-    DescriptionFactory description_factory, alternate_description_factory;
+    DescriptionFactory description_factory;
     FixedPointCoordinate current;
     unsigned entered_restricted_area_count;
     struct RoundAbout
@@ -66,7 +66,7 @@ template <class DataFacadeT> class JSONDescriptor : public BaseDescriptor<DataFa
         int length;
         unsigned position;
     };
-    std::vector<Segment> shortest_path_segments, alternative_path_segments;
+    std::vector<Segment> shortest_path_segments;
     ExtractRouteNames<DataFacadeT, Segment> GenerateRouteNames;
 
   public:
@@ -190,21 +190,29 @@ template <class DataFacadeT> class JSONDescriptor : public BaseDescriptor<DataFa
                                              shortest_leg_end_indices.end());
         json_result.values["via_indices"] = json_via_indices_array;
 
-        // only one alternative route is computed at this time, so this is hardcoded
-        if (INVALID_EDGE_WEIGHT != raw_route.alternative_path_length)
+        // every alternative is described on its own, arrays hold one entry per alternative
+        JSON::Array json_alternate_geometries_array;
+        JSON::Array json_alt_instructions;
+        JSON::Array json_alternate_route_summary_array;
+        JSON::Array json_alternate_names_array;
+        RouteNames route_names;
+        for (const auto i : osrm::irange<std::size_t>(0, raw_route.unpacked_alternatives.size()))
         {
-            json_result.values["found_alternative"] = JSON::True();
-            BOOST_ASSERT(!raw_route.alt_source_traversed_in_reverse.empty());
+            DescriptionFactory alternate_description_factory;
+            std::vector<Segment> alternative_path_segments;
+            BOOST_ASSERT(i < raw_route.alt_source_traversed_in_reverse.size());
             alternate_description_factory.SetStartSegment(
                 raw_route.segment_end_coordinates.front().source_phantom,
-                raw_route.alt_source_traversed_in_reverse.front());
+                raw_route.alt_source_traversed_in_reverse[i]);
             // Get all the coordinates for the computed route
-            for (const PathData &path_data : raw_route.unpacked_alternative)
+            for (const PathData &path_data : raw_route.unpacked_alternatives[i])
             {
                 current = facade->GetCoordinateOfNode(path_data.node);
                 alternate_description_factory.AppendSegment(current, path_data);
             }
-            alternate_description_factory.SetEndSegment(raw_route.segment_end_coordinates.back().target_phantom, raw_route.alt_source_traversed_in_reverse.back());
+            alternate_description_factory.SetEndSegment(
+                raw_route.segment_end_coordinates.back().target_phantom,
+                raw_route.alt_target_traversed_in_reverse[i]);
             alternate_description_factory.Run(facade, config.zoom_level);
 
             if (config.geometry)
@@ -212,27 +220,21 @@ template <class DataFacadeT> class JSONDescriptor : public BaseDescriptor<DataFa
                 JSON::Value alternate_geometry_string =
                     alternate_description_factory.AppendEncodedPolylineString(
                         config.encode_geometry);
-                JSON::Array json_alternate_geometries_array;
                 json_alternate_geometries_array.values.push_back(alternate_geometry_string);
-                json_result.values["alternative_geometries"] = json_alternate_geometries_array;
             }
-            // Generate instructions for each alternative (simulated here)
-            JSON::Array json_alt_instructions;
-            JSON::Array json_current_alt_instructions;
             if (config.instructions)
             {
+                JSON::Array json_current_alt_instructions;
                 BuildTextualDescription(alternate_description_factory,
                                         json_current_alt_instructions,
-                                        raw_route.alternative_path_length,
+                                        raw_route.alternative_path_lengths[i],
                                         alternative_path_segments);
                 json_alt_instructions.values.push_back(json_current_alt_instructions);
-                json_result.values["alternative_instructions"] = json_alt_instructions;
             }
             alternate_description_factory.BuildRouteSummary(
-                alternate_description_factory.entireLength, raw_route.alternative_path_length);
+                alternate_description_factory.entireLength, raw_route.alternative_path_lengths[i]);
 
             JSON::Object json_alternate_route_summary;
-            JSON::Array json_alternate_route_summary_array;
             json_alternate_route_summary.values["total_distance"] =
                 alternate_description_factory.summary.distance;
             json_alternate_route_summary.values["total_time"] =
@@ -242,36 +244,60 @@ template <class DataFacadeT> class JSONDescriptor : public BaseDescriptor<DataFa
             json_alternate_route_summary.values["end_point"] = facade->GetEscapedNameForNameID(
                 alternate_description_factory.summary.target_name_id);
             json_alternate_route_summary_array.values.push_back(json_alternate_route_summary);
-            json_result.values["alternative_summaries"] = json_alternate_route_summary_array;
 
-            std::vector<unsigned> const &alternate_leg_end_indices =
-                alternate_description_factory.GetViaIndices();
-            JSON::Array json_altenative_indices_array;
-            json_altenative_indices_array.values.insert(json_altenative_indices_array.values.end(),
-                                                        alternate_leg_end_indices.begin(),
-                                                        alternate_leg_end_indices.end());
-            json_result.values["alternative_indices"] = json_altenative_indices_array;
+            const RouteNames alternate_route_names =
+                GenerateRouteNames(shortest_path_segments, alternative_path_segments, facade);
+            JSON::Array json_alternate_names;
+            json_alternate_names.values.push_back(alternate_route_names.alternative_path_name_1);
+            json_alternate_names.values.push_back(alternate_route_names.alternative_path_name_2);
+            json_alternate_names_array.values.push_back(json_alternate_names);
+
+            if (0 == i)
+            {
+                // the shortest path is named to tell it apart from the first alternative
+                route_names = alternate_route_names;
+
+                // kept flat for compatibility, these are the indices of the first alternative
+                std::vector<unsigned> const &alternate_leg_end_indices =
+                    alternate_description_factory.GetViaIndices();
+                JSON::Array json_altenative_indices_array;
+                json_altenative_indices_array.values.insert(
+                    json_altenative_indices_array.values.end(),
+                    alternate_leg_end_indices.begin(),
+                    alternate_leg_end_indices.end());
+                json_result.values["alternative_indices"] = json_altenative_indices_array;
+            }
+        }
+
+        if (!raw_route.unpacked_alternatives.empty())
+        {
+            json_result.values["found_alternative"] = JSON::True();
+            if (config.geometry)
+            {
+                json_result.values["alternative_geometries"] = json_alternate_geometries_array;
+            }
+            if (config.instructions)
+            {
+                json_result.values["alternative_instructions"] = json_alt_instructions;
+            }
+            json_result.values["alternative_summaries"] = json_alternate_route_summary_array;
         }
         else
         {
             json_result.values["found_alternative"] = JSON::False();
+            std::vector<Segment> no_alternative_path_segments;
+            route_names =
+                GenerateRouteNames(shortest_path_segments, no_alternative_path_segments, facade);
         }
 
         // Get Names for both routes
-        RouteNames route_names =
-            GenerateRouteNames(shortest_path_segments, alternative_path_segments, facade);
         JSON::Array json_route_names;
         json_route_names.values.push_back(route_names.shortest_path_name_1);
         json_route_names.values.push_back(route_names.shortest_path_name_2);
         json_result.values["route_name"] = json_route_names;
 
-        if (INVALID_EDGE_WEIGHT != raw_route.alternative_path_length)
+        if (!raw_route.unpacked_alternatives.empty())
         {
-            JSON::Array json_alternate_names_array;
-            JSON::Array json_alternate_names;
-            json_alternate_names.values.push_back(route_names.alternative_path_name_1);
-            json_alternate_names.values.push_back(route_names.alternative_path_name_2);
-            json_alternate_names_array.values.push_back(json_alternate_names);
             json_result.values["alternative_names"] = json_alternate_names_array;
         }
 
@@ -0,0 +1,402 @@
+/*
+
+Copyright (c) 2014, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef BINARY_RESPONSE_H
+#define BINARY_RESPONSE_H
+
+// Compact binary encoding of table and viaroute responses, selected by output=binary.
+// All fixed-width integers are little-endian. Every response starts with
+//
+//   char[4] magic    "OSRB"
+//   uint16  version  currently 1
+//   uint16  kind     1 = distance table, 2 = route
+//   int32   status   0 on success, 207 if no route was found
+//
+// A distance table continues with
+//
+//   uint32  n                 number of locations
+//   int32   matrix[n * n]     row-major travel times in tenths of a second,
+//                             INT32_MAX marks unreachable pairs
+//
+// A route with status 0 continues with
+//
+//   uint32  total_distance    meters
+//   uint32  total_time        seconds
+//   uint32  coordinate_count
+//   varint  deltas[2 * coordinate_count]
+//                             zig-zag encoded differences of lat and lon in 1e-6 degrees,
+//                             the first pair is relative to (0, 0)
+//   uint32  via_index_count
+//   uint32  via_indices[via_index_count]
+//   uint32  instruction_count
+//   record  instructions[instruction_count], 20 bytes each:
+//             uint8  turn_instruction  as in the textual instructions, roundabouts are
+//                                      reported as EnterRoundAbout plus an exit number
+//             uint8  roundabout_exit   0 if not a roundabout
+//             uint16 bearing           degrees
+//             uint32 name_index        index into the name table below
+//             uint32 coordinate_index  first coordinate of the instruction
+//             uint32 length            meters
+//             uint32 duration          seconds
+//   uint32  name_count
+//   names[name_count], each a uint32 byte length followed by UTF-8 bytes
+//
+// Geometry and instructions are empty if they were switched off in the request.
+// Alternative routes are not part of the binary format.
+// Rejected requests are answered with the usual JSON status object and a JSON content type.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace osrm
+{
+namespace binary
+{
+
+const char MAGIC[4] = {'O', 'S', 'R', 'B'};
+const uint16_t VERSION = 1;
+const uint16_t TABLE_RESPONSE = 1;
+const uint16_t ROUTE_RESPONSE = 2;
+const unsigned INSTRUCTION_RECORD_SIZE = 20;
+
+struct Instruction
+{
+    uint8_t turn_instruction;
+    uint8_t roundabout_exit;
+    uint16_t bearing;
+    uint32_t name_index;
+    uint32_t coordinate_index;
+    uint32_t length;
+    uint32_t duration;
+};
+
+struct TableResponse
+{
+    int32_t status;
+    uint32_t number_of_locations;
+    std::vector<int32_t> matrix;
+};
+
+struct RouteResponse
+{
+    int32_t status;
+    uint32_t total_distance;
+    uint32_t total_time;
+    // pairs of lat, lon in 1e-6 degrees
+    std::vector<std::pair<int32_t, int32_t>> coordinates;
+    std::vector<uint32_t> via_indices;
+    std::vector<Instruction> instructions;
+    std::vector<std::string> names;
+};
+
+// encoding
+
+inline void AppendUInt8(std::vector<char> &output, const uint8_t value)
+{
+    output.push_back(static_cast<char>(value));
+}
+
+inline void AppendUInt16(std::vector<char> &output, const uint16_t value)
+{
+    output.push_back(static_cast<char>(value & 0xff));
+    output.push_back(static_cast<char>((value >> 8) & 0xff));
+}
+
+inline void AppendUInt32(std::vector<char> &output, const uint32_t value)
+{
+    output.push_back(static_cast<char>(value & 0xff));
+    output.push_back(static_cast<char>((value >> 8) & 0xff));
+    output.push_back(static_cast<char>((value >> 16) & 0xff));
+    output.push_back(static_cast<char>((value >> 24) & 0xff));
+}
+
+inline void AppendInt32(std::vector<char> &output, const int32_t value)
+{
+    AppendUInt32(output, static_cast<uint32_t>(value));
+}
+
+inline void AppendVarint(std::vector<char> &output, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        output.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    output.push_back(static_cast<char>(value));
+}
+
+inline void AppendZigZag(std::vector<char> &output, const int32_t value)
+{
+    AppendVarint(output,
+                 (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31));
+}
+
+inline void AppendHeader(std::vector<char> &output, const uint16_t kind, const int32_t status)
+{
+    output.insert(output.end(), MAGIC, MAGIC + 4);
+    AppendUInt16(output, VERSION);
+    AppendUInt16(output, kind);
+    AppendInt32(output, status);
+}
+
+inline void AppendString(std::vector<char> &output, const std::string &value)
+{
+    AppendUInt32(output, static_cast<uint32_t>(value.size()));
+    output.insert(output.end(), value.begin(), value.end());
+}
+
+// decoding, all functions return false on truncated or malformed input
+
+class Reader
+{
+  public:
+    Reader(const char *begin, const char *end) : position(begin), end(end) {}
+
+    bool ReadUInt8(uint8_t &value)
+    {
+        if (end - position < 1)
+        {
+            return false;
+        }
+        value = static_cast<uint8_t>(*position++);
+        return true;
+    }
+
+    bool ReadUInt16(uint16_t &value)
+    {
+        uint8_t low, high;
+        if (!ReadUInt8(low) || !ReadUInt8(high))
+        {
+            return false;
+        }
+        value = static_cast<uint16_t>(low | (high << 8));
+        return true;
+    }
+
+    bool ReadUInt32(uint32_t &value)
+    {
+        uint16_t low, high;
+        if (!ReadUInt16(low) || !ReadUInt16(high))
+        {
+            return false;
+        }
+        value = static_cast<uint32_t>(low) | (static_cast<uint32_t>(high) << 16);
+        return true;
+    }
+
+    bool ReadInt32(int32_t &value)
+    {
+        uint32_t raw;
+        if (!ReadUInt32(raw))
+        {
+            return false;
+        }
+        value = static_cast<int32_t>(raw);
+        return true;
+    }
+
+    bool ReadVarint(uint32_t &value)
+    {
+        value = 0;
+        for (unsigned shift = 0; shift < 35; shift += 7)
+        {
+            uint8_t byte;
+            if (!ReadUInt8(byte))
+            {
+                return false;
+            }
+            value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+            if (0 == (byte & 0x80))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool ReadZigZag(int32_t &value)
+    {
+        uint32_t raw;
+        if (!ReadVarint(raw))
+        {
+            return false;
+        }
+        value = static_cast<int32_t>((raw >> 1) ^ (~(raw & 1) + 1));
+        return true;
+    }
+
+    bool ReadString(std::string &value)
+    {
+        uint32_t length;
+        if (!ReadUInt32(length) || static_cast<uint32_t>(end - position) < length)
+        {
+            return false;
+        }
+        value.assign(position, position + length);
+        position += length;
+        return true;
+    }
+
+    bool ReadHeader(const uint16_t expected_kind, int32_t &status)
+    {
+        if (end - position < 4 || !std::equal(MAGIC, MAGIC + 4, position))
+        {
+            return false;
+        }
+        position += 4;
+        uint16_t version, kind;
+        return ReadUInt16(version) && VERSION == version && ReadUInt16(kind) &&
+               expected_kind == kind && ReadInt32(status);
+    }
+
+    // guards allocations against bogus counts
+    bool HasAtLeast(const uint64_t number_of_bytes) const
+    {
+        return static_cast<uint64_t>(end - position) >= number_of_bytes;
+    }
+
+  private:
+    const char *position;
+    const char *end;
+};
+
+inline bool DecodeTable(const std::vector<char> &input, TableResponse &table)
+{
+    Reader reader(input.data(), input.data() + input.size());
+    if (!reader.ReadHeader(TABLE_RESPONSE, table.status) ||
+        !reader.ReadUInt32(table.number_of_locations))
+    {
+        return false;
+    }
+    const uint64_t number_of_entries =
+        static_cast<uint64_t>(table.number_of_locations) * table.number_of_locations;
+    if (!reader.HasAtLeast(4 * number_of_entries))
+    {
+        return false;
+    }
+    table.matrix.resize(static_cast<std::size_t>(number_of_entries));
+    for (int32_t &entry : table.matrix)
+    {
+        reader.ReadInt32(entry);
+    }
+    return true;
+}
+
+inline bool DecodeRoute(const std::vector<char> &input, RouteResponse &route)
+{
+    Reader reader(input.data(), input.data() + input.size());
+    route.coordinates.clear();
+    route.via_indices.clear();
+    route.instructions.clear();
+    route.names.clear();
+    route.total_distance = 0;
+    route.total_time = 0;
+    if (!reader.ReadHeader(ROUTE_RESPONSE, route.status))
+    {
+        return false;
+    }
+    if (0 != route.status)
+    {
+        return true;
+    }
+
+    uint32_t count;
+    if (!reader.ReadUInt32(route.total_distance) || !reader.ReadUInt32(route.total_time) ||
+        !reader.ReadUInt32(count) || !reader.HasAtLeast(2 * static_cast<uint64_t>(count)))
+    {
+        return false;
+    }
+    int32_t lat = 0, lon = 0;
+    route.coordinates.reserve(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        int32_t lat_delta, lon_delta;
+        if (!reader.ReadZigZag(lat_delta) || !reader.ReadZigZag(lon_delta))
+        {
+            return false;
+        }
+        lat += lat_delta;
+        lon += lon_delta;
+        route.coordinates.emplace_back(lat, lon);
+    }
+
+    if (!reader.ReadUInt32(count) || !reader.HasAtLeast(4 * static_cast<uint64_t>(count)))
+    {
+        return false;
+    }
+    route.via_indices.resize(count);
+    for (uint32_t &via_index : route.via_indices)
+    {
+        reader.ReadUInt32(via_index);
+    }
+
+    if (!reader.ReadUInt32(count) ||
+        !reader.HasAtLeast(INSTRUCTION_RECORD_SIZE * static_cast<uint64_t>(count)))
+    {
+        return false;
+    }
+    route.instructions.resize(count);
+    for (Instruction &instruction : route.instructions)
+    {
+        reader.ReadUInt8(instruction.turn_instruction);
+        reader.ReadUInt8(instruction.roundabout_exit);
+        reader.ReadUInt16(instruction.bearing);
+        reader.ReadUInt32(instruction.name_index);
+        reader.ReadUInt32(instruction.coordinate_index);
+        reader.ReadUInt32(instruction.length);
+        reader.ReadUInt32(instruction.duration);
+    }
+
+    if (!reader.ReadUInt32(count) || !reader.HasAtLeast(4 * static_cast<uint64_t>(count)))
+    {
+        return false;
+    }
+    route.names.resize(count);
+    for (std::string &name : route.names)
+    {
+        if (!reader.ReadString(name))
+        {
+            return false;
+        }
+    }
+    for (const Instruction &instruction : route.instructions)
+    {
+        if (instruction.name_index >= route.names.size())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+}
+}
+
+#endif // BINARY_RESPONSE_H
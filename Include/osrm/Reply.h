@@ -41,11 +41,14 @@ const char okHTML[] = "";
 const char badRequestHTML[] = "{\"status\": 400,\"status_message\":\"Bad Request\"}";
 const char internalServerErrorHTML[] =
     "{\"status\": 500,\"status_message\":\"Internal Server Error\"}";
+const char serviceUnavailableHTML[] =
+    "{\"status\": 503,\"status_message\":\"Service Unavailable\"}";
 const char seperators[] = {':', ' '};
 const char crlf[] = {'\r', '\n'};
 const std::string okString = "HTTP/1.0 200 OK\r\n";
 const std::string badRequestString = "HTTP/1.0 400 Bad Request\r\n";
 const std::string internalServerErrorString = "HTTP/1.0 500 Internal Server Error\r\n";
+const std::string serviceUnavailableString = "HTTP/1.0 503 Service Unavailable\r\n";
 
 class Reply
 {
@@ -53,7 +56,8 @@ class Reply
     enum status_type
     { ok = 200,
       badRequest = 400,
-      internalServerError = 500 } status;
+      internalServerError = 500,
+      serviceUnavailable = 503 } status;
 
     std::vector<Header> headers;
     std::vector<boost::asio::const_buffer> ToBuffers();
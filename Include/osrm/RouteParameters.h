@@ -43,6 +43,14 @@ struct RouteParameters
 
     void setAlternateRouteFlag(const bool flag);
 
+    void setNumberOfAlternatives(const unsigned number);
+
+    void setTimeBound(const unsigned seconds);
+
+    void setNumberOfResults(const unsigned number);
+
+    void setRadius(const double meters);
+
     void setUTurn(const bool flag);
 
     void setAllUTurns(const bool flag);
@@ -51,6 +59,8 @@ struct RouteParameters
 
     void setChecksum(const unsigned check_sum);
 
+    void setTimeout(const unsigned milliseconds);
+
     void setInstructionFlag(const bool flag);
 
     void setService(const std::string &service);
@@ -72,11 +82,16 @@ struct RouteParameters
     short zoom_level;
     bool print_instructions;
     bool alternate_route;
+    unsigned number_of_alternatives; // at most this many alternatives if alternate_route is set
+    unsigned time_bound;             // seconds, 0 if none is given
+    unsigned number_of_results;      // at most this many nearest phantom nodes, 0 if none is given
+    double radius;                   // meters to look for nearest phantom nodes in, 0 if unbounded
     bool geometry;
     bool compression;
     bool deprecatedAPI;
     bool uturn_default;
     unsigned check_sum;
+    unsigned timeout; // in milliseconds, 0 means no deadline
     std::string service;
     std::string output_format;
     std::string jsonp_parameter;
@@ -44,7 +44,11 @@ class OSRM
     OSRM_impl *OSRM_pimpl_;
 
   public:
-    explicit OSRM(const ServerPaths &paths, const bool use_shared_memory = false);
+    explicit OSRM(const ServerPaths &paths,
+                  const bool use_shared_memory = false,
+                  const unsigned max_query_time = 0,
+                  const unsigned parallel_leg_threshold = 0,
+                  const unsigned leaf_cache_size = 0);
     ~OSRM();
     void RunQuery(RouteParameters &route_parameters, http::Reply &reply);
 };
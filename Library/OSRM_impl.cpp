@@ -37,6 +37,7 @@ namespace boost { namespace interprocess { class named_mutex; } }
 #include "../Plugins/BasePlugin.h"
 #include "../Plugins/DistanceTablePlugin.h"
 #include "../Plugins/HelloWorldPlugin.h"
+#include "../Plugins/IsochronePlugin.h"
 #include "../Plugins/LocatePlugin.h"
 #include "../Plugins/NearestPlugin.h"
 #include "../Plugins/TimestampPlugin.h"
@@ -56,26 +57,33 @@ namespace boost { namespace interprocess { class named_mutex; } }
 #include <utility>
 #include <vector>
 
-OSRM_impl::OSRM_impl(const ServerPaths &server_paths, const bool use_shared_memory)
-    : use_shared_memory(use_shared_memory)
+OSRM_impl::OSRM_impl(const ServerPaths &server_paths,
+                     const bool use_shared_memory,
+                     const unsigned max_query_time,
+                     const unsigned parallel_leg_threshold,
+                     const unsigned leaf_cache_size)
+    : use_shared_memory(use_shared_memory), max_query_time(max_query_time)
 {
     if (use_shared_memory)
     {
         barrier = new SharedBarriers();
-        query_data_facade = new SharedDataFacade<QueryEdge::EdgeData>();
+        query_data_facade = new SharedDataFacade<QueryEdge::EdgeData>(leaf_cache_size);
     }
     else
     {
-        query_data_facade = new InternalDataFacade<QueryEdge::EdgeData>(server_paths);
+        query_data_facade =
+            new InternalDataFacade<QueryEdge::EdgeData>(server_paths, leaf_cache_size);
     }
 
     // The following plugins handle all requests.
     RegisterPlugin(new DistanceTablePlugin<BaseDataFacade<QueryEdge::EdgeData>>(query_data_facade));
     RegisterPlugin(new HelloWorldPlugin());
+    RegisterPlugin(new IsochronePlugin<BaseDataFacade<QueryEdge::EdgeData>>(query_data_facade));
     RegisterPlugin(new LocatePlugin<BaseDataFacade<QueryEdge::EdgeData>>(query_data_facade));
     RegisterPlugin(new NearestPlugin<BaseDataFacade<QueryEdge::EdgeData>>(query_data_facade));
     RegisterPlugin(new TimestampPlugin<BaseDataFacade<QueryEdge::EdgeData>>(query_data_facade));
-    RegisterPlugin(new ViaRoutePlugin<BaseDataFacade<QueryEdge::EdgeData>>(query_data_facade));
+    RegisterPlugin(new ViaRoutePlugin<BaseDataFacade<QueryEdge::EdgeData>>(
+        query_data_facade, parallel_leg_threshold));
 }
 
 OSRM_impl::~OSRM_impl()
@@ -108,6 +116,14 @@ void OSRM_impl::RunQuery(RouteParameters &route_parameters, http::Reply &reply)
     if (plugin_map.end() != iter)
     {
         reply.status = http::Reply::ok;
+
+        // the server-wide limit caps whatever deadline the client asked for
+        if (0 != max_query_time &&
+            (0 == route_parameters.timeout || max_query_time < route_parameters.timeout))
+        {
+            route_parameters.timeout = max_query_time;
+        }
+
         if (use_shared_memory)
         {
             // lock update pending
@@ -128,7 +144,7 @@ void OSRM_impl::RunQuery(RouteParameters &route_parameters, http::Reply &reply)
                 ->CheckAndReloadFacade();
         }
 
-        iter->second->HandleRequest(route_parameters, reply);
+        iter->second->HandleRequestWithDeadline(route_parameters, reply);
         if (use_shared_memory)
         {
             // lock query
@@ -154,8 +170,13 @@ void OSRM_impl::RunQuery(RouteParameters &route_parameters, http::Reply &reply)
 
 // proxy code for compilation firewall
 
-OSRM::OSRM(const ServerPaths &paths, const bool use_shared_memory)
-    : OSRM_pimpl_(new OSRM_impl(paths, use_shared_memory))
+OSRM::OSRM(const ServerPaths &paths,
+           const bool use_shared_memory,
+           const unsigned max_query_time,
+           const unsigned parallel_leg_threshold,
+           const unsigned leaf_cache_size)
+    : OSRM_pimpl_(new OSRM_impl(
+          paths, use_shared_memory, max_query_time, parallel_leg_threshold, leaf_cache_size))
 {
 }
 
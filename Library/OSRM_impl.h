@@ -48,7 +48,11 @@ class OSRM_impl
     typedef std::unordered_map<std::string, BasePlugin *> PluginMap;
 
   public:
-    OSRM_impl(const ServerPaths &paths, const bool use_shared_memory);
+    OSRM_impl(const ServerPaths &paths,
+              const bool use_shared_memory,
+              const unsigned max_query_time,
+              const unsigned parallel_leg_threshold,
+              const unsigned leaf_cache_size);
     OSRM_impl(const OSRM_impl &) = delete;
     virtual ~OSRM_impl();
     void RunQuery(RouteParameters &route_parameters, http::Reply &reply);
@@ -57,6 +61,7 @@ class OSRM_impl
     void RegisterPlugin(BasePlugin *plugin);
     PluginMap plugin_map;
     bool use_shared_memory;
+    unsigned max_query_time;
     SharedBarriers *barrier;
     // base class pointer to the objects
     BaseDataFacade<QueryEdge::EdgeData> *query_data_facade;
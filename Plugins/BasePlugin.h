@@ -28,6 +28,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef BASEPLUGIN_H_
 #define BASEPLUGIN_H_
 
+#include "../Util/QueryDeadline.h"
 #include "../Util/StringUtil.h"
 
 #include <osrm/Coordinate.h>
@@ -45,6 +46,20 @@ class BasePlugin
     virtual ~BasePlugin() {}
     virtual const std::string GetDescriptor() const = 0;
     virtual void HandleRequest(const RouteParameters &routeParameters, http::Reply &reply) = 0;
+
+    // answers a request that ran past its deadline with 503 Service Unavailable. 408 Request
+    // Timeout would blame the client for sending its request too slowly.
+    void HandleRequestWithDeadline(const RouteParameters &routeParameters, http::Reply &reply)
+    {
+        try
+        {
+            HandleRequest(routeParameters, reply);
+        }
+        catch (const QueryTimeoutException &)
+        {
+            reply = http::Reply::StockReply(http::Reply::serviceUnavailable);
+        }
+    }
 };
 
 #endif /* BASEPLUGIN_H_ */
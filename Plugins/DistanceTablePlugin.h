@@ -35,6 +35,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../DataStructures/QueryEdge.h"
 #include "../DataStructures/SearchEngine.h"
 #include "../Descriptors/BaseDescriptor.h"
+#include "../Descriptors/BinaryDescriptor.h"
+#include "../Util/QueryDeadline.h"
 #include "../Util/SimpleLogger.h"
 #include "../Util/StringUtil.h"
 #include "../Util/TimingUtil.h"
@@ -71,6 +73,7 @@ template <class DataFacadeT> class DistanceTablePlugin : public BasePlugin
             return;
         }
 
+        const QueryDeadline deadline(route_parameters.timeout);
         RawRouteData raw_route;
         raw_route.check_sum = facade->GetCheckSum();
 
@@ -92,6 +95,9 @@ template <class DataFacadeT> class DistanceTablePlugin : public BasePlugin
         unsigned max_locations =
             std::min(100u, static_cast<unsigned>(raw_route.raw_via_node_coordinates.size()));
         PhantomNodeArray phantom_node_vector(max_locations);
+        // locations without a usable hint are looked up in one batch
+        std::vector<FixedPointCoordinate> lookup_coordinates;
+        std::vector<unsigned> lookup_locations;
         for (unsigned i = 0; i < max_locations; ++i)
         {
             if (checksum_OK && i < route_parameters.hints.size() &&
@@ -105,17 +111,23 @@ template <class DataFacadeT> class DistanceTablePlugin : public BasePlugin
                     continue;
                 }
             }
-            facade->IncrementalFindPhantomNodeForCoordinate(raw_route.raw_via_node_coordinates[i],
-                                                            phantom_node_vector[i],
-                                                            route_parameters.zoom_level,
-                                                            1);
+            lookup_coordinates.emplace_back(raw_route.raw_via_node_coordinates[i]);
+            lookup_locations.emplace_back(i);
+        }
 
-            BOOST_ASSERT(phantom_node_vector[i].front().isValid(facade->GetNumberOfNodes()));
+        PhantomNodeArray lookup_phantom_nodes;
+        facade->IncrementalFindPhantomNodesForCoordinates(
+            lookup_coordinates, lookup_phantom_nodes, route_parameters.zoom_level, 1, deadline);
+        for (unsigned j = 0; j < lookup_locations.size(); ++j)
+        {
+            phantom_node_vector[lookup_locations[j]] = std::move(lookup_phantom_nodes[j]);
+            BOOST_ASSERT(phantom_node_vector[lookup_locations[j]].front().isValid(
+                facade->GetNumberOfNodes()));
         }
 
         // TIMER_START(distance_table);
         std::shared_ptr<std::vector<EdgeWeight>> result_table =
-            search_engine_ptr->distance_table(phantom_node_vector);
+            search_engine_ptr->distance_table(phantom_node_vector, deadline);
         // TIMER_STOP(distance_table);
 
         if (!result_table)
@@ -123,9 +135,16 @@ template <class DataFacadeT> class DistanceTablePlugin : public BasePlugin
             reply = http::Reply::StockReply(http::Reply::badRequest);
             return;
         }
+
+        const unsigned number_of_locations = static_cast<unsigned>(phantom_node_vector.size());
+        if ("binary" == route_parameters.output_format)
+        { // raw int32 matrix, see <osrm/BinaryResponse.h>
+            BinaryDescriptor<DataFacadeT>::RunTable(number_of_locations, *result_table, reply);
+            return;
+        }
+
         JSON::Object json_object;
         JSON::Array json_array;
-        const unsigned number_of_locations = static_cast<unsigned>(phantom_node_vector.size());
         for (unsigned row = 0; row < number_of_locations; ++row)
         {
             JSON::Array json_row;
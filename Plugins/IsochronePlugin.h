@@ -0,0 +1,186 @@
+/*
+
+Copyright (c) 2014, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#ifndef ISOCHRONE_PLUGIN_H
+#define ISOCHRONE_PLUGIN_H
+
+#include "BasePlugin.h"
+
+#include "../Algorithms/ConvexHull.h"
+#include "../Algorithms/ObjectToBase64.h"
+#include "../DataStructures/JSONContainer.h"
+#include "../DataStructures/QueryEdge.h"
+#include "../DataStructures/SearchEngine.h"
+#include "../Util/QueryDeadline.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+ * This Plugin computes the area reachable from each location within time=<seconds>, either as
+ * the convex hull of the reached intersections or as the reached nodes with their travel time.
+ */
+
+template <class DataFacadeT> class IsochronePlugin : public BasePlugin
+{
+  private:
+    std::shared_ptr<SearchEngine<DataFacadeT>> search_engine_ptr;
+
+  public:
+    explicit IsochronePlugin(DataFacadeT *facade) : descriptor_string("isochrone"), facade(facade)
+    {
+        search_engine_ptr = std::make_shared<SearchEngine<DataFacadeT>>(facade);
+    }
+
+    virtual ~IsochronePlugin() {}
+
+    const std::string GetDescriptor() const { return descriptor_string; }
+
+    void HandleRequest(const RouteParameters &route_parameters, http::Reply &reply)
+    {
+        // check number of parameters, weights are in tenths of a second
+        if (route_parameters.coordinates.empty() ||
+            route_parameters.coordinates.size() > max_locations ||
+            0 == route_parameters.time_bound || route_parameters.time_bound > max_time_bound)
+        {
+            reply = http::Reply::StockReply(http::Reply::badRequest);
+            return;
+        }
+
+        if (std::any_of(begin(route_parameters.coordinates),
+                        end(route_parameters.coordinates),
+                        [&](FixedPointCoordinate coordinate)
+                        { return !coordinate.isValid(); }))
+        {
+            reply = http::Reply::StockReply(http::Reply::badRequest);
+            return;
+        }
+
+        JSON::Object json_object;
+        if (!search_engine_ptr->one_to_all.IsAvailable())
+        {
+            json_object.values["status"] = 207;
+            json_object.values["status_message"] = "No level ordered nodes loaded";
+            JSON::render(reply.content, json_object);
+            return;
+        }
+
+        const QueryDeadline deadline(route_parameters.timeout);
+        const bool checksum_OK = (route_parameters.check_sum == facade->GetCheckSum());
+        const unsigned number_of_locations =
+            static_cast<unsigned>(route_parameters.coordinates.size());
+        PhantomNodeArray phantom_node_vector(number_of_locations);
+        // locations without a usable hint are looked up in one batch
+        std::vector<FixedPointCoordinate> lookup_coordinates;
+        std::vector<unsigned> lookup_locations;
+        for (unsigned i = 0; i < number_of_locations; ++i)
+        {
+            if (checksum_OK && i < route_parameters.hints.size() &&
+                !route_parameters.hints[i].empty())
+            {
+                PhantomNode current_phantom_node;
+                DecodeObjectFromBase64(route_parameters.hints[i], current_phantom_node);
+                if (current_phantom_node.isValid(facade->GetNumberOfNodes()))
+                {
+                    phantom_node_vector[i].emplace_back(std::move(current_phantom_node));
+                    continue;
+                }
+            }
+            lookup_coordinates.emplace_back(route_parameters.coordinates[i]);
+            lookup_locations.emplace_back(i);
+        }
+
+        PhantomNodeArray lookup_phantom_nodes;
+        facade->IncrementalFindPhantomNodesForCoordinates(
+            lookup_coordinates, lookup_phantom_nodes, route_parameters.zoom_level, 1, deadline);
+        for (unsigned j = 0; j < lookup_locations.size(); ++j)
+        {
+            phantom_node_vector[lookup_locations[j]] = std::move(lookup_phantom_nodes[j]);
+        }
+
+        const EdgeWeight max_distance = static_cast<EdgeWeight>(10 * route_parameters.time_bound);
+        std::vector<std::vector<EdgeWeight>> distances;
+        search_engine_ptr->one_to_all(phantom_node_vector, max_distance, distances, deadline);
+
+        JSON::Array json_isochrones;
+        for (unsigned i = 0; i < number_of_locations; ++i)
+        {
+            JSON::Object json_isochrone;
+            if (route_parameters.geometry)
+            {
+                std::vector<FixedPointCoordinate> coordinates;
+                if (!phantom_node_vector[i].empty())
+                {
+                    coordinates.emplace_back(phantom_node_vector[i].front().location);
+                }
+                search_engine_ptr->one_to_all.GetReachedCoordinates(
+                    distances[i], max_distance, coordinates);
+
+                JSON::Array json_polygon;
+                for (const FixedPointCoordinate &coordinate : ConvexHull(std::move(coordinates)))
+                {
+                    JSON::Array json_coordinate;
+                    json_coordinate.values.push_back(coordinate.lat / COORDINATE_PRECISION);
+                    json_coordinate.values.push_back(coordinate.lon / COORDINATE_PRECISION);
+                    json_polygon.values.push_back(json_coordinate);
+                }
+                json_isochrone.values["polygon"] = json_polygon;
+            }
+            else
+            {
+                JSON::Array json_nodes;
+                for (const auto node : osrm::irange(0u, static_cast<unsigned>(distances[i].size())))
+                {
+                    if (INVALID_EDGE_WEIGHT != distances[i][node])
+                    {
+                        JSON::Array json_node;
+                        json_node.values.push_back(node);
+                        json_node.values.push_back(distances[i][node]);
+                        json_nodes.values.push_back(json_node);
+                    }
+                }
+                json_isochrone.values["reached_nodes"] = json_nodes;
+            }
+            json_isochrones.values.push_back(json_isochrone);
+        }
+        json_object.values["status"] = 0;
+        json_object.values["isochrones"] = json_isochrones;
+        JSON::render(reply.content, json_object);
+    }
+
+  private:
+    // every location keeps a distance per node of the search graph while it is swept
+    static const unsigned max_locations = 16;
+    // 2 hours, keeps the bounded distances far from overflowing
+    static const unsigned max_time_bound = 7200;
+
+    std::string descriptor_string;
+    DataFacadeT *facade;
+};
+
+#endif // ISOCHRONE_PLUGIN_H
@@ -31,11 +31,18 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "BasePlugin.h"
 #include "../DataStructures/JSONContainer.h"
 #include "../DataStructures/PhantomNodes.h"
+#include "../Util/QueryDeadline.h"
 
+#include <algorithm>
+#include <limits>
 #include <string>
+#include <utility>
+#include <vector>
 
 /*
  * This Plugin locates the nearest point on a street in the road network for a given coordinate.
+ * With number=<k> and/or radius=<meters> it also lists up to k points on streets within the
+ * radius, closest first.
  */
 
 template <class DataFacadeT> class NearestPlugin : public BasePlugin
@@ -54,14 +61,58 @@ template <class DataFacadeT> class NearestPlugin : public BasePlugin
             return;
         }
 
-        std::vector<PhantomNode> phantom_node_vector;
-        facade->IncrementalFindPhantomNodeForCoordinate(route_parameters.coordinates.front(),
-                                                        phantom_node_vector,
-                                                        route_parameters.zoom_level,
-                                                        1);
-
+        const QueryDeadline deadline(route_parameters.timeout);
+        const bool has_radius = 0. < route_parameters.radius;
         JSON::Object json_result;
-        if (phantom_node_vector.empty() || !phantom_node_vector.front().isValid())
+        if (0 == route_parameters.number_of_results && !has_radius)
+        {
+            std::vector<PhantomNode> phantom_node_vector;
+            facade->IncrementalFindPhantomNodeForCoordinate(route_parameters.coordinates.front(),
+                                                            phantom_node_vector,
+                                                            route_parameters.zoom_level,
+                                                            1,
+                                                            deadline);
+            if (phantom_node_vector.empty() || !phantom_node_vector.front().isValid())
+            {
+                json_result.values["status"] = 207;
+            }
+            else
+            {
+                reply.status = http::Reply::ok;
+                json_result.values["status"] = 0;
+                AddPhantomNode(phantom_node_vector.front(), json_result);
+            }
+            JSON::render(reply.content, json_result);
+            return;
+        }
+
+        // a radius without a number asks for every result within it, up to the cap
+        const unsigned requested_number_of_results =
+            0 < route_parameters.number_of_results
+                ? route_parameters.number_of_results
+                : max_number_of_results;
+        const unsigned number_of_results = requested_number_of_results < max_number_of_results
+                                               ? requested_number_of_results
+                                               : max_number_of_results;
+        const float max_distance = has_radius
+                                       ? static_cast<float>(std::min<double>(
+                                             route_parameters.radius, std::numeric_limits<float>::max()))
+                                       : std::numeric_limits<float>::max();
+        std::vector<std::pair<PhantomNode, double>> phantom_node_vector;
+        facade->IncrementalFindPhantomNodeForCoordinateWithDistance(
+            route_parameters.coordinates.front(),
+            phantom_node_vector,
+            route_parameters.zoom_level,
+            number_of_results,
+            max_distance,
+            deadline);
+        // the search has dropped the results in tiny components if there are any in big ones
+        if (phantom_node_vector.size() > number_of_results)
+        {
+            phantom_node_vector.resize(number_of_results);
+        }
+
+        if (phantom_node_vector.empty() || !phantom_node_vector.front().first.isValid())
         {
             json_result.values["status"] = 207;
         }
@@ -69,21 +120,36 @@ template <class DataFacadeT> class NearestPlugin : public BasePlugin
         {
             reply.status = http::Reply::ok;
             json_result.values["status"] = 0;
-            JSON::Array json_coordinate;
-            json_coordinate.values.push_back(phantom_node_vector.front().location.lat /
-                                             COORDINATE_PRECISION);
-            json_coordinate.values.push_back(phantom_node_vector.front().location.lon /
-                                             COORDINATE_PRECISION);
-            json_result.values["mapped_coordinate"] = json_coordinate;
-            std::string temp_string;
-            facade->GetName(phantom_node_vector.front().name_id, temp_string);
-            json_result.values["name"] = temp_string;
+            AddPhantomNode(phantom_node_vector.front().first, json_result);
+            JSON::Array json_results;
+            for (const auto &phantom_node_with_distance : phantom_node_vector)
+            {
+                JSON::Object json_phantom_node;
+                AddPhantomNode(phantom_node_with_distance.first, json_phantom_node);
+                json_phantom_node.values["distance"] = phantom_node_with_distance.second;
+                json_results.values.push_back(json_phantom_node);
+            }
+            json_result.values["results"] = json_results;
         }
 
         JSON::render(reply.content, json_result);
     }
 
   private:
+    void AddPhantomNode(const PhantomNode &phantom_node, JSON::Object &json_object) const
+    {
+        JSON::Array json_coordinate;
+        json_coordinate.values.push_back(phantom_node.location.lat / COORDINATE_PRECISION);
+        json_coordinate.values.push_back(phantom_node.location.lon / COORDINATE_PRECISION);
+        json_object.values["mapped_coordinate"] = json_coordinate;
+        std::string temp_string;
+        facade->GetName(phantom_node.name_id, temp_string);
+        json_object.values["name"] = temp_string;
+    }
+
+    // every result is measured exactly, so a request cannot ask for arbitrarily many
+    static const unsigned max_number_of_results = 100;
+
     DataFacadeT *facade;
     std::string descriptor_string;
 };
@@ -34,38 +34,27 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <boost/assert.hpp>
 
-#include <unordered_map>
-#include <unordered_set>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
 
+#include <algorithm>
+#include <atomic>
 #include <vector>
 
 const double VIAPATH_ALPHA = 0.10;
 const double VIAPATH_EPSILON = 0.15; // alternative at most 15% longer
-const double VIAPATH_GAMMA = 0.75;   // alternative shares at most 75% with the shortest.
+const double VIAPATH_GAMMA = 0.75;   // alternative shares at most 75% with the shortest
+                                     // and with each of the other alternatives.
+const unsigned VIAPATH_MAX_ALTERNATIVES = 5;
 
 template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInterface<DataFacadeT>
 {
     typedef BasicRoutingInterface<DataFacadeT> super;
     typedef typename DataFacadeT::EdgeData EdgeData;
     typedef SearchEngineData::QueryHeap QueryHeap;
-    typedef std::pair<NodeID, NodeID> SearchSpaceEdge;
+    typedef SearchWorkspace::SearchSpaceEdge SearchSpaceEdge;
 
-    struct RankedCandidateNode
-    {
-        RankedCandidateNode(const NodeID node, const int length, const int sharing)
-            : node(node), length(length), sharing(sharing)
-        {
-        }
-
-        NodeID node;
-        int length;
-        int sharing;
-
-        bool operator<(const RankedCandidateNode &other) const
-        {
-            return (2 * length + sharing) < (2 * other.length + other.sharing);
-        }
-    };
     DataFacadeT *facade;
     SearchEngineData &engine_working_data;
 
@@ -77,25 +66,35 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
 
     virtual ~AlternativeRouting() {}
 
-    void operator()(const PhantomNodes &phantom_node_pair, RawRouteData &raw_route_data)
+    void operator()(const PhantomNodes &phantom_node_pair,
+                    RawRouteData &raw_route_data,
+                    const QueryDeadline &deadline = QueryDeadline())
+    {
+        operator()(phantom_node_pair, 1, raw_route_data, deadline);
+    }
+
+    // Computes the shortest path and up to number_of_alternatives alternatives, all of them
+    // derived from a single pair of forward and reverse search spaces.
+    void operator()(const PhantomNodes &phantom_node_pair,
+                    const unsigned number_of_alternatives,
+                    RawRouteData &raw_route_data,
+                    const QueryDeadline &deadline = QueryDeadline())
     {
-        std::vector<NodeID> alternative_path;
-        std::vector<NodeID> via_node_candidate_list;
-        std::vector<SearchSpaceEdge> forward_search_space;
-        std::vector<SearchSpaceEdge> reverse_search_space;
-
-        // Init queues, semi-expensive because access to TSS invokes a sys-call
-        engine_working_data.InitializeOrClearFirstThreadLocalStorage(
-            super::facade->GetNumberOfNodes());
-        engine_working_data.InitializeOrClearSecondThreadLocalStorage(
-            super::facade->GetNumberOfNodes());
-        engine_working_data.InitializeOrClearThirdThreadLocalStorage(
-            super::facade->GetNumberOfNodes());
-
-        QueryHeap &forward_heap1 = *(engine_working_data.forwardHeap);
-        QueryHeap &reverse_heap1 = *(engine_working_data.backwardHeap);
-        QueryHeap &forward_heap2 = *(engine_working_data.forwardHeap2);
-        QueryHeap &reverse_heap2 = *(engine_working_data.backwardHeap2);
+        // the only access to TSS during this query, everything below works on the workspace
+        SearchWorkspace &workspace =
+            engine_working_data.GetThreadLocalWorkspace(super::facade->GetNumberOfNodes());
+
+        std::vector<NodeID> &via_node_candidate_list = workspace.via_node_candidate_list;
+        std::vector<SearchSpaceEdge> &forward_search_space = workspace.forward_search_space;
+        std::vector<SearchSpaceEdge> &reverse_search_space = workspace.reverse_search_space;
+        via_node_candidate_list.clear();
+        forward_search_space.clear();
+        reverse_search_space.clear();
+
+        QueryHeap &forward_heap1 = workspace.forward_heap1;
+        QueryHeap &reverse_heap1 = workspace.reverse_heap1;
+        forward_heap1.Clear();
+        reverse_heap1.Clear();
 
         int upper_bound_to_shortest_path_distance = INVALID_EDGE_WEIGHT;
         NodeID middle_node = SPECIAL_NODEID;
@@ -145,6 +144,7 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
         // search from s and t till new_min/(1+epsilon) > length_of_shortest_path
         while (0 < (forward_heap1.Size() + reverse_heap1.Size()))
         {
+            deadline.Check();
             if (0 < forward_heap1.Size())
             {
                 AlternativeRoutingStep<true>(forward_heap1,
@@ -174,21 +174,33 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
 
         sort_unique_resize(via_node_candidate_list);
 
-        std::vector<NodeID> packed_forward_path;
-        std::vector<NodeID> packed_reverse_path;
+        std::vector<NodeID> &packed_forward_path = workspace.packed_forward_path;
+        std::vector<NodeID> &packed_reverse_path = workspace.packed_reverse_path;
+        packed_forward_path.clear();
+        packed_reverse_path.clear();
 
         super::RetrievePackedPathFromSingleHeap(forward_heap1, middle_node, packed_forward_path);
         super::RetrievePackedPathFromSingleHeap(reverse_heap1, middle_node, packed_reverse_path);
 
         // this set is is used as an indicator if a node is on the shortest path
-        std::unordered_set<NodeID> nodes_in_path(packed_forward_path.size() +
-                                                 packed_reverse_path.size());
-        nodes_in_path.insert(packed_forward_path.begin(), packed_forward_path.end());
-        nodes_in_path.insert(middle_node);
-        nodes_in_path.insert(packed_reverse_path.begin(), packed_reverse_path.end());
+        ReusableHashTable<NodeID, bool> &nodes_in_path = workspace.nodes_in_path;
+        nodes_in_path.Clear();
+        for (const NodeID node : packed_forward_path)
+        {
+            nodes_in_path[node] = true;
+        }
+        nodes_in_path[middle_node] = true;
+        for (const NodeID node : packed_reverse_path)
+        {
+            nodes_in_path[node] = true;
+        }
 
-        std::unordered_map<NodeID, int> approximated_forward_sharing;
-        std::unordered_map<NodeID, int> approximated_reverse_sharing;
+        ReusableHashTable<NodeID, int> &approximated_forward_sharing =
+            workspace.approximated_forward_sharing;
+        ReusableHashTable<NodeID, int> &approximated_reverse_sharing =
+            workspace.approximated_reverse_sharing;
+        approximated_forward_sharing.Clear();
+        approximated_reverse_sharing.Clear();
 
         // sweep over search space, compute forward sharing for each current edge (u,v)
         for (const SearchSpaceEdge &current_edge : forward_search_space)
@@ -196,19 +208,19 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
             const NodeID u = current_edge.first;
             const NodeID v = current_edge.second;
 
-            if (nodes_in_path.find(v) != nodes_in_path.end())
+            if (nodes_in_path.Contains(v))
             {
                 // current_edge is on shortest path => sharing(v):=queue.GetKey(v);
-                approximated_forward_sharing.emplace(v, forward_heap1.GetKey(v));
+                approximated_forward_sharing.Insert(v, forward_heap1.GetKey(v));
             }
             else
             {
                 // current edge is not on shortest path. Check if we know a value for the other
                 // endpoint
-                const auto sharing_of_u_iterator = approximated_forward_sharing.find(u);
-                if (sharing_of_u_iterator != approximated_forward_sharing.end())
+                const int *sharing_of_u = approximated_forward_sharing.Find(u);
+                if (nullptr != sharing_of_u)
                 {
-                    approximated_forward_sharing.emplace(v, sharing_of_u_iterator->second);
+                    approximated_forward_sharing.Insert(v, *sharing_of_u);
                 }
             }
         }
@@ -218,19 +230,19 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
         {
             const NodeID u = current_edge.first;
             const NodeID v = current_edge.second;
-            if (nodes_in_path.find(v) != nodes_in_path.end())
+            if (nodes_in_path.Contains(v))
             {
                 // current_edge is on shortest path => sharing(u):=queue.GetKey(u);
-                approximated_reverse_sharing.emplace(v, reverse_heap1.GetKey(v));
+                approximated_reverse_sharing.Insert(v, reverse_heap1.GetKey(v));
             }
             else
             {
                 // current edge is not on shortest path. Check if we know a value for the other
                 // endpoint
-                const auto sharing_of_u_iterator = approximated_reverse_sharing.find(u);
-                if (sharing_of_u_iterator != approximated_reverse_sharing.end())
+                const int *sharing_of_u = approximated_reverse_sharing.Find(u);
+                if (nullptr != sharing_of_u)
                 {
-                    approximated_reverse_sharing.emplace(v, sharing_of_u_iterator->second);
+                    approximated_reverse_sharing.Insert(v, *sharing_of_u);
                 }
             }
         }
@@ -242,15 +254,14 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
         // reverse_search_space.size() << ", marked " << approximated_reverse_sharing.size() << "
         // nodes";
 
-        std::vector<NodeID> preselected_node_list;
+        std::vector<NodeID> &preselected_node_list = workspace.preselected_node_list;
+        preselected_node_list.clear();
         for (const NodeID node : via_node_candidate_list)
         {
-            const auto fwd_iterator = approximated_forward_sharing.find(node);
-            const int fwd_sharing =
-                (fwd_iterator != approximated_forward_sharing.end()) ? fwd_iterator->second : 0;
-            const auto rev_iterator = approximated_reverse_sharing.find(node);
-            const int rev_sharing =
-                (rev_iterator != approximated_reverse_sharing.end()) ? rev_iterator->second : 0;
+            const int *fwd_iterator = approximated_forward_sharing.Find(node);
+            const int fwd_sharing = (nullptr != fwd_iterator) ? *fwd_iterator : 0;
+            const int *rev_iterator = approximated_reverse_sharing.Find(node);
+            const int rev_sharing = (nullptr != rev_iterator) ? *rev_iterator : 0;
 
             const int approximated_sharing = fwd_sharing + rev_sharing;
             const int approximated_length = forward_heap1.GetKey(node) + reverse_heap1.GetKey(node);
@@ -275,50 +286,134 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
         packed_shortest_path.emplace_back(middle_node);
         packed_shortest_path.insert(
             packed_shortest_path.end(), packed_reverse_path.begin(), packed_reverse_path.end());
-        std::vector<RankedCandidateNode> ranked_candidates_list;
+        std::vector<RankedCandidateNode> &ranked_candidates_list = workspace.ranked_candidates_list;
+        ranked_candidates_list.clear();
 
-        // prioritizing via nodes for deep inspection
+        // prioritizing via nodes for deep inspection. The candidates are independent of each
+        // other and share the unpacked shortest path.
+        if (!preselected_node_list.empty())
+        {
+            UnpackShortestPath(packed_shortest_path, workspace.shortest_path_cache, workspace);
+        }
         for (const NodeID node : preselected_node_list)
         {
-            int length_of_via_path = 0, sharing_of_via_path = 0;
-            ComputeLengthAndSharingOfViaPath(node,
-                                             &length_of_via_path,
-                                             &sharing_of_via_path,
-                                             packed_shortest_path,
-                                             min_edge_offset);
-            const int maximum_allowed_sharing =
-                static_cast<int>(upper_bound_to_shortest_path_distance * VIAPATH_GAMMA);
-            if (sharing_of_via_path <= maximum_allowed_sharing &&
-                length_of_via_path <= upper_bound_to_shortest_path_distance * (1 + VIAPATH_EPSILON))
-            {
-                ranked_candidates_list.emplace_back(node, length_of_via_path, sharing_of_via_path);
-            }
+            ranked_candidates_list.emplace_back(node, 0, 0);
         }
+        InspectInParallel(
+            0,
+            ranked_candidates_list.size(),
+            deadline,
+            [&](const std::size_t index,
+                SearchWorkspace &scratch,
+                const QueryDeadline &task_deadline)
+            {
+                RankedCandidateNode &candidate = ranked_candidates_list[index];
+                ComputeLengthAndSharingOfViaPath(forward_heap1,
+                                                 reverse_heap1,
+                                                 candidate.node,
+                                                 &candidate.length,
+                                                 &candidate.sharing,
+                                                 packed_shortest_path,
+                                                 workspace.shortest_path_cache,
+                                                 min_edge_offset,
+                                                 scratch,
+                                                 task_deadline);
+            });
+        const int maximum_allowed_sharing =
+            static_cast<int>(upper_bound_to_shortest_path_distance * VIAPATH_GAMMA);
+        ranked_candidates_list.erase(
+            std::remove_if(ranked_candidates_list.begin(),
+                           ranked_candidates_list.end(),
+                           [&](const RankedCandidateNode &candidate)
+                           {
+                return candidate.sharing > maximum_allowed_sharing ||
+                       candidate.length >
+                           upper_bound_to_shortest_path_distance * (1 + VIAPATH_EPSILON);
+            }),
+            ranked_candidates_list.end());
         std::sort(ranked_candidates_list.begin(), ranked_candidates_list.end());
 
-        NodeID selected_via_node = SPECIAL_NODEID;
-        int length_of_via_path = INVALID_EDGE_WEIGHT;
-        NodeID s_v_middle = SPECIAL_NODEID, v_t_middle = SPECIAL_NODEID;
-        for (const RankedCandidateNode &candidate : ranked_candidates_list)
-        {
-            if (ViaNodeCandidatePassesTTest(forward_heap1,
-                                            reverse_heap1,
-                                            forward_heap2,
-                                            reverse_heap2,
-                                            candidate,
-                                            upper_bound_to_shortest_path_distance,
-                                            &length_of_via_path,
-                                            &s_v_middle,
-                                            &v_t_middle,
-                                            min_edge_offset))
-            {
-                // select first admissable
-                selected_via_node = candidate.node;
-                break;
+        // T-test the candidates in order of their rank. Each batch is just large enough to
+        // complete the set of alternatives if all of its candidates are admissable, hence a
+        // single alternative is found exactly as by a sequential search.
+        const unsigned maximum_number_of_alternatives =
+            std::min(number_of_alternatives, VIAPATH_MAX_ALTERNATIVES);
+        std::vector<AlternativePathCandidate> &tested_candidates = workspace.tested_candidates;
+        if (tested_candidates.size() < ranked_candidates_list.size())
+        {
+            tested_candidates.resize(ranked_candidates_list.size());
+        }
+        std::vector<std::size_t> &selected_candidates = workspace.selected_candidates;
+        selected_candidates.clear();
+        workspace.nodes_in_alternatives.Clear();
+
+        std::size_t next_candidate = 0;
+        while (selected_candidates.size() < maximum_number_of_alternatives &&
+               next_candidate < ranked_candidates_list.size())
+        {
+            const std::size_t end_of_batch =
+                std::min(ranked_candidates_list.size(),
+                         next_candidate + maximum_number_of_alternatives -
+                             selected_candidates.size());
+            InspectInParallel(
+                next_candidate,
+                end_of_batch,
+                deadline,
+                [&](const std::size_t index,
+                    SearchWorkspace &scratch,
+                    const QueryDeadline &task_deadline)
+                {
+                    AlternativePathCandidate &tested_candidate = tested_candidates[index];
+                    tested_candidate.packed_path.clear();
+                    NodeID s_v_middle = SPECIAL_NODEID, v_t_middle = SPECIAL_NODEID;
+                    tested_candidate.passes_t_test =
+                        ViaNodeCandidatePassesTTest(forward_heap1,
+                                                    reverse_heap1,
+                                                    scratch.forward_heap2,
+                                                    scratch.reverse_heap2,
+                                                    ranked_candidates_list[index],
+                                                    upper_bound_to_shortest_path_distance,
+                                                    &tested_candidate.length,
+                                                    &s_v_middle,
+                                                    &v_t_middle,
+                                                    min_edge_offset,
+                                                    scratch,
+                                                    task_deadline);
+                    if (tested_candidate.passes_t_test)
+                    {
+                        // alternate path <s,..,v,..,t>, v is the last node of <s,..,v>
+                        tested_candidate.packed_path.insert(tested_candidate.packed_path.end(),
+                                                            scratch.packed_s_v_path.begin(),
+                                                            scratch.packed_s_v_path.end() - 1);
+                        tested_candidate.packed_path.insert(tested_candidate.packed_path.end(),
+                                                            scratch.packed_v_t_path.begin(),
+                                                            scratch.packed_v_t_path.end());
+                    }
+                });
+
+            for (std::size_t index = next_candidate;
+                 index < end_of_batch &&
+                     selected_candidates.size() < maximum_number_of_alternatives;
+                 ++index)
+            {
+                const AlternativePathCandidate &tested_candidate = tested_candidates[index];
+                if (tested_candidate.passes_t_test &&
+                    SharesLittleWithSelectedAlternatives(tested_candidate.packed_path,
+                                                         selected_candidates.size(),
+                                                         workspace.nodes_in_alternatives,
+                                                         maximum_allowed_sharing))
+                {
+                    for (const NodeID node : tested_candidate.packed_path)
+                    {
+                        workspace.nodes_in_alternatives[node] |= (1u << selected_candidates.size());
+                    }
+                    selected_candidates.emplace_back(index);
+                }
             }
+            next_candidate = end_of_batch;
         }
 
-        // Unpack shortest path and alternative, if they exist
+        // Unpack shortest path and alternatives, if they exist
         if (INVALID_EDGE_WEIGHT != upper_bound_to_shortest_path_distance)
         {
             BOOST_ASSERT(!packed_shortest_path.empty());
@@ -334,21 +429,17 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
                 // -- start of route
                 phantom_node_pair,
                 // -- unpacked output
-                raw_route_data.unpacked_path_segments.front());
+                raw_route_data.unpacked_path_segments.front(),
+                workspace);
             raw_route_data.shortest_path_length = upper_bound_to_shortest_path_distance;
         }
 
-        if (SPECIAL_NODEID != selected_via_node)
+        BOOST_ASSERT(raw_route_data.unpacked_alternatives.empty());
+        for (const std::size_t index : selected_candidates)
         {
-            std::vector<NodeID> packed_alternate_path;
-            // retrieve alternate path
-            RetrievePackedAlternatePath(forward_heap1,
-                                        reverse_heap1,
-                                        forward_heap2,
-                                        reverse_heap2,
-                                        s_v_middle,
-                                        v_t_middle,
-                                        packed_alternate_path);
+            const AlternativePathCandidate &selected_candidate = tested_candidates[index];
+            const std::vector<NodeID> &packed_alternate_path = selected_candidate.packed_path;
+            BOOST_ASSERT(!packed_alternate_path.empty());
 
             raw_route_data.alt_source_traversed_in_reverse.push_back((
                 packed_alternate_path.front() != phantom_node_pair.source_phantom.forward_node_id));
@@ -356,62 +447,176 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
                 (packed_alternate_path.back() != phantom_node_pair.target_phantom.forward_node_id));
 
             // unpack the alternate path
-            super::UnpackPath(
-                packed_alternate_path, phantom_node_pair, raw_route_data.unpacked_alternative);
+            raw_route_data.unpacked_alternatives.emplace_back();
+            super::UnpackPath(packed_alternate_path,
+                              phantom_node_pair,
+                              raw_route_data.unpacked_alternatives.back(),
+                              workspace);
 
-            raw_route_data.alternative_path_length = length_of_via_path;
+            raw_route_data.alternative_path_lengths.emplace_back(selected_candidate.length);
         }
-        else
+    }
+
+  private:
+    // Runs inspect(index, workspace, deadline) for every index of [begin, end). Each task works
+    // on the workspace of the thread that runs it and only reads the search spaces of the query.
+    // Those live in the workspace of the calling thread. The section is isolated so that this
+    // thread does not pick up a task of another query while it waits, which would clear them.
+    template <class InspectionT>
+    void InspectInParallel(const std::size_t begin,
+                           const std::size_t end,
+                           const QueryDeadline &deadline,
+                           InspectionT &&inspect) const
+    {
+        const unsigned number_of_nodes = super::facade->GetNumberOfNodes();
+        std::atomic<bool> timed_out(false);
+
+        tbb::this_task_arena::isolate([&]()
+                                      {
+            tbb::parallel_for(tbb::blocked_range<std::size_t>(begin, end),
+                              [&](const tbb::blocked_range<std::size_t> &range)
+                              {
+                SearchWorkspace &scratch =
+                    engine_working_data.GetThreadLocalWorkspace(number_of_nodes);
+                // every task counts its own checks
+                const QueryDeadline task_deadline(deadline);
+                for (std::size_t index = range.begin(); index != range.end() && !timed_out;
+                     ++index)
+                {
+                    try
+                    {
+                        inspect(index, scratch, task_deadline);
+                    }
+                    catch (const QueryTimeoutException &)
+                    {
+                        timed_out = true;
+                        return;
+                    }
+                }
+            });
+        });
+
+        if (timed_out)
         {
-            BOOST_ASSERT(raw_route_data.alternative_path_length == INVALID_EDGE_WEIGHT);
+            throw QueryTimeoutException();
         }
     }
 
-  private:
-    // unpack alternate <s,..,v,..,t> by exploring search spaces from v
-    inline void RetrievePackedAlternatePath(const QueryHeap &forward_heap1,
-                                            const QueryHeap &reverse_heap1,
-                                            const QueryHeap &forward_heap2,
-                                            const QueryHeap &reverse_heap2,
-                                            const NodeID s_v_middle,
-                                            const NodeID v_t_middle,
-                                            std::vector<NodeID> &packed_path) const
+    // unpacks the shortest path once per query, all candidates compare against it
+    void UnpackShortestPath(const std::vector<NodeID> &packed_shortest_path,
+                            UnpackedPathCache &cache,
+                            SearchWorkspace &workspace) const
     {
-        // fetch packed path [s,v)
-        std::vector<NodeID> packed_v_t_path;
-        super::RetrievePackedPathFromHeap(forward_heap1, reverse_heap2, s_v_middle, packed_path);
-        packed_path.pop_back(); // remove middle node. It's in both half-paths
+        cache.Clear();
+        for (const auto i : osrm::irange<std::size_t>(1, packed_shortest_path.size()))
+        {
+            const EdgeID packed_edge_id = facade->FindEdgeInEitherDirection(
+                packed_shortest_path[i - 1], packed_shortest_path[i]);
+            cache.packed_edge_lengths.push_back(facade->GetEdgeData(packed_edge_id).distance);
+
+            const std::size_t offset = cache.nodes.size();
+            cache.offsets.emplace_back(offset);
+            super::UnpackEdge(
+                packed_shortest_path[i - 1], packed_shortest_path[i], cache.nodes, workspace);
+            for (std::size_t j = offset + 1; j < cache.nodes.size(); ++j)
+            {
+                const EdgeID edge_id =
+                    facade->FindEdgeInEitherDirection(cache.nodes[j - 1], cache.nodes[j]);
+                cache.edge_lengths.push_back(facade->GetEdgeData(edge_id).distance);
+            }
+            cache.edge_lengths.emplace_back(-1);
+        }
+        cache.offsets.emplace_back(cache.nodes.size());
+        BOOST_ASSERT(cache.nodes.size() == cache.edge_lengths.size());
+    }
 
-        // fetch patched path [v,t]
-        super::RetrievePackedPathFromHeap(
-            forward_heap2, reverse_heap1, v_t_middle, packed_v_t_path);
+    // appends the cached unpacking of a packed edge of the shortest path
+    inline void AppendUnpackedShortestPathEdge(const UnpackedPathCache &cache,
+                                               const std::size_t packed_edge,
+                                               std::vector<NodeID> &unpacked_path,
+                                               std::vector<int> &unpacked_edge_lengths) const
+    {
+        BOOST_ASSERT(packed_edge + 1 < cache.offsets.size());
+        const std::size_t begin = cache.offsets[packed_edge];
+        const std::size_t end = cache.offsets[packed_edge + 1];
+        unpacked_path.insert(
+            unpacked_path.end(), cache.nodes.begin() + begin, cache.nodes.begin() + end);
+        unpacked_edge_lengths.insert(unpacked_edge_lengths.end(),
+                                     cache.edge_lengths.begin() + begin,
+                                     cache.edge_lengths.begin() + end);
+    }
 
-        packed_path.insert(packed_path.end(), packed_v_t_path.begin(), packed_v_t_path.end());
+    // Approximates the sharing with every selected alternative on the packed level, by the
+    // length of the packed edges whose end nodes both lie on that alternative.
+    bool SharesLittleWithSelectedAlternatives(
+        const std::vector<NodeID> &packed_path,
+        const std::size_t number_of_selected_alternatives,
+        const ReusableHashTable<NodeID, unsigned> &nodes_in_alternatives,
+        const int maximum_allowed_sharing) const
+    {
+        BOOST_ASSERT(number_of_selected_alternatives < VIAPATH_MAX_ALTERNATIVES);
+        int sharing[VIAPATH_MAX_ALTERNATIVES] = {0};
+        for (const auto i : osrm::irange<std::size_t>(1, packed_path.size()))
+        {
+            const unsigned *first_alternatives = nodes_in_alternatives.Find(packed_path[i - 1]);
+            const unsigned *second_alternatives = nodes_in_alternatives.Find(packed_path[i]);
+            if (nullptr == first_alternatives || nullptr == second_alternatives ||
+                0 == (*first_alternatives & *second_alternatives))
+            {
+                continue;
+            }
+            const EdgeID edge_id =
+                facade->FindEdgeInEitherDirection(packed_path[i - 1], packed_path[i]);
+            const int length_of_edge = facade->GetEdgeData(edge_id).distance;
+            for (const auto alternative :
+                 osrm::irange<std::size_t>(0, number_of_selected_alternatives))
+            {
+                if (0 != (*first_alternatives & *second_alternatives & (1u << alternative)))
+                {
+                    sharing[alternative] += length_of_edge;
+                }
+            }
+        }
+        return std::all_of(sharing,
+                           sharing + number_of_selected_alternatives,
+                           [maximum_allowed_sharing](const int shared_length)
+                           { return shared_length <= maximum_allowed_sharing; });
     }
 
     // TODO: reorder parameters
     // compute and unpack <s,..,v> and <v,..,t> by exploring search spaces
     // from v and intersecting against queues. only half-searches have to be
-    // done at this stage
-    inline void ComputeLengthAndSharingOfViaPath(const NodeID via_node,
+    // done at this stage. The existing heaps are only read, the unpacked shortest path is taken
+    // from the cache.
+    inline void ComputeLengthAndSharingOfViaPath(const QueryHeap &existing_forward_heap,
+                                                 const QueryHeap &existing_reverse_heap,
+                                                 const NodeID via_node,
                                                  int *real_length_of_via_path,
                                                  int *sharing_of_via_path,
                                                  const std::vector<NodeID> &packed_shortest_path,
-                                                 const EdgeWeight min_edge_offset)
+                                                 const UnpackedPathCache &shortest_path_cache,
+                                                 const EdgeWeight min_edge_offset,
+                                                 SearchWorkspace &workspace,
+                                                 const QueryDeadline &deadline) const
     {
-        engine_working_data.InitializeOrClearSecondThreadLocalStorage(
-            super::facade->GetNumberOfNodes());
-
-        QueryHeap &existing_forward_heap = *engine_working_data.forwardHeap;
-        QueryHeap &existing_reverse_heap = *engine_working_data.backwardHeap;
-        QueryHeap &new_forward_heap = *engine_working_data.forwardHeap2;
-        QueryHeap &new_reverse_heap = *engine_working_data.backwardHeap2;
+        QueryHeap &new_forward_heap = workspace.forward_heap2;
+        QueryHeap &new_reverse_heap = workspace.reverse_heap2;
+        new_forward_heap.Clear();
+        new_reverse_heap.Clear();
 
-        std::vector<NodeID> packed_s_v_path;
-        std::vector<NodeID> packed_v_t_path;
+        std::vector<NodeID> &packed_s_v_path = workspace.packed_s_v_path;
+        std::vector<NodeID> &packed_v_t_path = workspace.packed_v_t_path;
+        packed_s_v_path.clear();
+        packed_v_t_path.clear();
 
-        std::vector<NodeID> partially_unpacked_shortest_path;
-        std::vector<NodeID> partially_unpacked_via_path;
+        std::vector<NodeID> &partially_unpacked_shortest_path =
+            workspace.partially_unpacked_shortest_path;
+        std::vector<NodeID> &partially_unpacked_via_path = workspace.partially_unpacked_via_path;
+        std::vector<int> &partially_unpacked_shortest_path_lengths =
+            workspace.partially_unpacked_shortest_path_lengths;
+        partially_unpacked_shortest_path.clear();
+        partially_unpacked_via_path.clear();
+        partially_unpacked_shortest_path_lengths.clear();
 
         NodeID s_v_middle = SPECIAL_NODEID;
         int upper_bound_s_v_path_length = INVALID_EDGE_WEIGHT;
@@ -419,6 +624,7 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
         // compute path <s,..,v> by reusing forward search from s
         while (!new_reverse_heap.Empty())
         {
+            deadline.Check();
             super::RoutingStep(new_reverse_heap,
                                existing_forward_heap,
                                &s_v_middle,
@@ -432,6 +638,7 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
         new_forward_heap.Insert(via_node, 0, via_node);
         while (!new_forward_heap.Empty())
         {
+            deadline.Check();
             super::RoutingStep(new_forward_heap,
                                existing_reverse_heap,
                                &v_t_middle,
@@ -461,9 +668,7 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
             if (packed_s_v_path[current_node] == packed_shortest_path[current_node] &&
                 packed_s_v_path[current_node + 1] == packed_shortest_path[current_node + 1])
             {
-                EdgeID edgeID = facade->FindEdgeInEitherDirection(
-                    packed_s_v_path[current_node], packed_s_v_path[current_node + 1]);
-                *sharing_of_via_path += facade->GetEdgeData(edgeID).distance;
+                *sharing_of_via_path += shortest_path_cache.packed_edge_lengths[current_node];
             }
             else
             {
@@ -471,10 +676,12 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
                 {
                     super::UnpackEdge(packed_s_v_path[current_node],
                                       packed_s_v_path[current_node + 1],
-                                      partially_unpacked_via_path);
-                    super::UnpackEdge(packed_shortest_path[current_node],
-                                      packed_shortest_path[current_node + 1],
-                                      partially_unpacked_shortest_path);
+                                      partially_unpacked_via_path,
+                                      workspace);
+                    AppendUnpackedShortestPathEdge(shortest_path_cache,
+                                                   current_node,
+                                                   partially_unpacked_shortest_path,
+                                                   partially_unpacked_shortest_path_lengths);
                     break;
                 }
             }
@@ -491,10 +698,8 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
                       partially_unpacked_shortest_path[current_node + 1]);
              ++current_node)
         {
-            EdgeID selected_edge =
-                facade->FindEdgeInEitherDirection(partially_unpacked_via_path[current_node],
-                                                  partially_unpacked_via_path[current_node + 1]);
-            *sharing_of_via_path += facade->GetEdgeData(selected_edge).distance;
+            BOOST_ASSERT(0 <= partially_unpacked_shortest_path_lengths[current_node]);
+            *sharing_of_via_path += partially_unpacked_shortest_path_lengths[current_node];
         }
 
         // Second, partially unpack v-->t in reverse order until paths deviate and note lengths
@@ -507,9 +712,8 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
                     packed_shortest_path[shortest_path_index - 1] &&
                 packed_v_t_path[via_path_index] == packed_shortest_path[shortest_path_index])
             {
-                EdgeID edgeID = facade->FindEdgeInEitherDirection(
-                    packed_v_t_path[via_path_index - 1], packed_v_t_path[via_path_index]);
-                *sharing_of_via_path += facade->GetEdgeData(edgeID).distance;
+                *sharing_of_via_path +=
+                    shortest_path_cache.packed_edge_lengths[shortest_path_index - 1];
             }
             else
             {
@@ -517,10 +721,12 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
                 {
                     super::UnpackEdge(packed_v_t_path[via_path_index - 1],
                                       packed_v_t_path[via_path_index],
-                                      partially_unpacked_via_path);
-                    super::UnpackEdge(packed_shortest_path[shortest_path_index - 1],
-                                      packed_shortest_path[shortest_path_index],
-                                      partially_unpacked_shortest_path);
+                                      partially_unpacked_via_path,
+                                      workspace);
+                    AppendUnpackedShortestPathEdge(shortest_path_cache,
+                                                   shortest_path_index - 1,
+                                                   partially_unpacked_shortest_path,
+                                                   partially_unpacked_shortest_path_lengths);
                     break;
                 }
             }
@@ -536,10 +742,20 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
                 partially_unpacked_via_path[via_path_index] ==
                     partially_unpacked_shortest_path[shortest_path_index])
             {
-                EdgeID edgeID = facade->FindEdgeInEitherDirection(
-                    partially_unpacked_via_path[via_path_index - 1],
-                    partially_unpacked_via_path[via_path_index]);
-                *sharing_of_via_path += facade->GetEdgeData(edgeID).distance;
+                const int cached_length =
+                    partially_unpacked_shortest_path_lengths[shortest_path_index - 1];
+                if (0 <= cached_length)
+                {
+                    *sharing_of_via_path += cached_length;
+                }
+                else
+                {
+                    // the pair spans the two unpacked edges, it is not in the cache
+                    EdgeID edgeID = facade->FindEdgeInEitherDirection(
+                        partially_unpacked_via_path[via_path_index - 1],
+                        partially_unpacked_via_path[via_path_index]);
+                    *sharing_of_via_path += facade->GetEdgeData(edgeID).distance;
+                }
             }
             else
             {
@@ -673,8 +889,8 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
     }
 
     // conduct T-Test
-    inline bool ViaNodeCandidatePassesTTest(QueryHeap &existing_forward_heap,
-                                            QueryHeap &existing_reverse_heap,
+    inline bool ViaNodeCandidatePassesTTest(const QueryHeap &existing_forward_heap,
+                                            const QueryHeap &existing_reverse_heap,
                                             QueryHeap &new_forward_heap,
                                             QueryHeap &new_reverse_heap,
                                             const RankedCandidateNode &candidate,
@@ -682,12 +898,16 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
                                             int *length_of_via_path,
                                             NodeID *s_v_middle,
                                             NodeID *v_t_middle,
-                                            const EdgeWeight min_edge_offset) const
+                                            const EdgeWeight min_edge_offset,
+                                            SearchWorkspace &workspace,
+                                            const QueryDeadline &deadline) const
     {
         new_forward_heap.Clear();
         new_reverse_heap.Clear();
-        std::vector<NodeID> packed_s_v_path;
-        std::vector<NodeID> packed_v_t_path;
+        std::vector<NodeID> &packed_s_v_path = workspace.packed_s_v_path;
+        std::vector<NodeID> &packed_v_t_path = workspace.packed_v_t_path;
+        packed_s_v_path.clear();
+        packed_v_t_path.clear();
 
         *s_v_middle = SPECIAL_NODEID;
         int upper_bound_s_v_path_length = INVALID_EDGE_WEIGHT;
@@ -695,6 +915,7 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
         new_reverse_heap.Insert(candidate.node, 0, candidate.node);
         while (new_reverse_heap.Size() > 0)
         {
+            deadline.Check();
             super::RoutingStep(new_reverse_heap,
                                existing_forward_heap,
                                s_v_middle,
@@ -714,6 +935,7 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
         new_forward_heap.Insert(candidate.node, 0, candidate.node);
         while (new_forward_heap.Size() > 0)
         {
+            deadline.Check();
             super::RoutingStep(new_forward_heap,
                                existing_reverse_heap,
                                v_t_middle,
@@ -749,7 +971,8 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
         const int T_threshold = static_cast<int>(VIAPATH_EPSILON * length_of_shortest_path);
         int unpacked_until_distance = 0;
 
-        std::stack<SearchSpaceEdge> unpack_stack;
+        std::vector<SearchSpaceEdge> &unpack_stack = workspace.unpack_stack;
+        unpack_stack.clear();
         // Traverse path s-->v
         for (std::size_t i = packed_s_v_path.size() - 1; (i > 0) && unpack_stack.empty(); --i)
         {
@@ -758,7 +981,7 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
             const int length_of_current_edge = facade->GetEdgeData(current_edge_id).distance;
             if ((length_of_current_edge + unpacked_until_distance) >= T_threshold)
             {
-                unpack_stack.emplace(packed_s_v_path[i - 1], packed_s_v_path[i]);
+                unpack_stack.emplace_back(packed_s_v_path[i - 1], packed_s_v_path[i]);
             }
             else
             {
@@ -769,8 +992,8 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
 
         while (!unpack_stack.empty())
         {
-            const SearchSpaceEdge via_path_edge = unpack_stack.top();
-            unpack_stack.pop();
+            const SearchSpaceEdge via_path_edge = unpack_stack.back();
+            unpack_stack.pop_back();
             EdgeID edge_in_via_path_id =
                 facade->FindEdgeInEitherDirection(via_path_edge.first, via_path_edge.second);
 
@@ -793,12 +1016,12 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
                 // to stack, else push first segment to stack and add distance of second one.
                 if (unpacked_until_distance + second_segment_length >= T_threshold)
                 {
-                    unpack_stack.emplace(via_path_middle_node_id, via_path_edge.second);
+                    unpack_stack.emplace_back(via_path_middle_node_id, via_path_edge.second);
                 }
                 else
                 {
                     unpacked_until_distance += second_segment_length;
-                    unpack_stack.emplace(via_path_edge.first, via_path_middle_node_id);
+                    unpack_stack.emplace_back(via_path_edge.first, via_path_middle_node_id);
                 }
             }
             else
@@ -822,7 +1045,7 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
             int length_of_current_edge = facade->GetEdgeData(edgeID).distance;
             if (length_of_current_edge + unpacked_until_distance >= T_threshold)
             {
-                unpack_stack.emplace(packed_v_t_path[i], packed_v_t_path[i + 1]);
+                unpack_stack.emplace_back(packed_v_t_path[i], packed_v_t_path[i + 1]);
             }
             else
             {
@@ -833,8 +1056,8 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
 
         while (!unpack_stack.empty())
         {
-            const SearchSpaceEdge via_path_edge = unpack_stack.top();
-            unpack_stack.pop();
+            const SearchSpaceEdge via_path_edge = unpack_stack.back();
+            unpack_stack.pop_back();
             EdgeID edge_in_via_path_id =
                 facade->FindEdgeInEitherDirection(via_path_edge.first, via_path_edge.second);
             if (SPECIAL_EDGEID == edge_in_via_path_id)
@@ -854,12 +1077,12 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
                 // stack, else push second segment to stack and add distance of first one.
                 if (unpacked_until_distance + lengthOfFirstSegment >= T_threshold)
                 {
-                    unpack_stack.emplace(via_path_edge.first, middleOfViaPath);
+                    unpack_stack.emplace_back(via_path_edge.first, middleOfViaPath);
                 }
                 else
                 {
                     unpacked_until_distance += lengthOfFirstSegment;
-                    unpack_stack.emplace(middleOfViaPath, via_path_edge.second);
+                    unpack_stack.emplace_back(middleOfViaPath, via_path_edge.second);
                 }
             }
             else
@@ -872,11 +1095,10 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
 
         t_test_path_length += unpacked_until_distance;
         // Run actual T-Test query and compare if distances equal.
-        engine_working_data.InitializeOrClearThirdThreadLocalStorage(
-            super::facade->GetNumberOfNodes());
-
-        QueryHeap &forward_heap3 = *engine_working_data.forwardHeap3;
-        QueryHeap &reverse_heap3 = *engine_working_data.backwardHeap3;
+        QueryHeap &forward_heap3 = workspace.forward_heap3;
+        QueryHeap &reverse_heap3 = workspace.reverse_heap3;
+        forward_heap3.Clear();
+        reverse_heap3.Clear();
         int upper_bound = INVALID_EDGE_WEIGHT;
         NodeID middle = SPECIAL_NODEID;
 
@@ -885,6 +1107,7 @@ template <class DataFacadeT> class AlternativeRouting : private BasicRoutingInte
         // exploration from s and t until deletemin/(1+epsilon) > _lengt_oO_sShortest_path
         while ((forward_heap3.Size() + reverse_heap3.Size()) > 0)
         {
+            deadline.Check();
             if (!forward_heap3.Empty())
             {
                 super::RoutingStep(
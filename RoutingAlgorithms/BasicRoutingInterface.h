@@ -32,18 +32,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../DataStructures/SearchEngineData.h"
 #include "../DataStructures/TurnInstructions.h"
 #include "../Util/ContainerUtils.h"
+#include "../Util/QueryDeadline.h"
 #include "../Util/SimpleLogger.h"
 
 #include <boost/assert.hpp>
 
-#include <stack>
-
-SearchEngineData::SearchEngineHeapPtr SearchEngineData::forwardHeap;
-SearchEngineData::SearchEngineHeapPtr SearchEngineData::backwardHeap;
-SearchEngineData::SearchEngineHeapPtr SearchEngineData::forwardHeap2;
-SearchEngineData::SearchEngineHeapPtr SearchEngineData::backwardHeap2;
-SearchEngineData::SearchEngineHeapPtr SearchEngineData::forwardHeap3;
-SearchEngineData::SearchEngineHeapPtr SearchEngineData::backwardHeap3;
+#include <vector>
 
 template <class DataFacadeT> class BasicRoutingInterface
 {
@@ -59,8 +53,9 @@ template <class DataFacadeT> class BasicRoutingInterface
     explicit BasicRoutingInterface(DataFacadeT *facade) : facade(facade) {}
     virtual ~BasicRoutingInterface() {};
 
+    // reverse_heap is only read, it may be shared by concurrent searches
     inline void RoutingStep(SearchEngineData::QueryHeap &forward_heap,
-                            SearchEngineData::QueryHeap &reverse_heap,
+                            const SearchEngineData::QueryHeap &reverse_heap,
                             NodeID *middle_node_id,
                             int *upper_bound,
                             const int min_edge_offset,
@@ -146,9 +141,13 @@ template <class DataFacadeT> class BasicRoutingInterface
         }
     }
 
+    // PathContainer is a std::vector<PathData> or anything that behaves like one for the
+    // operations used below, see PathLengthAccumulator
+    template <class PathContainer>
     inline void UnpackPath(const std::vector<NodeID> &packed_path,
                            const PhantomNodes &phantom_node_pair,
-                           std::vector<PathData> &unpacked_path) const
+                           PathContainer &unpacked_path,
+                           SearchWorkspace &workspace) const
     {
         const bool start_traversed_in_reverse =
             (packed_path.front() != phantom_node_pair.source_phantom.forward_node_id);
@@ -156,12 +155,13 @@ template <class DataFacadeT> class BasicRoutingInterface
             (packed_path.back() != phantom_node_pair.target_phantom.forward_node_id);
 
         const unsigned packed_path_size = static_cast<unsigned>(packed_path.size());
-        std::stack<std::pair<NodeID, NodeID>> recursion_stack;
+        std::vector<std::pair<NodeID, NodeID>> &recursion_stack = workspace.unpack_stack;
+        recursion_stack.clear();
 
         // We have to push the path in reverse order onto the stack because it's LIFO.
         for (unsigned i = packed_path_size - 1; i > 0; --i)
         {
-            recursion_stack.emplace(packed_path[i - 1], packed_path[i]);
+            recursion_stack.emplace_back(packed_path[i - 1], packed_path[i]);
         }
 
         std::pair<NodeID, NodeID> edge;
@@ -174,8 +174,8 @@ template <class DataFacadeT> class BasicRoutingInterface
                 *------------------>*
                        edge_id
             */
-            edge = recursion_stack.top();
-            recursion_stack.pop();
+            edge = recursion_stack.back();
+            recursion_stack.pop_back();
 
             // facade->FindEdge does not suffice here in case of shortcuts.
             // The above explanation unclear? Think!
@@ -219,8 +219,8 @@ template <class DataFacadeT> class BasicRoutingInterface
             { // unpack
                 const NodeID middle_node_id = ed.id;
                 // again, we need to this in reversed order
-                recursion_stack.emplace(middle_node_id, edge.second);
-                recursion_stack.emplace(edge.first, middle_node_id);
+                recursion_stack.emplace_back(middle_node_id, edge.second);
+                recursion_stack.emplace_back(edge.first, middle_node_id);
             }
             else
             {
@@ -238,7 +238,7 @@ template <class DataFacadeT> class BasicRoutingInterface
                 }
                 else
                 {
-                    std::vector<unsigned> id_vector;
+                    std::vector<unsigned> &id_vector = workspace.geometry_buffer;
                     facade->GetUncompressedGeometry(facade->GetGeometryIndexForEdgeID(ed.id),
                                                     id_vector);
 
@@ -264,7 +264,7 @@ template <class DataFacadeT> class BasicRoutingInterface
         }
         if (SPECIAL_EDGEID != phantom_node_pair.target_phantom.packed_geometry_id)
         {
-            std::vector<unsigned> id_vector;
+            std::vector<unsigned> &id_vector = workspace.geometry_buffer;
             facade->GetUncompressedGeometry(phantom_node_pair.target_phantom.packed_geometry_id,
                                             id_vector);
             const bool is_local_path = (phantom_node_pair.source_phantom.packed_geometry_id ==
@@ -326,16 +326,20 @@ template <class DataFacadeT> class BasicRoutingInterface
         }
     }
 
-    inline void UnpackEdge(const NodeID s, const NodeID t, std::vector<NodeID> &unpacked_path) const
+    inline void UnpackEdge(const NodeID s,
+                           const NodeID t,
+                           std::vector<NodeID> &unpacked_path,
+                           SearchWorkspace &workspace) const
     {
-        std::stack<std::pair<NodeID, NodeID>> recursion_stack;
-        recursion_stack.emplace(s, t);
+        std::vector<std::pair<NodeID, NodeID>> &recursion_stack = workspace.unpack_stack;
+        recursion_stack.clear();
+        recursion_stack.emplace_back(s, t);
 
         std::pair<NodeID, NodeID> edge;
         while (!recursion_stack.empty())
         {
-            edge = recursion_stack.top();
-            recursion_stack.pop();
+            edge = recursion_stack.back();
+            recursion_stack.pop_back();
 
             EdgeID smaller_edge_id = SPECIAL_EDGEID;
             int edge_weight = std::numeric_limits<EdgeWeight>::max();
@@ -370,8 +374,8 @@ template <class DataFacadeT> class BasicRoutingInterface
             { // unpack
                 const NodeID middle_node_id = ed.id;
                 // again, we need to this in reversed order
-                recursion_stack.emplace(middle_node_id, edge.second);
-                recursion_stack.emplace(edge.first, middle_node_id);
+                recursion_stack.emplace_back(middle_node_id, edge.second);
+                recursion_stack.emplace_back(edge.first, middle_node_id);
             }
             else
             {
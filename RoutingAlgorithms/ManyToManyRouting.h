@@ -29,14 +29,17 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define MANY_TO_MANY_ROUTING_H
 
 #include "BasicRoutingInterface.h"
+#include "../DataStructures/Range.h"
 #include "../DataStructures/SearchEngineData.h"
 #include "../typedefs.h"
 
 #include <boost/assert.hpp>
 
+#include <algorithm>
 #include <limits>
 #include <memory>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 template <class DataFacadeT> class ManyToManyRouting : public BasicRoutingInterface<DataFacadeT>
@@ -64,28 +67,62 @@ template <class DataFacadeT> class ManyToManyRouting : public BasicRoutingInterf
 
     ~ManyToManyRouting() {}
 
-    std::shared_ptr<std::vector<EdgeWeight>> operator()(const PhantomNodeArray &phantom_nodes_array)
-        const
+    std::shared_ptr<std::vector<EdgeWeight>>
+    operator()(const PhantomNodeArray &phantom_nodes_array,
+               const QueryDeadline &deadline = QueryDeadline()) const
     {
         const unsigned number_of_locations = static_cast<unsigned>(phantom_nodes_array.size());
         std::shared_ptr<std::vector<EdgeWeight>> result_table =
             std::make_shared<std::vector<EdgeWeight>>(number_of_locations * number_of_locations,
                                                       std::numeric_limits<EdgeWeight>::max());
 
-        engine_working_data.InitializeOrClearFirstThreadLocalStorage(
-            super::facade->GetNumberOfNodes());
+        std::vector<unsigned> search_sources;
+        std::vector<unsigned> search_targets;
+        if (super::facade->HasHubLabels())
+        {
+            ComputeTableFromHubLabels(
+                phantom_nodes_array, *result_table, search_sources, search_targets, deadline);
+            if (search_sources.empty())
+            {
+                return result_table;
+            }
+        }
+        else
+        {
+            for (const auto location : osrm::irange(0u, number_of_locations))
+            {
+                search_sources.push_back(location);
+                search_targets.push_back(location);
+            }
+        }
+
+        ComputeTableBySearch(
+            phantom_nodes_array, search_sources, search_targets, result_table, deadline);
+        return result_table;
+    }
+
+    // Fills the rows of the sources and the columns of the targets by a bucket search. The
+    // other entries of the table are left as they are.
+    void ComputeTableBySearch(const PhantomNodeArray &phantom_nodes_array,
+                              const std::vector<unsigned> &sources,
+                              const std::vector<unsigned> &targets,
+                              std::shared_ptr<std::vector<EdgeWeight>> result_table,
+                              const QueryDeadline &deadline) const
+    {
+        const unsigned number_of_locations = static_cast<unsigned>(phantom_nodes_array.size());
+        SearchWorkspace &workspace =
+            engine_working_data.GetThreadLocalWorkspace(super::facade->GetNumberOfNodes());
 
-        QueryHeap &query_heap = *(engine_working_data.forwardHeap);
+        QueryHeap &query_heap = workspace.forward_heap1;
 
         SearchSpaceWithBuckets search_space_with_buckets;
 
-        unsigned target_id = 0;
-        for (const std::vector<PhantomNode> &phantom_node_vector : phantom_nodes_array)
+        for (const unsigned target_id : targets)
         {
             query_heap.Clear();
             // insert target(s) at distance 0
 
-            for (const PhantomNode &phantom_node : phantom_node_vector)
+            for (const PhantomNode &phantom_node : phantom_nodes_array[target_id])
             {
                 if (SPECIAL_NODEID != phantom_node.forward_node_id)
                 {
@@ -104,17 +141,16 @@ template <class DataFacadeT> class ManyToManyRouting : public BasicRoutingInterf
             // explore search space
             while (!query_heap.Empty())
             {
+                deadline.Check();
                 BackwardRoutingStep(target_id, query_heap, search_space_with_buckets);
             }
-            ++target_id;
         }
 
         // for each source do forward search
-        unsigned source_id = 0;
-        for (const std::vector<PhantomNode> &phantom_node_vector : phantom_nodes_array)
+        for (const unsigned source_id : sources)
         {
             query_heap.Clear();
-            for (const PhantomNode &phantom_node : phantom_node_vector)
+            for (const PhantomNode &phantom_node : phantom_nodes_array[source_id])
             {
                 // insert sources at distance 0
                 if (SPECIAL_NODEID != phantom_node.forward_node_id)
@@ -134,17 +170,94 @@ template <class DataFacadeT> class ManyToManyRouting : public BasicRoutingInterf
             // explore search space
             while (!query_heap.Empty())
             {
+                deadline.Check();
                 ForwardRoutingStep(source_id,
                                    number_of_locations,
                                    query_heap,
                                    search_space_with_buckets,
                                    result_table);
             }
+        }
+    }
+
+    // Fills the table by intersecting the hub labels of the phantom nodes. A source and a
+    // target on the same segment, with the target behind the source, need a route around the
+    // segment that the labels do not represent. Such entries are left unset and their sources
+    // and targets are returned, to be computed by search.
+    void ComputeTableFromHubLabels(const PhantomNodeArray &phantom_nodes_array,
+                                   std::vector<EdgeWeight> &result_table,
+                                   std::vector<unsigned> &search_sources,
+                                   std::vector<unsigned> &search_targets,
+                                   const QueryDeadline &deadline) const
+    {
+        const unsigned number_of_locations = static_cast<unsigned>(phantom_nodes_array.size());
 
-            ++source_id;
+        // search graph nodes of every location with the weight of the partial segment
+        std::vector<std::vector<std::pair<NodeID, EdgeWeight>>> location_nodes(number_of_locations);
+        for (const auto location : osrm::irange(0u, number_of_locations))
+        {
+            for (const PhantomNode &phantom_node : phantom_nodes_array[location])
+            {
+                if (SPECIAL_NODEID != phantom_node.forward_node_id)
+                {
+                    location_nodes[location].emplace_back(
+                        phantom_node.forward_node_id, phantom_node.GetForwardWeightPlusOffset());
+                }
+                if (SPECIAL_NODEID != phantom_node.reverse_node_id)
+                {
+                    location_nodes[location].emplace_back(
+                        phantom_node.reverse_node_id, phantom_node.GetReverseWeightPlusOffset());
+                }
+            }
+        }
+
+        std::vector<bool> is_search_target(number_of_locations, false);
+        for (const auto source_id : osrm::irange(0u, number_of_locations))
+        {
+            deadline.Check();
+            bool is_search_source = false;
+            for (const auto target_id : osrm::irange(0u, number_of_locations))
+            {
+                EdgeWeight &table_entry = result_table[source_id * number_of_locations + target_id];
+                bool needs_search = false;
+                for (const auto &source : location_nodes[source_id])
+                {
+                    for (const auto &target : location_nodes[target_id])
+                    {
+                        const EdgeWeight label_distance =
+                            super::facade->GetHubLabelDistance(source.first, target.first);
+                        if (INVALID_EDGE_WEIGHT == label_distance)
+                        {
+                            continue;
+                        }
+                        const EdgeWeight distance = label_distance - source.second + target.second;
+                        if (distance < 0)
+                        {
+                            needs_search = true;
+                            continue;
+                        }
+                        table_entry = std::min(table_entry, distance);
+                    }
+                }
+                if (needs_search)
+                {
+                    table_entry = std::numeric_limits<EdgeWeight>::max();
+                    is_search_source = true;
+                    is_search_target[target_id] = true;
+                }
+            }
+            if (is_search_source)
+            {
+                search_sources.push_back(source_id);
+            }
+        }
+        for (const auto target_id : osrm::irange(0u, number_of_locations))
+        {
+            if (is_search_target[target_id])
+            {
+                search_targets.push_back(target_id);
+            }
         }
-        BOOST_ASSERT(source_id == target_id);
-        return result_table;
     }
 
     void ForwardRoutingStep(const unsigned source_id,
@@ -0,0 +1,281 @@
+/*
+
+Copyright (c) 2014, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#ifndef ONE_TO_ALL_ROUTING_H
+#define ONE_TO_ALL_ROUTING_H
+
+#include "BasicRoutingInterface.h"
+#include "../DataStructures/Range.h"
+#include "../DataStructures/SearchEngineData.h"
+#include "../typedefs.h"
+
+#include <boost/assert.hpp>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <vector>
+
+// PHAST: an upward search from each source followed by one linear sweep over all nodes of the
+// search graph, top-down by level, that relaxes the downward edges. Several sources share a
+// sweep, their distances of a node are adjacent in memory and relaxed in one go.
+template <class DataFacadeT> class OneToAllRouting : public BasicRoutingInterface<DataFacadeT>
+{
+    typedef BasicRoutingInterface<DataFacadeT> super;
+    typedef SearchEngineData::QueryHeap QueryHeap;
+    SearchEngineData &engine_working_data;
+
+    static const unsigned SOURCES_PER_SWEEP = 8;
+    // above every bounded distance, adding an edge weight must not overflow
+    static const EdgeWeight UNREACHED = std::numeric_limits<EdgeWeight>::max() / 2;
+
+  public:
+    OneToAllRouting(DataFacadeT *facade, SearchEngineData &engine_working_data)
+        : super(facade), engine_working_data(engine_working_data)
+    {
+    }
+
+    ~OneToAllRouting() {}
+
+    bool IsAvailable() const
+    {
+        return 0 != super::facade->GetNumberOfLevelOrderedNodes() &&
+               super::facade->GetNumberOfLevelOrderedNodes() == super::facade->GetNumberOfNodes();
+    }
+
+    // Fills per source the distance to every node of the search graph, INVALID_EDGE_WEIGHT if
+    // it is farther than max_distance.
+    void operator()(const PhantomNodeArray &phantom_nodes_array,
+                    const EdgeWeight max_distance,
+                    std::vector<std::vector<EdgeWeight>> &distances,
+                    const QueryDeadline &deadline = QueryDeadline()) const
+    {
+        BOOST_ASSERT(IsAvailable());
+        BOOST_ASSERT(max_distance < UNREACHED);
+        distances.resize(phantom_nodes_array.size());
+
+        const unsigned number_of_nodes = super::facade->GetNumberOfNodes();
+        const std::size_t number_of_sweeps =
+            (phantom_nodes_array.size() + SOURCES_PER_SWEEP - 1) / SOURCES_PER_SWEEP;
+        std::atomic<bool> timed_out(false);
+
+        tbb::parallel_for(
+            tbb::blocked_range<std::size_t>(0, number_of_sweeps),
+            [&](const tbb::blocked_range<std::size_t> &range)
+            {
+                SearchWorkspace &workspace =
+                    engine_working_data.GetThreadLocalWorkspace(number_of_nodes);
+                // every task counts its own checks
+                const QueryDeadline task_deadline(deadline);
+                std::vector<EdgeWeight> sweep_distances;
+                for (std::size_t sweep = range.begin(); sweep != range.end() && !timed_out;
+                     ++sweep)
+                {
+                    const std::size_t first_source = sweep * SOURCES_PER_SWEEP;
+                    const std::size_t number_of_sources = std::min<std::size_t>(
+                        SOURCES_PER_SWEEP, phantom_nodes_array.size() - first_source);
+                    try
+                    {
+                        Sweep(phantom_nodes_array,
+                              first_source,
+                              number_of_sources,
+                              max_distance,
+                              workspace.forward_heap1,
+                              sweep_distances,
+                              task_deadline);
+                    }
+                    catch (const QueryTimeoutException &)
+                    {
+                        timed_out = true;
+                        return;
+                    }
+                    for (const auto lane : osrm::irange<std::size_t>(0, number_of_sources))
+                    {
+                        std::vector<EdgeWeight> &source_distances = distances[first_source + lane];
+                        source_distances.resize(number_of_nodes);
+                        for (const auto node : osrm::irange(0u, number_of_nodes))
+                        {
+                            const EdgeWeight distance =
+                                sweep_distances[node * SOURCES_PER_SWEEP + lane];
+                            // the source segment may start behind the phantom node
+                            source_distances[node] = (distance <= max_distance)
+                                                         ? std::max(distance, 0)
+                                                         : INVALID_EDGE_WEIGHT;
+                        }
+                    }
+                }
+            });
+
+        if (timed_out)
+        {
+            throw QueryTimeoutException();
+        }
+    }
+
+    // Collects the intersection at the end of every original edge that is passed completely
+    // within max_distance, given the distances of one source.
+    void GetReachedCoordinates(const std::vector<EdgeWeight> &distances,
+                               const EdgeWeight max_distance,
+                               std::vector<FixedPointCoordinate> &coordinates) const
+    {
+        BOOST_ASSERT(distances.size() == super::facade->GetNumberOfNodes());
+        const auto is_reached = [&](const NodeID node, const EdgeWeight weight)
+        {
+            return INVALID_EDGE_WEIGHT != distances[node] &&
+                   distances[node] + weight <= max_distance;
+        };
+
+        for (const auto node : osrm::irange(0u, super::facade->GetNumberOfNodes()))
+        {
+            for (const auto edge : super::facade->GetAdjacentEdgeRange(node))
+            {
+                const EdgeData &data = super::facade->GetEdgeData(edge);
+                if (data.shortcut)
+                {
+                    continue;
+                }
+                const NodeID target = super::facade->GetTarget(edge);
+                if ((data.forward && is_reached(node, data.distance)) ||
+                    (data.backward && is_reached(target, data.distance)))
+                {
+                    coordinates.emplace_back(super::facade->GetCoordinateOfNode(
+                        super::facade->GetGeometryIndexForEdgeID(data.id)));
+                }
+            }
+        }
+    }
+
+  private:
+    typedef typename DataFacadeT::EdgeData EdgeData;
+
+    // Sweeps the sources [first_source, first_source + number_of_sources), the distance of
+    // source i to node v ends up in sweep_distances[v * SOURCES_PER_SWEEP + i].
+    void Sweep(const PhantomNodeArray &phantom_nodes_array,
+               const std::size_t first_source,
+               const std::size_t number_of_sources,
+               const EdgeWeight max_distance,
+               QueryHeap &query_heap,
+               std::vector<EdgeWeight> &sweep_distances,
+               const QueryDeadline &deadline) const
+    {
+        BOOST_ASSERT(number_of_sources <= SOURCES_PER_SWEEP);
+        const unsigned number_of_nodes = super::facade->GetNumberOfNodes();
+        sweep_distances.assign(number_of_nodes * SOURCES_PER_SWEEP, EdgeWeight(UNREACHED));
+
+        for (const auto lane : osrm::irange<std::size_t>(0, number_of_sources))
+        {
+            query_heap.Clear();
+            for (const PhantomNode &phantom_node : phantom_nodes_array[first_source + lane])
+            {
+                if (SPECIAL_NODEID != phantom_node.forward_node_id)
+                {
+                    InsertSource(query_heap,
+                                 phantom_node.forward_node_id,
+                                 -phantom_node.GetForwardWeightPlusOffset());
+                }
+                if (SPECIAL_NODEID != phantom_node.reverse_node_id)
+                {
+                    InsertSource(query_heap,
+                                 phantom_node.reverse_node_id,
+                                 -phantom_node.GetReverseWeightPlusOffset());
+                }
+            }
+
+            // upward search, nodes above the bound can only lead to farther ones
+            while (!query_heap.Empty())
+            {
+                deadline.Check();
+                const NodeID node = query_heap.DeleteMin();
+                const EdgeWeight distance = query_heap.GetKey(node);
+                if (distance > max_distance)
+                {
+                    break;
+                }
+                sweep_distances[node * SOURCES_PER_SWEEP + lane] = distance;
+
+                for (const auto edge : super::facade->GetAdjacentEdgeRange(node))
+                {
+                    const EdgeData &data = super::facade->GetEdgeData(edge);
+                    if (!data.forward)
+                    {
+                        continue;
+                    }
+                    const NodeID to = super::facade->GetTarget(edge);
+                    const EdgeWeight to_distance = distance + data.distance;
+                    if (!query_heap.WasInserted(to))
+                    {
+                        query_heap.Insert(to, to_distance, node);
+                    }
+                    else if (to_distance < query_heap.GetKey(to))
+                    {
+                        query_heap.DecreaseKey(to, to_distance);
+                    }
+                }
+            }
+        }
+
+        // downward sweep, the higher end of every edge is final before its lower end is visited
+        for (const auto index : osrm::irange(0u, number_of_nodes))
+        {
+            deadline.Check();
+            const NodeID node = super::facade->GetLevelOrderedNode(index);
+            EdgeWeight *node_distances = &sweep_distances[node * SOURCES_PER_SWEEP];
+            for (const auto edge : super::facade->GetAdjacentEdgeRange(node))
+            {
+                const EdgeData &data = super::facade->GetEdgeData(edge);
+                if (!data.backward)
+                {
+                    continue;
+                }
+                const EdgeWeight weight = data.distance;
+                const EdgeWeight *upper_distances =
+                    &sweep_distances[super::facade->GetTarget(edge) * SOURCES_PER_SWEEP];
+                for (unsigned lane = 0; lane < SOURCES_PER_SWEEP; ++lane)
+                {
+                    node_distances[lane] =
+                        std::min(node_distances[lane], upper_distances[lane] + weight);
+                }
+            }
+        }
+    }
+
+    void InsertSource(QueryHeap &query_heap, const NodeID node, const EdgeWeight distance) const
+    {
+        if (!query_heap.WasInserted(node))
+        {
+            query_heap.Insert(node, distance, node);
+        }
+        else if (distance < query_heap.GetKey(node))
+        {
+            query_heap.DecreaseKey(node, distance);
+        }
+    }
+};
+
+#endif // ONE_TO_ALL_ROUTING_H
@@ -30,197 +30,244 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <boost/assert.hpp>
 
+#include <algorithm>
+
 #include "BasicRoutingInterface.h"
+#include "../DataStructures/PathLengthAccumulator.h"
 #include "../DataStructures/Range.h"
 #include "../DataStructures/SearchEngineData.h"
 #include "../typedefs.h"
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <atomic>
+#include <vector>
+
 template <class DataFacadeT> class ShortestPathRouting : public BasicRoutingInterface<DataFacadeT>
 {
     typedef BasicRoutingInterface<DataFacadeT> super;
     typedef SearchEngineData::QueryHeap QueryHeap;
     SearchEngineData &engine_working_data;
+    std::size_t parallel_leg_threshold;
+
+    // Speculative searches seed the source with this instead of the length of the previous legs.
+    // It keeps every meeting point non-negative, just as an accumulated route length would.
+    static const int SPECULATIVE_SEED = 1 << 28;
+
+    // Outcome of the searches of one leg that were run without knowing the previous legs.
+    // Indexed by [entry][exit], where 0 is the forward and 1 the reverse node of the source
+    // respectively target phantom. Distances exclude the seed of the previous legs.
+    // The first leg and legs after a u-turn start at 0 from both source nodes. Their seeds are
+    // known up front, so they run the exact search of the sequential mode and keep the result
+    // in the entry 0 row.
+    struct SpeculativeLeg
+    {
+        bool seeds_known;
+        int distance[2][2];
+        std::vector<NodeID> packed_path[2][2];
+    };
 
   public:
     ShortestPathRouting(DataFacadeT *facade, SearchEngineData &engine_working_data)
-        : super(facade), engine_working_data(engine_working_data)
+        : super(facade), engine_working_data(engine_working_data), parallel_leg_threshold(0)
     {
     }
 
     ~ShortestPathRouting() {}
 
+    // Routes with at least this many legs search all legs in parallel and stitch them together
+    // afterwards. 0 disables the parallel mode.
+    void SetParallelLegThreshold(const std::size_t threshold) { parallel_leg_threshold = threshold; }
+
     void operator()(const std::vector<PhantomNodes> &phantom_nodes_vector,
                     const std::vector<bool> &uturn_indicators,
-                    RawRouteData &raw_route_data) const
+                    RawRouteData &raw_route_data,
+                    const QueryDeadline &deadline = QueryDeadline()) const
+    {
+        SearchWorkspace &workspace =
+            engine_working_data.GetThreadLocalWorkspace(super::facade->GetNumberOfNodes());
+
+        const int shortest_path_length =
+            SearchPackedLegs(phantom_nodes_vector, uturn_indicators, workspace, deadline);
+        if (INVALID_EDGE_WEIGHT == shortest_path_length)
+        {
+            raw_route_data.shortest_path_length = INVALID_EDGE_WEIGHT;
+            return;
+        }
+
+        const std::size_t number_of_legs = phantom_nodes_vector.size();
+        raw_route_data.unpacked_path_segments.resize(number_of_legs);
+
+        // While this thread waits for the unpacking it may run a task of another query that
+        // reuses its workspace, so the parallel mode works on a copy of the packed legs.
+        const bool use_parallel_legs = UseParallelLegs(number_of_legs);
+        std::vector<std::vector<NodeID>> copied_packed_legs;
+        if (use_parallel_legs)
+        {
+            copied_packed_legs.assign(workspace.packed_legs1.begin(),
+                                      workspace.packed_legs1.begin() + number_of_legs);
+            UnpackLegsInParallel(phantom_nodes_vector, copied_packed_legs, raw_route_data);
+        }
+        const std::vector<std::vector<NodeID>> &packed_legs1 =
+            (use_parallel_legs ? copied_packed_legs : workspace.packed_legs1);
+
+        for (const std::size_t index : osrm::irange<std::size_t>(0, number_of_legs))
+        {
+            BOOST_ASSERT(!phantom_nodes_vector.empty());
+            BOOST_ASSERT(number_of_legs == raw_route_data.unpacked_path_segments.size());
+
+            if (!use_parallel_legs)
+            {
+                PhantomNodes unpack_phantom_node_pair = phantom_nodes_vector[index];
+                super::UnpackPath(
+                    // -- packed input
+                    packed_legs1[index],
+                    // -- start and end of (sub-)route
+                    unpack_phantom_node_pair,
+                    // -- unpacked output
+                    raw_route_data.unpacked_path_segments[index],
+                    workspace);
+            }
+
+            raw_route_data.source_traversed_in_reverse.push_back(
+            (packed_legs1[index].front() != phantom_nodes_vector[index].source_phantom.forward_node_id));
+            raw_route_data.target_traversed_in_reverse.push_back(
+            (packed_legs1[index].back() != phantom_nodes_vector[index].target_phantom.forward_node_id));
+        }
+        raw_route_data.shortest_path_length = shortest_path_length;
+    }
+
+    // Computes duration and length of the shortest route only. The packed legs are walked
+    // down to the original edges without materializing the unpacked path. The duration is
+    // INVALID_EDGE_WEIGHT if there is no route.
+    void ComputeDurationAndLength(const std::vector<PhantomNodes> &phantom_nodes_vector,
+                                  const std::vector<bool> &uturn_indicators,
+                                  int *duration,
+                                  double *length,
+                                  const QueryDeadline &deadline = QueryDeadline()) const
+    {
+        BOOST_ASSERT(!phantom_nodes_vector.empty());
+        SearchWorkspace &workspace =
+            engine_working_data.GetThreadLocalWorkspace(super::facade->GetNumberOfNodes());
+
+        *duration = SearchPackedLegs(phantom_nodes_vector, uturn_indicators, workspace, deadline);
+        *length = 0.;
+        if (INVALID_EDGE_WEIGHT == *duration)
+        {
+            return;
+        }
+
+        PathLengthAccumulator<DataFacadeT> accumulator(
+            super::facade, phantom_nodes_vector.front().source_phantom.location);
+        for (const std::size_t index : osrm::irange<std::size_t>(0, phantom_nodes_vector.size()))
+        {
+            accumulator.StartLeg();
+            super::UnpackPath(
+                workspace.packed_legs1[index], phantom_nodes_vector[index], accumulator, workspace);
+            accumulator.AppendCoordinate(phantom_nodes_vector[index].target_phantom.location);
+        }
+        *length = accumulator.GetLength();
+    }
+
+  private:
+    inline bool UseParallelLegs(const std::size_t number_of_legs) const
+    {
+        return 0 != parallel_leg_threshold && number_of_legs >= parallel_leg_threshold;
+    }
+
+    // Runs the searches of all legs and leaves the packed legs of the shortest route in
+    // workspace.packed_legs1. Returns the length of the route or INVALID_EDGE_WEIGHT.
+    int SearchPackedLegs(const std::vector<PhantomNodes> &phantom_nodes_vector,
+                         const std::vector<bool> &uturn_indicators,
+                         SearchWorkspace &workspace,
+                         const QueryDeadline &deadline) const
     {
         int distance1 = 0;
         int distance2 = 0;
         bool search_from_1st_node = true;
         bool search_from_2nd_node = true;
-        NodeID middle1 = SPECIAL_NODEID;
-        NodeID middle2 = SPECIAL_NODEID;
-        std::vector<std::vector<NodeID>> packed_legs1(phantom_nodes_vector.size());
-        std::vector<std::vector<NodeID>> packed_legs2(phantom_nodes_vector.size());
 
-        engine_working_data.InitializeOrClearFirstThreadLocalStorage(
-            super::facade->GetNumberOfNodes());
-        engine_working_data.InitializeOrClearSecondThreadLocalStorage(
-            super::facade->GetNumberOfNodes());
-        engine_working_data.InitializeOrClearThirdThreadLocalStorage(
-            super::facade->GetNumberOfNodes());
+        const std::size_t number_of_legs = phantom_nodes_vector.size();
+        const bool use_parallel_legs = UseParallelLegs(number_of_legs);
 
-        QueryHeap &forward_heap1 = *(engine_working_data.forwardHeap);
-        QueryHeap &reverse_heap1 = *(engine_working_data.backwardHeap);
-        QueryHeap &forward_heap2 = *(engine_working_data.forwardHeap2);
-        QueryHeap &reverse_heap2 = *(engine_working_data.backwardHeap2);
+        // the tasks only use the heaps of the workspaces, including the one of this thread
+        std::vector<SpeculativeLeg> speculative_legs;
+        if (use_parallel_legs)
+        {
+            SearchLegsInParallel(phantom_nodes_vector, uturn_indicators, speculative_legs, deadline);
+        }
+
+        // the leg lists may be longer than this route, only the first number_of_legs are used
+        workspace.PrepareLegs(number_of_legs);
+        std::vector<std::vector<NodeID>> &packed_legs1 = workspace.packed_legs1;
+        std::vector<std::vector<NodeID>> &packed_legs2 = workspace.packed_legs2;
+        std::vector<NodeID> &temporary_packed_leg1 = workspace.temporary_packed_leg1;
+        std::vector<NodeID> &temporary_packed_leg2 = workspace.temporary_packed_leg2;
 
         std::size_t current_leg = 0;
         // Get distance to next pair of target nodes.
         for (const PhantomNodes &phantom_node_pair : phantom_nodes_vector)
         {
-            forward_heap1.Clear();
-            forward_heap2.Clear();
-            reverse_heap1.Clear();
-            reverse_heap2.Clear();
             int local_upper_bound1 = INVALID_EDGE_WEIGHT;
             int local_upper_bound2 = INVALID_EDGE_WEIGHT;
-
-            middle1 = SPECIAL_NODEID;
-            middle2 = SPECIAL_NODEID;
+            temporary_packed_leg1.clear();
+            temporary_packed_leg2.clear();
 
             const bool allow_u_turn = current_leg > 0 && uturn_indicators.size() > current_leg && uturn_indicators[current_leg-1];
-            EdgeWeight min_edge_offset = 0;
-
-            // insert new starting nodes into forward heap, adjusted by previous distances.
-            if ((allow_u_turn || search_from_1st_node) &&
-                phantom_node_pair.source_phantom.forward_node_id != SPECIAL_NODEID)
-            {
-                forward_heap1.Insert(
-                    phantom_node_pair.source_phantom.forward_node_id,
-                    (allow_u_turn ? 0 : distance1) - phantom_node_pair.source_phantom.GetForwardWeightPlusOffset(),
-                    phantom_node_pair.source_phantom.forward_node_id);
-                min_edge_offset = std::min(min_edge_offset, (allow_u_turn ? 0 : distance1) - phantom_node_pair.source_phantom.GetForwardWeightPlusOffset());
-                // SimpleLogger().Write(logDEBUG) << "fwd-a2 insert: " << phantom_node_pair.source_phantom.forward_node_id << ", w: " << (allow_u_turn ? 0 : distance1) - phantom_node_pair.source_phantom.GetForwardWeightPlusOffset();
-                forward_heap2.Insert(
-                    phantom_node_pair.source_phantom.forward_node_id,
-                    (allow_u_turn ? 0 : distance1) - phantom_node_pair.source_phantom.GetForwardWeightPlusOffset(),
-                    phantom_node_pair.source_phantom.forward_node_id);
-                min_edge_offset = std::min(min_edge_offset, (allow_u_turn ? 0 : distance1) - phantom_node_pair.source_phantom.GetForwardWeightPlusOffset());
-                // SimpleLogger().Write(logDEBUG) << "fwd-b2 insert: " << phantom_node_pair.source_phantom.forward_node_id << ", w: " << (allow_u_turn ? 0 : distance1) - phantom_node_pair.source_phantom.GetForwardWeightPlusOffset();
-
-            }
-            if ((allow_u_turn || search_from_2nd_node) &&
-                phantom_node_pair.source_phantom.reverse_node_id != SPECIAL_NODEID)
-            {
-                forward_heap1.Insert(
-                    phantom_node_pair.source_phantom.reverse_node_id,
-                    (allow_u_turn ? 0 : distance2) - phantom_node_pair.source_phantom.GetReverseWeightPlusOffset(),
-                    phantom_node_pair.source_phantom.reverse_node_id);
-                min_edge_offset = std::min(min_edge_offset, (allow_u_turn ? 0 : distance2) - phantom_node_pair.source_phantom.GetReverseWeightPlusOffset());
-                // SimpleLogger().Write(logDEBUG) << "fwd-a2 insert: " << phantom_node_pair.source_phantom.reverse_node_id <<
-                //                     ", w: " << (allow_u_turn ? 0 : distance2) - phantom_node_pair.source_phantom.GetReverseWeightPlusOffset();
-                forward_heap2.Insert(
-                    phantom_node_pair.source_phantom.reverse_node_id,
-                    (allow_u_turn ? 0 : distance2) - phantom_node_pair.source_phantom.GetReverseWeightPlusOffset(),
-                    phantom_node_pair.source_phantom.reverse_node_id);
-                min_edge_offset = std::min(min_edge_offset, (allow_u_turn ? 0 : distance2) - phantom_node_pair.source_phantom.GetReverseWeightPlusOffset());
-                // SimpleLogger().Write(logDEBUG) << "fwd-b2 insert: " << phantom_node_pair.source_phantom.reverse_node_id <<
-                //                     ", w: " << (allow_u_turn ? 0 : distance2) - phantom_node_pair.source_phantom.GetReverseWeightPlusOffset();
-            }
-
-            // insert new backward nodes into backward heap, unadjusted.
-            if (phantom_node_pair.target_phantom.forward_node_id != SPECIAL_NODEID)
-            {
-                reverse_heap1.Insert(phantom_node_pair.target_phantom.forward_node_id,
-                                     phantom_node_pair.target_phantom.GetForwardWeightPlusOffset(),
-                                     phantom_node_pair.target_phantom.forward_node_id);
-                // SimpleLogger().Write(logDEBUG) << "rev-a insert: " << phantom_node_pair.target_phantom.forward_node_id <<
-                //                     ", w: " << phantom_node_pair.target_phantom.GetForwardWeightPlusOffset();
-           }
-
-            if (phantom_node_pair.target_phantom.reverse_node_id != SPECIAL_NODEID)
-            {
-                reverse_heap2.Insert(phantom_node_pair.target_phantom.reverse_node_id,
-                                     phantom_node_pair.target_phantom.GetReverseWeightPlusOffset(),
-                                     phantom_node_pair.target_phantom.reverse_node_id);
-                // SimpleLogger().Write(logDEBUG) << "rev-a insert: " << phantom_node_pair.target_phantom.reverse_node_id <<
-                //                     ", w: " << phantom_node_pair.target_phantom.GetReverseWeightPlusOffset();
-            }
-
-            // run two-Target Dijkstra routing step.
-            while (0 < (forward_heap1.Size() + reverse_heap1.Size()))
-            {
-                if (!forward_heap1.Empty())
-                {
-                    super::RoutingStep(
-                        forward_heap1, reverse_heap1, &middle1, &local_upper_bound1, min_edge_offset, true);
-                }
-                if (!reverse_heap1.Empty())
-                {
-                    super::RoutingStep(
-                        reverse_heap1, forward_heap1, &middle1, &local_upper_bound1, min_edge_offset, false);
-                }
-            }
 
-            if (!reverse_heap2.Empty())
+            // start nodes are adjusted by previous distances.
+            const bool seed_forward_node =
+                (allow_u_turn || search_from_1st_node) &&
+                phantom_node_pair.source_phantom.forward_node_id != SPECIAL_NODEID;
+            const bool seed_reverse_node =
+                (allow_u_turn || search_from_2nd_node) &&
+                phantom_node_pair.source_phantom.reverse_node_id != SPECIAL_NODEID;
+            const int forward_seed = (allow_u_turn ? 0 : distance1);
+            const int reverse_seed = (allow_u_turn ? 0 : distance2);
+
+            // a speculative leg that would have met at a negative distance is searched again
+            const bool stitched = use_parallel_legs &&
+                                  StitchSpeculativeLeg(speculative_legs[current_leg],
+                                                       seed_forward_node,
+                                                       forward_seed,
+                                                       seed_reverse_node,
+                                                       reverse_seed,
+                                                       &local_upper_bound1,
+                                                       &local_upper_bound2,
+                                                       temporary_packed_leg1,
+                                                       temporary_packed_leg2);
+            if (!stitched)
             {
-                while (0 < (forward_heap2.Size() + reverse_heap2.Size()))
-                {
-                    if (!forward_heap2.Empty())
-                    {
-                        super::RoutingStep(
-                            forward_heap2, reverse_heap2, &middle2, &local_upper_bound2, min_edge_offset, true);
-                    }
-                    if (!reverse_heap2.Empty())
-                    {
-                        super::RoutingStep(
-                            reverse_heap2, forward_heap2, &middle2, &local_upper_bound2, min_edge_offset, false);
-                    }
-                }
+                SearchLeg(workspace,
+                          phantom_node_pair,
+                          seed_forward_node,
+                          forward_seed,
+                          seed_reverse_node,
+                          reverse_seed,
+                          &local_upper_bound1,
+                          &local_upper_bound2,
+                          temporary_packed_leg1,
+                          temporary_packed_leg2,
+                          deadline);
             }
 
             // No path found for both target nodes?
             if ((INVALID_EDGE_WEIGHT == local_upper_bound1) &&
                 (INVALID_EDGE_WEIGHT == local_upper_bound2))
             {
-                raw_route_data.shortest_path_length = INVALID_EDGE_WEIGHT;
-                raw_route_data.alternative_path_length = INVALID_EDGE_WEIGHT;
-                return;
+                return INVALID_EDGE_WEIGHT;
             }
 
-            search_from_1st_node = true;
-            search_from_2nd_node = true;
-            if (SPECIAL_NODEID == middle1)
-            {
-                search_from_1st_node = false;
-            }
-            if (SPECIAL_NODEID == middle2)
-            {
-                search_from_2nd_node = false;
-            }
+            search_from_1st_node = (INVALID_EDGE_WEIGHT != local_upper_bound1);
+            search_from_2nd_node = (INVALID_EDGE_WEIGHT != local_upper_bound2);
 
             // Was at most one of the two paths not found?
             BOOST_ASSERT_MSG((INVALID_EDGE_WEIGHT != distance1 || INVALID_EDGE_WEIGHT != distance2), "no path found");
 
-            // Unpack paths if they exist
-            std::vector<NodeID> temporary_packed_leg1;
-            std::vector<NodeID> temporary_packed_leg2;
-
             BOOST_ASSERT((unsigned)current_leg < packed_legs1.size());
             BOOST_ASSERT((unsigned)current_leg < packed_legs2.size());
 
-            if (INVALID_EDGE_WEIGHT != local_upper_bound1)
-            {
-                super::RetrievePackedPathFromHeap(
-                    forward_heap1, reverse_heap1, middle1, temporary_packed_leg1);
-            }
-
-            if (INVALID_EDGE_WEIGHT != local_upper_bound2)
-            {
-                super::RetrievePackedPathFromHeap(
-                    forward_heap2, reverse_heap2, middle2, temporary_packed_leg2);
-            }
-
             // if one of the paths was not found, replace it with the other one.
             if ((allow_u_turn && local_upper_bound1 > local_upper_bound2) || temporary_packed_leg1.empty())
             {
@@ -266,12 +313,16 @@ template <class DataFacadeT> class ShortestPathRouting : public BasicRoutingInte
                     const NodeID last_id_of_packed_legs2 = packed_legs2[current_leg - 1].back();
                     if (start_id_of_leg1 != last_id_of_packed_legs1)
                     {
-                        packed_legs1 = packed_legs2;
+                        std::copy(packed_legs2.begin(),
+                                  packed_legs2.begin() + current_leg,
+                                  packed_legs1.begin());
                         BOOST_ASSERT(start_id_of_leg1 == temporary_packed_leg1.front());
                     }
                     else if (start_id_of_leg2 != last_id_of_packed_legs2)
                     {
-                        packed_legs2 = packed_legs1;
+                        std::copy(packed_legs1.begin(),
+                                  packed_legs1.begin() + current_leg,
+                                  packed_legs2.begin());
                         BOOST_ASSERT(start_id_of_leg2 == temporary_packed_leg2.front());
                     }
                 }
@@ -307,28 +358,287 @@ template <class DataFacadeT> class ShortestPathRouting : public BasicRoutingInte
         {
             std::swap(packed_legs1, packed_legs2);
         }
-        raw_route_data.unpacked_path_segments.resize(packed_legs1.size());
 
-        for (const std::size_t index : osrm::irange<std::size_t>(0, packed_legs1.size()))
+        return std::min(distance1, distance2);
+    }
+
+    // Runs the two bidirectional searches of a leg, one towards each node of the target
+    // phantom. The enabled source nodes start at the given seeds, i.e. the length of the route
+    // up to them.
+    void SearchLeg(SearchWorkspace &workspace,
+                   const PhantomNodes &phantom_node_pair,
+                   const bool seed_forward_node,
+                   const int forward_seed,
+                   const bool seed_reverse_node,
+                   const int reverse_seed,
+                   int *local_upper_bound1,
+                   int *local_upper_bound2,
+                   std::vector<NodeID> &packed_leg1,
+                   std::vector<NodeID> &packed_leg2,
+                   const QueryDeadline &deadline) const
+    {
+        QueryHeap &forward_heap1 = workspace.forward_heap1;
+        QueryHeap &reverse_heap1 = workspace.reverse_heap1;
+        QueryHeap &forward_heap2 = workspace.forward_heap2;
+        QueryHeap &reverse_heap2 = workspace.reverse_heap2;
+        forward_heap1.Clear();
+        forward_heap2.Clear();
+        reverse_heap1.Clear();
+        reverse_heap2.Clear();
+
+        NodeID middle1 = SPECIAL_NODEID;
+        NodeID middle2 = SPECIAL_NODEID;
+        EdgeWeight min_edge_offset = 0;
+
+        if (seed_forward_node)
+        {
+            const int weight =
+                forward_seed - phantom_node_pair.source_phantom.GetForwardWeightPlusOffset();
+            forward_heap1.Insert(phantom_node_pair.source_phantom.forward_node_id,
+                                 weight,
+                                 phantom_node_pair.source_phantom.forward_node_id);
+            forward_heap2.Insert(phantom_node_pair.source_phantom.forward_node_id,
+                                 weight,
+                                 phantom_node_pair.source_phantom.forward_node_id);
+            min_edge_offset = std::min(min_edge_offset, weight);
+        }
+        if (seed_reverse_node)
+        {
+            const int weight =
+                reverse_seed - phantom_node_pair.source_phantom.GetReverseWeightPlusOffset();
+            forward_heap1.Insert(phantom_node_pair.source_phantom.reverse_node_id,
+                                 weight,
+                                 phantom_node_pair.source_phantom.reverse_node_id);
+            forward_heap2.Insert(phantom_node_pair.source_phantom.reverse_node_id,
+                                 weight,
+                                 phantom_node_pair.source_phantom.reverse_node_id);
+            min_edge_offset = std::min(min_edge_offset, weight);
+        }
+
+        // insert new backward nodes into backward heap, unadjusted.
+        if (phantom_node_pair.target_phantom.forward_node_id != SPECIAL_NODEID)
         {
-            BOOST_ASSERT(!phantom_nodes_vector.empty());
-            BOOST_ASSERT(packed_legs1.size() == raw_route_data.unpacked_path_segments.size());
+            reverse_heap1.Insert(phantom_node_pair.target_phantom.forward_node_id,
+                                 phantom_node_pair.target_phantom.GetForwardWeightPlusOffset(),
+                                 phantom_node_pair.target_phantom.forward_node_id);
+        }
 
-            PhantomNodes unpack_phantom_node_pair = phantom_nodes_vector[index];
-            super::UnpackPath(
-                // -- packed input
-                packed_legs1[index],
-                // -- start and end of (sub-)route
-                unpack_phantom_node_pair,
-                // -- unpacked output
-                raw_route_data.unpacked_path_segments[index]);
+        if (phantom_node_pair.target_phantom.reverse_node_id != SPECIAL_NODEID)
+        {
+            reverse_heap2.Insert(phantom_node_pair.target_phantom.reverse_node_id,
+                                 phantom_node_pair.target_phantom.GetReverseWeightPlusOffset(),
+                                 phantom_node_pair.target_phantom.reverse_node_id);
+        }
 
-            raw_route_data.source_traversed_in_reverse.push_back(
-            (packed_legs1[index].front() != phantom_nodes_vector[index].source_phantom.forward_node_id));
-            raw_route_data.target_traversed_in_reverse.push_back(
-            (packed_legs1[index].back() != phantom_nodes_vector[index].target_phantom.forward_node_id));
+        // run two-Target Dijkstra routing step.
+        while (0 < (forward_heap1.Size() + reverse_heap1.Size()))
+        {
+            deadline.Check();
+            if (!forward_heap1.Empty())
+            {
+                super::RoutingStep(
+                    forward_heap1, reverse_heap1, &middle1, local_upper_bound1, min_edge_offset, true);
+            }
+            if (!reverse_heap1.Empty())
+            {
+                super::RoutingStep(
+                    reverse_heap1, forward_heap1, &middle1, local_upper_bound1, min_edge_offset, false);
+            }
+        }
+
+        if (!reverse_heap2.Empty())
+        {
+            while (0 < (forward_heap2.Size() + reverse_heap2.Size()))
+            {
+                deadline.Check();
+                if (!forward_heap2.Empty())
+                {
+                    super::RoutingStep(
+                        forward_heap2, reverse_heap2, &middle2, local_upper_bound2, min_edge_offset, true);
+                }
+                if (!reverse_heap2.Empty())
+                {
+                    super::RoutingStep(
+                        reverse_heap2, forward_heap2, &middle2, local_upper_bound2, min_edge_offset, false);
+                }
+            }
+        }
+
+        if (INVALID_EDGE_WEIGHT != *local_upper_bound1)
+        {
+            BOOST_ASSERT(SPECIAL_NODEID != middle1);
+            super::RetrievePackedPathFromHeap(forward_heap1, reverse_heap1, middle1, packed_leg1);
+        }
+
+        if (INVALID_EDGE_WEIGHT != *local_upper_bound2)
+        {
+            BOOST_ASSERT(SPECIAL_NODEID != middle2);
+            super::RetrievePackedPathFromHeap(forward_heap2, reverse_heap2, middle2, packed_leg2);
+        }
+    }
+
+    // Searches every leg once from each source node. The legs are independent of each other,
+    // each task works on the workspace of the thread that runs it.
+    void SearchLegsInParallel(const std::vector<PhantomNodes> &phantom_nodes_vector,
+                              const std::vector<bool> &uturn_indicators,
+                              std::vector<SpeculativeLeg> &speculative_legs,
+                              const QueryDeadline &deadline) const
+    {
+        speculative_legs.resize(phantom_nodes_vector.size());
+        for (const std::size_t index : osrm::irange<std::size_t>(0, speculative_legs.size()))
+        {
+            speculative_legs[index].seeds_known =
+                (0 == index) || (uturn_indicators.size() > index && uturn_indicators[index - 1]);
+        }
+        const unsigned number_of_nodes = super::facade->GetNumberOfNodes();
+        std::atomic<bool> timed_out(false);
+
+        tbb::parallel_for(
+            tbb::blocked_range<std::size_t>(0, 2 * phantom_nodes_vector.size()),
+            [&](const tbb::blocked_range<std::size_t> &range)
+            {
+                SearchWorkspace &workspace =
+                    engine_working_data.GetThreadLocalWorkspace(number_of_nodes);
+                // every task counts its own checks
+                const QueryDeadline task_deadline(deadline);
+                for (std::size_t task = range.begin(); task != range.end() && !timed_out; ++task)
+                {
+                    const PhantomNodes &phantom_node_pair = phantom_nodes_vector[task / 2];
+                    const unsigned entry = task % 2;
+                    SpeculativeLeg &leg = speculative_legs[task / 2];
+                    // with known seeds a single search starts from both source nodes
+                    const int seed = (leg.seeds_known ? 0 : SPECULATIVE_SEED);
+                    const bool seed_forward_node =
+                        (leg.seeds_known || 0 == entry) &&
+                        SPECIAL_NODEID != phantom_node_pair.source_phantom.forward_node_id;
+                    const bool seed_reverse_node =
+                        (leg.seeds_known || 1 == entry) &&
+                        SPECIAL_NODEID != phantom_node_pair.source_phantom.reverse_node_id;
+
+                    int upper_bound1 = INVALID_EDGE_WEIGHT;
+                    int upper_bound2 = INVALID_EDGE_WEIGHT;
+                    if ((seed_forward_node || seed_reverse_node) &&
+                        (!leg.seeds_known || 0 == entry))
+                    {
+                        try
+                        {
+                            SearchLeg(workspace,
+                                      phantom_node_pair,
+                                      seed_forward_node,
+                                      seed,
+                                      seed_reverse_node,
+                                      seed,
+                                      &upper_bound1,
+                                      &upper_bound2,
+                                      leg.packed_path[entry][0],
+                                      leg.packed_path[entry][1],
+                                      task_deadline);
+                        }
+                        catch (const QueryTimeoutException &)
+                        {
+                            timed_out = true;
+                            return;
+                        }
+                    }
+                    leg.distance[entry][0] = (INVALID_EDGE_WEIGHT == upper_bound1)
+                                                 ? INVALID_EDGE_WEIGHT
+                                                 : upper_bound1 - seed;
+                    leg.distance[entry][1] = (INVALID_EDGE_WEIGHT == upper_bound2)
+                                                 ? INVALID_EDGE_WEIGHT
+                                                 : upper_bound2 - seed;
+                }
+            });
+
+        if (timed_out)
+        {
+            throw QueryTimeoutException();
+        }
+    }
+
+    // Picks for both target nodes the best of the speculative searches whose source node would
+    // have been seeded by the sequential search. Returns false if the leg has to be searched
+    // again, i.e. if the sequential search would have discarded a meeting point at negative
+    // distance and continued from there. The upper bounds and packed legs are left untouched then.
+    bool StitchSpeculativeLeg(const SpeculativeLeg &leg,
+                              const bool seed_forward_node,
+                              const int forward_seed,
+                              const bool seed_reverse_node,
+                              const int reverse_seed,
+                              int *local_upper_bound1,
+                              int *local_upper_bound2,
+                              std::vector<NodeID> &packed_leg1,
+                              std::vector<NodeID> &packed_leg2) const
+    {
+        int *upper_bound[2] = {local_upper_bound1, local_upper_bound2};
+        std::vector<NodeID> *packed_leg[2] = {&packed_leg1, &packed_leg2};
+
+        if (leg.seeds_known)
+        {
+            BOOST_ASSERT(0 == forward_seed && 0 == reverse_seed);
+            for (const unsigned target : {0u, 1u})
+            {
+                *upper_bound[target] = leg.distance[0][target];
+                packed_leg[target]->assign(leg.packed_path[0][target].begin(),
+                                           leg.packed_path[0][target].end());
+            }
+            return true;
         }
-        raw_route_data.shortest_path_length = std::min(distance1, distance2);
+
+        const bool seeded[2] = {seed_forward_node, seed_reverse_node};
+        const int seed[2] = {forward_seed, reverse_seed};
+        int best_entry[2] = {-1, -1};
+        int best_length[2] = {INVALID_EDGE_WEIGHT, INVALID_EDGE_WEIGHT};
+        for (const unsigned target : {0u, 1u})
+        {
+            for (const unsigned entry : {0u, 1u})
+            {
+                if (!seeded[entry] || INVALID_EDGE_WEIGHT == leg.distance[entry][target])
+                {
+                    continue;
+                }
+                const int length = seed[entry] + leg.distance[entry][target];
+                if (length < 0)
+                {
+                    return false;
+                }
+                if (length < best_length[target])
+                {
+                    best_length[target] = length;
+                    best_entry[target] = entry;
+                }
+            }
+        }
+
+        for (const unsigned target : {0u, 1u})
+        {
+            *upper_bound[target] = best_length[target];
+            if (-1 != best_entry[target])
+            {
+                packed_leg[target]->assign(leg.packed_path[best_entry[target]][target].begin(),
+                                           leg.packed_path[best_entry[target]][target].end());
+            }
+        }
+        return true;
+    }
+
+    void UnpackLegsInParallel(const std::vector<PhantomNodes> &phantom_nodes_vector,
+                              const std::vector<std::vector<NodeID>> &packed_legs,
+                              RawRouteData &raw_route_data) const
+    {
+        const unsigned number_of_nodes = super::facade->GetNumberOfNodes();
+        tbb::parallel_for(tbb::blocked_range<std::size_t>(0, phantom_nodes_vector.size()),
+                          [&](const tbb::blocked_range<std::size_t> &range)
+                          {
+            SearchWorkspace &workspace =
+                engine_working_data.GetThreadLocalWorkspace(number_of_nodes);
+            for (std::size_t index = range.begin(); index != range.end(); ++index)
+            {
+                super::UnpackPath(packed_legs[index],
+                                  phantom_nodes_vector[index],
+                                  raw_route_data.unpacked_path_segments[index],
+                                  workspace);
+            }
+        });
     }
 };
 
@@ -34,13 +34,29 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 namespace qi = boost::spirit::qi;
 
+// qi::double_ without nan and inf, which no parameter can take
+template <typename T> struct FiniteRealPolicies : qi::real_policies<T>
+{
+    template <typename Iterator, typename Attribute>
+    static bool parse_nan(Iterator &, Iterator const &, Attribute &)
+    {
+        return false;
+    }
+
+    template <typename Iterator, typename Attribute>
+    static bool parse_inf(Iterator &, Iterator const &, Attribute &)
+    {
+        return false;
+    }
+};
+
 template <typename Iterator, class HandlerT>
 struct APIGrammar : qi::grammar<Iterator>
 {
     explicit APIGrammar(HandlerT * h) : APIGrammar::base_type(api_call), handler(h)
     {
         api_call = qi::lit('/') >> string[boost::bind(&HandlerT::setService, handler, ::_1)] >> *(query) >> -(uturns);
-        query    = ('?') >> (+(zoom | output | jsonp | checksum | location | hint | u | cmp | language | instruction | geometry | alt_route | old_API));
+        query    = ('?') >> (+(zoom | output | jsonp | checksum | location | hint | u | cmp | language | instruction | geometry | alt_route | alternatives | time | number | radius | old_API | timeout));
 
         zoom        = (-qi::lit('&')) >> qi::lit('z')            >> '=' >> qi::short_[boost::bind(&HandlerT::setZoomLevel, handler, ::_1)];
         output      = (-qi::lit('&')) >> qi::lit("output")       >> '=' >> string[boost::bind(&HandlerT::setOutputFormat, handler, ::_1)];
@@ -49,13 +65,18 @@ struct APIGrammar : qi::grammar<Iterator>
         instruction = (-qi::lit('&')) >> qi::lit("instructions") >> '=' >> qi::bool_[boost::bind(&HandlerT::setInstructionFlag, handler, ::_1)];
         geometry    = (-qi::lit('&')) >> qi::lit("geometry")     >> '=' >> qi::bool_[boost::bind(&HandlerT::setGeometryFlag, handler, ::_1)];
         cmp         = (-qi::lit('&')) >> qi::lit("compression")  >> '=' >> qi::bool_[boost::bind(&HandlerT::setCompressionFlag, handler, ::_1)];
-        location    = (-qi::lit('&')) >> qi::lit("loc")          >> '=' >> (qi::double_ >> qi::lit(',') >> qi::double_)[boost::bind(&HandlerT::addCoordinate, handler, ::_1)];
+        location    = (-qi::lit('&')) >> qi::lit("loc")          >> '=' >> (finite_double >> qi::lit(',') >> finite_double)[boost::bind(&HandlerT::addCoordinate, handler, ::_1)];
         hint        = (-qi::lit('&')) >> qi::lit("hint")         >> '=' >> stringwithDot[boost::bind(&HandlerT::addHint, handler, ::_1)];
         u           = (-qi::lit('&')) >> qi::lit("u")            >> '=' >> qi::bool_[boost::bind(&HandlerT::setUTurn, handler, ::_1)];
         uturns      = (-qi::lit('&')) >> qi::lit("uturns")       >> '=' >> qi::bool_[boost::bind(&HandlerT::setAllUTurns, handler, ::_1)];
         language    = (-qi::lit('&')) >> qi::lit("hl")           >> '=' >> string[boost::bind(&HandlerT::setLanguage, handler, ::_1)];
         alt_route   = (-qi::lit('&')) >> qi::lit("alt")          >> '=' >> qi::bool_[boost::bind(&HandlerT::setAlternateRouteFlag, handler, ::_1)];
+        alternatives = (-qi::lit('&')) >> qi::lit("alternatives") >> '=' >> qi::uint_[boost::bind(&HandlerT::setNumberOfAlternatives, handler, ::_1)];
+        time        = (-qi::lit('&')) >> qi::lit("time")         >> '=' >> qi::uint_[boost::bind(&HandlerT::setTimeBound, handler, ::_1)];
+        number      = (-qi::lit('&')) >> qi::lit("number")       >> '=' >> qi::uint_[boost::bind(&HandlerT::setNumberOfResults, handler, ::_1)];
+        radius      = (-qi::lit('&')) >> qi::lit("radius")       >> '=' >> finite_double[boost::bind(&HandlerT::setRadius, handler, ::_1)];
         old_API     = (-qi::lit('&')) >> qi::lit("geomformat")   >> '=' >> string[boost::bind(&HandlerT::setDeprecatedAPIFlag, handler, ::_1)];
+        timeout     = (-qi::lit('&')) >> qi::lit("timeout")      >> '=' >> qi::uint_[boost::bind(&HandlerT::setTimeout, handler, ::_1)];
 
         string            = +(qi::char_("a-zA-Z"));
         stringwithDot     = +(qi::char_("a-zA-Z0-9_.-"));
@@ -65,7 +86,10 @@ struct APIGrammar : qi::grammar<Iterator>
     qi::rule<Iterator> api_call, query;
     qi::rule<Iterator, std::string()> service, zoom, output, string, jsonp, checksum, location, hint,
                                       stringwithDot, stringwithPercent, language, instruction, geometry,
-                                      cmp, alt_route, u, uturns, old_API ;
+                                      cmp, alt_route, alternatives, time, number, radius, u, uturns,
+                                      old_API, timeout;
+
+    qi::real_parser<double, FiniteRealPolicies<double>> finite_double;
 
     HandlerT * handler;
 };
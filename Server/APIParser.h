@@ -0,0 +1,540 @@
+/*
+
+Copyright (c) 2014, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef API_PARSER_H
+#define API_PARSER_H
+
+#include <osrm/Coordinate.h>
+#include <osrm/RouteParameters.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <string>
+
+// Hand-written replacement for APIGrammar. It accepts exactly the same language, i.e.
+//   /service(?param=value(&param=value)*)*(&uturns=bool)?
+// and parses a request in a single pass without building intermediate strings for
+// numbers and coordinates. Percent-escapes are decoded in place beforehand.
+class APIParser
+{
+  public:
+    explicit APIParser(RouteParameters &parameters) : parameters(parameters) {}
+
+    // replaces %XX escapes by the character they encode without reallocating
+    static void DecodeInPlace(std::string &request)
+    {
+        std::size_t write_position = 0;
+        for (std::size_t read_position = 0; read_position < request.size(); ++write_position)
+        {
+            if ('%' == request[read_position] && read_position + 2 < request.size() &&
+                0 <= HexValue(request[read_position + 1]) &&
+                0 <= HexValue(request[read_position + 2]))
+            {
+                request[write_position] =
+                    static_cast<char>(16 * HexValue(request[read_position + 1]) +
+                                      HexValue(request[read_position + 2]));
+                read_position += 3;
+                continue;
+            }
+            request[write_position] = request[read_position++];
+        }
+        request.resize(write_position);
+    }
+
+    // Returns the number of characters consumed, the request was well-formed iff this
+    // equals its length. Expects percent-escapes to be decoded already.
+    std::size_t Parse(const std::string &request)
+    {
+        // an upper bound on the number of parameters, saves reallocations for long tables
+        const std::size_t max_parameters =
+            1 + static_cast<std::size_t>(std::count(request.begin(), request.end(), '&'));
+        parameters.coordinates.reserve(max_parameters);
+        parameters.hints.reserve(max_parameters);
+        parameters.uturns.reserve(max_parameters);
+
+        begin = request.data();
+        end = begin + request.size();
+        const char *current = begin;
+
+        // a malformed service is reported at position 0, just like a failing grammar
+        if (current == end || '/' != *current)
+        {
+            return 0;
+        }
+        ++current;
+        const char *service_end = SkipLetters(current);
+        if (service_end == current)
+        {
+            return 0;
+        }
+        parameters.setService(std::string(current, service_end));
+        current = service_end;
+
+        while (current != end && '?' == *current)
+        {
+            const char *query_start = current + 1;
+            const char *parameter_end = ParseParameter(query_start);
+            if (parameter_end == query_start)
+            {
+                // at least one parameter has to follow a '?'
+                break;
+            }
+            current = parameter_end;
+            while (current != (parameter_end = ParseParameter(current)))
+            {
+                current = parameter_end;
+            }
+        }
+
+        current = ParseUTurns(current);
+        return static_cast<std::size_t>(current - begin);
+    }
+
+  private:
+    RouteParameters &parameters;
+    const char *begin;
+    const char *end;
+
+    static inline bool IsLetter(const char c)
+    {
+        return ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z');
+    }
+
+    static inline bool IsDigit(const char c) { return '0' <= c && c <= '9'; }
+
+    static inline bool IsHintCharacter(const char c)
+    {
+        return IsLetter(c) || IsDigit(c) || '_' == c || '.' == c || '-' == c;
+    }
+
+    static inline int HexValue(const char c)
+    {
+        if (IsDigit(c))
+        {
+            return c - '0';
+        }
+        if ('A' <= c && c <= 'F')
+        {
+            return c - 'A' + 10;
+        }
+        if ('a' <= c && c <= 'f')
+        {
+            return c - 'a' + 10;
+        }
+        return -1;
+    }
+
+    const char *SkipLetters(const char *current) const
+    {
+        while (current != end && IsLetter(*current))
+        {
+            ++current;
+        }
+        return current;
+    }
+
+    // matches name followed by '=' and returns the position of the value, nullptr otherwise
+    const char *MatchName(const char *current, const char *name) const
+    {
+        while ('\0' != *name)
+        {
+            if (current == end || *current != *name)
+            {
+                return nullptr;
+            }
+            ++current;
+            ++name;
+        }
+        if (current == end || '=' != *current)
+        {
+            return nullptr;
+        }
+        return current + 1;
+    }
+
+    const char *ParseBool(const char *current, bool &value) const
+    {
+        static const char true_string[] = "true";
+        static const char false_string[] = "false";
+        if (static_cast<std::size_t>(end - current) >= 4 &&
+            std::equal(true_string, true_string + 4, current))
+        {
+            value = true;
+            return current + 4;
+        }
+        if (static_cast<std::size_t>(end - current) >= 5 &&
+            std::equal(false_string, false_string + 5, current))
+        {
+            value = false;
+            return current + 5;
+        }
+        return nullptr;
+    }
+
+    template <typename IntegerT>
+    const char *ParseInteger(const char *current, IntegerT &value, const bool allow_sign) const
+    {
+        bool negative = false;
+        if (allow_sign && current != end && ('-' == *current || '+' == *current))
+        {
+            negative = ('-' == *current);
+            ++current;
+        }
+        if (current == end || !IsDigit(*current))
+        {
+            return nullptr;
+        }
+        // accumulate in 64 bits and bail out on overflow of the target type
+        const int64_t limit = negative ? -static_cast<int64_t>(std::numeric_limits<IntegerT>::min())
+                                       : static_cast<int64_t>(std::numeric_limits<IntegerT>::max());
+        int64_t result = 0;
+        while (current != end && IsDigit(*current))
+        {
+            result = 10 * result + (*current - '0');
+            if (result > limit)
+            {
+                return nullptr;
+            }
+            ++current;
+        }
+        value = static_cast<IntegerT>(negative ? -result : result);
+        return current;
+    }
+
+    // Parses [sign] digits [. digits] [(e|E) [sign] digits] where either the integer or the
+    // fractional part may be empty. An exponent that does not fit into an int is not
+    // considered part of the number. As in the grammar, nan and inf are rejected. Up to 15
+    // significant digits and moderate exponents are handled exactly by a single
+    // multiplication or division, which is correctly rounded since both operands are exact.
+    // Everything else is left to strtod.
+    const char *ParseDouble(const char *current, double &value) const
+    {
+        static const double powers_of_ten[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                               1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                               1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        const char *token_start = current;
+        bool negative = false;
+        if (current != end && ('-' == *current || '+' == *current))
+        {
+            negative = ('-' == *current);
+            ++current;
+        }
+
+        uint64_t mantissa = 0;
+        int significant_digits = 0;
+        int64_t exponent = 0;
+        bool has_digits = false;
+        while (current != end && IsDigit(*current))
+        {
+            has_digits = true;
+            if (0 != mantissa || '0' != *current)
+            {
+                if (significant_digits < 19)
+                {
+                    mantissa = 10 * mantissa + (*current - '0');
+                }
+                else
+                {
+                    ++exponent;
+                }
+                ++significant_digits;
+            }
+            ++current;
+        }
+        if (current != end && '.' == *current)
+        {
+            const char *after_dot = current + 1;
+            while (after_dot != end && IsDigit(*after_dot))
+            {
+                has_digits = true;
+                if (0 != mantissa || '0' != *after_dot)
+                {
+                    if (significant_digits < 19)
+                    {
+                        mantissa = 10 * mantissa + (*after_dot - '0');
+                        --exponent;
+                    }
+                    ++significant_digits;
+                }
+                else
+                {
+                    --exponent;
+                }
+                ++after_dot;
+            }
+            if (has_digits)
+            {
+                current = after_dot;
+            }
+        }
+        if (!has_digits)
+        {
+            return nullptr;
+        }
+
+        // the exponent is optional, a dangling 'e' is not part of the number
+        if (current != end && ('e' == *current || 'E' == *current))
+        {
+            int exponent_value = 0;
+            const char *exponent_end = ParseInteger(current + 1, exponent_value, true);
+            if (nullptr != exponent_end)
+            {
+                exponent += exponent_value;
+                current = exponent_end;
+            }
+        }
+
+        if (significant_digits <= 15 && -22 <= exponent && exponent <= 22)
+        {
+            const double result = static_cast<double>(mantissa);
+            value = (exponent < 0 ? result / powers_of_ten[-exponent]
+                                  : result * powers_of_ten[exponent]);
+        }
+        else
+        {
+            const std::string token(token_start, current);
+            value = std::abs(std::strtod(token.c_str(), nullptr));
+            // numbers beyond the range of a double are malformed
+            if (std::numeric_limits<double>::max() < value)
+            {
+                return nullptr;
+            }
+        }
+        if (negative)
+        {
+            value = -value;
+        }
+        return current;
+    }
+
+    // Parses a single [&]name=value pair and returns the position behind it. If the
+    // parameter is malformed nothing is changed and current is returned.
+    const char *ParseParameter(const char *current)
+    {
+        const char *name = (current != end && '&' == *current) ? current + 1 : current;
+        const char *value = nullptr;
+        const char *value_end = nullptr;
+        bool flag = false;
+
+        if (nullptr != (value = MatchName(name, "z")))
+        {
+            short zoom_level = 0;
+            if (nullptr != (value_end = ParseInteger(value, zoom_level, true)))
+            {
+                parameters.setZoomLevel(zoom_level);
+                return value_end;
+            }
+        }
+        else if (nullptr != (value = MatchName(name, "output")))
+        {
+            if (value != (value_end = SkipLetters(value)))
+            {
+                parameters.setOutputFormat(std::string(value, value_end));
+                return value_end;
+            }
+        }
+        else if (nullptr != (value = MatchName(name, "jsonp")))
+        {
+            value_end = value;
+            while (value_end != end)
+            {
+                if (IsHintCharacter(*value_end) || '[' == *value_end || ']' == *value_end)
+                {
+                    ++value_end;
+                }
+                else if ('%' == *value_end && 2 < end - value_end &&
+                         (IsDigit(value_end[1]) || ('A' <= value_end[1] && value_end[1] <= 'Z')) &&
+                         (IsDigit(value_end[2]) || ('A' <= value_end[2] && value_end[2] <= 'Z')))
+                {
+                    value_end += 3;
+                }
+                else
+                {
+                    break;
+                }
+            }
+            if (value != value_end)
+            {
+                parameters.setJSONpParameter(std::string(value, value_end));
+                return value_end;
+            }
+        }
+        else if (nullptr != (value = MatchName(name, "checksum")))
+        {
+            unsigned check_sum = 0;
+            if (nullptr != (value_end = ParseInteger(value, check_sum, false)))
+            {
+                parameters.setChecksum(check_sum);
+                return value_end;
+            }
+        }
+        else if (nullptr != (value = MatchName(name, "loc")))
+        {
+            double lat = 0., lon = 0.;
+            if (nullptr != (value_end = ParseDouble(value, lat)) && value_end != end &&
+                ',' == *value_end && nullptr != (value_end = ParseDouble(value_end + 1, lon)))
+            {
+                parameters.coordinates.emplace_back(static_cast<int>(COORDINATE_PRECISION * lat),
+                                                    static_cast<int>(COORDINATE_PRECISION * lon));
+                return value_end;
+            }
+        }
+        else if (nullptr != (value = MatchName(name, "hint")))
+        {
+            value_end = value;
+            while (value_end != end && IsHintCharacter(*value_end))
+            {
+                ++value_end;
+            }
+            if (value != value_end)
+            {
+                parameters.addHint(std::string(value, value_end));
+                return value_end;
+            }
+        }
+        else if (nullptr != (value = MatchName(name, "u")))
+        {
+            if (nullptr != (value_end = ParseBool(value, flag)))
+            {
+                parameters.setUTurn(flag);
+                return value_end;
+            }
+        }
+        else if (nullptr != (value = MatchName(name, "compression")))
+        {
+            if (nullptr != (value_end = ParseBool(value, flag)))
+            {
+                parameters.setCompressionFlag(flag);
+                return value_end;
+            }
+        }
+        else if (nullptr != (value = MatchName(name, "hl")))
+        {
+            if (value != (value_end = SkipLetters(value)))
+            {
+                parameters.setLanguage(std::string(value, value_end));
+                return value_end;
+            }
+        }
+        else if (nullptr != (value = MatchName(name, "instructions")))
+        {
+            if (nullptr != (value_end = ParseBool(value, flag)))
+            {
+                parameters.setInstructionFlag(flag);
+                return value_end;
+            }
+        }
+        else if (nullptr != (value = MatchName(name, "geometry")))
+        {
+            if (nullptr != (value_end = ParseBool(value, flag)))
+            {
+                parameters.setGeometryFlag(flag);
+                return value_end;
+            }
+        }
+        else if (nullptr != (value = MatchName(name, "alt")))
+        {
+            if (nullptr != (value_end = ParseBool(value, flag)))
+            {
+                parameters.setAlternateRouteFlag(flag);
+                return value_end;
+            }
+        }
+        else if (nullptr != (value = MatchName(name, "alternatives")))
+        {
+            unsigned number_of_alternatives = 0;
+            if (nullptr != (value_end = ParseInteger(value, number_of_alternatives, false)))
+            {
+                parameters.setNumberOfAlternatives(number_of_alternatives);
+                return value_end;
+            }
+        }
+        else if (nullptr != (value = MatchName(name, "time")))
+        {
+            unsigned time_bound = 0;
+            if (nullptr != (value_end = ParseInteger(value, time_bound, false)))
+            {
+                parameters.setTimeBound(time_bound);
+                return value_end;
+            }
+        }
+        else if (nullptr != (value = MatchName(name, "number")))
+        {
+            unsigned number_of_results = 0;
+            if (nullptr != (value_end = ParseInteger(value, number_of_results, false)))
+            {
+                parameters.setNumberOfResults(number_of_results);
+                return value_end;
+            }
+        }
+        else if (nullptr != (value = MatchName(name, "radius")))
+        {
+            double radius = 0.;
+            if (nullptr != (value_end = ParseDouble(value, radius)))
+            {
+                parameters.setRadius(radius);
+                return value_end;
+            }
+        }
+        else if (nullptr != (value = MatchName(name, "geomformat")))
+        {
+            if (value != (value_end = SkipLetters(value)))
+            {
+                parameters.setDeprecatedAPIFlag(std::string(value, value_end));
+                return value_end;
+            }
+        }
+        else if (nullptr != (value = MatchName(name, "timeout")))
+        {
+            unsigned timeout = 0;
+            if (nullptr != (value_end = ParseInteger(value, timeout, false)))
+            {
+                parameters.setTimeout(timeout);
+                return value_end;
+            }
+        }
+        return current;
+    }
+
+    const char *ParseUTurns(const char *current)
+    {
+        const char *name = (current != end && '&' == *current) ? current + 1 : current;
+        const char *value = MatchName(name, "uturns");
+        bool flag = false;
+        const char *value_end = nullptr;
+        if (nullptr != value && nullptr != (value_end = ParseBool(value, flag)))
+        {
+            parameters.setAllUTurns(flag);
+            return value_end;
+        }
+        return current;
+    }
+};
+
+#endif // API_PARSER_H
@@ -31,8 +31,6 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <boost/assert.hpp>
 #include <boost/bind.hpp>
-#include <boost/iostreams/filtering_stream.hpp>
-#include <boost/iostreams/filter/gzip.hpp>
 
 #include <string>
 #include <vector>
@@ -40,8 +38,11 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 namespace http
 {
 
-Connection::Connection(boost::asio::io_service &io_service, RequestHandler &handler)
-    : strand(io_service), TCP_socket(io_service), request_handler(handler)
+Connection::Connection(boost::asio::io_service &io_service,
+                       RequestHandler &handler,
+                       const CompressionSettings &compression_settings)
+    : strand(io_service), TCP_socket(io_service), request_handler(handler),
+      compression_settings(compression_settings), compression_type(noCompression)
 {
 }
 
@@ -65,8 +66,8 @@ void Connection::handle_read(const boost::system::error_code &error, std::size_t
         return;
     }
 
-    // no error detected, let's parse the request
-    CompressionType compression_type(noCompression);
+    // no error detected, let's parse the request. a request may span several reads,
+    // so the negotiated compression type lives as long as the connection
     boost::tribool result;
     boost::tie(result, boost::tuples::ignore) =
         request_parser.Parse(request,
@@ -80,34 +81,31 @@ void Connection::handle_read(const boost::system::error_code &error, std::size_t
         request.endpoint = TCP_socket.remote_endpoint().address();
         request_handler.handle_request(request, reply);
 
-        // Header compression_header;
-        std::vector<char> compressed_output;
         std::vector<boost::asio::const_buffer> output_buffer;
 
+        // small responses are not worth the effort of compressing them
+        if (reply.content.size() < compression_settings.min_size)
+        {
+            compression_type = noCompression;
+        }
+
         // compress the result w/ gzip/deflate if requested
-        switch (compression_type)
+        if (noCompression != compression_type &&
+            DeflateContext::GetThreadLocalContext(compression_settings.level)
+                .Compress(reply.content, compression_type, compressed_output))
         {
-        case deflateRFC1951:
-            // use deflate for compression
-            reply.headers.insert(reply.headers.begin(), {"Content-Encoding", "deflate"});
-            CompressBufferCollection(reply.content, compression_type, compressed_output);
-            reply.SetSize(static_cast<unsigned>(compressed_output.size()));
-            output_buffer = reply.HeaderstoBuffers();
-            output_buffer.push_back(boost::asio::buffer(compressed_output));
-            break;
-        case gzipRFC1952:
-            // use gzip for compression
-            reply.headers.insert(reply.headers.begin(), {"Content-Encoding", "gzip"});
-            CompressBufferCollection(reply.content, compression_type, compressed_output);
-            reply.SetSize(static_cast<unsigned>(compressed_output.size()));
+            reply.headers.insert(
+                reply.headers.begin(),
+                {"Content-Encoding", (gzipRFC1952 == compression_type ? "gzip" : "deflate")});
+            reply.SetSize(static_cast<unsigned>(compressed_output.Size()));
             output_buffer = reply.HeaderstoBuffers();
-            output_buffer.push_back(boost::asio::buffer(compressed_output));
-            break;
-        case noCompression:
+            compressed_output.AppendBuffers(output_buffer);
+        }
+        else
+        {
             // don't use any compression
             reply.SetUncompressedSize();
             output_buffer = reply.ToBuffers();
-            break;
         }
         // write result to stream
         boost::asio::async_write(TCP_socket,
@@ -148,27 +146,4 @@ void Connection::handle_write(const boost::system::error_code &error)
         TCP_socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignore_error);
     }
 }
-
-void Connection::CompressBufferCollection(std::vector<char> uncompressed_data,
-                                          CompressionType compression_type,
-                                          std::vector<char> &compressed_data)
-{
-    boost::iostreams::gzip_params compression_parameters;
-
-    // there's a trade-off between speed and size. speed wins
-    compression_parameters.level = boost::iostreams::zlib::best_speed;
-    // check which compression flavor is used
-    if (deflateRFC1951 == compression_type)
-    {
-        compression_parameters.noheader = true;
-    }
-
-    BOOST_ASSERT(compressed_data.empty());
-    // plug data into boost's compression stream
-    boost::iostreams::filtering_ostream gzip_stream;
-    gzip_stream.push(boost::iostreams::gzip_compressor(compression_parameters));
-    gzip_stream.push(boost::iostreams::back_inserter(compressed_data));
-    gzip_stream.write(&uncompressed_data[0], uncompressed_data.size());
-    boost::iostreams::close(gzip_stream);
-}
 }
@@ -28,6 +28,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef CONNECTION_H
 #define CONNECTION_H
 
+#include "DeflateContext.h"
 #include "RequestParser.h"
 #include "Http/CompressionType.h"
 #include "Http/Request.h"
@@ -73,7 +74,9 @@ namespace http
 class Connection : public std::enable_shared_from_this<Connection>
 {
   public:
-    explicit Connection(boost::asio::io_service &io_service, RequestHandler &handler);
+    explicit Connection(boost::asio::io_service &io_service,
+                        RequestHandler &handler,
+                        const CompressionSettings &compression_settings);
     Connection(const Connection &) = delete;
     Connection() = delete;
 
@@ -88,17 +91,17 @@ class Connection : public std::enable_shared_from_this<Connection>
     /// Handle completion of a write operation.
     void handle_write(const boost::system::error_code &e);
 
-    void CompressBufferCollection(std::vector<char> uncompressed_data,
-                                  CompressionType compression_type,
-                                  std::vector<char> &compressed_data);
-
     boost::asio::io_service::strand strand;
     boost::asio::ip::tcp::socket TCP_socket;
     RequestHandler &request_handler;
+    const CompressionSettings &compression_settings;
     boost::array<char, 8192> incoming_data_buffer;
     Request request;
     RequestParser request_parser;
+    CompressionType compression_type;
     Reply reply;
+    // must outlive the asynchronous write of the reply
+    CompressedOutput compressed_output;
 };
 
 } // namespace http
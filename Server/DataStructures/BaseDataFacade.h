@@ -36,6 +36,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../../DataStructures/Range.h"
 #include "../../DataStructures/TurnInstructions.h"
 #include "../../Util/OSRMException.h"
+#include "../../Util/QueryDeadline.h"
 #include "../../Util/StringUtil.h"
 #include "../../typedefs.h"
 
@@ -103,7 +104,40 @@ template <class EdgeDataT> class BaseDataFacade
     virtual bool IncrementalFindPhantomNodeForCoordinate(const FixedPointCoordinate &input_coordinate,
                                               std::vector<PhantomNode> &resulting_phantom_node_vector,
                                               const unsigned zoom_level,
-                                              const unsigned number_of_results) = 0;
+                                              const unsigned number_of_results,
+                                              const QueryDeadline &deadline = QueryDeadline()) = 0;
+
+    // the number_of_results nearest phantom nodes closer than max_distance meters with their
+    // distances, closest first
+    virtual bool IncrementalFindPhantomNodeForCoordinateWithDistance(
+        const FixedPointCoordinate &input_coordinate,
+        std::vector<std::pair<PhantomNode, double>> &resulting_phantom_node_vector,
+        const unsigned zoom_level,
+        const unsigned number_of_results,
+        const float max_distance,
+        const QueryDeadline &deadline = QueryDeadline()) = 0;
+
+    // batches of the above, resulting_phantom_nodes[i] belongs to input_coordinates[i]
+    virtual void
+    IncrementalFindPhantomNodesForCoordinates(const std::vector<FixedPointCoordinate> &input_coordinates,
+                                              PhantomNodeArray &resulting_phantom_nodes,
+                                              const unsigned zoom_level,
+                                              const unsigned number_of_results,
+                                              const QueryDeadline &deadline = QueryDeadline()) = 0;
+
+    virtual void FindPhantomNodesForCoordinates(const std::vector<FixedPointCoordinate> &input_coordinates,
+                                                std::vector<PhantomNode> &resulting_phantom_nodes,
+                                                const unsigned zoom_level) = 0;
+
+    // hub labels are optional, without them distances are found by searching the graph
+    virtual bool HasHubLabels() const = 0;
+
+    virtual EdgeWeight GetHubLabelDistance(const NodeID source, const NodeID target) const = 0;
+
+    // nodes of the search graph ordered top-down by level, none if they were not loaded
+    virtual unsigned GetNumberOfLevelOrderedNodes() const = 0;
+
+    virtual NodeID GetLevelOrderedNode(const unsigned index) const = 0;
 
     virtual unsigned GetCheckSum() const = 0;
 
@@ -32,6 +32,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "BaseDataFacade.h"
 
+#include "../../DataStructures/HubLabels.h"
 #include "../../DataStructures/OriginalEdgeData.h"
 #include "../../DataStructures/QueryNode.h"
 #include "../../DataStructures/QueryEdge.h"
@@ -46,6 +47,11 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <osrm/Coordinate.h>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <atomic>
+
 template <class EdgeDataT> class InternalDataFacade : public BaseDataFacade<EdgeDataT>
 {
 
@@ -54,6 +60,9 @@ template <class EdgeDataT> class InternalDataFacade : public BaseDataFacade<Edge
     typedef StaticGraph<typename super::EdgeData> QueryGraph;
     typedef typename QueryGraph::InputEdge InputEdge;
     typedef typename super::RTreeLeaf RTreeLeaf;
+    // the r-trees of all threads view the tree nodes loaded once by the facade
+    typedef StaticRTree<RTreeLeaf, ShM<FixedPointCoordinate, false>::vector, true> RTree;
+    typedef typename RTree::TreeNode RTreeNode;
 
     InternalDataFacade() {}
 
@@ -71,11 +80,17 @@ template <class EdgeDataT> class InternalDataFacade : public BaseDataFacade<Edge
     ShM<unsigned, false>::vector m_geometry_indices;
     ShM<unsigned, false>::vector m_geometry_list;
 
-    boost::thread_specific_ptr<StaticRTree<RTreeLeaf, ShM<FixedPointCoordinate, false>::vector, false>>
-    m_static_rtree;
-    boost::filesystem::path ram_index_path;
+    // queries sharing the leaf cache of one r-tree when coordinates are looked up in batches
+    static const std::size_t RTREE_QUERIES_PER_BATCH = 32;
+
+    boost::thread_specific_ptr<RTree> m_static_rtree;
+    std::vector<RTreeNode> m_rtree_nodes;
+    std::shared_ptr<typename RTree::LeafCache> m_leaf_cache;
     boost::filesystem::path file_index_path;
+    boost::filesystem::path segment_data_path;
     RangeTable<16, false> m_name_table;
+    HubLabels<false> m_hub_labels;
+    ShM<NodeID, false>::vector m_level_ordered_nodes;
 
     void LoadTimestamp(const boost::filesystem::path &timestamp_path)
     {
@@ -194,15 +209,120 @@ template <class EdgeDataT> class InternalDataFacade : public BaseDataFacade<Edge
         geometry_stream.close();
     }
 
+    void LoadRTreeNodes(const boost::filesystem::path &ram_index_path)
+    {
+        if (0 == boost::filesystem::file_size(ram_index_path))
+        {
+            throw OSRMException("ram index file is empty");
+        }
+        boost::filesystem::ifstream tree_node_file(ram_index_path, std::ios::binary);
+
+        uint32_t tree_size = 0;
+        tree_node_file.read((char *)&tree_size, sizeof(uint32_t));
+        m_rtree_nodes.resize(tree_size);
+        if (tree_size > 0)
+        {
+            tree_node_file.read((char *)&m_rtree_nodes[0], sizeof(RTreeNode) * tree_size);
+        }
+        tree_node_file.close();
+    }
+
     void LoadRTree()
     {
         BOOST_ASSERT_MSG(!m_coordinate_list->empty(), "coordinates must be loaded before r-tree");
 
         m_static_rtree.reset(
-            new StaticRTree<RTreeLeaf>(ram_index_path, file_index_path, m_coordinate_list)
+            new RTree(m_rtree_nodes.data(),
+                      m_rtree_nodes.size(),
+                      file_index_path,
+                      segment_data_path,
+                      m_coordinate_list,
+                      m_leaf_cache)
         );
     }
 
+    // Sorts the queries by Hilbert value and answers runs of consecutive ones in parallel, each
+    // run on the r-tree of the thread that takes it, where it shares the leaves it loads. These
+    // r-trees only hold the file streams and search buffers of their thread.
+    template <class BatchFunctionT>
+    void RunRTreeQueryBatches(const std::vector<FixedPointCoordinate> &input_coordinates,
+                              const QueryDeadline &deadline,
+                              BatchFunctionT &&run_batch)
+    {
+        std::vector<uint32_t> query_order;
+        RTree::SortByHilbertValue(input_coordinates, query_order);
+
+        std::atomic<bool> timed_out(false);
+        tbb::parallel_for(
+            tbb::blocked_range<std::size_t>(0, query_order.size(), RTREE_QUERIES_PER_BATCH),
+            [&](const tbb::blocked_range<std::size_t> &range)
+            {
+                if (!m_static_rtree.get())
+                {
+                    LoadRTree();
+                }
+                // every task counts its own checks
+                const QueryDeadline task_deadline(deadline);
+                try
+                {
+                    run_batch(*m_static_rtree,
+                              query_order.data() + range.begin(),
+                              query_order.data() + range.end(),
+                              task_deadline);
+                }
+                catch (const QueryTimeoutException &)
+                {
+                    timed_out = true;
+                }
+            });
+
+        if (timed_out)
+        {
+            throw QueryTimeoutException();
+        }
+    }
+
+    void LoadNodeLevels(const boost::filesystem::path &levels_path)
+    {
+        boost::filesystem::ifstream levels_stream(levels_path, std::ios::binary);
+        unsigned check_sum = 0;
+        unsigned number_of_nodes = 0;
+        levels_stream.read((char *)&check_sum, sizeof(unsigned));
+        levels_stream.read((char *)&number_of_nodes, sizeof(unsigned));
+        if (!levels_stream || check_sum != m_check_sum || number_of_nodes != GetNumberOfNodes())
+        {
+            SimpleLogger().Write(logWARNING) << levels_path.string()
+                                             << " does not belong to the graph, ignoring it";
+            return;
+        }
+        m_level_ordered_nodes.resize(number_of_nodes);
+        if (number_of_nodes > 0)
+        {
+            levels_stream.read((char *)&m_level_ordered_nodes[0], number_of_nodes * sizeof(NodeID));
+        }
+    }
+
+    void LoadHubLabels(const boost::filesystem::path &hub_labels_path)
+    {
+        boost::filesystem::ifstream hub_labels_stream(hub_labels_path, std::ios::binary);
+        HubLabelFileHeader header;
+        hub_labels_stream.read((char *)&header, sizeof(HubLabelFileHeader));
+        if (!hub_labels_stream || header.check_sum != m_check_sum ||
+            header.number_of_nodes != GetNumberOfNodes())
+        {
+            SimpleLogger().Write(logWARNING) << hub_labels_path.string()
+                                             << " does not belong to the graph, ignoring it";
+            return;
+        }
+
+        HubLabels<false>::OffsetContainerT offsets(2 * header.number_of_nodes + 1);
+        HubLabels<false>::HubContainerT hubs(header.number_of_entries);
+        HubLabels<false>::DistanceContainerT distances(header.number_of_entries);
+        ReadHubLabels(hub_labels_stream, header, offsets.data(), hubs.data(), distances.data());
+        m_hub_labels = HubLabels<false>(offsets, hubs, distances);
+        SimpleLogger().Write() << "loaded " << header.number_of_entries << " hub label entries";
+    }
+
     void LoadStreetNames(const boost::filesystem::path &names_file)
     {
         boost::filesystem::ifstream name_stream(names_file, std::ios::binary);
@@ -228,7 +348,8 @@ template <class EdgeDataT> class InternalDataFacade : public BaseDataFacade<Edge
         m_static_rtree.reset();
     }
 
-    explicit InternalDataFacade(const ServerPaths &server_paths)
+    // leaf_cache_size is the number of megabytes of r-tree leaves shared by all threads
+    explicit InternalDataFacade(const ServerPaths &server_paths, const unsigned leaf_cache_size = 0)
     {
         // generate paths of data files
         if (server_paths.find("hsgrdata") == server_paths.end())
@@ -268,10 +389,16 @@ template <class EdgeDataT> class InternalDataFacade : public BaseDataFacade<Edge
         const boost::filesystem::path &timestamp_path = paths_iterator->second;
         paths_iterator = server_paths.find("ramindex");
         BOOST_ASSERT(server_paths.end() != paths_iterator);
-        ram_index_path = paths_iterator->second;
+        const boost::filesystem::path &ram_index_path = paths_iterator->second;
         paths_iterator = server_paths.find("fileindex");
         BOOST_ASSERT(server_paths.end() != paths_iterator);
         file_index_path = paths_iterator->second;
+        // only the leaf files of the current version come with a segment file
+        paths_iterator = server_paths.find("segmentdata");
+        if (server_paths.end() != paths_iterator)
+        {
+            segment_data_path = paths_iterator->second;
+        }
         paths_iterator = server_paths.find("nodesdata");
         BOOST_ASSERT(server_paths.end() != paths_iterator);
         const boost::filesystem::path &nodes_data_path = paths_iterator->second;
@@ -284,6 +411,8 @@ template <class EdgeDataT> class InternalDataFacade : public BaseDataFacade<Edge
         paths_iterator = server_paths.find("geometries");
         BOOST_ASSERT(server_paths.end() != paths_iterator);
         const boost::filesystem::path &geometries_path = paths_iterator->second;
+        const ServerPaths::const_iterator levels_iterator = server_paths.find("levels");
+        const ServerPaths::const_iterator hub_labels_iterator = server_paths.find("hublabels");
 
         // load data
         SimpleLogger().Write() << "loading graph data";
@@ -299,11 +428,29 @@ template <class EdgeDataT> class InternalDataFacade : public BaseDataFacade<Edge
         SimpleLogger().Write() << "loading r-tree";
         AssertPathExists(ram_index_path);
         AssertPathExists(file_index_path);
+        LoadRTreeNodes(ram_index_path);
+        if (0 < leaf_cache_size)
+        {
+            m_leaf_cache = std::make_shared<typename RTree::LeafCache>(
+                static_cast<std::size_t>(leaf_cache_size) << 20);
+        }
         SimpleLogger().Write() << "loading timestamp";
         LoadTimestamp(timestamp_path);
         SimpleLogger().Write() << "loading street names";
         AssertPathExists(names_data_path);
         LoadStreetNames(names_data_path);
+        if (server_paths.end() != levels_iterator &&
+            boost::filesystem::is_regular_file(levels_iterator->second))
+        {
+            SimpleLogger().Write() << "loading node levels";
+            LoadNodeLevels(levels_iterator->second);
+        }
+        if (server_paths.end() != hub_labels_iterator &&
+            boost::filesystem::is_regular_file(hub_labels_iterator->second))
+        {
+            SimpleLogger().Write() << "loading hub labels";
+            LoadHubLabels(hub_labels_iterator->second);
+        }
     }
 
     // search graph access
@@ -387,15 +534,99 @@ template <class EdgeDataT> class InternalDataFacade : public BaseDataFacade<Edge
     IncrementalFindPhantomNodeForCoordinate(const FixedPointCoordinate &input_coordinate,
                                             std::vector<PhantomNode> &resulting_phantom_node_vector,
                                             const unsigned zoom_level,
-                                            const unsigned number_of_results)
+                                            const unsigned number_of_results,
+                                            const QueryDeadline &deadline)
     {
         if (!m_static_rtree.get())
         {
             LoadRTree();
         }
 
-        return m_static_rtree->IncrementalFindPhantomNodeForCoordinate(
-            input_coordinate, resulting_phantom_node_vector, zoom_level, number_of_results);
+        return m_static_rtree->IncrementalFindPhantomNodeForCoordinate(input_coordinate,
+                                                                       resulting_phantom_node_vector,
+                                                                       zoom_level,
+                                                                       number_of_results,
+                                                                       deadline);
+    }
+
+    bool IncrementalFindPhantomNodeForCoordinateWithDistance(
+        const FixedPointCoordinate &input_coordinate,
+        std::vector<std::pair<PhantomNode, double>> &resulting_phantom_node_vector,
+        const unsigned zoom_level,
+        const unsigned number_of_results,
+        const float max_distance,
+        const QueryDeadline &deadline)
+    {
+        if (!m_static_rtree.get())
+        {
+            LoadRTree();
+        }
+
+        return m_static_rtree->IncrementalFindPhantomNodeForCoordinateWithDistance(
+            input_coordinate,
+            resulting_phantom_node_vector,
+            zoom_level,
+            number_of_results,
+            max_distance,
+            deadline);
+    }
+
+    void
+    IncrementalFindPhantomNodesForCoordinates(const std::vector<FixedPointCoordinate> &input_coordinates,
+                                              PhantomNodeArray &resulting_phantom_nodes,
+                                              const unsigned zoom_level,
+                                              const unsigned number_of_results,
+                                              const QueryDeadline &deadline)
+    {
+        resulting_phantom_nodes.clear();
+        resulting_phantom_nodes.resize(input_coordinates.size());
+        RunRTreeQueryBatches(input_coordinates,
+                             deadline,
+                             [&](RTree &rtree,
+                                 const uint32_t *query_begin,
+                                 const uint32_t *query_end,
+                                 const QueryDeadline &task_deadline)
+                             {
+            rtree.IncrementalFindPhantomNodesForCoordinates(input_coordinates,
+                                                            query_begin,
+                                                            query_end,
+                                                            resulting_phantom_nodes,
+                                                            zoom_level,
+                                                            number_of_results,
+                                                            task_deadline);
+        });
+    }
+
+    void FindPhantomNodesForCoordinates(const std::vector<FixedPointCoordinate> &input_coordinates,
+                                        std::vector<PhantomNode> &resulting_phantom_nodes,
+                                        const unsigned zoom_level)
+    {
+        resulting_phantom_nodes.clear();
+        resulting_phantom_nodes.resize(input_coordinates.size());
+        RunRTreeQueryBatches(input_coordinates,
+                             QueryDeadline(),
+                             [&](RTree &rtree,
+                                 const uint32_t *query_begin,
+                                 const uint32_t *query_end,
+                                 const QueryDeadline &)
+                             {
+            rtree.FindPhantomNodesForCoordinates(
+                input_coordinates, query_begin, query_end, resulting_phantom_nodes, zoom_level);
+        });
+    }
+
+    unsigned GetNumberOfLevelOrderedNodes() const { return m_level_ordered_nodes.size(); }
+
+    NodeID GetLevelOrderedNode(const unsigned index) const
+    {
+        return m_level_ordered_nodes[index];
+    }
+
+    bool HasHubLabels() const { return !m_hub_labels.empty(); }
+
+    EdgeWeight GetHubLabelDistance(const NodeID source, const NodeID target) const
+    {
+        return m_hub_labels.GetDistance(source, target);
     }
 
     unsigned GetCheckSum() const { return m_check_sum; }
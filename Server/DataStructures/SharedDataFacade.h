@@ -33,6 +33,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "BaseDataFacade.h"
 #include "SharedDataType.h"
 
+#include "../../DataStructures/HubLabels.h"
 #include "../../DataStructures/RangeTable.h"
 #include "../../DataStructures/StaticGraph.h"
 #include "../../DataStructures/StaticRTree.h"
@@ -40,7 +41,11 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../../Util/ProgramOptions.h"
 #include "../../Util/SimpleLogger.h"
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
 #include <algorithm>
+#include <atomic>
 #include <memory>
 
 template <class EdgeDataT> class SharedDataFacade : public BaseDataFacade<EdgeDataT>
@@ -55,6 +60,7 @@ template <class EdgeDataT> class SharedDataFacade : public BaseDataFacade<EdgeDa
     typedef typename RangeTable<16, true>::BlockT NameIndexBlock;
     typedef typename QueryGraph::InputEdge InputEdge;
     typedef typename super::RTreeLeaf RTreeLeaf;
+    typedef StaticRTree<RTreeLeaf, ShM<FixedPointCoordinate, true>::vector, true> RTree;
     typedef typename StaticRTree<RTreeLeaf, ShM<FixedPointCoordinate, true>::vector, true>::TreeNode
     RTreeNode;
 
@@ -83,11 +89,18 @@ template <class EdgeDataT> class SharedDataFacade : public BaseDataFacade<EdgeDa
     ShM<unsigned, true>::vector m_geometry_indices;
     ShM<unsigned, true>::vector m_geometry_list;
 
-    boost::thread_specific_ptr<StaticRTree<RTreeLeaf, ShM<FixedPointCoordinate, true>::vector, true>>
-    m_static_rtree;
+    // queries sharing the leaf cache of one r-tree when coordinates are looked up in batches
+    static const std::size_t RTREE_QUERIES_PER_BATCH = 32;
+
+    boost::thread_specific_ptr<RTree> m_static_rtree;
     boost::filesystem::path file_index_path;
+    boost::filesystem::path segment_data_path;
+    std::size_t m_leaf_cache_bytes;
+    std::shared_ptr<typename RTree::LeafCache> m_leaf_cache;
 
     std::shared_ptr<RangeTable<16, true>> m_name_table;
+    ShM<NodeID, true>::vector m_level_ordered_nodes;
+    std::shared_ptr<HubLabels<true>> m_hub_labels;
 
     void LoadChecksum()
     {
@@ -113,14 +126,57 @@ template <class EdgeDataT> class SharedDataFacade : public BaseDataFacade<EdgeDa
         RTreeNode *tree_ptr =
             data_layout->GetBlockPtr<RTreeNode>(shared_memory, SharedDataLayout::R_SEARCH_TREE);
         m_static_rtree.reset(
-            new StaticRTree<RTreeLeaf, ShM<FixedPointCoordinate, true>::vector, true>(
-                tree_ptr,
-                data_layout->num_entries[SharedDataLayout::R_SEARCH_TREE],
-                file_index_path,
-                m_coordinate_list)
+            new RTree(tree_ptr,
+                      data_layout->num_entries[SharedDataLayout::R_SEARCH_TREE],
+                      file_index_path,
+                      segment_data_path,
+                      m_coordinate_list,
+                      m_leaf_cache)
         );
     }
 
+    // Sorts the queries by Hilbert value and answers runs of consecutive ones in parallel, each
+    // run on the r-tree of the thread that takes it, where it shares the leaves it loads. These
+    // r-trees view the tree nodes in shared memory and only hold the file streams and search
+    // buffers of their thread.
+    template <class BatchFunctionT>
+    void RunRTreeQueryBatches(const std::vector<FixedPointCoordinate> &input_coordinates,
+                              const QueryDeadline &deadline,
+                              BatchFunctionT &&run_batch)
+    {
+        std::vector<uint32_t> query_order;
+        RTree::SortByHilbertValue(input_coordinates, query_order);
+
+        std::atomic<bool> timed_out(false);
+        tbb::parallel_for(
+            tbb::blocked_range<std::size_t>(0, query_order.size(), RTREE_QUERIES_PER_BATCH),
+            [&](const tbb::blocked_range<std::size_t> &range)
+            {
+                if (!m_static_rtree.get())
+                {
+                    LoadRTree();
+                }
+                // every task counts its own checks
+                const QueryDeadline task_deadline(deadline);
+                try
+                {
+                    run_batch(*m_static_rtree,
+                              query_order.data() + range.begin(),
+                              query_order.data() + range.end(),
+                              task_deadline);
+                }
+                catch (const QueryTimeoutException &)
+                {
+                    timed_out = true;
+                }
+            });
+
+        if (timed_out)
+        {
+            throw QueryTimeoutException();
+        }
+    }
+
     void LoadGraph()
     {
         m_number_of_nodes = data_layout->num_entries[SharedDataLayout::GRAPH_NODE_LIST];
@@ -211,10 +267,48 @@ template <class EdgeDataT> class SharedDataFacade : public BaseDataFacade<EdgeDa
         m_geometry_list.swap(geometry_list);
     }
 
+    void LoadNodeLevels()
+    {
+        if (0 == data_layout->num_entries[SharedDataLayout::LEVEL_ORDERED_NODES])
+        {
+            m_level_ordered_nodes = ShM<NodeID, true>::vector();
+            return;
+        }
+        NodeID *level_ordered_nodes_ptr =
+            data_layout->GetBlockPtr<NodeID>(shared_memory, SharedDataLayout::LEVEL_ORDERED_NODES);
+        typename ShM<NodeID, true>::vector level_ordered_nodes(
+            level_ordered_nodes_ptr, data_layout->num_entries[SharedDataLayout::LEVEL_ORDERED_NODES]);
+        m_level_ordered_nodes.swap(level_ordered_nodes);
+    }
+
+    void LoadHubLabels()
+    {
+        if (0 == data_layout->num_entries[SharedDataLayout::HUB_LABEL_OFFSETS])
+        {
+            m_hub_labels = std::make_shared<HubLabels<true>>();
+            return;
+        }
+        unsigned *offsets_ptr =
+            data_layout->GetBlockPtr<unsigned>(shared_memory, SharedDataLayout::HUB_LABEL_OFFSETS);
+        NodeID *hubs_ptr =
+            data_layout->GetBlockPtr<NodeID>(shared_memory, SharedDataLayout::HUB_LABEL_HUBS);
+        EdgeWeight *distances_ptr = data_layout->GetBlockPtr<EdgeWeight>(
+            shared_memory, SharedDataLayout::HUB_LABEL_DISTANCES);
+        typename ShM<unsigned, true>::vector offsets(
+            offsets_ptr, data_layout->num_entries[SharedDataLayout::HUB_LABEL_OFFSETS]);
+        typename ShM<NodeID, true>::vector hubs(
+            hubs_ptr, data_layout->num_entries[SharedDataLayout::HUB_LABEL_HUBS]);
+        typename ShM<EdgeWeight, true>::vector distances(
+            distances_ptr, data_layout->num_entries[SharedDataLayout::HUB_LABEL_DISTANCES]);
+        m_hub_labels = std::make_shared<HubLabels<true>>(offsets, hubs, distances);
+    }
+
   public:
     virtual ~SharedDataFacade() {}
 
-    SharedDataFacade()
+    // leaf_cache_size is the number of megabytes of r-tree leaves shared by all threads
+    explicit SharedDataFacade(const unsigned leaf_cache_size = 0)
+        : m_leaf_cache_bytes(static_cast<std::size_t>(leaf_cache_size) << 20)
     {
         data_timestamp_ptr = (SharedDataTimestamp *)SharedMemoryFactory::Get(
                                  CURRENT_REGIONS, sizeof(SharedDataTimestamp), false, false)->Ptr();
@@ -257,6 +351,13 @@ template <class EdgeDataT> class SharedDataFacade : public BaseDataFacade<EdgeDa
                 throw OSRMException("Could not load leaf index file."
                                     "Is any data loaded into shared memory?");
             }
+            segment_data_path = boost::filesystem::path(
+                data_layout->GetBlockPtr<char>(shared_memory, SharedDataLayout::SEGMENT_DATA_PATH));
+            // leaves of the previous data must not be served for the new one
+            if (0 < m_leaf_cache_bytes)
+            {
+                m_leaf_cache = std::make_shared<typename RTree::LeafCache>(m_leaf_cache_bytes);
+            }
 
             LoadGraph();
             LoadChecksum();
@@ -265,6 +366,8 @@ template <class EdgeDataT> class SharedDataFacade : public BaseDataFacade<EdgeDa
             LoadTimestamp();
             LoadViaNodeList();
             LoadNames();
+            LoadNodeLevels();
+            LoadHubLabels();
 
             data_layout->PrintInformation();
 
@@ -378,15 +481,99 @@ template <class EdgeDataT> class SharedDataFacade : public BaseDataFacade<EdgeDa
     IncrementalFindPhantomNodeForCoordinate(const FixedPointCoordinate &input_coordinate,
                                             std::vector<PhantomNode> &resulting_phantom_node_vector,
                                             const unsigned zoom_level,
-                                            const unsigned number_of_results)
+                                            const unsigned number_of_results,
+                                            const QueryDeadline &deadline)
     {
         if (!m_static_rtree.get())
         {
             LoadRTree();
         }
 
-        return m_static_rtree->IncrementalFindPhantomNodeForCoordinate(
-            input_coordinate, resulting_phantom_node_vector, zoom_level, number_of_results);
+        return m_static_rtree->IncrementalFindPhantomNodeForCoordinate(input_coordinate,
+                                                                       resulting_phantom_node_vector,
+                                                                       zoom_level,
+                                                                       number_of_results,
+                                                                       deadline);
+    }
+
+    bool IncrementalFindPhantomNodeForCoordinateWithDistance(
+        const FixedPointCoordinate &input_coordinate,
+        std::vector<std::pair<PhantomNode, double>> &resulting_phantom_node_vector,
+        const unsigned zoom_level,
+        const unsigned number_of_results,
+        const float max_distance,
+        const QueryDeadline &deadline)
+    {
+        if (!m_static_rtree.get())
+        {
+            LoadRTree();
+        }
+
+        return m_static_rtree->IncrementalFindPhantomNodeForCoordinateWithDistance(
+            input_coordinate,
+            resulting_phantom_node_vector,
+            zoom_level,
+            number_of_results,
+            max_distance,
+            deadline);
+    }
+
+    void
+    IncrementalFindPhantomNodesForCoordinates(const std::vector<FixedPointCoordinate> &input_coordinates,
+                                              PhantomNodeArray &resulting_phantom_nodes,
+                                              const unsigned zoom_level,
+                                              const unsigned number_of_results,
+                                              const QueryDeadline &deadline)
+    {
+        resulting_phantom_nodes.clear();
+        resulting_phantom_nodes.resize(input_coordinates.size());
+        RunRTreeQueryBatches(input_coordinates,
+                             deadline,
+                             [&](RTree &rtree,
+                                 const uint32_t *query_begin,
+                                 const uint32_t *query_end,
+                                 const QueryDeadline &task_deadline)
+                             {
+            rtree.IncrementalFindPhantomNodesForCoordinates(input_coordinates,
+                                                            query_begin,
+                                                            query_end,
+                                                            resulting_phantom_nodes,
+                                                            zoom_level,
+                                                            number_of_results,
+                                                            task_deadline);
+        });
+    }
+
+    void FindPhantomNodesForCoordinates(const std::vector<FixedPointCoordinate> &input_coordinates,
+                                        std::vector<PhantomNode> &resulting_phantom_nodes,
+                                        const unsigned zoom_level)
+    {
+        resulting_phantom_nodes.clear();
+        resulting_phantom_nodes.resize(input_coordinates.size());
+        RunRTreeQueryBatches(input_coordinates,
+                             QueryDeadline(),
+                             [&](RTree &rtree,
+                                 const uint32_t *query_begin,
+                                 const uint32_t *query_end,
+                                 const QueryDeadline &)
+                             {
+            rtree.FindPhantomNodesForCoordinates(
+                input_coordinates, query_begin, query_end, resulting_phantom_nodes, zoom_level);
+        });
+    }
+
+    unsigned GetNumberOfLevelOrderedNodes() const { return m_level_ordered_nodes.size(); }
+
+    NodeID GetLevelOrderedNode(const unsigned index) const
+    {
+        return m_level_ordered_nodes[index];
+    }
+
+    bool HasHubLabels() const { return !m_hub_labels->empty(); }
+
+    EdgeWeight GetHubLabelDistance(const NodeID source, const NodeID target) const
+    {
+        return m_hub_labels->GetDistance(source, target);
     }
 
     unsigned GetCheckSum() const { return m_check_sum; }
@@ -54,9 +54,14 @@ struct SharedDataLayout
         GEOMETRIES_INDEX,
         GEOMETRIES_LIST,
         GEOMETRIES_INDICATORS,
+        LEVEL_ORDERED_NODES,
+        HUB_LABEL_OFFSETS,
+        HUB_LABEL_HUBS,
+        HUB_LABEL_DISTANCES,
         HSGR_CHECKSUM,
         TIMESTAMP,
         FILE_INDEX_PATH,
+        SEGMENT_DATA_PATH,
         NUM_BLOCKS
     };
 
@@ -87,6 +92,9 @@ struct SharedDataLayout
                                        << "/" << ((num_entries[GEOMETRIES_INDICATORS] / 8) + 1);
         SimpleLogger().Write(logDEBUG) << "geometries_index_list_size: " << num_entries[GEOMETRIES_INDEX];
         SimpleLogger().Write(logDEBUG) << "geometries_list_size:       " << num_entries[GEOMETRIES_LIST];
+        SimpleLogger().Write(logDEBUG) << "level_ordered_nodes_size:   " << num_entries[LEVEL_ORDERED_NODES];
+        SimpleLogger().Write(logDEBUG) << "hub_label_offsets_size:     " << num_entries[HUB_LABEL_OFFSETS];
+        SimpleLogger().Write(logDEBUG) << "hub_label_entries_size:     " << num_entries[HUB_LABEL_HUBS];
         SimpleLogger().Write(logDEBUG) << "sizeof(checksum):           " << entry_size[HSGR_CHECKSUM];
 
         SimpleLogger().Write(logDEBUG) << "NAME_OFFSETS         " << ": " << GetBlockSize(NAME_OFFSETS         );
@@ -102,9 +110,14 @@ struct SharedDataLayout
         SimpleLogger().Write(logDEBUG) << "GEOMETRIES_INDEX     " << ": " << GetBlockSize(GEOMETRIES_INDEX     );
         SimpleLogger().Write(logDEBUG) << "GEOMETRIES_LIST      " << ": " << GetBlockSize(GEOMETRIES_LIST      );
         SimpleLogger().Write(logDEBUG) << "GEOMETRIES_INDICATORS" << ": " << GetBlockSize(GEOMETRIES_INDICATORS);
+        SimpleLogger().Write(logDEBUG) << "LEVEL_ORDERED_NODES  " << ": " << GetBlockSize(LEVEL_ORDERED_NODES  );
+        SimpleLogger().Write(logDEBUG) << "HUB_LABEL_OFFSETS    " << ": " << GetBlockSize(HUB_LABEL_OFFSETS    );
+        SimpleLogger().Write(logDEBUG) << "HUB_LABEL_HUBS       " << ": " << GetBlockSize(HUB_LABEL_HUBS       );
+        SimpleLogger().Write(logDEBUG) << "HUB_LABEL_DISTANCES  " << ": " << GetBlockSize(HUB_LABEL_DISTANCES  );
         SimpleLogger().Write(logDEBUG) << "HSGR_CHECKSUM        " << ": " << GetBlockSize(HSGR_CHECKSUM        );
         SimpleLogger().Write(logDEBUG) << "TIMESTAMP            " << ": " << GetBlockSize(TIMESTAMP            );
         SimpleLogger().Write(logDEBUG) << "FILE_INDEX_PATH      " << ": " << GetBlockSize(FILE_INDEX_PATH      );
+        SimpleLogger().Write(logDEBUG) << "SEGMENT_DATA_PATH    " << ": " << GetBlockSize(SEGMENT_DATA_PATH    );
     }
 
     template<typename T>
@@ -0,0 +1,194 @@
+/*
+
+Copyright (c) 2014, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "DeflateContext.h"
+
+#include "../Util/OSRMException.h"
+
+#include <boost/assert.hpp>
+#include <boost/thread/tss.hpp>
+
+#include <mutex>
+
+namespace http
+{
+
+namespace
+{
+// keeps at most 16 MB of idle chunks around
+const std::size_t MAX_POOLED_CHUNKS = 1024;
+
+std::mutex chunk_pool_mutex;
+std::vector<std::unique_ptr<CompressedOutput::Chunk>> chunk_pool;
+
+boost::thread_specific_ptr<DeflateContext> thread_local_context;
+
+void InitializeStream(z_stream &stream, const int level, const int window_bits)
+{
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    if (Z_OK != deflateInit2(&stream, level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY))
+    {
+        throw OSRMException("could not initialize zlib stream");
+    }
+}
+}
+
+CompressedOutput::~CompressedOutput() { Clear(); }
+
+void CompressedOutput::Clear()
+{
+    {
+        std::lock_guard<std::mutex> lock(chunk_pool_mutex);
+        for (std::unique_ptr<Chunk> &chunk : chunks)
+        {
+            if (chunk_pool.size() >= MAX_POOLED_CHUNKS)
+            {
+                break;
+            }
+            chunk_pool.emplace_back(std::move(chunk));
+        }
+    }
+    chunks.clear();
+    last_chunk_size = 0;
+}
+
+std::size_t CompressedOutput::Size() const
+{
+    if (chunks.empty())
+    {
+        return 0;
+    }
+    return (chunks.size() - 1) * CHUNK_SIZE + last_chunk_size;
+}
+
+void CompressedOutput::AppendBuffers(std::vector<boost::asio::const_buffer> &buffers) const
+{
+    for (std::size_t i = 0; i < chunks.size(); ++i)
+    {
+        const std::size_t chunk_size = (i + 1 == chunks.size() ? last_chunk_size : CHUNK_SIZE);
+        buffers.push_back(boost::asio::buffer(chunks[i]->data(), chunk_size));
+    }
+}
+
+CompressedOutput::Chunk &CompressedOutput::AddChunk()
+{
+    std::unique_ptr<Chunk> chunk;
+    {
+        std::lock_guard<std::mutex> lock(chunk_pool_mutex);
+        if (!chunk_pool.empty())
+        {
+            chunk = std::move(chunk_pool.back());
+            chunk_pool.pop_back();
+        }
+    }
+    if (!chunk)
+    {
+        chunk.reset(new Chunk);
+    }
+    chunks.emplace_back(std::move(chunk));
+    last_chunk_size = 0;
+    return *chunks.back();
+}
+
+DeflateContext::DeflateContext(const int level) : level(level)
+{
+    // window bits of 15+16 make zlib write a gzip header, negative ones a raw deflate stream
+    InitializeStream(gzip_stream, level, 15 + 16);
+    InitializeStream(deflate_stream, level, -15);
+}
+
+DeflateContext::~DeflateContext()
+{
+    deflateEnd(&gzip_stream);
+    deflateEnd(&deflate_stream);
+}
+
+DeflateContext &DeflateContext::GetThreadLocalContext(const int level)
+{
+    if (!thread_local_context.get())
+    {
+        thread_local_context.reset(new DeflateContext(level));
+    }
+    thread_local_context->SetLevel(level);
+    return *thread_local_context;
+}
+
+void DeflateContext::SetLevel(const int new_level)
+{
+    if (level == new_level)
+    {
+        return;
+    }
+    // reset streams hold no pending output, so the new level takes effect right away
+    for (z_stream *stream : {&gzip_stream, &deflate_stream})
+    {
+        deflateReset(stream);
+        if (Z_OK != deflateParams(stream, new_level, Z_DEFAULT_STRATEGY))
+        {
+            throw OSRMException("could not change the zlib compression level");
+        }
+    }
+    level = new_level;
+}
+
+bool DeflateContext::Compress(const std::vector<char> &input,
+                              const CompressionType compression_type,
+                              CompressedOutput &output)
+{
+    BOOST_ASSERT(noCompression != compression_type);
+    BOOST_ASSERT(0 == output.Size());
+
+    z_stream &stream = (gzipRFC1952 == compression_type ? gzip_stream : deflate_stream);
+    deflateReset(&stream);
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+    stream.avail_in = static_cast<uInt>(input.size());
+
+    int result = Z_OK;
+    while (Z_OK == result)
+    {
+        if (output.chunks.empty() || CompressedOutput::CHUNK_SIZE == output.last_chunk_size)
+        {
+            output.AddChunk();
+        }
+        CompressedOutput::Chunk &chunk = *output.chunks.back();
+        const std::size_t free_space = CompressedOutput::CHUNK_SIZE - output.last_chunk_size;
+        stream.next_out = reinterpret_cast<Bytef *>(chunk.data() + output.last_chunk_size);
+        stream.avail_out = static_cast<uInt>(free_space);
+        result = deflate(&stream, Z_FINISH);
+        output.last_chunk_size += free_space - stream.avail_out;
+    }
+
+    if (Z_STREAM_END != result)
+    {
+        output.Clear();
+        return false;
+    }
+    return true;
+}
+}
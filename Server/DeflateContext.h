@@ -0,0 +1,96 @@
+/*
+
+Copyright (c) 2014, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef DEFLATE_CONTEXT_H
+#define DEFLATE_CONTEXT_H
+
+#include "Http/CompressionType.h"
+
+#include <boost/asio.hpp>
+
+#include <zlib.h>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace http
+{
+
+// Compressed output is written into fixed-size chunks that are recycled through a
+// process-wide free list. A response is sent as one scatter-gather buffer per chunk.
+class CompressedOutput
+{
+  public:
+    static const std::size_t CHUNK_SIZE = 16 * 1024;
+    typedef std::array<char, CHUNK_SIZE> Chunk;
+
+    CompressedOutput() : last_chunk_size(0) {}
+    CompressedOutput(const CompressedOutput &) = delete;
+    ~CompressedOutput();
+
+    void Clear();
+    std::size_t Size() const;
+    void AppendBuffers(std::vector<boost::asio::const_buffer> &buffers) const;
+
+  private:
+    friend class DeflateContext;
+
+    // hands out a chunk with CHUNK_SIZE bytes of free space
+    Chunk &AddChunk();
+
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    std::size_t last_chunk_size;
+};
+
+// Owns one z_stream per compression flavor. Streams are set up once per thread and
+// rewound with deflateReset() for every response instead of being reallocated.
+class DeflateContext
+{
+  public:
+    explicit DeflateContext(const int level);
+    DeflateContext(const DeflateContext &) = delete;
+    ~DeflateContext();
+
+    // the context of the calling thread, switched to level if it was used with another one
+    static DeflateContext &GetThreadLocalContext(const int level);
+
+    // returns false if zlib failed, output is left empty in that case
+    bool Compress(const std::vector<char> &input,
+                  const CompressionType compression_type,
+                  CompressedOutput &output);
+
+  private:
+    void SetLevel(const int new_level);
+
+    int level;
+    z_stream gzip_stream;
+    z_stream deflate_stream;
+};
+}
+
+#endif // DEFLATE_CONTEXT_H
@@ -36,6 +36,20 @@ enum CompressionType
   gzipRFC1952,
   deflateRFC1951 };
 
+struct CompressionSettings
+{
+    CompressionSettings() : level(1), min_size(0) {}
+    CompressionSettings(const int level, const unsigned min_size)
+        : level(level), min_size(min_size)
+    {
+    }
+
+    // zlib compression level, 0 (none) to 9 (best)
+    int level;
+    // responses smaller than this many bytes are sent uncompressed
+    unsigned min_size;
+};
+
 } // namespace http
 
 #endif // COMPRESSION_TYPE_H
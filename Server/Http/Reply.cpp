@@ -103,6 +103,10 @@ std::string Reply::ToString(Reply::status_type status)
     {
         return badRequestHTML;
     }
+    if (Reply::serviceUnavailable == status)
+    {
+        return serviceUnavailableHTML;
+    }
     return internalServerErrorHTML;
 }
 
@@ -116,6 +120,10 @@ boost::asio::const_buffer Reply::ToBuffer(Reply::status_type status)
     {
         return boost::asio::buffer(internalServerErrorString);
     }
+    if (Reply::serviceUnavailable == status)
+    {
+        return boost::asio::buffer(serviceUnavailableString);
+    }
     return boost::asio::buffer(badRequestString);
 }
 
@@ -37,9 +37,11 @@ namespace http
 
 struct Request
 {
+    std::string method;
     std::string uri;
     std::string referrer;
     std::string agent;
+    std::string body;
     boost::asio::ip::address endpoint;
 };
 
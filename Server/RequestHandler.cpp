@@ -25,7 +25,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 */
 
-#include "APIGrammar.h"
+#include "APIParser.h"
 #include "RequestHandler.h"
 #include "Http/Request.h"
 
@@ -38,20 +38,25 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <osrm/Reply.h>
 #include <osrm/RouteParameters.h>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
 #include <ctime>
 
 #include <algorithm>
 #include <iostream>
+#include <string>
+#include <vector>
 
 RequestHandler::RequestHandler() : routing_machine(nullptr) {}
 
-void RequestHandler::handle_request(const http::Request &req, http::Reply &reply)
+void RequestHandler::handle_request(http::Request &req, http::Reply &reply)
 {
     // parse command
     try
     {
-        std::string request;
-        URIDecode(req.uri, request);
+        APIParser::DecodeInPlace(req.uri);
+        const std::string &request = req.uri;
 
         // deactivated as GCC apparently does not implement that, not even in 4.9
         // std::time_t t = std::time(nullptr);
@@ -76,22 +81,25 @@ void RequestHandler::handle_request(const http::Request &req, http::Reply &reply
                                << (0 == req.referrer.length() ? "- " : " ") << req.agent
                                << (0 == req.agent.length() ? "- " : " ") << request;
 
-        RouteParameters route_parameters;
-        APIGrammarParser api_parser(&route_parameters);
+        if ("POST" == req.method)
+        {
+            HandleBatchRequest(request, req.body, reply);
+            return;
+        }
 
-        auto iter = request.begin();
-        const bool result = boost::spirit::qi::parse(iter, request.end(), api_parser);
+        RouteParameters route_parameters;
+        APIParser api_parser(route_parameters);
+        const std::size_t position = api_parser.Parse(request);
 
         // check if the was an error with the request
-        if (!result || (iter != request.end()))
+        if (position != request.size())
         {
             reply = http::Reply::StockReply(http::Reply::badRequest);
             reply.content.clear();
-            const unsigned position = static_cast<unsigned>(std::distance(request.begin(), iter));
             JSON::Object json_result;
             json_result.values["status"] = 400;
             std::string message = "Query string malformed close to position ";
-            message += UintToString(position);
+            message += UintToString(static_cast<unsigned>(position));
             json_result.values["status_message"] = message;
             JSON::render(reply.content, json_result);
             return;
@@ -100,6 +108,12 @@ void RequestHandler::handle_request(const http::Request &req, http::Reply &reply
         // parsing done, lets call the right plugin to handle the request
         BOOST_ASSERT_MSG(routing_machine != nullptr, "pointer not init'ed");
 
+        // binary output can't be wrapped into a jsonp call
+        if ("binary" == route_parameters.output_format)
+        {
+            route_parameters.jsonp_parameter.clear();
+        }
+
         if (!route_parameters.jsonp_parameter.empty())
         { // prepend response with jsonp parameter
             const std::string json_p = (route_parameters.jsonp_parameter + "(");
@@ -119,6 +133,11 @@ void RequestHandler::handle_request(const http::Request &req, http::Reply &reply
             reply.headers.emplace_back("Content-Type", "application/gpx+xml; charset=UTF-8");
             reply.headers.emplace_back("Content-Disposition", "attachment; filename=\"route.gpx\"");
         }
+        else if ("binary" == route_parameters.output_format && http::Reply::ok == reply.status)
+        { // compact binary encoding, errors keep their JSON body and are labelled as such
+            reply.headers.emplace_back("Content-Type", "application/octet-stream");
+            reply.headers.emplace_back("Content-Disposition", "attachment; filename=\"response.bin\"");
+        }
         else if (route_parameters.jsonp_parameter.empty())
         { // json file
             reply.headers.emplace_back("Content-Type", "application/json; charset=UTF-8");
@@ -139,4 +158,102 @@ void RequestHandler::handle_request(const http::Request &req, http::Reply &reply
     }
 }
 
+// A batch carries one query per line of the POST body, each in the same form as the
+// URI of a GET request, e.g. /viaroute?loc=52.5,13.4&loc=52.6,13.3. The queries are
+// independent of each other and run in parallel. The reply is a JSON array that holds
+// the individual results in the order in which the queries were submitted. A batch of
+// more than MAX_BATCH_QUERIES queries is rejected as a whole.
+void RequestHandler::HandleBatchRequest(const std::string &uri,
+                                        const std::string &body,
+                                        http::Reply &reply)
+{
+    if ("/batch" != uri)
+    {
+        reply = http::Reply::StockReply(http::Reply::badRequest);
+        return;
+    }
+
+    std::vector<std::string> queries;
+    std::string::size_type line_start = 0;
+    while (line_start < body.size())
+    {
+        std::string::size_type line_end = body.find('\n', line_start);
+        if (std::string::npos == line_end)
+        {
+            line_end = body.size();
+        }
+        std::string query = body.substr(line_start, line_end - line_start);
+        if (!query.empty() && '\r' == query.back())
+        {
+            query.pop_back();
+        }
+        if (!query.empty())
+        {
+            if (MAX_BATCH_QUERIES == queries.size())
+            {
+                reply = http::Reply::StockReply(http::Reply::badRequest);
+                return;
+            }
+            queries.emplace_back(std::move(query));
+        }
+        line_start = line_end + 1;
+    }
+
+    BOOST_ASSERT_MSG(routing_machine != nullptr, "pointer not init'ed");
+    std::vector<http::Reply> replies(queries.size());
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, queries.size()),
+                      [&](const tbb::blocked_range<std::size_t> &range)
+                      {
+        for (std::size_t i = range.begin(); i != range.end(); ++i)
+        {
+            RunBatchQuery(queries[i], replies[i]);
+        }
+    });
+
+    reply.status = http::Reply::ok;
+    reply.content.push_back('[');
+    for (std::size_t i = 0; i < replies.size(); ++i)
+    {
+        if (0 != i)
+        {
+            reply.content.push_back(',');
+        }
+        reply.content.insert(
+            reply.content.end(), replies[i].content.begin(), replies[i].content.end());
+    }
+    reply.content.push_back(']');
+
+    reply.headers.emplace_back("Content-Length",
+                               UintToString(static_cast<unsigned>(reply.content.size())));
+    reply.headers.emplace_back("Content-Type", "application/json; charset=UTF-8");
+    reply.headers.emplace_back("Content-Disposition", "inline; filename=\"response.json\"");
+}
+
+void RequestHandler::RunBatchQuery(std::string &query, http::Reply &reply)
+{
+    try
+    {
+        APIParser::DecodeInPlace(query);
+
+        RouteParameters route_parameters;
+        APIParser api_parser(route_parameters);
+        const std::size_t position = api_parser.Parse(query);
+
+        // every result is embedded into a single JSON array, i.e. no gpx, binary or jsonp
+        if (position != query.size() || !route_parameters.jsonp_parameter.empty() ||
+            "gpx" == route_parameters.output_format || "binary" == route_parameters.output_format)
+        {
+            reply = http::Reply::StockReply(http::Reply::badRequest);
+            return;
+        }
+        routing_machine->RunQuery(route_parameters, reply);
+    }
+    catch (const std::exception &e)
+    {
+        reply = http::Reply::StockReply(http::Reply::internalServerError);
+        SimpleLogger().Write(logWARNING) << "[server error] code: " << e.what()
+                                         << ", batch query: " << query;
+    }
+}
+
 void RequestHandler::RegisterRoutingMachine(OSRM *osrm) { routing_machine = osrm; }
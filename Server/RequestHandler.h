@@ -28,9 +28,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef REQUEST_HANDLER_H
 #define REQUEST_HANDLER_H
 
+#include <cstddef>
 #include <string>
 
-template <typename Iterator, class HandlerT> struct APIGrammar;
 struct RouteParameters;
 class OSRM;
 
@@ -44,15 +44,19 @@ class RequestHandler
 {
 
   public:
-    typedef APIGrammar<std::string::iterator, RouteParameters> APIGrammarParser;
-
     RequestHandler();
     RequestHandler(const RequestHandler &) = delete;
 
-    void handle_request(const http::Request &req, http::Reply &rep);
+    void handle_request(http::Request &req, http::Reply &rep);
     void RegisterRoutingMachine(OSRM *osrm);
 
+    // upper bound on the number of queries in a batch, each has its own deadline only
+    static const std::size_t MAX_BATCH_QUERIES = 1000;
+
   private:
+    void HandleBatchRequest(const std::string &uri, const std::string &body, http::Reply &reply);
+    void RunBatchQuery(std::string &query, http::Reply &reply);
+
     OSRM *routing_machine;
 };
 
@@ -31,9 +31,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 namespace http
 {
 
-RequestParser::RequestParser() : state_(method_start), header({"", ""}) {}
+RequestParser::RequestParser() : state_(method_start), header({"", ""}), content_length(0) {}
 
-void RequestParser::Reset() { state_ = method_start; }
+void RequestParser::Reset()
+{
+    state_ = method_start;
+    content_length = 0;
+}
 
 boost::tuple<boost::tribool, char *>
 RequestParser::Parse(Request &req, char *begin, char *end, http::CompressionType *compression_type)
@@ -61,6 +65,7 @@ RequestParser::consume(Request &req, char input, http::CompressionType *compress
             return false;
         }
         state_ = method;
+        req.method.push_back(input);
         return boost::indeterminate;
     case method:
         if (input == ' ')
@@ -72,6 +77,7 @@ RequestParser::consume(Request &req, char input, http::CompressionType *compress
         {
             return false;
         }
+        req.method.push_back(input);
         return boost::indeterminate;
     case uri_start:
         if (isCTL(input))
@@ -195,6 +201,28 @@ RequestParser::consume(Request &req, char input, http::CompressionType *compress
             req.agent = header.value;
         }
 
+        if ("Content-Length" == header.name)
+        {
+            // digits only, checked against the limit after each one so it cannot overflow
+            if (header.value.empty())
+            {
+                return false;
+            }
+            content_length = 0;
+            for (const char digit : header.value)
+            {
+                if (!isDigit(digit))
+                {
+                    return false;
+                }
+                content_length = 10 * content_length + (digit - '0');
+                if (content_length > MAX_CONTENT_LENGTH)
+                {
+                    return false;
+                }
+            }
+        }
+
         if (input == '\r')
         {
             state_ = expecting_newline_3;
@@ -262,10 +290,26 @@ RequestParser::consume(Request &req, char input, http::CompressionType *compress
             return boost::indeterminate;
         }
         return false;
-    default: // expecting_newline_3:
-        return (input == '\n');
-    // default:
-    //     return false;
+    case expecting_newline_3:
+        if (input != '\n')
+        {
+            return false;
+        }
+        // only POST requests carry a body, everything else is done after the headers
+        if (0 == content_length || "POST" != req.method)
+        {
+            return true;
+        }
+        req.body.reserve(content_length);
+        state_ = content;
+        return boost::indeterminate;
+    default: // content
+        req.body.push_back(input);
+        if (req.body.size() < content_length)
+        {
+            return boost::indeterminate;
+        }
+        return true;
     }
 }
 
@@ -34,6 +34,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <boost/logic/tribool.hpp>
 #include <boost/tuple/tuple.hpp>
 
+#include <cstddef>
+
 namespace http
 {
 
@@ -45,6 +47,9 @@ class RequestParser
     RequestParser();
     void Reset();
 
+    // upper bound on the size of a POST body that is accepted
+    static const std::size_t MAX_CONTENT_LENGTH = 4 * 1024 * 1024;
+
     boost::tuple<boost::tribool, char *>
     Parse(Request &req, char *begin, char *end, CompressionType *compressionType);
 
@@ -80,9 +85,11 @@ class RequestParser
       space_before_header_value,
       header_value,
       expecting_newline_2,
-      expecting_newline_3 } state_;
+      expecting_newline_3,
+      content } state_;
 
     Header header;
+    std::size_t content_length;
 };
 
 } // namespace http
@@ -44,9 +44,15 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 class Server
 {
   public:
-    explicit Server(const std::string &address, const int port, const unsigned thread_pool_size)
-        : thread_pool_size(thread_pool_size), acceptor(io_service),
-          new_connection(new http::Connection(io_service, request_handler)), request_handler()
+    explicit Server(const std::string &address,
+                    const int port,
+                    const unsigned thread_pool_size,
+                    const http::CompressionSettings &compression_settings)
+        : thread_pool_size(thread_pool_size), compression_settings(compression_settings),
+          acceptor(io_service),
+          new_connection(
+              new http::Connection(io_service, request_handler, this->compression_settings)),
+          request_handler()
     {
         const std::string port_string = IntToString(port);
 
@@ -91,7 +97,8 @@ class Server
         if (!e)
         {
             new_connection->start();
-            new_connection.reset(new http::Connection(io_service, request_handler));
+            new_connection.reset(
+                new http::Connection(io_service, request_handler, compression_settings));
             acceptor.async_accept(
                 new_connection->socket(),
                 boost::bind(&Server::HandleAccept, this, boost::asio::placeholders::error));
@@ -99,6 +106,7 @@ class Server
     }
 
     unsigned thread_pool_size;
+    const http::CompressionSettings compression_settings;
     boost::asio::io_service io_service;
     boost::asio::ip::tcp::acceptor acceptor;
     std::shared_ptr<http::Connection> new_connection;
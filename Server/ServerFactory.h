@@ -37,12 +37,16 @@ struct ServerFactory
 {
     ServerFactory() = delete;
     ServerFactory(const ServerFactory &) = delete;
-    static Server *CreateServer(std::string &ip_address, int ip_port, unsigned requested_num_threads)
+    static Server *CreateServer(std::string &ip_address,
+                                int ip_port,
+                                unsigned requested_num_threads,
+                                const http::CompressionSettings &compression_settings =
+                                    http::CompressionSettings())
     {
         SimpleLogger().Write() << "http 1.1 compression handled by zlib version " << zlibVersion();
         const unsigned hardware_threads = std::max(1u, std::thread::hardware_concurrency());
         const unsigned real_num_threads = std::min(hardware_threads, requested_num_threads);
-        return new Server(ip_address, ip_port, real_num_threads);
+        return new Server(ip_address, ip_port, real_num_threads, compression_settings);
     }
 };
 
@@ -35,6 +35,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <boost/assert.hpp>
 #include <boost/filesystem.hpp>
 
+#include <algorithm>
 #include <memory>
 #include <vector>
 
@@ -68,6 +69,41 @@ int main(int argc, char *argv[])
         // BOOST_ASSERT_MSG(0 != edge_list.size(), "edge list empty");
         SimpleLogger().Write() << "loaded " << node_list.size() << " nodes and " << edge_list.size()
                                << " edges";
+
+        unsigned edges_per_checksum = 0;
+        std::vector<unsigned> block_checksums;
+        if (!readHSGRBlockChecksums<QueryGraph::NodeArrayEntry, QueryGraph::EdgeArrayEntry>(
+                hsgr_path, node_list.size(), edge_list.size(), edges_per_checksum, block_checksums))
+        {
+            SimpleLogger().Write(logWARNING) << "edge array has no checksums";
+        }
+        else
+        {
+            const unsigned number_of_edges = edge_list.size();
+            if (0 == edges_per_checksum ||
+                block_checksums.size() !=
+                    (number_of_edges + edges_per_checksum - 1) / edges_per_checksum)
+            {
+                SimpleLogger().Write(logWARNING) << "edge array checksums do not cover the edges";
+                return 1;
+            }
+            for (const auto block : osrm::irange<unsigned>(0, block_checksums.size()))
+            {
+                const unsigned first_edge = block * edges_per_checksum;
+                const unsigned block_size =
+                    std::min(edges_per_checksum, number_of_edges - first_edge);
+                if (block_checksums[block] !=
+                    computeHSGRBlockChecksum(&edge_list[first_edge], block_size))
+                {
+                    SimpleLogger().Write(logWARNING) << "checksum mismatch in edges " << first_edge
+                                                     << " to " << first_edge + block_size - 1;
+                    return 1;
+                }
+            }
+            SimpleLogger().Write() << "verified " << block_checksums.size()
+                                   << " edge array checksums";
+        }
+
         std::shared_ptr<QueryGraph> m_query_graph =
             std::make_shared<QueryGraph>(node_list, edge_list);
 
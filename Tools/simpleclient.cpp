@@ -65,7 +65,8 @@ int main(int argc, const char *argv[])
     try
     {
         std::string ip_address;
-        int ip_port, requested_thread_num;
+        int ip_port, requested_thread_num, max_query_time, parallel_leg_threshold, leaf_cache_size,
+            compression_level, compression_threshold;
         bool use_shared_memory = false, trial = false;
         ServerPaths server_paths;
         if (!GenerateServerProgramOptions(argc,
@@ -74,6 +75,11 @@ int main(int argc, const char *argv[])
                                           ip_address,
                                           ip_port,
                                           requested_thread_num,
+                                          max_query_time,
+                                          parallel_leg_threshold,
+                                          leaf_cache_size,
+                                          compression_level,
+                                          compression_threshold,
                                           use_shared_memory,
                                           trial))
         {
@@ -83,7 +89,11 @@ int main(int argc, const char *argv[])
         SimpleLogger().Write() << "starting up engines, " << g_GIT_DESCRIPTION << ", "
                                << "compiled at " << __DATE__ << ", " __TIME__;
 
-        OSRM routing_machine(server_paths, use_shared_memory);
+        OSRM routing_machine(server_paths,
+                             use_shared_memory,
+                             max_query_time,
+                             parallel_leg_threshold,
+                             leaf_cache_size);
 
         RouteParameters route_parameters;
         route_parameters.zoom_level = 18;           // no generalization
@@ -0,0 +1,97 @@
+#include "../../DataStructures/SearchEngineData.h"
+#include "../../typedefs.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <vector>
+
+namespace
+{
+// heap allocations made by the calling thread, counted by the replaced operator new below.
+// The replacement covers the whole executable, which is why this test has one of its own.
+thread_local std::size_t allocations_on_this_thread = 0;
+}
+
+void *operator new(std::size_t size)
+{
+    ++allocations_on_this_thread;
+    void *pointer = std::malloc(0 == size ? 1 : size);
+    if (nullptr == pointer)
+    {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+
+BOOST_AUTO_TEST_SUITE(search_workspace_allocation)
+
+BOOST_AUTO_TEST_CASE(workspace_reused_without_allocation)
+{
+    SearchEngineData engine_working_data;
+    std::mt19937 g(11);
+    std::uniform_int_distribution<NodeID> node_distribution(0, 1000000);
+    std::vector<NodeID> nodes;
+    for (unsigned i = 0; i < 20000; ++i)
+    {
+        nodes.push_back(node_distribution(g));
+    }
+
+    const auto run_query = [&]()
+    {
+        SearchWorkspace &workspace = engine_working_data.GetThreadLocalWorkspace(1000000);
+        workspace.forward_heap1.Clear();
+        workspace.forward_search_space.clear();
+        workspace.PrepareLegs(4);
+        for (const NodeID node : nodes)
+        {
+            if (!workspace.forward_heap1.WasInserted(node))
+            {
+                workspace.forward_heap1.Insert(node, node % 97, node);
+            }
+        }
+        while (!workspace.forward_heap1.Empty())
+        {
+            const NodeID node = workspace.forward_heap1.DeleteMin();
+            workspace.forward_search_space.emplace_back(node, node);
+            workspace.packed_legs1[node % 4].push_back(node);
+        }
+        return &workspace;
+    };
+
+    const std::size_t cold_allocations = allocations_on_this_thread;
+    SearchWorkspace *first_workspace = run_query();
+    run_query();
+    BOOST_CHECK_GT(allocations_on_this_thread, cold_allocations);
+    const std::size_t warm_capacity_growth_count =
+        engine_working_data.GetThreadLocalWorkspace(1000000).CapacityGrowthCount();
+#ifndef NDEBUG
+    BOOST_CHECK_GT(warm_capacity_growth_count, 0);
+#endif
+
+    // no check in between, the test framework may allocate itself
+    std::vector<SearchWorkspace *> workspaces(5);
+    const std::size_t warm_allocations = allocations_on_this_thread;
+    for (SearchWorkspace *&workspace : workspaces)
+    {
+        workspace = run_query();
+    }
+    BOOST_CHECK_EQUAL(allocations_on_this_thread, warm_allocations);
+    for (SearchWorkspace *workspace : workspaces)
+    {
+        BOOST_CHECK_EQUAL(first_workspace, workspace);
+    }
+    BOOST_CHECK_EQUAL(engine_working_data.GetThreadLocalWorkspace(1000000).CapacityGrowthCount(),
+                      warm_capacity_growth_count);
+
+    // another engine on the same thread shares the workspace
+    SearchEngineData other_engine_working_data;
+    BOOST_CHECK_EQUAL(&other_engine_working_data.GetThreadLocalWorkspace(1000000),
+                      first_workspace);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
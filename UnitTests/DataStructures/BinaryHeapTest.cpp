@@ -19,7 +19,8 @@ typedef int TestKey;
 typedef int TestWeight;
 typedef boost::mpl::list<ArrayStorage<TestNodeID, TestKey>,
                          MapStorage<TestNodeID, TestKey>,
-                         UnorderedMapStorage<TestNodeID, TestKey>> storage_types;
+                         UnorderedMapStorage<TestNodeID, TestKey>,
+                         ReusableHashStorage<TestNodeID, TestKey>> storage_types;
 
 template <unsigned NUM_ELEM> struct RandomDataFixture
 {
@@ -148,4 +149,35 @@ BOOST_FIXTURE_TEST_CASE_TEMPLATE(decrease_key_test, T, storage_types, RandomData
     }
 }
 
+// the const lookups must neither insert into the index storage nor disagree with the others
+BOOST_FIXTURE_TEST_CASE(const_lookup_test, RandomDataFixture<NUM_NODES>)
+{
+    typedef BinaryHeap<TestNodeID,
+                       TestKey,
+                       TestWeight,
+                       TestData,
+                       ReusableHashStorage<TestNodeID, TestKey>> HeapType;
+    HeapType heap(NUM_NODES);
+    const HeapType &const_heap = heap;
+
+    for (unsigned idx : order)
+    {
+        if (0 == idx % 2)
+        {
+            heap.Insert(ids[idx], weights[idx], data[idx]);
+        }
+    }
+    const std::size_t capacity = heap.Capacity();
+
+    for (unsigned idx : order)
+    {
+        BOOST_CHECK_EQUAL(const_heap.WasInserted(ids[idx]), 0 == idx % 2);
+        if (0 == idx % 2)
+        {
+            BOOST_CHECK_EQUAL(const_heap.GetKey(ids[idx]), weights[idx]);
+        }
+    }
+    BOOST_CHECK_EQUAL(capacity, heap.Capacity());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
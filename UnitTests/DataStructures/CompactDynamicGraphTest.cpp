@@ -0,0 +1,211 @@
+#include "../../DataStructures/CompactDynamicGraph.h"
+#include "../../DataStructures/Range.h"
+#include "../../typedefs.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+#include <sstream>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(compact_dynamic_graph)
+
+struct TestData
+{
+    unsigned distance;
+};
+
+typedef CompactDynamicGraph<TestData> TestGraph;
+typedef TestGraph::InputEdge TestInputEdge;
+
+constexpr unsigned TEST_NUM_NODES = 100;
+constexpr unsigned TEST_NUM_EDGES = 300;
+constexpr unsigned TEST_NUM_OPERATIONS = 20000;
+// Choosen by a fair W20 dice roll (this value is completely arbitrary)
+constexpr unsigned RANDOM_SEED = 12;
+
+typedef std::vector<std::vector<std::pair<NodeID, unsigned>>> AdjacencyList;
+
+// edges of every node have to appear in the same order as in the reference
+void CheckGraph(const TestGraph &graph, const AdjacencyList &reference)
+{
+    unsigned number_of_edges = 0;
+    for (const auto node : osrm::irange(0u, graph.GetNumberOfNodes()))
+    {
+        BOOST_REQUIRE_EQUAL(graph.GetOutDegree(node), reference[node].size());
+        unsigned position = 0;
+        for (const auto edge : graph.GetAdjacentEdgeRange(node))
+        {
+            BOOST_CHECK_EQUAL(graph.GetTarget(edge), reference[node][position].first);
+            BOOST_CHECK_EQUAL(graph.GetEdgeData(edge).distance, reference[node][position].second);
+            ++position;
+        }
+        number_of_edges += position;
+    }
+    BOOST_CHECK_EQUAL(graph.GetNumberOfEdges(), number_of_edges);
+}
+
+BOOST_AUTO_TEST_CASE(construction_test)
+{
+    std::mt19937 g(RANDOM_SEED);
+    std::uniform_int_distribution<> node_udist(0, TEST_NUM_NODES - 1);
+
+    std::vector<TestInputEdge> input_edges;
+    for (unsigned i = 0; i < TEST_NUM_EDGES; ++i)
+    {
+        input_edges.emplace_back(node_udist(g), node_udist(g), TestData{i});
+    }
+    std::stable_sort(input_edges.begin(), input_edges.end());
+
+    AdjacencyList reference(TEST_NUM_NODES);
+    for (const auto &edge : input_edges)
+    {
+        reference[edge.source].emplace_back(edge.target, edge.data.distance);
+    }
+
+    TestGraph graph(TEST_NUM_NODES, input_edges);
+    CheckGraph(graph, reference);
+    BOOST_CHECK_EQUAL(graph.GetNumberOfUnusedSlots(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(insert_delete_compact_test)
+{
+    std::mt19937 g(RANDOM_SEED);
+    std::uniform_int_distribution<> node_udist(0, TEST_NUM_NODES - 1);
+    std::uniform_int_distribution<> operation_udist(0, 99);
+
+    std::vector<TestInputEdge> input_edges;
+    for (unsigned i = 0; i < TEST_NUM_EDGES; ++i)
+    {
+        input_edges.emplace_back(node_udist(g), node_udist(g), TestData{i});
+    }
+    std::stable_sort(input_edges.begin(), input_edges.end());
+
+    AdjacencyList reference(TEST_NUM_NODES);
+    for (const auto &edge : input_edges)
+    {
+        reference[edge.source].emplace_back(edge.target, edge.data.distance);
+    }
+    TestGraph graph(TEST_NUM_NODES, input_edges);
+
+    for (unsigned i = 0; i < TEST_NUM_OPERATIONS; ++i)
+    {
+        const NodeID source = node_udist(g);
+        const NodeID target = node_udist(g);
+        const int operation = operation_udist(g);
+        if (operation < 60)
+        {
+            graph.InsertEdge(source, target, TestData{i});
+            reference[source].emplace_back(target, i);
+        }
+        else if (operation < 98)
+        {
+            // deleted edges are replaced by the last edge of the node
+            const int deleted = graph.DeleteEdgesTo(source, target);
+            int expected = 0;
+            auto &edges = reference[source];
+            for (unsigned position = 0; position < edges.size() - expected; ++position)
+            {
+                while (position < edges.size() - expected && edges[position].first == target)
+                {
+                    ++expected;
+                    edges[position] = edges[edges.size() - expected];
+                }
+            }
+            edges.resize(edges.size() - expected);
+            BOOST_CHECK_EQUAL(deleted, expected);
+        }
+        else
+        {
+            graph.Compact();
+            BOOST_CHECK_EQUAL(graph.GetNumberOfUnusedSlots(), 0);
+            BOOST_CHECK_EQUAL(graph.GetNumberOfFreeSlots(), 0);
+        }
+
+        if (0 == i % 1000)
+        {
+            CheckGraph(graph, reference);
+        }
+    }
+    CheckGraph(graph, reference);
+
+    graph.Compact();
+    CheckGraph(graph, reference);
+    BOOST_CHECK_EQUAL(graph.GetNumberOfUnusedSlots(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(free_block_reuse_test)
+{
+    // tight initial layout: node 0 owns slots [0,5), node 1 [5,8) and node 2 [8,9)
+    std::vector<TestInputEdge> input_edges;
+    for (unsigned i = 0; i < 5; ++i)
+    {
+        input_edges.emplace_back(0, 1, TestData{i});
+    }
+    for (unsigned i = 0; i < 3; ++i)
+    {
+        input_edges.emplace_back(1, 2, TestData{i});
+    }
+    input_edges.emplace_back(2, 0, TestData{0});
+    TestGraph graph(3, input_edges);
+
+    // node 0 moves to the end of the arena and leaves its old block behind
+    graph.InsertEdge(0, 2, TestData{5});
+    BOOST_CHECK_EQUAL(graph.BeginEdges(0), 9);
+    BOOST_CHECK_EQUAL(graph.GetNumberOfFreeSlots(), 5);
+
+    // node 1 outgrows its block and is moved into the one node 0 left behind
+    graph.InsertEdge(1, 0, TestData{3});
+    BOOST_CHECK_EQUAL(graph.BeginEdges(1), 0);
+    BOOST_CHECK_EQUAL(graph.GetNumberOfFreeSlots(), 3);
+    BOOST_CHECK_EQUAL(graph.GetNumberOfUnusedSlots(), 5);
+
+    unsigned distance = 0;
+    for (const auto edge : graph.GetAdjacentEdgeRange(1))
+    {
+        BOOST_CHECK_EQUAL(graph.GetEdgeData(edge).distance, distance++);
+    }
+    BOOST_CHECK_EQUAL(distance, 4);
+    BOOST_CHECK_EQUAL(graph.FindEdge(1, 1), graph.EndEdges(1));
+    BOOST_CHECK_EQUAL(graph.GetTarget(graph.FindEdge(1, 0)), 0);
+
+    graph.Compact();
+    BOOST_CHECK_EQUAL(graph.BeginEdges(1), 0);
+    BOOST_CHECK_EQUAL(graph.BeginEdges(2), 4);
+    BOOST_CHECK_EQUAL(graph.BeginEdges(0), 5);
+    BOOST_CHECK_EQUAL(graph.GetNumberOfUnusedSlots(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(serialization_test)
+{
+    std::mt19937 g(RANDOM_SEED);
+    std::uniform_int_distribution<> node_udist(0, TEST_NUM_NODES - 1);
+
+    AdjacencyList reference(TEST_NUM_NODES);
+    TestGraph graph(TEST_NUM_NODES);
+    for (unsigned i = 0; i < TEST_NUM_EDGES; ++i)
+    {
+        const NodeID source = node_udist(g);
+        const NodeID target = node_udist(g);
+        graph.InsertEdge(source, target, TestData{i});
+        reference[source].emplace_back(target, i);
+    }
+    BOOST_CHECK_GT(graph.GetNumberOfUnusedSlots(), 0);
+
+    std::stringstream stream;
+    stream << graph;
+
+    TestGraph loaded_graph(0);
+    stream >> loaded_graph;
+    BOOST_CHECK(stream.good());
+    BOOST_CHECK_EQUAL(loaded_graph.GetNumberOfNodes(), TEST_NUM_NODES);
+    BOOST_CHECK_EQUAL(loaded_graph.GetNumberOfUnusedSlots(), 0);
+    CheckGraph(loaded_graph, reference);
+
+    // the loaded graph has no slack and has to grow on the next insertion
+    loaded_graph.InsertEdge(0, 1, TestData{TEST_NUM_EDGES});
+    reference[0].emplace_back(1, TEST_NUM_EDGES);
+    CheckGraph(loaded_graph, reference);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,61 @@
+#include "../../DataStructures/ConcurrentLeafCache.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <array>
+#include <memory>
+
+BOOST_AUTO_TEST_SUITE(concurrent_leaf_cache)
+
+typedef std::array<uint32_t, 16> TestLeaf;
+typedef ConcurrentLeafCache<TestLeaf> TestLeafCache;
+
+TestLeafCache::LeafPtr MakeLeaf(const uint32_t leaf_id)
+{
+    auto leaf = std::make_shared<TestLeaf>();
+    leaf->fill(leaf_id);
+    return leaf;
+}
+
+BOOST_AUTO_TEST_CASE(hits_and_misses)
+{
+    TestLeafCache cache(64 * sizeof(TestLeaf));
+    BOOST_CHECK(!cache.Find(7));
+    cache.Insert(7, MakeLeaf(7));
+    const auto leaf = cache.Find(7);
+    BOOST_REQUIRE(leaf);
+    BOOST_CHECK_EQUAL((*leaf)[0], 7);
+
+    // a second copy of a cached leaf is dropped in favour of the first
+    BOOST_CHECK_EQUAL(cache.Insert(7, MakeLeaf(7)), leaf);
+
+    const TestLeafCache::Statistics statistics = cache.GetStatistics();
+    BOOST_CHECK_EQUAL(statistics.hits, 1);
+    BOOST_CHECK_EQUAL(statistics.misses, 1);
+    BOOST_CHECK_EQUAL(statistics.evictions, 0);
+    BOOST_CHECK_EQUAL(statistics.number_of_leaves, 1);
+    BOOST_CHECK_EQUAL(statistics.capacity, 64);
+    BOOST_CHECK_EQUAL(statistics.GetHitRate(), 0.5);
+}
+
+BOOST_AUTO_TEST_CASE(clock_eviction)
+{
+    // 16 shards of two leaves, all ids below map to the first shard
+    TestLeafCache cache(32 * sizeof(TestLeaf));
+    cache.Insert(0, MakeLeaf(0));
+    const auto evicted_leaf = cache.Insert(16, MakeLeaf(16));
+
+    // the referenced leaf gets a second chance
+    BOOST_CHECK(cache.Find(0));
+    cache.Insert(32, MakeLeaf(32));
+    BOOST_CHECK(cache.Find(0));
+    BOOST_CHECK(!cache.Find(16));
+    BOOST_CHECK(cache.Find(32));
+    BOOST_CHECK_EQUAL(cache.GetStatistics().evictions, 1);
+
+    // leaves handed out before stay valid
+    BOOST_REQUIRE(evicted_leaf);
+    BOOST_CHECK_EQUAL((*evicted_leaf)[0], 16);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,113 @@
+#include "../../Algorithms/ConvexHull.h"
+
+#include <osrm/Coordinate.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(convex_hull)
+
+// hull coordinates as (lat, lon) pairs, the hull has no defined start
+std::vector<std::pair<int, int>> Sorted(const std::vector<FixedPointCoordinate> &coordinates)
+{
+    std::vector<std::pair<int, int>> result;
+    for (const FixedPointCoordinate &coordinate : coordinates)
+    {
+        result.emplace_back(coordinate.lat, coordinate.lon);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+BOOST_AUTO_TEST_CASE(fewer_than_three_coordinates)
+{
+    BOOST_CHECK(ConvexHull({}).empty());
+
+    const std::vector<FixedPointCoordinate> one = ConvexHull({FixedPointCoordinate(10, 20)});
+    BOOST_REQUIRE_EQUAL(one.size(), 1u);
+    BOOST_CHECK(one.front() == FixedPointCoordinate(10, 20));
+
+    const std::vector<FixedPointCoordinate> two =
+        ConvexHull({FixedPointCoordinate(10, 20), FixedPointCoordinate(30, 5)});
+    BOOST_CHECK_EQUAL(two.size(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(duplicates)
+{
+    // duplicates are removed, three copies of one coordinate are a single point
+    const std::vector<FixedPointCoordinate> same = ConvexHull(
+        {FixedPointCoordinate(10, 20), FixedPointCoordinate(10, 20), FixedPointCoordinate(10, 20)});
+    BOOST_REQUIRE_EQUAL(same.size(), 1u);
+    BOOST_CHECK(same.front() == FixedPointCoordinate(10, 20));
+
+    const std::vector<FixedPointCoordinate> square = ConvexHull({FixedPointCoordinate(0, 0),
+                                                                 FixedPointCoordinate(0, 10),
+                                                                 FixedPointCoordinate(10, 10),
+                                                                 FixedPointCoordinate(0, 10),
+                                                                 FixedPointCoordinate(10, 0),
+                                                                 FixedPointCoordinate(0, 0),
+                                                                 FixedPointCoordinate(10, 10)});
+    BOOST_CHECK_EQUAL(square.size(), 4u);
+}
+
+BOOST_AUTO_TEST_CASE(collinear)
+{
+    // all on one line, only the two ends remain
+    std::vector<FixedPointCoordinate> line;
+    for (int i = 0; i < 6; ++i)
+    {
+        line.emplace_back(100 + 3 * i, 50 - 2 * i);
+    }
+    std::shuffle(line.begin(), line.end(), std::mt19937(3));
+    const std::vector<std::pair<int, int>> ends = Sorted(ConvexHull(line));
+    BOOST_REQUIRE_EQUAL(ends.size(), 2u);
+    BOOST_CHECK(ends.front() == std::make_pair(100, 50));
+    BOOST_CHECK(ends.back() == std::make_pair(115, 40));
+
+    // coordinates on the edges of a triangle are dropped
+    const std::vector<FixedPointCoordinate> triangle = ConvexHull({FixedPointCoordinate(0, 0),
+                                                                   FixedPointCoordinate(0, 5),
+                                                                   FixedPointCoordinate(0, 10),
+                                                                   FixedPointCoordinate(5, 5),
+                                                                   FixedPointCoordinate(10, 0),
+                                                                   FixedPointCoordinate(5, 0),
+                                                                   FixedPointCoordinate(2, 2)});
+    const std::vector<std::pair<int, int>> corners = Sorted(triangle);
+    BOOST_REQUIRE_EQUAL(corners.size(), 3u);
+    BOOST_CHECK(corners[0] == std::make_pair(0, 0));
+    BOOST_CHECK(corners[1] == std::make_pair(0, 10));
+    BOOST_CHECK(corners[2] == std::make_pair(10, 0));
+}
+
+BOOST_AUTO_TEST_CASE(counter_clockwise)
+{
+    std::mt19937 generator(7);
+    std::uniform_int_distribution<int> distribution(-1000, 1000);
+    std::vector<FixedPointCoordinate> coordinates;
+    for (int i = 0; i < 200; ++i)
+    {
+        coordinates.emplace_back(distribution(generator), distribution(generator));
+    }
+    const std::vector<FixedPointCoordinate> hull = ConvexHull(coordinates);
+    BOOST_REQUIRE_GE(hull.size(), 3u);
+
+    // every coordinate lies on or to the left of every hull edge in the lon/lat plane
+    for (std::size_t i = 0; i < hull.size(); ++i)
+    {
+        const FixedPointCoordinate &a = hull[i];
+        const FixedPointCoordinate &b = hull[(i + 1) % hull.size()];
+        for (const FixedPointCoordinate &c : coordinates)
+        {
+            const int64_t cross = static_cast<int64_t>(b.lon - a.lon) * (c.lat - a.lat) -
+                                  static_cast<int64_t>(b.lat - a.lat) * (c.lon - a.lon);
+            BOOST_CHECK_GE(cross, 0);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,223 @@
+#include "../../Contractor/HubLabelBuilder.h"
+#include "../../DataStructures/HubLabels.h"
+#include "../../DataStructures/QueryEdge.h"
+#include "../../DataStructures/StaticGraph.h"
+#include "../../typedefs.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <queue>
+#include <random>
+#include <sstream>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(hub_labels)
+
+typedef StaticGraph<QueryEdge::EdgeData> TestGraph;
+typedef std::vector<std::map<NodeID, EdgeWeight>> AdjacencyList;
+
+constexpr unsigned GRID_SIZE = 8;
+constexpr unsigned NUM_NODES = GRID_SIZE * GRID_SIZE;
+constexpr unsigned RANDOM_SEED = 23;
+
+// Directed grid with different weights in both directions, contracted in order of node ids.
+// Every contraction adds all shortcuts, which is a valid (if dense) hierarchy.
+struct ContractedGridFixture
+{
+    ContractedGridFixture() : outgoing(NUM_NODES), incoming(NUM_NODES)
+    {
+        std::mt19937 g(RANDOM_SEED);
+        std::uniform_int_distribution<> weight_udist(1, 100);
+        std::vector<NodeID> node_ids(NUM_NODES);
+        for (unsigned i = 0; i < NUM_NODES; ++i)
+        {
+            node_ids[i] = i;
+        }
+        std::shuffle(node_ids.begin(), node_ids.end(), g);
+
+        const auto add_edge = [this](const NodeID from, const NodeID to, const EdgeWeight weight)
+        {
+            outgoing[from][to] = weight;
+            incoming[to][from] = weight;
+        };
+        for (unsigned y = 0; y < GRID_SIZE; ++y)
+        {
+            for (unsigned x = 0; x < GRID_SIZE; ++x)
+            {
+                const NodeID node = node_ids[y * GRID_SIZE + x];
+                if (x + 1 < GRID_SIZE)
+                {
+                    add_edge(node, node_ids[y * GRID_SIZE + x + 1], weight_udist(g));
+                    add_edge(node_ids[y * GRID_SIZE + x + 1], node, weight_udist(g));
+                }
+                if (y + 1 < GRID_SIZE)
+                {
+                    add_edge(node, node_ids[(y + 1) * GRID_SIZE + x], weight_udist(g));
+                    add_edge(node_ids[(y + 1) * GRID_SIZE + x], node, weight_udist(g));
+                }
+            }
+        }
+
+        AdjacencyList remaining_outgoing = outgoing;
+        AdjacencyList remaining_incoming = incoming;
+        std::vector<TestGraph::InputEdge> edges;
+        for (NodeID node = 0; node < NUM_NODES; ++node)
+        {
+            for (const auto &in : remaining_incoming[node])
+            {
+                for (const auto &out : remaining_outgoing[node])
+                {
+                    if (in.first == out.first)
+                    {
+                        continue;
+                    }
+                    const EdgeWeight weight = in.second + out.second;
+                    auto shortcut = remaining_outgoing[in.first].find(out.first);
+                    if (shortcut == remaining_outgoing[in.first].end() || weight < shortcut->second)
+                    {
+                        remaining_outgoing[in.first][out.first] = weight;
+                        remaining_incoming[out.first][in.first] = weight;
+                    }
+                }
+            }
+            for (const auto &out : remaining_outgoing[node])
+            {
+                edges.emplace_back(node, out.first, MakeEdgeData(out.second, true));
+                remaining_incoming[out.first].erase(node);
+            }
+            for (const auto &in : remaining_incoming[node])
+            {
+                edges.emplace_back(node, in.first, MakeEdgeData(in.second, false));
+                remaining_outgoing[in.first].erase(node);
+            }
+        }
+        graph.reset(new TestGraph(NUM_NODES, edges));
+    }
+
+    static QueryEdge::EdgeData MakeEdgeData(const EdgeWeight weight, const bool forward)
+    {
+        QueryEdge::EdgeData data;
+        data.distance = weight;
+        data.forward = forward;
+        data.backward = !forward;
+        return data;
+    }
+
+    EdgeWeight Dijkstra(const NodeID source, const NodeID target) const
+    {
+        std::vector<EdgeWeight> distances(NUM_NODES, INVALID_EDGE_WEIGHT);
+        std::priority_queue<std::pair<EdgeWeight, NodeID>,
+                            std::vector<std::pair<EdgeWeight, NodeID>>,
+                            std::greater<std::pair<EdgeWeight, NodeID>>> queue;
+        distances[source] = 0;
+        queue.emplace(0, source);
+        while (!queue.empty())
+        {
+            const auto top = queue.top();
+            queue.pop();
+            if (top.first > distances[top.second])
+            {
+                continue;
+            }
+            for (const auto &out : outgoing[top.second])
+            {
+                if (top.first + out.second < distances[out.first])
+                {
+                    distances[out.first] = top.first + out.second;
+                    queue.emplace(distances[out.first], out.first);
+                }
+            }
+        }
+        return distances[target];
+    }
+
+    AdjacencyList outgoing;
+    AdjacencyList incoming;
+    std::unique_ptr<TestGraph> graph;
+};
+
+BOOST_FIXTURE_TEST_CASE(labels_give_shortest_distances, ContractedGridFixture)
+{
+    HubLabelBuilder<TestGraph> builder(*graph);
+    builder.Run();
+
+    // full labels would hold every higher node, pruning must remove some of them
+    BOOST_CHECK_LT(builder.GetNumberOfEntries(), NUM_NODES * (NUM_NODES + 1));
+
+    std::stringstream label_stream;
+    builder.Write(label_stream, 42);
+
+    HubLabelFileHeader header;
+    label_stream.read((char *)&header, sizeof(HubLabelFileHeader));
+    BOOST_CHECK_EQUAL(header.check_sum, 42);
+    BOOST_CHECK_EQUAL(header.number_of_nodes, NUM_NODES);
+    BOOST_CHECK_EQUAL(header.number_of_entries, builder.GetNumberOfEntries());
+
+    HubLabels<false>::OffsetContainerT offsets(2 * NUM_NODES + 1);
+    HubLabels<false>::HubContainerT hubs(header.number_of_entries);
+    HubLabels<false>::DistanceContainerT distances(header.number_of_entries);
+    ReadHubLabels(label_stream, header, offsets.data(), hubs.data(), distances.data());
+    const HubLabels<false> labels(offsets, hubs, distances);
+    BOOST_CHECK_EQUAL(labels.GetNumberOfNodes(), NUM_NODES);
+
+    for (NodeID source = 0; source < NUM_NODES; ++source)
+    {
+        for (NodeID target = 0; target < NUM_NODES; ++target)
+        {
+            const EdgeWeight expected = Dijkstra(source, target);
+            BOOST_CHECK_EQUAL(builder.GetDistance(source, target), expected);
+            BOOST_CHECK_EQUAL(labels.GetDistance(source, target), expected);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(intersection_matches_merge)
+{
+    std::mt19937 g(RANDOM_SEED);
+    std::uniform_int_distribution<NodeID> hub_udist(0, 200);
+    std::uniform_int_distribution<EdgeWeight> distance_udist(0, 1000);
+    std::uniform_int_distribution<unsigned> size_udist(0, 40);
+
+    for (unsigned round = 0; round < 1000; ++round)
+    {
+        std::vector<NodeID> hubs[2];
+        std::vector<EdgeWeight> distances[2];
+        std::map<NodeID, EdgeWeight> labels[2];
+        for (unsigned i = 0; i < 2; ++i)
+        {
+            const unsigned size = size_udist(g);
+            while (labels[i].size() < size)
+            {
+                labels[i][hub_udist(g)] = distance_udist(g);
+            }
+            for (const auto &entry : labels[i])
+            {
+                hubs[i].push_back(entry.first);
+                distances[i].push_back(entry.second);
+            }
+        }
+
+        EdgeWeight expected = INVALID_EDGE_WEIGHT;
+        for (const auto &entry : labels[0])
+        {
+            const auto other = labels[1].find(entry.first);
+            if (other != labels[1].end())
+            {
+                expected = std::min(expected, entry.second + other->second);
+            }
+        }
+        BOOST_CHECK_EQUAL(IntersectHubLabels(hubs[0].data(),
+                                             distances[0].data(),
+                                             hubs[0].size(),
+                                             hubs[1].data(),
+                                             distances[1].data(),
+                                             hubs[1].size()),
+                          expected);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
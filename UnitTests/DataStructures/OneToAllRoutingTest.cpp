@@ -0,0 +1,294 @@
+#include "../../DataStructures/PhantomNodes.h"
+#include "../../DataStructures/QueryEdge.h"
+#include "../../DataStructures/Range.h"
+#include "../../DataStructures/SearchEngineData.h"
+#include "../../RoutingAlgorithms/OneToAllRouting.h"
+#include "../../typedefs.h"
+
+#include <osrm/Coordinate.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <queue>
+#include <random>
+#include <utility>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(one_to_all_routing)
+
+typedef std::map<std::pair<NodeID, NodeID>, EdgeWeight> WeightMap;
+
+// A random directed graph, contracted in the order of the node ids without witness searches.
+// Every edge is stored at its lower end, the level order lists the nodes top-down.
+class ContractedFacade
+{
+  public:
+    typedef QueryEdge::EdgeData EdgeData;
+
+    ContractedFacade(const unsigned number_of_nodes,
+                     const unsigned number_of_edges,
+                     const unsigned seed)
+        : number_of_nodes(number_of_nodes)
+    {
+        std::mt19937 generator(seed);
+        std::uniform_int_distribution<NodeID> node_distribution(0, number_of_nodes - 1);
+        std::uniform_int_distribution<EdgeWeight> weight_distribution(1, 50);
+        while (original_edges.size() < number_of_edges)
+        {
+            const NodeID from = node_distribution(generator);
+            const NodeID to = node_distribution(generator);
+            if (from != to)
+            {
+                const EdgeWeight weight = weight_distribution(generator);
+                AddEdge(original_edges, from, to, weight);
+            }
+        }
+
+        // contracting a node bridges every pair of its remaining neighbours
+        WeightMap remaining = original_edges;
+        WeightMap search_graph;
+        for (const NodeID node : osrm::irange(0u, number_of_nodes))
+        {
+            std::vector<std::pair<NodeID, EdgeWeight>> incoming, outgoing;
+            for (const auto &edge : remaining)
+            {
+                if (edge.first.second == node && edge.first.first > node)
+                {
+                    incoming.emplace_back(edge.first.first, edge.second);
+                }
+                if (edge.first.first == node && edge.first.second > node)
+                {
+                    outgoing.emplace_back(edge.first.second, edge.second);
+                }
+            }
+            for (const auto &in : incoming)
+            {
+                AddEdge(search_graph, in.first, node, in.second);
+                for (const auto &out : outgoing)
+                {
+                    if (in.first != out.first)
+                    {
+                        AddEdge(remaining, in.first, out.first, in.second + out.second);
+                    }
+                }
+            }
+            for (const auto &out : outgoing)
+            {
+                AddEdge(search_graph, node, out.first, out.second);
+            }
+        }
+
+        std::vector<std::vector<QueryEdge>> adjacency(number_of_nodes);
+        for (const auto &edge : search_graph)
+        {
+            const NodeID from = edge.first.first;
+            const NodeID to = edge.first.second;
+            QueryEdge::EdgeData data;
+            data.id = 0;
+            data.shortcut = false;
+            data.distance = edge.second;
+            data.forward = (from < to);
+            data.backward = (from > to);
+            const NodeID lower = std::min(from, to);
+            adjacency[lower].emplace_back(lower, std::max(from, to), data);
+        }
+        for (const NodeID node : osrm::irange(0u, number_of_nodes))
+        {
+            first_edge.push_back(static_cast<EdgeID>(edges.size()));
+            edges.insert(edges.end(), adjacency[node].begin(), adjacency[node].end());
+            level_order.push_back(number_of_nodes - 1 - node);
+        }
+        first_edge.push_back(static_cast<EdgeID>(edges.size()));
+    }
+
+    unsigned GetNumberOfNodes() const { return number_of_nodes; }
+
+    unsigned GetNumberOfLevelOrderedNodes() const
+    {
+        return static_cast<unsigned>(level_order.size());
+    }
+
+    NodeID GetLevelOrderedNode(const unsigned index) const { return level_order[index]; }
+
+    osrm::range<EdgeID> GetAdjacentEdgeRange(const NodeID node) const
+    {
+        return osrm::irange(first_edge[node], first_edge[node + 1]);
+    }
+
+    NodeID GetTarget(const EdgeID edge) const { return edges[edge].target; }
+
+    const EdgeData &GetEdgeData(const EdgeID edge) const { return edges[edge].data; }
+
+    // plain Dijkstra on the original graph, starting at the given node distances
+    std::vector<EdgeWeight>
+    Dijkstra(const std::vector<std::pair<NodeID, EdgeWeight>> &sources) const
+    {
+        std::vector<EdgeWeight> distances(number_of_nodes, INVALID_EDGE_WEIGHT);
+        typedef std::pair<EdgeWeight, NodeID> QueueEntry;
+        std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+        for (const auto &source : sources)
+        {
+            queue.emplace(source.second, source.first);
+        }
+        while (!queue.empty())
+        {
+            const QueueEntry entry = queue.top();
+            queue.pop();
+            if (INVALID_EDGE_WEIGHT != distances[entry.second])
+            {
+                continue;
+            }
+            distances[entry.second] = entry.first;
+            for (const auto &edge : original_edges)
+            {
+                if (edge.first.first == entry.second &&
+                    INVALID_EDGE_WEIGHT == distances[edge.first.second])
+                {
+                    queue.emplace(entry.first + edge.second, edge.first.second);
+                }
+            }
+        }
+        return distances;
+    }
+
+  private:
+    unsigned number_of_nodes;
+    WeightMap original_edges;
+    std::vector<EdgeID> first_edge;
+    std::vector<QueryEdge> edges;
+    std::vector<NodeID> level_order;
+
+    static void
+    AddEdge(WeightMap &graph, const NodeID from, const NodeID to, const EdgeWeight weight)
+    {
+        auto iter = graph.find(std::make_pair(from, to));
+        if (iter == graph.end())
+        {
+            graph.emplace(std::make_pair(from, to), weight);
+        }
+        else
+        {
+            iter->second = std::min(iter->second, weight);
+        }
+    }
+};
+
+PhantomNode MakePhantom(const NodeID forward_node, const NodeID reverse_node, const int offset)
+{
+    FixedPointCoordinate location(52500000, 13400000);
+    return PhantomNode(
+        forward_node, reverse_node, 0, offset, offset + 7, 0, 0, SPECIAL_EDGEID, location, 0);
+}
+
+void CheckAgainstDijkstra(const ContractedFacade &facade,
+                          const PhantomNodeArray &phantom_nodes_array,
+                          const EdgeWeight max_distance)
+{
+    ContractedFacade query_facade(facade);
+    SearchEngineData engine_working_data;
+    OneToAllRouting<ContractedFacade> one_to_all(&query_facade, engine_working_data);
+    BOOST_REQUIRE(one_to_all.IsAvailable());
+
+    std::vector<std::vector<EdgeWeight>> distances;
+    one_to_all(phantom_nodes_array, max_distance, distances);
+    BOOST_REQUIRE_EQUAL(distances.size(), phantom_nodes_array.size());
+
+    for (const auto source : osrm::irange<std::size_t>(0, phantom_nodes_array.size()))
+    {
+        std::vector<std::pair<NodeID, EdgeWeight>> sources;
+        for (const PhantomNode &phantom_node : phantom_nodes_array[source])
+        {
+            if (SPECIAL_NODEID != phantom_node.forward_node_id)
+            {
+                sources.emplace_back(phantom_node.forward_node_id,
+                                     -phantom_node.GetForwardWeightPlusOffset());
+            }
+            if (SPECIAL_NODEID != phantom_node.reverse_node_id)
+            {
+                sources.emplace_back(phantom_node.reverse_node_id,
+                                     -phantom_node.GetReverseWeightPlusOffset());
+            }
+        }
+        const std::vector<EdgeWeight> expected = facade.Dijkstra(sources);
+
+        BOOST_REQUIRE_EQUAL(distances[source].size(), facade.GetNumberOfNodes());
+        for (const NodeID node : osrm::irange(0u, facade.GetNumberOfNodes()))
+        {
+            const EdgeWeight expected_distance =
+                (INVALID_EDGE_WEIGHT != expected[node] && expected[node] <= max_distance)
+                    ? std::max(expected[node], 0)
+                    : INVALID_EDGE_WEIGHT;
+            BOOST_CHECK_EQUAL(distances[source][node], expected_distance);
+        }
+    }
+}
+
+PhantomNodeArray RandomSources(const unsigned number_of_sources,
+                               const unsigned number_of_nodes,
+                               std::mt19937 &generator)
+{
+    std::uniform_int_distribution<NodeID> node_distribution(0, number_of_nodes - 1);
+    std::uniform_int_distribution<int> offset_distribution(0, 30);
+    std::bernoulli_distribution oneway_distribution(0.3);
+
+    PhantomNodeArray phantom_nodes_array(number_of_sources);
+    for (std::vector<PhantomNode> &phantom_nodes : phantom_nodes_array)
+    {
+        const NodeID forward_node = node_distribution(generator);
+        const NodeID reverse_node =
+            oneway_distribution(generator) ? SPECIAL_NODEID : node_distribution(generator);
+        phantom_nodes.push_back(
+            MakePhantom(forward_node, reverse_node, offset_distribution(generator)));
+    }
+    return phantom_nodes_array;
+}
+
+BOOST_AUTO_TEST_CASE(single_partial_sweep)
+{
+    const ContractedFacade facade(30, 90, 5);
+    std::mt19937 generator(5);
+    // fewer sources than lanes, the unused lanes must not leak into the results
+    for (const unsigned number_of_sources : {1u, 3u, 7u})
+    {
+        CheckAgainstDijkstra(facade, RandomSources(number_of_sources, 30, generator), 100000);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(several_sweeps)
+{
+    for (const unsigned seed : {1u, 2u, 3u})
+    {
+        const ContractedFacade facade(40, 130, seed);
+        std::mt19937 generator(seed);
+        CheckAgainstDijkstra(facade, RandomSources(8, 40, generator), 100000);
+        CheckAgainstDijkstra(facade, RandomSources(19, 40, generator), 100000);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(bounded_distance)
+{
+    const ContractedFacade facade(40, 130, 9);
+    std::mt19937 generator(9);
+    for (const EdgeWeight max_distance : {0, 20, 60})
+    {
+        CheckAgainstDijkstra(facade, RandomSources(11, 40, generator), max_distance);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(negative_source_offsets)
+{
+    const ContractedFacade facade(30, 90, 13);
+    // the phantom nodes lie far into their segments, the segment start is behind them
+    PhantomNodeArray phantom_nodes_array;
+    phantom_nodes_array.push_back({MakePhantom(4, SPECIAL_NODEID, 40)});
+    phantom_nodes_array.push_back({MakePhantom(11, 17, 25)});
+    // a location snapped to two segments
+    phantom_nodes_array.push_back({MakePhantom(2, SPECIAL_NODEID, 5), MakePhantom(21, 8, 35)});
+    CheckAgainstDijkstra(facade, phantom_nodes_array, 100000);
+    CheckAgainstDijkstra(facade, phantom_nodes_array, 30);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,60 @@
+#include "../../DataStructures/PathLengthAccumulator.h"
+#include "../../typedefs.h"
+
+#include <osrm/Coordinate.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(path_length_accumulator)
+
+struct CoordinateFacade
+{
+    FixedPointCoordinate GetCoordinateOfNode(const unsigned id) const { return coordinates[id]; }
+
+    std::vector<FixedPointCoordinate> coordinates;
+};
+
+BOOST_AUTO_TEST_CASE(sums_segment_lengths)
+{
+    CoordinateFacade facade;
+    for (int i = 0; i < 5; ++i)
+    {
+        facade.coordinates.emplace_back(52500000 + 1000 * i, 13400000 + 700 * i * i);
+    }
+    const FixedPointCoordinate start(52499000, 13399000);
+    const FixedPointCoordinate end(52506000, 13412000);
+
+    PathLengthAccumulator<CoordinateFacade> accumulator(&facade, start);
+    accumulator.StartLeg();
+    BOOST_CHECK(accumulator.empty());
+
+    double expected_length = 0.;
+    FixedPointCoordinate previous = start;
+    for (NodeID node = 0; node < 5; ++node)
+    {
+        accumulator.emplace_back(node, 0u, TurnInstruction::NoTurn, 1);
+        expected_length +=
+            FixedPointCoordinate::ApproximateEuclideanDistance(previous, facade.coordinates[node]);
+        previous = facade.coordinates[node];
+    }
+    BOOST_CHECK_EQUAL(accumulator.size(), 5);
+    BOOST_CHECK_EQUAL(accumulator.back().node, 4);
+    BOOST_CHECK_EQUAL(accumulator[3].node, 3);
+
+    // a repeated node adds nothing and can be dropped again
+    accumulator.emplace_back(PathData(4, 0u, TurnInstruction::NoTurn, 1));
+    accumulator.pop_back();
+    BOOST_CHECK_EQUAL(accumulator.size(), 5);
+    BOOST_CHECK_EQUAL(accumulator.back().node, 4);
+
+    accumulator.AppendCoordinate(end);
+    expected_length += FixedPointCoordinate::ApproximateEuclideanDistance(previous, end);
+    BOOST_CHECK_CLOSE(accumulator.GetLength(), expected_length, 0.0001);
+
+    accumulator.StartLeg();
+    BOOST_CHECK(accumulator.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,66 @@
+#include "../../DataStructures/ReusableHashTable.h"
+#include "../../DataStructures/SearchEngineData.h"
+#include "../../typedefs.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(search_engine_data)
+
+BOOST_AUTO_TEST_CASE(hash_table_insert_find_clear)
+{
+    ReusableHashTable<NodeID, int> table(4);
+    std::mt19937 g(7);
+    std::uniform_int_distribution<NodeID> node_distribution(0, 1u << 30);
+
+    std::vector<NodeID> nodes;
+    for (unsigned i = 0; i < 5000; ++i)
+    {
+        nodes.push_back(node_distribution(g));
+    }
+
+    for (unsigned round = 0; round < 3; ++round)
+    {
+        table.Clear();
+        BOOST_CHECK_EQUAL(table.Size(), 0);
+        for (const NodeID node : nodes)
+        {
+            table[node] = static_cast<int>(node % 1000) + round;
+        }
+        for (const NodeID node : nodes)
+        {
+            const int *value = table.Find(node);
+            BOOST_REQUIRE(nullptr != value);
+            BOOST_CHECK_EQUAL(*value, static_cast<int>(node % 1000) + round);
+        }
+        BOOST_CHECK(!table.Contains(1u << 31));
+    }
+
+    // insert does not overwrite, like emplace on a std::unordered_map
+    table.Clear();
+    BOOST_CHECK(table.Insert(42, 1));
+    BOOST_CHECK(!table.Insert(42, 2));
+    BOOST_CHECK_EQUAL(*table.Find(42), 1);
+    BOOST_CHECK_EQUAL(table.Size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(cleared_heap_forgets_nodes)
+{
+    SearchWorkspace::QueryHeap heap(100);
+    for (NodeID node = 0; node < 100; ++node)
+    {
+        heap.Insert(node, 100 - node, node);
+    }
+    heap.Clear();
+    for (NodeID node = 0; node < 100; ++node)
+    {
+        BOOST_CHECK(!heap.WasInserted(node));
+    }
+    heap.Insert(7, 3, 7);
+    BOOST_CHECK(heap.WasInserted(7));
+    BOOST_CHECK_EQUAL(heap.Min(), 7);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,275 @@
+#include "../../DataStructures/PhantomNodes.h"
+#include "../../DataStructures/QueryEdge.h"
+#include "../../DataStructures/Range.h"
+#include "../../DataStructures/RawRouteData.h"
+#include "../../DataStructures/SearchEngineData.h"
+#include "../../DataStructures/TurnInstructions.h"
+#include "../../RoutingAlgorithms/ShortestPathRouting.h"
+#include "../../typedefs.h"
+
+#include <osrm/Coordinate.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(shortest_path_routing)
+
+// An edge-expanded street grid without shortcuts. Segment s of the grid has the forward node
+// 2s and, unless it is a oneway, the reverse node 2s+1. Every edge is stored at both of its
+// ends, so the bidirectional search of the router degenerates into a plain Dijkstra search.
+class GridFacade
+{
+  public:
+    typedef QueryEdge::EdgeData EdgeData;
+
+    GridFacade(const unsigned width, const unsigned height, const unsigned seed)
+    {
+        std::mt19937 generator(seed);
+        std::uniform_int_distribution<int> length_distribution(10, 100);
+        std::uniform_int_distribution<int> penalty_distribution(1, 5);
+        std::bernoulli_distribution oneway_distribution(0.15);
+
+        // node-based segments between neighbouring crossings
+        for (unsigned y = 0; y < height; ++y)
+        {
+            for (unsigned x = 0; x < width; ++x)
+            {
+                const unsigned crossing = y * width + x;
+                if (x + 1 < width)
+                {
+                    AddSegment(crossing, crossing + 1, length_distribution(generator),
+                               oneway_distribution(generator));
+                }
+                if (y + 1 < height)
+                {
+                    AddSegment(crossing, crossing + width, length_distribution(generator),
+                               oneway_distribution(generator));
+                }
+            }
+        }
+
+        // turns between the directed segments, u-turns are forbidden
+        std::vector<std::vector<NodeID>> incoming(width * height), outgoing(width * height);
+        for (const NodeID node : osrm::irange<NodeID>(0, 2 * segments.size()))
+        {
+            if (IsValidNode(node))
+            {
+                incoming[Head(node)].push_back(node);
+                outgoing[Tail(node)].push_back(node);
+            }
+        }
+        adjacency.resize(2 * segments.size());
+        for (const unsigned crossing : osrm::irange<unsigned>(0, width * height))
+        {
+            for (const NodeID from : incoming[crossing])
+            {
+                for (const NodeID to : outgoing[crossing])
+                {
+                    if (from / 2 != to / 2)
+                    {
+                        AddEdge(from, to, segments[from / 2].length + penalty_distribution(generator));
+                    }
+                }
+            }
+        }
+
+        for (const NodeID node : osrm::irange<NodeID>(0, adjacency.size()))
+        {
+            first_edge.push_back(static_cast<EdgeID>(edges.size()));
+            edges.insert(edges.end(), adjacency[node].begin(), adjacency[node].end());
+        }
+        first_edge.push_back(static_cast<EdgeID>(edges.size()));
+    }
+
+    unsigned GetNumberOfNodes() const { return static_cast<unsigned>(adjacency.size()); }
+
+    unsigned GetNumberOfSegments() const { return static_cast<unsigned>(segments.size()); }
+
+    int GetSegmentLength(const unsigned segment) const { return segments[segment].length; }
+
+    bool IsOneway(const unsigned segment) const { return segments[segment].oneway; }
+
+    osrm::range<EdgeID> GetAdjacentEdgeRange(const NodeID node) const
+    {
+        return osrm::irange(first_edge[node], first_edge[node + 1]);
+    }
+
+    NodeID GetTarget(const EdgeID edge) const { return edges[edge].target; }
+
+    const EdgeData &GetEdgeData(const EdgeID edge) const { return edges[edge].data; }
+
+    unsigned GetNameIndexFromEdgeID(const unsigned id) const { return id / 2; }
+
+    TurnInstruction GetTurnInstructionForEdgeID(const unsigned) const
+    {
+        return TurnInstruction::GoStraight;
+    }
+
+    bool EdgeIsCompressed(const unsigned) const { return false; }
+
+    unsigned GetGeometryIndexForEdgeID(const unsigned id) const { return Head(id); }
+
+    void GetUncompressedGeometry(const unsigned, std::vector<unsigned> &) const {}
+
+    // a location on segment at the given distance from its first crossing
+    PhantomNode MakePhantom(const unsigned segment, const int position) const
+    {
+        FixedPointCoordinate location(52500000 + static_cast<int>(segment), 13400000 + position);
+        return PhantomNode(2 * segment,
+                           segments[segment].oneway ? SPECIAL_NODEID : 2 * segment + 1,
+                           segment,
+                           position,
+                           segments[segment].length - position,
+                           0,
+                           0,
+                           SPECIAL_EDGEID,
+                           location,
+                           0);
+    }
+
+  private:
+    struct Segment
+    {
+        unsigned from;
+        unsigned to;
+        int length;
+        bool oneway;
+    };
+
+    std::vector<Segment> segments;
+    std::vector<std::vector<QueryEdge>> adjacency;
+    std::vector<EdgeID> first_edge;
+    std::vector<QueryEdge> edges;
+
+    void AddSegment(const unsigned from, const unsigned to, const int length, const bool oneway)
+    {
+        segments.push_back({from, to, length, oneway});
+    }
+
+    bool IsValidNode(const NodeID node) const { return 0 == node % 2 || !segments[node / 2].oneway; }
+
+    unsigned Tail(const NodeID node) const
+    {
+        return (0 == node % 2) ? segments[node / 2].from : segments[node / 2].to;
+    }
+
+    unsigned Head(const NodeID node) const
+    {
+        return (0 == node % 2) ? segments[node / 2].to : segments[node / 2].from;
+    }
+
+    void AddEdge(const NodeID from, const NodeID to, const int weight)
+    {
+        QueryEdge::EdgeData data;
+        data.id = from;
+        data.shortcut = false;
+        data.distance = weight;
+        data.forward = true;
+        data.backward = false;
+        adjacency[from].emplace_back(from, to, data);
+        data.forward = false;
+        data.backward = true;
+        adjacency[to].emplace_back(to, from, data);
+    }
+};
+
+RawRouteData Route(GridFacade &facade,
+                   const std::vector<PhantomNodes> &legs,
+                   const std::vector<bool> &uturns,
+                   const std::size_t parallel_leg_threshold)
+{
+    SearchEngineData engine_working_data;
+    ShortestPathRouting<GridFacade> router(&facade, engine_working_data);
+    router.SetParallelLegThreshold(parallel_leg_threshold);
+    RawRouteData raw_route;
+    router(legs, uturns, raw_route);
+    return raw_route;
+}
+
+void CheckSameRoute(GridFacade &facade,
+                    const std::vector<PhantomNodes> &legs,
+                    const std::vector<bool> &uturns)
+{
+    const RawRouteData sequential = Route(facade, legs, uturns, 0);
+    const RawRouteData parallel = Route(facade, legs, uturns, 2);
+    BOOST_CHECK_EQUAL(sequential.shortest_path_length, parallel.shortest_path_length);
+    if (INVALID_EDGE_WEIGHT != sequential.shortest_path_length &&
+        INVALID_EDGE_WEIGHT != parallel.shortest_path_length)
+    {
+        BOOST_CHECK_EQUAL(parallel.unpacked_path_segments.size(), legs.size());
+        BOOST_CHECK_EQUAL(parallel.source_traversed_in_reverse.size(), legs.size());
+        BOOST_CHECK_EQUAL(parallel.target_traversed_in_reverse.size(), legs.size());
+    }
+}
+
+std::vector<PhantomNodes> MakeLegs(const std::vector<PhantomNode> &via_points)
+{
+    std::vector<PhantomNodes> legs;
+    for (const std::size_t i : osrm::irange<std::size_t>(1, via_points.size()))
+    {
+        legs.push_back(PhantomNodes{via_points[i - 1], via_points[i]});
+    }
+    return legs;
+}
+
+BOOST_AUTO_TEST_CASE(same_segment_in_reverse_order)
+{
+    GridFacade facade(4, 4, 3);
+    for (const unsigned segment : osrm::irange<unsigned>(0, facade.GetNumberOfSegments()))
+    {
+        const int length = facade.GetSegmentLength(segment);
+        // the second location lies behind the first one on the same segment
+        const std::vector<PhantomNodes> legs =
+            MakeLegs({facade.MakePhantom(segment, length - 3),
+                      facade.MakePhantom(segment, 3),
+                      facade.MakePhantom(segment, length - 5)});
+
+        const RawRouteData sequential = Route(facade, legs, {}, 0);
+        const RawRouteData parallel = Route(facade, legs, {}, 2);
+        BOOST_CHECK_EQUAL(sequential.shortest_path_length, parallel.shortest_path_length);
+        if (!facade.IsOneway(segment))
+        {
+            // turning around at the first location goes straight back along the segment
+            BOOST_CHECK_NE(parallel.shortest_path_length, INVALID_EDGE_WEIGHT);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(random_via_routes)
+{
+    for (const unsigned seed : {1u, 2u, 3u, 4u})
+    {
+        GridFacade facade(7, 6, seed);
+        std::mt19937 generator(seed);
+        std::uniform_int_distribution<unsigned> segment_distribution(
+            0, facade.GetNumberOfSegments() - 1);
+        std::uniform_int_distribution<unsigned> via_count_distribution(2, 8);
+        std::bernoulli_distribution same_segment_distribution(0.3);
+        std::bernoulli_distribution uturn_distribution(0.3);
+
+        for (unsigned route = 0; route < 150; ++route)
+        {
+            std::vector<PhantomNode> via_points;
+            std::vector<bool> uturns;
+            const unsigned number_of_via_points = via_count_distribution(generator);
+            unsigned segment = segment_distribution(generator);
+            for (unsigned i = 0; i < number_of_via_points; ++i)
+            {
+                // stay on the segment of the previous location now and then, in either order
+                if (0 == i || !same_segment_distribution(generator))
+                {
+                    segment = segment_distribution(generator);
+                }
+                std::uniform_int_distribution<int> position_distribution(
+                    1, facade.GetSegmentLength(segment) - 1);
+                via_points.push_back(facade.MakePhantom(segment, position_distribution(generator)));
+                uturns.push_back(uturn_distribution(generator));
+            }
+            CheckSameRoute(facade, MakeLegs(via_points), uturns);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -10,6 +10,7 @@
 #include <boost/test/test_case_template.hpp>
 #include <boost/mpl/list.hpp>
 
+#include <memory>
 #include <random>
 #include <unordered_set>
 
@@ -299,16 +300,48 @@ void sampling_verify_rtree(RTreeT &rtree, LinearSearchNN &lsnn, unsigned num_sam
         lsnn.FindPhantomNodeForCoordinate(q, phantom_ln, 1);
         BOOST_CHECK_EQUAL(phantom_rtree, phantom_ln);
     }
+
+    BOOST_TEST_MESSAGE("Sampling queries in one batch");
+    std::vector<uint32_t> query_order;
+    RTreeT::SortByHilbertValue(queries, query_order);
+    BOOST_CHECK_EQUAL(query_order.size(), queries.size());
+    std::vector<PhantomNode> batch_phantoms(queries.size());
+    rtree.FindPhantomNodesForCoordinates(
+        queries, query_order.data(), query_order.data() + query_order.size(), batch_phantoms, 1);
+    PhantomNodeArray batch_incremental_phantoms(queries.size());
+    rtree.IncrementalFindPhantomNodesForCoordinates(queries,
+                                                    query_order.data(),
+                                                    query_order.data() + query_order.size(),
+                                                    batch_incremental_phantoms,
+                                                    1,
+                                                    1);
+    for (unsigned i = 0; i < queries.size(); ++i)
+    {
+        PhantomNode phantom_rtree;
+        rtree.FindPhantomNodeForCoordinate(queries[i], phantom_rtree, 1);
+        BOOST_CHECK_EQUAL(batch_phantoms[i], phantom_rtree);
+
+        std::vector<PhantomNode> incremental_phantoms;
+        rtree.IncrementalFindPhantomNodeForCoordinate(queries[i], incremental_phantoms, 1, 1);
+        BOOST_REQUIRE_EQUAL(incremental_phantoms.size(), batch_incremental_phantoms[i].size());
+        for (unsigned j = 0; j < incremental_phantoms.size(); ++j)
+        {
+            BOOST_CHECK_EQUAL(incremental_phantoms[j], batch_incremental_phantoms[i][j]);
+        }
+    }
 }
 
 template <typename FixtureT, typename RTreeT = TestStaticRTree>
 void build_rtree(const std::string &prefix,
                  FixtureT *fixture,
                  std::string &leaves_path,
-                 std::string &nodes_path)
+                 std::string &segments_path,
+                 std::string &nodes_path,
+                 const RTreePacking packing = RTreePacking::Hilbert)
 {
     nodes_path = prefix + ".ramIndex";
     leaves_path = prefix + ".fileIndex";
+    segments_path = prefix + ".segments";
     const std::string coords_path = prefix + ".nodes";
 
     boost::filesystem::ofstream node_stream(coords_path, std::ios::binary);
@@ -317,20 +350,31 @@ void build_rtree(const std::string &prefix,
     node_stream.write((char *)&(fixture->nodes[0]), num_nodes * sizeof(NodeInfo));
     node_stream.close();
 
-    RTreeT r(fixture->edges, nodes_path, leaves_path, fixture->nodes);
+    RTreeT r(fixture->edges, nodes_path, leaves_path, segments_path, fixture->nodes, packing);
 }
 
 template <typename FixtureT, typename RTreeT = TestStaticRTree>
-void construction_test(const std::string &prefix, FixtureT *fixture)
+void construction_test(const std::string &prefix,
+                       FixtureT *fixture,
+                       const RTreePacking packing = RTreePacking::Hilbert)
 {
     std::string leaves_path;
+    std::string segments_path;
     std::string nodes_path;
-    build_rtree<FixtureT, RTreeT>(prefix, fixture, leaves_path, nodes_path);
-    RTreeT rtree(nodes_path, leaves_path, fixture->coords);
+    build_rtree<FixtureT, RTreeT>(
+        prefix, fixture, leaves_path, segments_path, nodes_path, packing);
+    RTreeT rtree(nodes_path, leaves_path, segments_path, fixture->coords);
     LinearSearchNN lsnn(fixture->coords, fixture->edges);
 
     simple_verify_rtree(rtree, fixture->coords, fixture->edges);
     sampling_verify_rtree(rtree, lsnn, 100);
+
+    // a cache of a single leaf evicts on almost every query
+    const auto leaf_cache = std::make_shared<typename RTreeT::LeafCache>(1);
+    RTreeT cached_rtree(nodes_path, leaves_path, segments_path, fixture->coords, leaf_cache);
+    sampling_verify_rtree(cached_rtree, lsnn, 100);
+    BOOST_CHECK_GT(leaf_cache->GetStatistics().misses, 0);
+    BOOST_CHECK_EQUAL(leaf_cache->GetStatistics().capacity, 1);
 }
 
 BOOST_FIXTURE_TEST_CASE(construct_half_leaf_test, TestRandomGraphFixture_LeafHalfFull)
@@ -358,6 +402,276 @@ BOOST_FIXTURE_TEST_CASE(construct_multiple_levels_test, TestRandomGraphFixture_M
     construction_test("test_5", this);
 }
 
+BOOST_FIXTURE_TEST_CASE(construct_str_two_leaves_test, TestRandomGraphFixture_TwoLeaves)
+{
+    construction_test("test_str_3", this, RTreePacking::SortTileRecursive);
+}
+
+BOOST_FIXTURE_TEST_CASE(construct_str_multiple_levels_test, TestRandomGraphFixture_MultipleLevels)
+{
+    construction_test("test_str_5", this, RTreePacking::SortTileRecursive);
+}
+
+// Every level covers the segments, and every level below the root has as many nodes as its
+// parents have children
+BOOST_FIXTURE_TEST_CASE(level_statistics_test, TestRandomGraphFixture_MultipleLevels)
+{
+    for (const RTreePacking packing : {RTreePacking::Hilbert, RTreePacking::SortTileRecursive})
+    {
+        std::string leaves_path;
+        std::string segments_path;
+        std::string nodes_path;
+        build_rtree<TestRandomGraphFixture_MultipleLevels>(
+            "test_statistics", this, leaves_path, segments_path, nodes_path, packing);
+        TestStaticRTree rtree(nodes_path, leaves_path, segments_path, coords);
+
+        const auto statistics = rtree.GetLevelStatistics();
+        BOOST_REQUIRE_GT(statistics.size(), 2);
+        BOOST_CHECK_EQUAL(statistics.front().number_of_nodes, 1);
+        BOOST_CHECK_CLOSE(statistics.front().coverage, 1., 0.0001);
+        BOOST_CHECK_EQUAL(statistics.front().overlap, 0.);
+        const unsigned number_of_leaves =
+            (edges.size() + TEST_LEAF_NODE_SIZE - 1) / TEST_LEAF_NODE_SIZE;
+        BOOST_CHECK_EQUAL(statistics.back().number_of_nodes, number_of_leaves);
+        for (unsigned level = 1; level < statistics.size(); ++level)
+        {
+            BOOST_CHECK_EQUAL(statistics[level].level, level);
+            BOOST_CHECK_GT(statistics[level].number_of_nodes, statistics[level - 1].number_of_nodes);
+            BOOST_CHECK_GT(statistics[level].coverage, 0.);
+            BOOST_CHECK_GE(statistics[level].overlap, 0.);
+        }
+    }
+}
+
+// The lower bounds of every kernel only skip segments that cannot change the result
+BOOST_FIXTURE_TEST_CASE(leaf_scan_kernels_test, TestRandomGraphFixture_MultipleLevels)
+{
+    std::string leaves_path;
+    std::string segments_path;
+    std::string nodes_path;
+    build_rtree<TestRandomGraphFixture_MultipleLevels>(
+        "test_kernels", this, leaves_path, segments_path, nodes_path);
+    TestStaticRTree exact_rtree(nodes_path, leaves_path, segments_path, coords);
+    exact_rtree.SetLeafScanKernel(LeafScanKernel::Exact);
+    TestStaticRTree rtree(nodes_path, leaves_path, segments_path, coords);
+
+    std::mt19937 g(RANDOM_SEED);
+    std::uniform_int_distribution<> lat_udist(WORLD_MIN_LAT, WORLD_MAX_LAT);
+    std::uniform_int_distribution<> lon_udist(WORLD_MIN_LON, WORLD_MAX_LON);
+    std::vector<FixedPointCoordinate> queries;
+    for (unsigned i = 0; i < 100; ++i)
+    {
+        queries.emplace_back(lat_udist(g), lon_udist(g));
+    }
+
+    for (const LeafScanKernel kernel :
+         {LeafScanKernel::Scalar, LeafScanKernel::SSE2, LeafScanKernel::AVX2})
+    {
+        if (!IsLeafScanKernelSupported(kernel))
+        {
+            continue;
+        }
+        BOOST_TEST_MESSAGE("Leaf scan kernel " << GetLeafScanKernelName(kernel));
+        rtree.SetLeafScanKernel(kernel);
+        for (const auto &q : queries)
+        {
+            PhantomNode exact_phantom;
+            exact_rtree.FindPhantomNodeForCoordinate(q, exact_phantom, 1);
+            PhantomNode phantom;
+            rtree.FindPhantomNodeForCoordinate(q, phantom, 1);
+            BOOST_CHECK_EQUAL(exact_phantom, phantom);
+
+            std::vector<PhantomNode> exact_phantoms;
+            exact_rtree.IncrementalFindPhantomNodeForCoordinate(q, exact_phantoms, 1, 5);
+            std::vector<PhantomNode> phantoms;
+            rtree.IncrementalFindPhantomNodeForCoordinate(q, phantoms, 1, 5);
+            BOOST_REQUIRE_EQUAL(exact_phantoms.size(), phantoms.size());
+            for (unsigned j = 0; j < phantoms.size(); ++j)
+            {
+                BOOST_CHECK_EQUAL(exact_phantoms[j], phantoms[j]);
+            }
+        }
+    }
+}
+
+// The k nearest segments within a radius are the closest ones a linear scan finds
+BOOST_FIXTURE_TEST_CASE(nearest_with_distance_test, TestRandomGraphFixture_MultipleLevels)
+{
+    std::string leaves_path;
+    std::string segments_path;
+    std::string nodes_path;
+    build_rtree<TestRandomGraphFixture_MultipleLevels>(
+        "test_nearest", this, leaves_path, segments_path, nodes_path);
+    TestStaticRTree rtree(nodes_path, leaves_path, segments_path, coords);
+
+    std::mt19937 g(RANDOM_SEED);
+    std::uniform_int_distribution<> lat_udist(WORLD_MIN_LAT, WORLD_MAX_LAT);
+    std::uniform_int_distribution<> lon_udist(WORLD_MIN_LON, WORLD_MAX_LON);
+    for (unsigned i = 0; i < 100; ++i)
+    {
+        const FixedPointCoordinate q(lat_udist(g), lon_udist(g));
+        std::vector<float> distances;
+        for (const TestData &e : edges)
+        {
+            distances.push_back(FixedPointCoordinate::ComputePerpendicularDistance(
+                coords->at(e.u), coords->at(e.v), q));
+        }
+        std::sort(distances.begin(), distances.end());
+
+        std::vector<PhantomNode> phantoms;
+        rtree.IncrementalFindPhantomNodeForCoordinate(q, phantoms, 1, 5);
+        std::vector<std::pair<PhantomNode, double>> phantoms_with_distance;
+        rtree.IncrementalFindPhantomNodeForCoordinateWithDistance(q, phantoms_with_distance, 1, 5);
+        BOOST_REQUIRE_EQUAL(phantoms_with_distance.size(), 5);
+        BOOST_REQUIRE_EQUAL(phantoms.size(), phantoms_with_distance.size());
+        for (unsigned j = 0; j < phantoms.size(); ++j)
+        {
+            BOOST_CHECK_EQUAL(phantoms[j], phantoms_with_distance[j].first);
+            BOOST_CHECK_CLOSE(phantoms_with_distance[j].second, distances[j], 0.01);
+        }
+
+        // a radius between the third and the fourth closest segment leaves three of them
+        if (distances[3] - distances[2] < 1.f)
+        {
+            continue;
+        }
+        const float radius = (distances[2] + distances[3]) / 2;
+        phantoms_with_distance.clear();
+        rtree.IncrementalFindPhantomNodeForCoordinateWithDistance(
+            q, phantoms_with_distance, 1, 5, radius);
+        BOOST_CHECK_EQUAL(phantoms_with_distance.size(), 3);
+        for (const auto &phantom_with_distance : phantoms_with_distance)
+        {
+            BOOST_CHECK_LT(phantom_with_distance.second, radius);
+        }
+
+        phantoms_with_distance.clear();
+        BOOST_CHECK(!rtree.IncrementalFindPhantomNodeForCoordinateWithDistance(
+            q, phantoms_with_distance, 1, 5, distances[0] / 2));
+        BOOST_CHECK(phantoms_with_distance.empty());
+    }
+}
+
+// Results in tiny components do not take the places of results in big components
+BOOST_AUTO_TEST_CASE(nearest_tiny_component_test)
+{
+    typedef std::pair<float, float> Coord;
+    typedef std::pair<unsigned, unsigned> Edge;
+    // five parallel segments north of the query, each a degree further away
+    std::vector<Coord> input_coords;
+    std::vector<Edge> input_edges;
+    for (unsigned i = 0; i < 5; ++i)
+    {
+        input_coords.emplace_back(1.0 + i, -1.0);
+        input_coords.emplace_back(1.0 + i, 1.0);
+        input_edges.emplace_back(2 * i, 2 * i + 1);
+    }
+    GraphFixture fixture(input_coords, input_edges);
+    for (unsigned i = 0; i < fixture.edges.size(); ++i)
+    {
+        fixture.edges[i].name_id = i;
+        fixture.edges[i].is_in_tiny_cc = (0 == i % 2);
+    }
+
+    std::string leaves_path;
+    std::string segments_path;
+    std::string nodes_path;
+    build_rtree<GraphFixture>("test_tiny", &fixture, leaves_path, segments_path, nodes_path);
+    TestStaticRTree rtree(nodes_path, leaves_path, segments_path, fixture.coords);
+
+    const FixedPointCoordinate input(0, 0);
+    std::vector<std::pair<PhantomNode, double>> phantoms_with_distance;
+    rtree.IncrementalFindPhantomNodeForCoordinateWithDistance(input, phantoms_with_distance, 1, 2);
+    BOOST_REQUIRE_EQUAL(phantoms_with_distance.size(), 2);
+    BOOST_CHECK_EQUAL(phantoms_with_distance[0].first.name_id, 1);
+    BOOST_CHECK_EQUAL(phantoms_with_distance[1].first.name_id, 3);
+
+    // within the radius there is only a tiny component, it stands in for the big ones
+    phantoms_with_distance.clear();
+    rtree.IncrementalFindPhantomNodeForCoordinateWithDistance(
+        input, phantoms_with_distance, 1, 5, 150000.f);
+    BOOST_REQUIRE_EQUAL(phantoms_with_distance.size(), 1);
+    BOOST_CHECK_EQUAL(phantoms_with_distance[0].first.name_id, 0);
+
+    // a radius that reaches a big component drops the tiny one
+    phantoms_with_distance.clear();
+    rtree.IncrementalFindPhantomNodeForCoordinateWithDistance(
+        input, phantoms_with_distance, 1, 5, 250000.f);
+    BOOST_REQUIRE_EQUAL(phantoms_with_distance.size(), 1);
+    BOOST_CHECK_EQUAL(phantoms_with_distance[0].first.name_id, 1);
+}
+
+// Legacy leaf files must still load and give the same results
+BOOST_FIXTURE_TEST_CASE(legacy_leaf_file_test, TestRandomGraphFixture_TwoLeaves)
+{
+    std::string leaves_path;
+    std::string segments_path;
+    std::string nodes_path;
+    build_rtree<TestRandomGraphFixture_TwoLeaves>(
+        "test_legacy", this, leaves_path, segments_path, nodes_path);
+
+    // the leaf file holds no segments, they are in the segment file in the order of the leaves
+    boost::filesystem::ifstream leaves_stream(leaves_path, std::ios::binary);
+    TestStaticRTree::LeafFileHeader header;
+    leaves_stream.read((char *)&header, sizeof(header));
+    BOOST_REQUIRE_EQUAL(header.magic_number, TestStaticRTree::LEAF_FILE_MAGIC_NUMBER);
+    BOOST_REQUIRE_EQUAL(header.element_count, edges.size());
+    const uint64_t number_of_leaves =
+        (header.element_count + TEST_LEAF_NODE_SIZE - 1) / TEST_LEAF_NODE_SIZE;
+    std::vector<uint64_t> leaf_offsets(number_of_leaves + 1);
+    leaves_stream.read((char *)leaf_offsets.data(), leaf_offsets.size() * sizeof(uint64_t));
+    BOOST_REQUIRE(leaves_stream.good());
+    BOOST_CHECK_EQUAL(leaf_offsets.back(), boost::filesystem::file_size(leaves_path));
+    leaves_stream.close();
+
+    std::vector<TestData> segments(header.element_count);
+    BOOST_REQUIRE_EQUAL(boost::filesystem::file_size(segments_path),
+                        segments.size() * sizeof(TestData));
+    boost::filesystem::ifstream segments_stream(segments_path, std::ios::binary);
+    segments_stream.read((char *)segments.data(), segments.size() * sizeof(TestData));
+    BOOST_REQUIRE(segments_stream.good());
+
+    // the legacy format is the element count followed by the object count and a full array of
+    // objects per leaf
+    const std::string legacy_leaves_path = "test_legacy_v0.fileIndex";
+    boost::filesystem::ofstream legacy_stream(legacy_leaves_path, std::ios::binary);
+    legacy_stream.write((char *)&header.element_count, sizeof(uint64_t));
+    for (uint64_t first = 0; first < segments.size(); first += TEST_LEAF_NODE_SIZE)
+    {
+        const uint32_t object_count =
+            std::min<uint64_t>(TEST_LEAF_NODE_SIZE, segments.size() - first);
+        std::vector<TestData> objects(TEST_LEAF_NODE_SIZE);
+        std::copy(segments.begin() + first, segments.begin() + first + object_count, objects.begin());
+        legacy_stream.write((char *)&object_count, sizeof(uint32_t));
+        legacy_stream.write((char *)objects.data(), objects.size() * sizeof(TestData));
+    }
+    legacy_stream.close();
+
+    // it does not need a segment file
+    TestStaticRTree rtree(nodes_path, leaves_path, segments_path, coords);
+    TestStaticRTree legacy_rtree(nodes_path, legacy_leaves_path, "", coords);
+    LinearSearchNN lsnn(coords, edges);
+    simple_verify_rtree(legacy_rtree, coords, edges);
+    sampling_verify_rtree(legacy_rtree, lsnn, 100);
+
+    std::mt19937 g(RANDOM_SEED);
+    std::uniform_int_distribution<> lat_udist(WORLD_MIN_LAT, WORLD_MAX_LAT);
+    std::uniform_int_distribution<> lon_udist(WORLD_MIN_LON, WORLD_MAX_LON);
+    for (unsigned i = 0; i < 100; ++i)
+    {
+        const FixedPointCoordinate q(lat_udist(g), lon_udist(g));
+        std::vector<PhantomNode> phantoms;
+        rtree.IncrementalFindPhantomNodeForCoordinate(q, phantoms, 1, 5);
+        std::vector<PhantomNode> legacy_phantoms;
+        legacy_rtree.IncrementalFindPhantomNodeForCoordinate(q, legacy_phantoms, 1, 5);
+        BOOST_REQUIRE_EQUAL(phantoms.size(), legacy_phantoms.size());
+        for (unsigned j = 0; j < phantoms.size(); ++j)
+        {
+            BOOST_CHECK_EQUAL(phantoms[j], legacy_phantoms[j]);
+        }
+    }
+}
+
 /*
  * Bug: If you querry a point that lies between two BBs that have a gap,
  * one BB will be pruned, even if it could contain a nearer match.
@@ -387,20 +701,25 @@ BOOST_AUTO_TEST_CASE(regression_test)
     typedef StaticRTree<TestData, std::vector<FixedPointCoordinate>, false, 2, 3> MiniStaticRTree;
 
     std::string leaves_path;
+
+    std::string segments_path;
     std::string nodes_path;
-    build_rtree<GraphFixture, MiniStaticRTree>(
-        "test_regression", &fixture, leaves_path, nodes_path);
-    MiniStaticRTree rtree(nodes_path, leaves_path, fixture.coords);
-
-    // query a node just right of the center of the gap
-    FixedPointCoordinate input(20.0 * COORDINATE_PRECISION, 55.1 * COORDINATE_PRECISION);
-    FixedPointCoordinate result;
-    rtree.LocateClosestEndPointForCoordinate(input, result, 1);
-    FixedPointCoordinate result_ln;
-    LinearSearchNN lsnn(fixture.coords, fixture.edges);
-    lsnn.LocateClosestEndPointForCoordinate(input, result_ln, 1);
-
-    BOOST_CHECK_EQUAL(result_ln, result);
+    for (const RTreePacking packing : {RTreePacking::Hilbert, RTreePacking::SortTileRecursive})
+    {
+        build_rtree<GraphFixture, MiniStaticRTree>(
+            "test_regression", &fixture, leaves_path, segments_path, nodes_path, packing);
+        MiniStaticRTree rtree(nodes_path, leaves_path, segments_path, fixture.coords);
+
+        // query a node just right of the center of the gap
+        FixedPointCoordinate input(20.0 * COORDINATE_PRECISION, 55.1 * COORDINATE_PRECISION);
+        FixedPointCoordinate result;
+        rtree.LocateClosestEndPointForCoordinate(input, result, 1);
+        FixedPointCoordinate result_ln;
+        LinearSearchNN lsnn(fixture.coords, fixture.edges);
+        lsnn.LocateClosestEndPointForCoordinate(input, result_ln, 1);
+
+        BOOST_CHECK_EQUAL(result_ln, result);
+    }
 }
 
 void TestRectangle(double width, double height, double center_lat, double center_lon)
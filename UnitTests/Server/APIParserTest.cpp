@@ -0,0 +1,217 @@
+#include "../../Server/APIGrammar.h"
+#include "../../Server/APIParser.h"
+
+#include <osrm/RouteParameters.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(api_parser)
+
+typedef APIGrammar<std::string::iterator, RouteParameters> APIGrammarParser;
+
+// position up to which the reference grammar consumed the request
+std::size_t ParseWithGrammar(std::string request, RouteParameters &parameters)
+{
+    APIGrammarParser grammar(&parameters);
+    auto iter = request.begin();
+    const bool result = boost::spirit::qi::parse(iter, request.end(), grammar);
+    if (!result)
+    {
+        return 0;
+    }
+    return static_cast<std::size_t>(std::distance(request.begin(), iter));
+}
+
+void CheckEquivalence(const std::string &request)
+{
+    RouteParameters expected, actual;
+    const std::size_t expected_position = ParseWithGrammar(request, expected);
+    APIParser parser(actual);
+    const std::size_t actual_position = parser.Parse(request);
+
+    BOOST_TEST_CHECKPOINT("request: " << request);
+    BOOST_CHECK_EQUAL(expected_position, actual_position);
+
+    // rejected requests are never handed to a plugin. the grammar also leaves partial
+    // attributes of failed alternatives behind, e.g. a dangling '%' in a jsonp name
+    if (expected_position != request.size())
+    {
+        return;
+    }
+    BOOST_CHECK_EQUAL(expected.zoom_level, actual.zoom_level);
+    BOOST_CHECK_EQUAL(expected.print_instructions, actual.print_instructions);
+    BOOST_CHECK_EQUAL(expected.alternate_route, actual.alternate_route);
+    BOOST_CHECK_EQUAL(expected.number_of_alternatives, actual.number_of_alternatives);
+    BOOST_CHECK_EQUAL(expected.time_bound, actual.time_bound);
+    BOOST_CHECK_EQUAL(expected.number_of_results, actual.number_of_results);
+    BOOST_CHECK_EQUAL(expected.radius, actual.radius);
+    BOOST_CHECK_EQUAL(expected.geometry, actual.geometry);
+    BOOST_CHECK_EQUAL(expected.compression, actual.compression);
+    BOOST_CHECK_EQUAL(expected.deprecatedAPI, actual.deprecatedAPI);
+    BOOST_CHECK_EQUAL(expected.uturn_default, actual.uturn_default);
+    BOOST_CHECK_EQUAL(expected.check_sum, actual.check_sum);
+    BOOST_CHECK_EQUAL(expected.timeout, actual.timeout);
+    BOOST_CHECK_EQUAL(expected.service, actual.service);
+    BOOST_CHECK_EQUAL(expected.output_format, actual.output_format);
+    BOOST_CHECK_EQUAL(expected.jsonp_parameter, actual.jsonp_parameter);
+    BOOST_CHECK_EQUAL(expected.language, actual.language);
+    BOOST_CHECK(expected.hints == actual.hints);
+    BOOST_CHECK(expected.uturns == actual.uturns);
+    BOOST_REQUIRE_EQUAL(expected.coordinates.size(), actual.coordinates.size());
+    for (std::size_t i = 0; i < expected.coordinates.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(expected.coordinates[i].lat, actual.coordinates[i].lat);
+        BOOST_CHECK_EQUAL(expected.coordinates[i].lon, actual.coordinates[i].lon);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(well_formed_requests)
+{
+    const std::vector<std::string> requests = {
+        "/viaroute?loc=52.519930,13.438640&loc=52.513191,13.415852",
+        "/viaroute?z=14&output=json&jsonp=cb_1.x[0]&instructions=true&alt=false"
+        "&loc=52.5,13.4&hint=abc_-.1&loc=-33.9,+18.4&u=true&hint=xyz&geometry=false"
+        "&compression=false&checksum=123456&hl=de&timeout=250&alternatives=3",
+        "/table?loc=1e1,2E-1&loc=.5,5.&loc=-0.000001,179.9999999999999999",
+        "/nearest?loc=52.4,13.1&z=-3",
+        "/viaroute?loc=1,2&loc=3,4&uturns=true",
+        "/viaroute?loc=1,2?loc=3,4&geomformat=cmp",
+        "/locate?loc=52.4,13.1&z=99999",
+        "/isochrone?loc=52.4,13.1&time=900&geometry=false",
+        "/viaroute?loc=1,2&loc=3,4&alternatives=0",
+        "/nearest?loc=52.4,13.1&number=5&radius=25.5",
+        "/nearest?loc=52.4,13.1&number=0&radius=-10",
+    };
+    for (const std::string &request : requests)
+    {
+        CheckEquivalence(request);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(malformed_requests)
+{
+    const std::vector<std::string> requests = {
+        "", "/", "viaroute", "/123", "/viaroute?", "/viaroute?loc=52.5", "/viaroute?loc=a,b",
+        "/viaroute?loc=1,2&", "/viaroute?z=", "/viaroute?z=1x", "/viaroute?checksum=-1",
+        "/viaroute?checksum=4294967296", "/viaroute?alt=True", "/viaroute?alternatives=-1",
+        "/viaroute?uturns=true&loc=1,2",
+        "/viaroute?loc=1,2&uturns=true&uturns=false", "/viaroute?loc=1e,2", "/viaroute?jsonp=%zz",
+        "/viaroute?jsonp=a%4Fb%4", "/viaroute?geometryx=true", "/viaroute?ooutput=json",
+        "/nearest?loc=1,2&number=-1", "/nearest?loc=1,2&radius=", "/nearest?loc=1,2&radius=x",
+        "/viaroute?loc=nan,1", "/viaroute?loc=1,-inf", "/viaroute?loc=+Infinity,1",
+        "/viaroute?loc=NAN(1),1", "/nearest?loc=1,2&radius=inf", "/nearest?loc=1,2&radius=nan",
+    };
+    for (const std::string &request : requests)
+    {
+        CheckEquivalence(request);
+    }
+}
+
+// random requests glued together from valid and broken fragments
+BOOST_AUTO_TEST_CASE(fuzzed_requests)
+{
+    const std::vector<std::string> fragments = {
+        "/viaroute", "/table", "?", "&", "loc=", "z=", "output=", "jsonp=", "checksum=",
+        "hint=", "u=", "uturns=", "compression=", "hl=", "instructions=", "geometry=", "alt=",
+        "alternatives=", "time=", "number=", "radius=", "geomformat=", "timeout=", "true",
+        "false", "json", "gpx",
+        "52.519930", "-13.4", "+0.5", ".", ",", "1e3", "E", "-", "_", "[", "]", "%41", "%", "=",
+        "12345678901", "0", "999", "abc", "x.y-z", "1.23456789012345678901", "nan", "inf",
+        "infinity",
+    };
+    std::mt19937 generator(4711);
+    std::uniform_int_distribution<std::size_t> fragment_distribution(0, fragments.size() - 1);
+    std::uniform_int_distribution<std::size_t> length_distribution(1, 12);
+    for (unsigned round = 0; round < 5000; ++round)
+    {
+        std::string request = (0 == round % 3 ? "/viaroute?" : "");
+        const std::size_t length = length_distribution(generator);
+        for (std::size_t i = 0; i < length; ++i)
+        {
+            request += fragments[fragment_distribution(generator)];
+        }
+        CheckEquivalence(request);
+    }
+}
+
+// mostly well-formed requests built from parameters with random values, some of them
+// with a single character flipped
+BOOST_AUTO_TEST_CASE(fuzzed_parameters)
+{
+    const std::vector<std::pair<std::string, std::vector<std::string>>> parameters = {
+        {"z", {"17", "-1", "+3", "99999"}},
+        {"output", {"json", "gpx", "binary"}},
+        {"jsonp", {"cb_[1]", "a.b-c", "x%41Z"}},
+        {"checksum", {"0", "4294967295", "007"}},
+        {"hint", {"x.y-z", "abc_123"}},
+        {"u", {"true", "false"}},
+        {"compression", {"true", "false"}},
+        {"hl", {"de", "en"}},
+        {"instructions", {"true", "false"}},
+        {"geometry", {"true", "false"}},
+        {"alt", {"true", "false"}},
+        {"alternatives", {"0", "1", "5"}},
+        {"time", {"0", "900"}},
+        {"number", {"0", "1", "10"}},
+        {"radius", {"0", "25.5", "-3", "1e2"}},
+        {"geomformat", {"cmp"}},
+        {"timeout", {"0", "250"}},
+        {"loc", {}},
+        {"loc", {}},
+    };
+    std::mt19937 generator(1337);
+    std::uniform_int_distribution<std::size_t> parameter_distribution(0, parameters.size() - 1);
+    std::uniform_int_distribution<int> digit_distribution(0, 9);
+    std::uniform_int_distribution<int> printable_distribution(32, 126);
+    std::uniform_int_distribution<int> percent_distribution(0, 99);
+    std::uniform_real_distribution<double> coordinate_distribution(-180., 180.);
+    for (unsigned round = 0; round < 5000; ++round)
+    {
+        std::string request = "/viaroute";
+        const int number_of_parameters = 1 + digit_distribution(generator);
+        for (int i = 0; i < number_of_parameters; ++i)
+        {
+            request += (0 == i ? '?' : '&');
+            const auto &parameter = parameters[parameter_distribution(generator)];
+            request += parameter.first + "=";
+            if (parameter.second.empty())
+            {
+                std::string coordinate =
+                    std::to_string(coordinate_distribution(generator)).substr(
+                        0, 4 + digit_distribution(generator));
+                request += coordinate + "," + std::to_string(coordinate_distribution(generator));
+            }
+            else
+            {
+                std::uniform_int_distribution<std::size_t> value_distribution(
+                    0, parameter.second.size() - 1);
+                request += parameter.second[value_distribution(generator)];
+            }
+        }
+        if (percent_distribution(generator) < 10)
+        {
+            request += "&uturns=true";
+        }
+        if (percent_distribution(generator) < 30)
+        {
+            std::uniform_int_distribution<std::size_t> position_distribution(0, request.size() - 1);
+            request[position_distribution(generator)] =
+                static_cast<char>(printable_distribution(generator));
+        }
+        CheckEquivalence(request);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(in_place_decoding)
+{
+    std::string request = "/viaroute%3Floc=52.5%2C13.4%26loc%3d1,2%2";
+    APIParser::DecodeInPlace(request);
+    BOOST_CHECK_EQUAL(request, "/viaroute?loc=52.5,13.4&loc=1,2%2");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,166 @@
+#include "../../Library/OSRM.h"
+#include "../../Server/RequestHandler.h"
+#include "../../Server/Http/Request.h"
+
+#include <osrm/Reply.h>
+#include <osrm/RouteParameters.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+
+// The tests do not link libOSRM. This stand-in answers every query with its service name
+// and the number of coordinates, so the request handler can be checked without a data set.
+OSRM::OSRM(const ServerPaths &, const bool, const unsigned, const unsigned, const unsigned)
+    : OSRM_pimpl_(nullptr)
+{
+}
+
+OSRM::~OSRM() {}
+
+void OSRM::RunQuery(RouteParameters &route_parameters, http::Reply &reply)
+{
+    if ("unknown" == route_parameters.service)
+    {
+        reply = http::Reply::StockReply(http::Reply::badRequest);
+        return;
+    }
+    reply.status = http::Reply::ok;
+    const std::string result = "{\"service\":\"" + route_parameters.service + "\",\"locations\":" +
+                               std::to_string(route_parameters.coordinates.size()) + "}";
+    reply.content.insert(reply.content.end(), result.begin(), result.end());
+}
+
+BOOST_AUTO_TEST_SUITE(batch_request)
+
+std::string RunRequest(const std::string &method,
+                       const std::string &uri,
+                       const std::string &body,
+                       http::Reply &reply)
+{
+    ServerPaths paths;
+    OSRM routing_machine(paths);
+    RequestHandler handler;
+    handler.RegisterRoutingMachine(&routing_machine);
+
+    http::Request request;
+    request.method = method;
+    request.uri = uri;
+    request.body = body;
+    handler.handle_request(request, reply);
+    return std::string(reply.content.begin(), reply.content.end());
+}
+
+std::string RunBatch(const std::string &uri, const std::string &body, http::Reply &reply)
+{
+    return RunRequest("POST", uri, body, reply);
+}
+
+std::string GetContentType(const http::Reply &reply)
+{
+    std::string content_type;
+    for (const http::Header &header : reply.headers)
+    {
+        if ("Content-Type" == header.name)
+        {
+            content_type = header.value;
+        }
+    }
+    return content_type;
+}
+
+BOOST_AUTO_TEST_CASE(mixed_lines)
+{
+    const std::string body = "/viaroute?loc=52.5,13.4&loc=52.6,13.3\n"
+                             "/viaroute?loc=52.5,13.4&loc=abc\r\n"
+                             "\n"
+                             "/nearest?loc=52.5%2C13.4\r\n"
+                             "/viaroute?loc=52.5,13.4&loc=52.6,13.3&jsonp=callback\n"
+                             "/viaroute?loc=52.5,13.4&loc=52.6,13.3&output=gpx\n"
+                             "/table?loc=52.5,13.4&loc=52.6,13.3&output=binary\n"
+                             "/table?loc=52.5,13.4&loc=52.6,13.3";
+    const std::string bad_request = http::badRequestHTML;
+
+    http::Reply reply;
+    const std::string result = RunBatch("/batch", body, reply);
+    BOOST_CHECK_EQUAL(reply.status, http::Reply::ok);
+    // empty lines are skipped, the results keep the order of the queries
+    BOOST_CHECK_EQUAL(result,
+                      "[{\"service\":\"viaroute\",\"locations\":2}," + bad_request +
+                          ",{\"service\":\"nearest\",\"locations\":1}," + bad_request + "," +
+                          bad_request + "," + bad_request +
+                          ",{\"service\":\"table\",\"locations\":2}]");
+
+    bool has_content_type = false;
+    for (const http::Header &header : reply.headers)
+    {
+        if ("Content-Type" == header.name)
+        {
+            has_content_type = true;
+            BOOST_CHECK_EQUAL(header.value, "application/json; charset=UTF-8");
+        }
+        if ("Content-Length" == header.name)
+        {
+            BOOST_CHECK_EQUAL(header.value, std::to_string(result.size()));
+        }
+    }
+    BOOST_CHECK(has_content_type);
+}
+
+BOOST_AUTO_TEST_CASE(empty_batch)
+{
+    http::Reply reply;
+    BOOST_CHECK_EQUAL(RunBatch("/batch", "", reply), "[]");
+    BOOST_CHECK_EQUAL(reply.status, http::Reply::ok);
+}
+
+BOOST_AUTO_TEST_CASE(query_limit)
+{
+    std::string body;
+    for (std::size_t i = 0; i < RequestHandler::MAX_BATCH_QUERIES; ++i)
+    {
+        body += "/nearest?loc=52.5,13.4\n\n";
+    }
+
+    std::string expected_result = "[";
+    for (std::size_t i = 0; i < RequestHandler::MAX_BATCH_QUERIES; ++i)
+    {
+        expected_result += (0 == i ? "" : ",");
+        expected_result += "{\"service\":\"nearest\",\"locations\":1}";
+    }
+    expected_result += "]";
+
+    http::Reply reply;
+    BOOST_CHECK(RunBatch("/batch", body, reply) == expected_result);
+    BOOST_CHECK_EQUAL(reply.status, http::Reply::ok);
+
+    // empty lines do not count
+    body += "/nearest?loc=52.5,13.4";
+    http::Reply rejected_reply;
+    BOOST_CHECK_EQUAL(RunBatch("/batch", body, rejected_reply), http::badRequestHTML);
+    BOOST_CHECK_EQUAL(rejected_reply.status, http::Reply::badRequest);
+}
+
+BOOST_AUTO_TEST_CASE(wrong_uri)
+{
+    http::Reply reply;
+    RunBatch("/viaroute", "/nearest?loc=52.5,13.4\n", reply);
+    BOOST_CHECK_EQUAL(reply.status, http::Reply::badRequest);
+}
+
+BOOST_AUTO_TEST_CASE(binary_errors_are_json)
+{
+    http::Reply reply;
+    RunRequest("GET", "/table?loc=52.5,13.4&loc=52.6,13.3&output=binary", "", reply);
+    BOOST_CHECK_EQUAL(reply.status, http::Reply::ok);
+    BOOST_CHECK_EQUAL(GetContentType(reply), "application/octet-stream");
+
+    http::Reply error_reply;
+    const std::string result =
+        RunRequest("GET", "/unknown?loc=52.5,13.4&output=binary", "", error_reply);
+    BOOST_CHECK_EQUAL(error_reply.status, http::Reply::badRequest);
+    BOOST_CHECK_EQUAL(result, http::badRequestHTML);
+    BOOST_CHECK_EQUAL(GetContentType(error_reply), "application/json; charset=UTF-8");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
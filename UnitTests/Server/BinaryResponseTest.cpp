@@ -0,0 +1,165 @@
+#include "../../Descriptors/BinaryDescriptor.h"
+#include "../../DataStructures/PhantomNodes.h"
+#include "../../DataStructures/RawRouteData.h"
+#include "../../typedefs.h"
+
+#include <osrm/BinaryResponse.h>
+#include <osrm/Coordinate.h>
+#include <osrm/Reply.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(binary_response)
+
+// Serves the coordinates and street names that the descriptor looks up
+struct TestFacade
+{
+    std::vector<FixedPointCoordinate> coordinates;
+    std::vector<std::string> names;
+
+    FixedPointCoordinate GetCoordinateOfNode(const NodeID id) const { return coordinates[id]; }
+
+    void GetName(const unsigned name_id, std::string &result) const { result = names[name_id]; }
+};
+
+PhantomNode MakePhantom(const NodeID node, const unsigned name_id, FixedPointCoordinate location)
+{
+    return PhantomNode(node, SPECIAL_NODEID, name_id, 10, 10, 0, 0, SPECIAL_EDGEID, location, 0);
+}
+
+// heads north on Main Street, turns right into Side Street and ends there
+RawRouteData MakeRoute(TestFacade &facade)
+{
+    facade.coordinates = {FixedPointCoordinate(52501000, 13400000),
+                          FixedPointCoordinate(52501000, 13402000),
+                          FixedPointCoordinate(52501000, 13404000)};
+    facade.names = {"Main Street", "Side Street"};
+
+    RawRouteData raw_route;
+    raw_route.segment_end_coordinates.push_back(
+        PhantomNodes{MakePhantom(0, 0, FixedPointCoordinate(52500000, 13400000)),
+                     MakePhantom(2, 1, FixedPointCoordinate(52501000, 13405000))});
+    raw_route.source_traversed_in_reverse.push_back(false);
+    raw_route.target_traversed_in_reverse.push_back(false);
+    raw_route.unpacked_path_segments.push_back(
+        {PathData(0, 0, TurnInstruction::TurnRight, 100),
+         PathData(1, 1, TurnInstruction::NoTurn, 100),
+         PathData(2, 1, TurnInstruction::NoTurn, 100)});
+    raw_route.shortest_path_length = 320;
+    return raw_route;
+}
+
+BOOST_AUTO_TEST_CASE(route_round_trip)
+{
+    TestFacade facade;
+    const RawRouteData raw_route = MakeRoute(facade);
+
+    http::Reply reply;
+    BinaryDescriptor<TestFacade> descriptor(&facade);
+    descriptor.SetConfig(DescriptorConfig());
+    descriptor.Run(raw_route, reply);
+
+    osrm::binary::RouteResponse route;
+    BOOST_REQUIRE(osrm::binary::DecodeRoute(reply.content, route));
+    BOOST_CHECK_EQUAL(route.status, 0);
+    BOOST_CHECK_EQUAL(route.total_time, 32u);
+    BOOST_CHECK_GT(route.total_distance, 0u);
+
+    BOOST_REQUIRE_GE(route.coordinates.size(), 2u);
+    BOOST_CHECK_EQUAL(route.coordinates.front().first, 52500000);
+    BOOST_CHECK_EQUAL(route.coordinates.front().second, 13400000);
+    BOOST_CHECK_EQUAL(route.coordinates.back().first, 52501000);
+    BOOST_CHECK_EQUAL(route.coordinates.back().second, 13405000);
+    BOOST_CHECK(!route.via_indices.empty());
+
+    BOOST_REQUIRE_GE(route.instructions.size(), 3u);
+    BOOST_CHECK_EQUAL(route.instructions.front().turn_instruction,
+                      static_cast<uint8_t>(TurnInstruction::HeadOn));
+    BOOST_CHECK_EQUAL(route.instructions[1].turn_instruction,
+                      static_cast<uint8_t>(TurnInstruction::TurnRight));
+    BOOST_CHECK_EQUAL(route.instructions.back().turn_instruction,
+                      static_cast<uint8_t>(TurnInstruction::ReachedYourDestination));
+    for (const osrm::binary::Instruction &instruction : route.instructions)
+    {
+        BOOST_CHECK_LT(instruction.coordinate_index, route.coordinates.size());
+    }
+    BOOST_CHECK_EQUAL(route.names[route.instructions.front().name_index], "Main Street");
+    BOOST_CHECK_EQUAL(route.names[route.instructions[1].name_index], "Side Street");
+    BOOST_CHECK_EQUAL(route.names[route.instructions.back().name_index], "Side Street");
+
+    // every name is stored once
+    BOOST_CHECK_EQUAL(route.names.size(), 2u);
+
+    // cut-off replies are rejected
+    for (std::size_t length = 0; length < reply.content.size(); ++length)
+    {
+        const std::vector<char> truncated(reply.content.begin(), reply.content.begin() + length);
+        BOOST_CHECK(!osrm::binary::DecodeRoute(truncated, route));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(route_without_geometry_and_instructions)
+{
+    TestFacade facade;
+    const RawRouteData raw_route = MakeRoute(facade);
+
+    DescriptorConfig config;
+    config.geometry = false;
+    config.instructions = false;
+
+    http::Reply reply;
+    BinaryDescriptor<TestFacade> descriptor(&facade);
+    descriptor.SetConfig(config);
+    descriptor.Run(raw_route, reply);
+
+    osrm::binary::RouteResponse route;
+    BOOST_REQUIRE(osrm::binary::DecodeRoute(reply.content, route));
+    BOOST_CHECK_EQUAL(route.status, 0);
+    BOOST_CHECK_EQUAL(route.total_time, 32u);
+    BOOST_CHECK(route.coordinates.empty());
+    BOOST_CHECK(route.instructions.empty());
+    BOOST_CHECK(route.names.empty());
+}
+
+BOOST_AUTO_TEST_CASE(no_route)
+{
+    TestFacade facade;
+    http::Reply reply;
+    BinaryDescriptor<TestFacade> descriptor(&facade);
+    descriptor.Run(RawRouteData(), reply);
+
+    osrm::binary::RouteResponse route;
+    BOOST_REQUIRE(osrm::binary::DecodeRoute(reply.content, route));
+    BOOST_CHECK_EQUAL(route.status, 207);
+    BOOST_CHECK(route.coordinates.empty());
+}
+
+BOOST_AUTO_TEST_CASE(table_round_trip)
+{
+    const std::vector<EdgeWeight> table = {0, 35, INVALID_EDGE_WEIGHT, 41, 0, 17, 9, -3, 0};
+
+    http::Reply reply;
+    BinaryDescriptor<TestFacade>::RunTable(3, table, reply);
+
+    osrm::binary::TableResponse decoded;
+    BOOST_REQUIRE(osrm::binary::DecodeTable(reply.content, decoded));
+    BOOST_CHECK_EQUAL(decoded.status, 0);
+    BOOST_CHECK_EQUAL(decoded.number_of_locations, 3u);
+    BOOST_CHECK_EQUAL(decoded.matrix[2], std::numeric_limits<int32_t>::max());
+    BOOST_CHECK_EQUAL_COLLECTIONS(
+        decoded.matrix.begin(), decoded.matrix.end(), table.begin(), table.end());
+
+    // a table reply is not a route reply
+    osrm::binary::RouteResponse route;
+    BOOST_CHECK(!osrm::binary::DecodeRoute(reply.content, route));
+
+    reply.content.pop_back();
+    BOOST_CHECK(!osrm::binary::DecodeTable(reply.content, decoded));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,116 @@
+#include "../../Server/DeflateContext.h"
+
+#include <boost/asio.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <zlib.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(deflate_context)
+
+// copies the chunks of the output into one contiguous buffer
+std::vector<char> Flatten(const http::CompressedOutput &output)
+{
+    std::vector<boost::asio::const_buffer> buffers;
+    output.AppendBuffers(buffers);
+    std::vector<char> result;
+    for (const boost::asio::const_buffer &buffer : buffers)
+    {
+        const char *data = boost::asio::buffer_cast<const char *>(buffer);
+        result.insert(result.end(), data, data + boost::asio::buffer_size(buffer));
+    }
+    BOOST_CHECK_EQUAL(result.size(), output.Size());
+    return result;
+}
+
+std::vector<char> Inflate(const std::vector<char> &compressed, const int window_bits)
+{
+    z_stream stream;
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    stream.next_in = Z_NULL;
+    stream.avail_in = 0;
+    BOOST_REQUIRE_EQUAL(inflateInit2(&stream, window_bits), Z_OK);
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(compressed.data()));
+    stream.avail_in = static_cast<uInt>(compressed.size());
+
+    std::vector<char> result;
+    std::vector<char> buffer(4096);
+    int status = Z_OK;
+    while (Z_OK == status)
+    {
+        stream.next_out = reinterpret_cast<Bytef *>(buffer.data());
+        stream.avail_out = static_cast<uInt>(buffer.size());
+        status = inflate(&stream, Z_NO_FLUSH);
+        result.insert(result.end(), buffer.data(), buffer.data() + buffer.size() - stream.avail_out);
+    }
+    BOOST_CHECK_EQUAL(status, Z_STREAM_END);
+    BOOST_CHECK_EQUAL(stream.avail_in, 0);
+    inflateEnd(&stream);
+    return result;
+}
+
+// JSON-like text spanning several chunks, with enough randomness not to shrink to nothing
+std::vector<char> MakeInput(const std::size_t size)
+{
+    std::mt19937 generator(4711);
+    std::uniform_int_distribution<int> digit_distribution(0, 9);
+    std::string text;
+    while (text.size() < size)
+    {
+        text += "{\"mapped_coordinate\":[52.";
+        for (int i = 0; i < 6; ++i)
+        {
+            text += static_cast<char>('0' + digit_distribution(generator));
+        }
+        text += ",13.4],\"name\":\"Unter den Linden\"},";
+    }
+    return std::vector<char>(text.begin(), text.begin() + size);
+}
+
+BOOST_AUTO_TEST_CASE(round_trip)
+{
+    http::DeflateContext context(6);
+    for (const std::size_t size : {std::size_t(0), std::size_t(1), std::size_t(100 * 1024)})
+    {
+        const std::vector<char> input = MakeInput(size);
+
+        http::CompressedOutput gzip_output;
+        BOOST_REQUIRE(context.Compress(input, http::gzipRFC1952, gzip_output));
+        BOOST_CHECK(Inflate(Flatten(gzip_output), 15 + 16) == input);
+
+        // the streams are reused for the next response
+        http::CompressedOutput deflate_output;
+        BOOST_REQUIRE(context.Compress(input, http::deflateRFC1951, deflate_output));
+        BOOST_CHECK(Inflate(Flatten(deflate_output), -15) == input);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(thread_local_context_level)
+{
+    const std::vector<char> input = MakeInput(64 * 1024);
+
+    http::CompressedOutput compressed;
+    BOOST_REQUIRE(http::DeflateContext::GetThreadLocalContext(9).Compress(
+        input, http::gzipRFC1952, compressed));
+    BOOST_CHECK_LT(compressed.Size(), input.size());
+
+    // level 0 only stores the input, so the output cannot be smaller than it
+    http::CompressedOutput stored;
+    BOOST_REQUIRE(http::DeflateContext::GetThreadLocalContext(0).Compress(
+        input, http::gzipRFC1952, stored));
+    BOOST_CHECK_GT(stored.Size(), input.size());
+    BOOST_CHECK(Inflate(Flatten(stored), 15 + 16) == input);
+
+    http::CompressedOutput compressed_again;
+    BOOST_REQUIRE(http::DeflateContext::GetThreadLocalContext(9).Compress(
+        input, http::gzipRFC1952, compressed_again));
+    BOOST_CHECK_EQUAL(compressed_again.Size(), compressed.Size());
+    BOOST_CHECK(Inflate(Flatten(compressed_again), 15 + 16) == input);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
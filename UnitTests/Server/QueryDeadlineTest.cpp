@@ -0,0 +1,127 @@
+#include "../../Plugins/BasePlugin.h"
+#include "../../Util/QueryDeadline.h"
+
+#include <osrm/Reply.h>
+#include <osrm/RouteParameters.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+BOOST_AUTO_TEST_SUITE(query_deadline)
+
+// a deadline of 1ms that has certainly passed
+QueryDeadline ExpiredDeadline()
+{
+    const QueryDeadline deadline(1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    return deadline;
+}
+
+// checks its deadline like the search loops of the routing plugins do
+class SearchingPlugin : public BasePlugin
+{
+  public:
+    explicit SearchingPlugin(const unsigned delay_in_ms) : delay_in_ms(delay_in_ms) {}
+    const std::string GetDescriptor() const { return "search"; }
+    void HandleRequest(const RouteParameters &route_parameters, http::Reply &reply)
+    {
+        const QueryDeadline deadline(route_parameters.timeout);
+        std::this_thread::sleep_for(std::chrono::milliseconds(delay_in_ms));
+        for (unsigned i = 0; i < 1024; ++i)
+        {
+            deadline.Check();
+        }
+        reply.status = http::Reply::ok;
+        reply.content.push_back('x');
+    }
+
+  private:
+    const unsigned delay_in_ms;
+};
+
+BOOST_AUTO_TEST_CASE(unset_deadline)
+{
+    const QueryDeadline deadline;
+    BOOST_CHECK(!deadline.IsSet());
+    BOOST_CHECK(!deadline.Expired());
+    for (unsigned i = 0; i < 1024; ++i)
+    {
+        BOOST_REQUIRE_NO_THROW(deadline.Check());
+    }
+
+    // a timeout of 0 means no limit
+    const QueryDeadline no_limit(0);
+    BOOST_CHECK(!no_limit.IsSet());
+    BOOST_CHECK_NO_THROW(no_limit.Check());
+}
+
+BOOST_AUTO_TEST_CASE(pending_deadline)
+{
+    const QueryDeadline deadline(60 * 1000);
+    BOOST_CHECK(deadline.IsSet());
+    BOOST_CHECK(!deadline.Expired());
+    for (unsigned i = 0; i < 1024; ++i)
+    {
+        BOOST_REQUIRE_NO_THROW(deadline.Check());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(expired_deadline_is_sampled)
+{
+    const QueryDeadline deadline = ExpiredDeadline();
+    BOOST_CHECK(deadline.Expired());
+
+    // the clock is only read on every 256th call
+    for (unsigned i = 1; i < 256; ++i)
+    {
+        BOOST_REQUIRE_NO_THROW(deadline.Check());
+    }
+    BOOST_CHECK_THROW(deadline.Check(), QueryTimeoutException);
+    for (unsigned i = 1; i < 256; ++i)
+    {
+        BOOST_REQUIRE_NO_THROW(deadline.Check());
+    }
+    BOOST_CHECK_THROW(deadline.Check(), QueryTimeoutException);
+}
+
+BOOST_AUTO_TEST_CASE(copies_count_separately)
+{
+    const QueryDeadline deadline = ExpiredDeadline();
+    for (unsigned i = 1; i < 256; ++i)
+    {
+        deadline.Check();
+    }
+    // the per-task copies of parallel searches keep counting on their own
+    const QueryDeadline task_deadline(deadline);
+    BOOST_CHECK_THROW(deadline.Check(), QueryTimeoutException);
+    BOOST_CHECK_THROW(task_deadline.Check(), QueryTimeoutException);
+    for (unsigned i = 1; i < 256; ++i)
+    {
+        BOOST_REQUIRE_NO_THROW(task_deadline.Check());
+    }
+    BOOST_CHECK_THROW(task_deadline.Check(), QueryTimeoutException);
+}
+
+BOOST_AUTO_TEST_CASE(timeout_reply)
+{
+    SearchingPlugin plugin(5);
+    RouteParameters route_parameters;
+
+    route_parameters.timeout = 0;
+    http::Reply reply;
+    plugin.HandleRequestWithDeadline(route_parameters, reply);
+    BOOST_CHECK_EQUAL(reply.status, http::Reply::ok);
+    BOOST_CHECK_EQUAL(reply.content.size(), 1u);
+
+    route_parameters.timeout = 1;
+    http::Reply timed_out_reply;
+    plugin.HandleRequestWithDeadline(route_parameters, timed_out_reply);
+    BOOST_CHECK_EQUAL(timed_out_reply.status, http::Reply::serviceUnavailable);
+    const std::string content(timed_out_reply.content.begin(), timed_out_reply.content.end());
+    BOOST_CHECK_EQUAL(content, http::serviceUnavailableHTML);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
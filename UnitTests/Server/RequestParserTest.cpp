@@ -0,0 +1,125 @@
+#include "../../Server/RequestParser.h"
+#include "../../Server/Http/Request.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(request_parser)
+
+// feeds the request in chunks of the given sizes, the last chunk takes the rest
+boost::tribool ParseInChunks(const std::string &message,
+                             const std::vector<std::size_t> &chunk_sizes,
+                             http::Request &request)
+{
+    http::RequestParser parser;
+    http::CompressionType compression_type = http::noCompression;
+    std::vector<char> buffer(message.begin(), message.end());
+    char *position = buffer.data();
+    char *const end = buffer.data() + buffer.size();
+    boost::tribool result = boost::indeterminate;
+    for (std::size_t chunk = 0; position != end; ++chunk)
+    {
+        char *chunk_end =
+            (chunk < chunk_sizes.size() && chunk_sizes[chunk] < std::size_t(end - position))
+                ? position + chunk_sizes[chunk]
+                : end;
+        boost::tie(result, position) = parser.Parse(request, position, chunk_end, &compression_type);
+        if (result || !result)
+        {
+            break;
+        }
+    }
+    return result;
+}
+
+BOOST_AUTO_TEST_CASE(get_request)
+{
+    http::Request request;
+    const boost::tribool result =
+        ParseInChunks("GET /viaroute?loc=1,2 HTTP/1.1\r\nHost: localhost\r\n\r\n", {}, request);
+    BOOST_CHECK(bool(result));
+    BOOST_CHECK_EQUAL(request.method, "GET");
+    BOOST_CHECK_EQUAL(request.uri, "/viaroute?loc=1,2");
+    BOOST_CHECK(request.body.empty());
+}
+
+BOOST_AUTO_TEST_CASE(body_split_across_reads)
+{
+    const std::string body = "/viaroute?loc=1,2&loc=3,4\n/nearest?loc=1,2\n";
+    const std::string message = "POST /batch HTTP/1.1\r\nContent-Length: " +
+                                std::to_string(body.size()) + "\r\n\r\n" + body;
+
+    // the headers end in the first read, the body arrives in three pieces
+    const std::size_t header_size = message.size() - body.size();
+    for (const std::vector<std::size_t> &chunks :
+         {std::vector<std::size_t>{header_size, 5, 20},
+          std::vector<std::size_t>{header_size - 2, 1, 1, body.size() - 1},
+          std::vector<std::size_t>(message.size(), 1)})
+    {
+        http::Request request;
+        BOOST_CHECK(bool(ParseInChunks(message, chunks, request)));
+        BOOST_CHECK_EQUAL(request.method, "POST");
+        BOOST_CHECK_EQUAL(request.uri, "/batch");
+        BOOST_CHECK_EQUAL(request.body, body);
+    }
+
+    // an incomplete body keeps the parser waiting for more input
+    http::RequestParser parser;
+    http::CompressionType compression_type = http::noCompression;
+    std::vector<char> buffer(message.begin(), message.end() - 1);
+    http::Request request;
+    boost::tribool result;
+    char *position;
+    boost::tie(result, position) =
+        parser.Parse(request, buffer.data(), buffer.data() + buffer.size(), &compression_type);
+    BOOST_CHECK(boost::indeterminate(result));
+    BOOST_CHECK_EQUAL(request.body, body.substr(0, body.size() - 1));
+}
+
+BOOST_AUTO_TEST_CASE(missing_content_length)
+{
+    // without a Content-Length the request ends after the headers, the body is ignored
+    http::Request request;
+    const std::string message = "POST /batch HTTP/1.1\r\nHost: localhost\r\n\r\n/nearest?loc=1,2\n";
+    BOOST_CHECK(bool(ParseInChunks(message, {}, request)));
+    BOOST_CHECK_EQUAL(request.uri, "/batch");
+    BOOST_CHECK(request.body.empty());
+}
+
+BOOST_AUTO_TEST_CASE(content_length_limit)
+{
+    const std::size_t limit = http::RequestParser::MAX_CONTENT_LENGTH;
+
+    http::Request too_large;
+    BOOST_CHECK(bool(!ParseInChunks("POST /batch HTTP/1.1\r\nContent-Length: " +
+                                        std::to_string(limit + 1) + "\r\n\r\n",
+                                    {},
+                                    too_large)));
+
+    // a body of exactly the limit is accepted
+    http::Request at_limit;
+    const std::string body(limit, 'x');
+    BOOST_CHECK(bool(ParseInChunks("POST /batch HTTP/1.1\r\nContent-Length: " +
+                                       std::to_string(limit) + "\r\n\r\n" + body,
+                                   {},
+                                   at_limit)));
+    BOOST_CHECK_EQUAL(at_limit.body.size(), limit);
+}
+
+BOOST_AUTO_TEST_CASE(malformed_content_length)
+{
+    // values that overflow, are signed or are not plain numbers are rejected
+    for (const std::string value : {"99999999999", "18446744073709551616", "-1", "+1", "1x", "0x10", ""})
+    {
+        http::Request request;
+        BOOST_CHECK_MESSAGE(bool(!ParseInChunks("POST /batch HTTP/1.1\r\nContent-Length: " +
+                                                    value + "\r\n\r\n",
+                                                {},
+                                                request)),
+                            "Content-Length: " << value);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -73,11 +73,20 @@ inline bool GenerateDataStoreOptions(const int argc, const char *argv[], ServerP
         "fileindex",
         boost::program_options::value<boost::filesystem::path>(&paths["fileindex"]),
         ".fileIndex file")(
+        "segmentdata",
+        boost::program_options::value<boost::filesystem::path>(&paths["segmentdata"]),
+        ".segments file")(
         "namesdata",
         boost::program_options::value<boost::filesystem::path>(&paths["namesdata"]),
         ".names file")("timestamp",
                        boost::program_options::value<boost::filesystem::path>(&paths["timestamp"]),
-                       ".timestamp file");
+                       ".timestamp file")(
+        "levels",
+        boost::program_options::value<boost::filesystem::path>(&paths["levels"]),
+        ".levels file (optional)")(
+        "hublabels",
+        boost::program_options::value<boost::filesystem::path>(&paths["hublabels"]),
+        ".hl file (optional)");
 
     // hidden options, will be allowed both on command line and in config
     // file, but will not be shown to the user
@@ -141,6 +150,8 @@ inline bool GenerateDataStoreOptions(const int argc, const char *argv[], ServerP
                                     !paths.find("ramindex")->second.string().empty()) ||
                                    (paths.find("fileindex") != paths.end() &&
                                     !paths.find("fileindex")->second.string().empty()) ||
+                                   (paths.find("segmentdata") != paths.end() &&
+                                    !paths.find("segmentdata")->second.string().empty()) ||
                                    (paths.find("timestamp") != paths.end() &&
                                     !paths.find("timestamp")->second.string().empty());
 
@@ -210,6 +221,12 @@ inline bool GenerateDataStoreOptions(const int argc, const char *argv[], ServerP
             path_iterator->second = base_string + ".fileIndex";
         }
 
+        path_iterator = paths.find("segmentdata");
+        if (path_iterator != paths.end())
+        {
+            path_iterator->second = base_string + ".segments";
+        }
+
         path_iterator = paths.find("namesdata");
         if (path_iterator != paths.end())
         {
@@ -221,6 +238,18 @@ inline bool GenerateDataStoreOptions(const int argc, const char *argv[], ServerP
         {
             path_iterator->second = base_string + ".timestamp";
         }
+
+        path_iterator = paths.find("levels");
+        if (path_iterator != paths.end())
+        {
+            path_iterator->second = base_string + ".levels";
+        }
+
+        path_iterator = paths.find("hublabels");
+        if (path_iterator != paths.end())
+        {
+            path_iterator->second = base_string + ".hl";
+        }
     }
 
     path_iterator = paths.find("hsgrdata");
@@ -38,6 +38,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../typedefs.h"
 
 #include <boost/assert.hpp>
+#include <boost/crc.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
 
@@ -430,4 +431,49 @@ unsigned readHSGRFromStream(const boost::filesystem::path &hsgr_file,
     return number_of_nodes;
 }
 
+// The edge array of the .hsgr is followed by the number of edges per block, the number of
+// blocks and the CRC32 of each block. Older files end with the edge array.
+static const unsigned HSGR_EDGES_PER_CHECKSUM = 4096;
+
+template <typename EdgeT>
+unsigned computeHSGRBlockChecksum(const EdgeT *first_edge, const unsigned number_of_edges)
+{
+    boost::crc_32_type block_crc;
+    block_crc.process_bytes(first_edge, number_of_edges * sizeof(EdgeT));
+    return block_crc.checksum();
+}
+
+// Reads the block checksums that follow the edge array, false if the file has none
+template <typename NodeT, typename EdgeT>
+bool readHSGRBlockChecksums(const boost::filesystem::path &hsgr_file,
+                            const unsigned number_of_nodes,
+                            const unsigned number_of_edges,
+                            unsigned &edges_per_checksum,
+                            std::vector<unsigned> &checksums)
+{
+    const uint64_t trailer_offset = sizeof(FingerPrint) + 3 * sizeof(unsigned) +
+                                    uint64_t(number_of_nodes) * sizeof(NodeT) +
+                                    uint64_t(number_of_edges) * sizeof(EdgeT);
+    if (boost::filesystem::file_size(hsgr_file) < trailer_offset + 2 * sizeof(unsigned))
+    {
+        return false;
+    }
+
+    boost::filesystem::ifstream hsgr_input_stream(hsgr_file, std::ios::binary);
+    hsgr_input_stream.seekg(trailer_offset);
+    unsigned number_of_checksums = 0;
+    hsgr_input_stream.read((char *)&edges_per_checksum, sizeof(unsigned));
+    hsgr_input_stream.read((char *)&number_of_checksums, sizeof(unsigned));
+    checksums.resize(number_of_checksums);
+    if (number_of_checksums > 0)
+    {
+        hsgr_input_stream.read((char *)&(checksums[0]), number_of_checksums * sizeof(unsigned));
+    }
+    if (!hsgr_input_stream)
+    {
+        throw OSRMException("hsgr checksums are truncated");
+    }
+    return true;
+}
+
 #endif // GRAPHLOADER_H
@@ -28,6 +28,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef MACHINE_INFO_H
 #define MACHINE_INFO_H
 
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include <cstdint>
+
 enum Endianness
 { LittleEndian = 1,
   BigEndian = 2 };
@@ -54,4 +60,25 @@ inline unsigned SwapEndian(unsigned x)
     return x;
 }
 
+// Returns the peak resident set size of the process in bytes, 0 if unknown
+inline uint64_t GetPeakResidentMemory()
+{
+#ifdef _WIN32
+    return 0;
+#else
+    struct rusage usage;
+    if (0 != getrusage(RUSAGE_SELF, &usage))
+    {
+        return 0;
+    }
+#ifdef __APPLE__
+    // reported in bytes on OS X
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+    // reported in kilobytes on Linux and the BSDs
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
 #endif // MACHINE_INFO_H
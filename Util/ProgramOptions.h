@@ -52,6 +52,11 @@ inline unsigned GenerateServerProgramOptions(const int argc,
                                              std::string &ip_address,
                                              int &ip_port,
                                              int &requested_num_threads,
+                                             int &max_query_time,
+                                             int &parallel_leg_threshold,
+                                             int &leaf_cache_size,
+                                             int &compression_level,
+                                             int &compression_threshold,
                                              bool &use_shared_memory,
                                              bool &trial)
 {
@@ -87,11 +92,20 @@ inline unsigned GenerateServerProgramOptions(const int argc,
         "fileindex",
         boost::program_options::value<boost::filesystem::path>(&paths["fileindex"]),
         "File index file")(
+        "segmentdata",
+        boost::program_options::value<boost::filesystem::path>(&paths["segmentdata"]),
+        ".segments file")(
         "namesdata",
         boost::program_options::value<boost::filesystem::path>(&paths["namesdata"]),
         ".names file")("timestamp",
                        boost::program_options::value<boost::filesystem::path>(&paths["timestamp"]),
                        ".timestamp file")(
+        "levels",
+        boost::program_options::value<boost::filesystem::path>(&paths["levels"]),
+        ".levels file (optional)")(
+        "hublabels",
+        boost::program_options::value<boost::filesystem::path>(&paths["hublabels"]),
+        ".hl file (optional)")(
         "ip,i",
         boost::program_options::value<std::string>(&ip_address)->default_value("0.0.0.0"),
         "IP address")(
@@ -99,6 +113,21 @@ inline unsigned GenerateServerProgramOptions(const int argc,
         "threads,t",
         boost::program_options::value<int>(&requested_num_threads)->default_value(8),
         "Number of threads to use")(
+        "querytimeout",
+        boost::program_options::value<int>(&max_query_time)->default_value(0),
+        "Abort queries running longer than this many milliseconds (0 = no limit)")(
+        "parallellegs",
+        boost::program_options::value<int>(&parallel_leg_threshold)->default_value(0),
+        "Search the legs of routes with at least this many legs in parallel (0 = never)")(
+        "leafcache",
+        boost::program_options::value<int>(&leaf_cache_size)->default_value(0),
+        "Megabytes of r-tree leaves cached for all threads (0 = no cache)")(
+        "compressionlevel",
+        boost::program_options::value<int>(&compression_level)->default_value(1),
+        "zlib level for gzip/deflate encoded responses, 0 (none) to 9 (best)")(
+        "compressionthreshold",
+        boost::program_options::value<int>(&compression_threshold)->default_value(1024),
+        "Send responses smaller than this many bytes uncompressed")(
         "sharedmemory,s",
         boost::program_options::value<bool>(&use_shared_memory)->implicit_value(true),
         "Load data from shared memory");
@@ -167,6 +196,31 @@ inline unsigned GenerateServerProgramOptions(const int argc,
         throw OSRMException("Number of threads must be a positive number");
     }
 
+    if (0 > max_query_time)
+    {
+        throw OSRMException("Query timeout must not be negative");
+    }
+
+    if (0 > parallel_leg_threshold)
+    {
+        throw OSRMException("Parallel leg threshold must not be negative");
+    }
+
+    if (0 > leaf_cache_size)
+    {
+        throw OSRMException("Leaf cache size must not be negative");
+    }
+
+    if (0 > compression_level || 9 < compression_level)
+    {
+        throw OSRMException("Compression level must be between 0 and 9");
+    }
+
+    if (0 > compression_threshold)
+    {
+        throw OSRMException("Compression threshold must not be negative");
+    }
+
     if (!use_shared_memory && option_variables.count("base"))
     {
         path_iterator = paths.find("base");
@@ -239,6 +293,14 @@ inline unsigned GenerateServerProgramOptions(const int argc,
             throw OSRMException(base_string + ".fileIndex not found");
         }
 
+        // only the leaf files of the current version come with a segment file
+        path_iterator = paths.find("segmentdata");
+        if (path_iterator != paths.end() &&
+            !boost::filesystem::is_regular_file(path_iterator->second))
+        {
+            path_iterator->second = base_string + ".segments";
+        }
+
         path_iterator = paths.find("namesdata");
         if (path_iterator != paths.end() &&
             !boost::filesystem::is_regular_file(path_iterator->second))
@@ -257,6 +319,20 @@ inline unsigned GenerateServerProgramOptions(const int argc,
             path_iterator->second = base_string + ".timestamp";
         }
 
+        path_iterator = paths.find("levels");
+        if (path_iterator != paths.end() &&
+            !boost::filesystem::is_regular_file(path_iterator->second))
+        {
+            path_iterator->second = base_string + ".levels";
+        }
+
+        path_iterator = paths.find("hublabels");
+        if (path_iterator != paths.end() &&
+            !boost::filesystem::is_regular_file(path_iterator->second))
+        {
+            path_iterator->second = base_string + ".hl";
+        }
+
         return INIT_OK_START_ENGINE;
     }
     if (use_shared_memory && !option_variables.count("base"))
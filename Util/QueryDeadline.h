@@ -0,0 +1,79 @@
+/*
+
+Copyright (c) 2014, Project OSRM, Dennis Luxen, others
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef QUERY_DEADLINE_H
+#define QUERY_DEADLINE_H
+
+#include "OSRMException.h"
+
+#include <chrono>
+
+class QueryTimeoutException : public OSRMException
+{
+  public:
+    QueryTimeoutException() : OSRMException("query exceeded its deadline") {}
+};
+
+// A point in time after which a query is aborted. Search loops call Check() on every
+// iteration, but the clock is only read once every CHECK_INTERVAL calls to keep the
+// overhead on the hot path negligible. A default-constructed deadline never expires.
+class QueryDeadline
+{
+  public:
+    QueryDeadline() : is_set(false), checks(0) {}
+
+    explicit QueryDeadline(const unsigned timeout_in_ms)
+        : expiry(std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_in_ms)),
+          is_set(0 != timeout_in_ms), checks(0)
+    {
+    }
+
+    inline bool IsSet() const { return is_set; }
+
+    inline bool Expired() const { return is_set && std::chrono::steady_clock::now() > expiry; }
+
+    inline void Check() const
+    {
+        if (!is_set || (++checks % CHECK_INTERVAL) != 0)
+        {
+            return;
+        }
+        if (std::chrono::steady_clock::now() > expiry)
+        {
+            throw QueryTimeoutException();
+        }
+    }
+
+  private:
+    static const unsigned CHECK_INTERVAL = 256;
+
+    std::chrono::steady_clock::time_point expiry;
+    bool is_set;
+    mutable unsigned checks;
+};
+
+#endif // QUERY_DEADLINE_H
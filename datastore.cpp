@@ -25,6 +25,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 */
 
+#include "DataStructures/HubLabels.h"
 #include "DataStructures/OriginalEdgeData.h"
 #include "DataStructures/RangeTable.h"
 #include "DataStructures/QueryEdge.h"
@@ -196,6 +197,13 @@ int main(const int argc, const char *argv[])
         const boost::filesystem::path index_file_path_absolute =
             boost::filesystem::portable_canonical(paths_iterator->second);
         const std::string &file_index_path = index_file_path_absolute.string();
+        // only the leaf files of the current version come with a segment file
+        paths_iterator = server_paths.find("segmentdata");
+        const std::string segment_data_path =
+            (server_paths.end() != paths_iterator &&
+             boost::filesystem::is_regular_file(paths_iterator->second))
+                ? boost::filesystem::portable_canonical(paths_iterator->second).string()
+                : std::string();
         paths_iterator = server_paths.find("nodesdata");
         BOOST_ASSERT(server_paths.end() != paths_iterator);
         BOOST_ASSERT(!paths_iterator->second.empty());
@@ -212,6 +220,15 @@ int main(const int argc, const char *argv[])
         BOOST_ASSERT(server_paths.end() != paths_iterator);
         BOOST_ASSERT(!paths_iterator->second.empty());
         const boost::filesystem::path &geometries_data_path = paths_iterator->second;
+        // node levels and hub labels are optional
+        paths_iterator = server_paths.find("levels");
+        const boost::filesystem::path levels_path =
+            (server_paths.end() != paths_iterator) ? paths_iterator->second
+                                                   : boost::filesystem::path();
+        paths_iterator = server_paths.find("hublabels");
+        const boost::filesystem::path hub_labels_path =
+            (server_paths.end() != paths_iterator) ? paths_iterator->second
+                                                   : boost::filesystem::path();
 
         // determine segment to use
         bool segment2_in_use = SharedMemory::RegionExists(LAYOUT_2);
@@ -240,6 +257,8 @@ int main(const int argc, const char *argv[])
 
         shared_layout_ptr->SetBlockSize<char>(SharedDataLayout::FILE_INDEX_PATH,
                                               file_index_path.length() + 1);
+        shared_layout_ptr->SetBlockSize<char>(SharedDataLayout::SEGMENT_DATA_PATH,
+                                              segment_data_path.length() + 1);
 
         // collect number of elements to store in shared memory object
         SimpleLogger().Write() << "load names from: " << names_data_path;
@@ -361,6 +380,52 @@ int main(const int argc, const char *argv[])
         shared_layout_ptr->SetBlockSize<unsigned>(SharedDataLayout::GEOMETRIES_LIST,
                                                   number_of_compressed_geometries);
 
+        // load node level size, the levels must belong to the graph
+        boost::filesystem::ifstream levels_input_stream;
+        if (!levels_path.empty() && boost::filesystem::is_regular_file(levels_path))
+        {
+            levels_input_stream.open(levels_path, std::ios::binary);
+            unsigned levels_checksum = 0;
+            unsigned number_of_level_ordered_nodes = 0;
+            levels_input_stream.read((char *)&levels_checksum, sizeof(unsigned));
+            levels_input_stream.read((char *)&number_of_level_ordered_nodes, sizeof(unsigned));
+            if (levels_input_stream && levels_checksum == checksum &&
+                number_of_level_ordered_nodes + 1 == number_of_graph_nodes)
+            {
+                shared_layout_ptr->SetBlockSize<NodeID>(SharedDataLayout::LEVEL_ORDERED_NODES,
+                                                        number_of_level_ordered_nodes);
+            }
+            else
+            {
+                SimpleLogger().Write(logWARNING) << levels_path.string()
+                                                 << " does not belong to the graph, ignoring it";
+            }
+        }
+
+        // load hub label sizes, the labels must belong to the graph
+        boost::filesystem::ifstream hub_labels_input_stream;
+        HubLabelFileHeader hub_label_header;
+        if (!hub_labels_path.empty() && boost::filesystem::is_regular_file(hub_labels_path))
+        {
+            hub_labels_input_stream.open(hub_labels_path, std::ios::binary);
+            hub_labels_input_stream.read((char *)&hub_label_header, sizeof(HubLabelFileHeader));
+            if (hub_labels_input_stream && hub_label_header.check_sum == checksum &&
+                hub_label_header.number_of_nodes + 1 == number_of_graph_nodes)
+            {
+                shared_layout_ptr->SetBlockSize<unsigned>(
+                    SharedDataLayout::HUB_LABEL_OFFSETS, 2 * hub_label_header.number_of_nodes + 1);
+                shared_layout_ptr->SetBlockSize<NodeID>(SharedDataLayout::HUB_LABEL_HUBS,
+                                                        hub_label_header.number_of_entries);
+                shared_layout_ptr->SetBlockSize<EdgeWeight>(SharedDataLayout::HUB_LABEL_DISTANCES,
+                                                            hub_label_header.number_of_entries);
+            }
+            else
+            {
+                SimpleLogger().Write(logWARNING) << hub_labels_path.string()
+                                                 << " does not belong to the graph, ignoring it";
+            }
+        }
+
         // allocate shared memory block
         SimpleLogger().Write() << "allocating shared memory of "
                                << shared_layout_ptr->GetSizeOfLayout() << " bytes";
@@ -385,6 +450,15 @@ int main(const int argc, const char *argv[])
                   0);
         std::copy(file_index_path.begin(), file_index_path.end(), file_index_path_ptr);
 
+        // segment data file name, empty for leaf files that hold the segments themselves
+        char *segment_data_path_ptr = shared_layout_ptr->GetBlockPtr<char, true>(
+            shared_memory_ptr, SharedDataLayout::SEGMENT_DATA_PATH);
+        std::fill(segment_data_path_ptr,
+                  segment_data_path_ptr +
+                      shared_layout_ptr->GetBlockSize(SharedDataLayout::SEGMENT_DATA_PATH),
+                  0);
+        std::copy(segment_data_path.begin(), segment_data_path.end(), segment_data_path_ptr);
+
         // Loading street names
         unsigned *name_offsets_ptr = shared_layout_ptr->GetBlockPtr<unsigned, true>(
             shared_memory_ptr, SharedDataLayout::NAME_OFFSETS);
@@ -539,6 +613,31 @@ int main(const int argc, const char *argv[])
         }
         hsgr_input_stream.close();
 
+        // load the level ordered nodes
+        if (shared_layout_ptr->GetBlockSize(SharedDataLayout::LEVEL_ORDERED_NODES) > 0)
+        {
+            NodeID *level_ordered_nodes_ptr = shared_layout_ptr->GetBlockPtr<NodeID, true>(
+                shared_memory_ptr, SharedDataLayout::LEVEL_ORDERED_NODES);
+            levels_input_stream.read(
+                (char *)level_ordered_nodes_ptr,
+                shared_layout_ptr->GetBlockSize(SharedDataLayout::LEVEL_ORDERED_NODES));
+        }
+        levels_input_stream.close();
+
+        // decode the hub labels
+        if (shared_layout_ptr->num_entries[SharedDataLayout::HUB_LABEL_OFFSETS] > 0)
+        {
+            ReadHubLabels(hub_labels_input_stream,
+                          hub_label_header,
+                          shared_layout_ptr->GetBlockPtr<unsigned, true>(
+                              shared_memory_ptr, SharedDataLayout::HUB_LABEL_OFFSETS),
+                          shared_layout_ptr->GetBlockPtr<NodeID, true>(
+                              shared_memory_ptr, SharedDataLayout::HUB_LABEL_HUBS),
+                          shared_layout_ptr->GetBlockPtr<EdgeWeight, true>(
+                              shared_memory_ptr, SharedDataLayout::HUB_LABEL_DISTANCES));
+        }
+        hub_labels_input_stream.close();
+
         // acquire lock
         SharedMemory *data_type_memory =
             SharedMemoryFactory::Get(CURRENT_REGIONS, sizeof(SharedDataTimestamp), true, false);
@@ -16,7 +16,15 @@ Feature: osrm-prepare command line options: help
         And stdout should contain "--restrictions"
         And stdout should contain "--profile"
         And stdout should contain "--threads"
-        And stdout should contain 15 lines
+        And stdout should contain "--hub-labels"
+        And stdout should contain "--rtree-packing"
+        And stdout should contain "--checkpoint-interval"
+        And stdout should contain "--resume"
+        And stdout should contain "--priority-updates"
+        And stdout should contain "--contraction-report"
+        And stdout should contain "--keep-edge-based"
+        And stdout should contain "--from-edge-based"
+        And stdout should contain 30 lines
         And it should exit with code 0
 
     Scenario: osrm-prepare - Help, short
@@ -31,7 +39,15 @@ Feature: osrm-prepare command line options: help
         And stdout should contain "--restrictions"
         And stdout should contain "--profile"
         And stdout should contain "--threads"
-        And stdout should contain 15 lines
+        And stdout should contain "--hub-labels"
+        And stdout should contain "--rtree-packing"
+        And stdout should contain "--checkpoint-interval"
+        And stdout should contain "--resume"
+        And stdout should contain "--priority-updates"
+        And stdout should contain "--contraction-report"
+        And stdout should contain "--keep-edge-based"
+        And stdout should contain "--from-edge-based"
+        And stdout should contain 30 lines
         And it should exit with code 0
 
     Scenario: osrm-prepare - Help, long
@@ -46,5 +62,13 @@ Feature: osrm-prepare command line options: help
         And stdout should contain "--restrictions"
         And stdout should contain "--profile"
         And stdout should contain "--threads"
-        And stdout should contain 15 lines
+        And stdout should contain "--hub-labels"
+        And stdout should contain "--rtree-packing"
+        And stdout should contain "--checkpoint-interval"
+        And stdout should contain "--resume"
+        And stdout should contain "--priority-updates"
+        And stdout should contain "--contraction-report"
+        And stdout should contain "--keep-edge-based"
+        And stdout should contain "--from-edge-based"
+        And stdout should contain 30 lines
         And it should exit with code 0
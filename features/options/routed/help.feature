@@ -19,13 +19,21 @@ Feature: osrm-routed command line options: help
         And stdout should contain "--edgesdata arg"
         And stdout should contain "--ramindex arg"
         And stdout should contain "--fileindex arg"
+        And stdout should contain "--segmentdata arg"
         And stdout should contain "--namesdata arg"
         And stdout should contain "--timestamp arg"
+        And stdout should contain "--levels arg"
+        And stdout should contain "--hublabels arg"
         And stdout should contain "--ip"
         And stdout should contain "--port"
         And stdout should contain "--threads"
+        And stdout should contain "--querytimeout"
+        And stdout should contain "--parallellegs"
+        And stdout should contain "--leafcache"
+        And stdout should contain "--compressionlevel"
+        And stdout should contain "--compressionthreshold"
         And stdout should contain "--sharedmemory"
-        And stdout should contain 22 lines
+        And stdout should contain 35 lines
         And it should exit with code 0
 
     Scenario: osrm-routed - Help, short
@@ -43,13 +51,21 @@ Feature: osrm-routed command line options: help
         And stdout should contain "--edgesdata arg"
         And stdout should contain "--ramindex arg"
         And stdout should contain "--fileindex arg"
+        And stdout should contain "--segmentdata arg"
         And stdout should contain "--namesdata arg"
         And stdout should contain "--timestamp arg"
+        And stdout should contain "--levels arg"
+        And stdout should contain "--hublabels arg"
         And stdout should contain "--ip"
         And stdout should contain "--port"
         And stdout should contain "--threads"
+        And stdout should contain "--querytimeout"
+        And stdout should contain "--parallellegs"
+        And stdout should contain "--leafcache"
+        And stdout should contain "--compressionlevel"
+        And stdout should contain "--compressionthreshold"
         And stdout should contain "--sharedmemory"
-        And stdout should contain 22 lines
+        And stdout should contain 35 lines
         And it should exit with code 0
 
     Scenario: osrm-routed - Help, long
@@ -67,11 +83,19 @@ Feature: osrm-routed command line options: help
         And stdout should contain "--edgesdata arg"
         And stdout should contain "--ramindex arg"
         And stdout should contain "--fileindex arg"
+        And stdout should contain "--segmentdata arg"
         And stdout should contain "--namesdata arg"
         And stdout should contain "--timestamp arg"
+        And stdout should contain "--levels arg"
+        And stdout should contain "--hublabels arg"
         And stdout should contain "--ip"
         And stdout should contain "--port"
         And stdout should contain "--threads"
+        And stdout should contain "--querytimeout"
+        And stdout should contain "--parallellegs"
+        And stdout should contain "--leafcache"
+        And stdout should contain "--compressionlevel"
+        And stdout should contain "--compressionthreshold"
         And stdout should contain "--sharedmemory"
-        And stdout should contain 22 lines
+        And stdout should contain 35 lines
         And it should exit with code 0
@@ -73,7 +73,8 @@ int main(int argc, const char *argv[])
 
         bool use_shared_memory = false, trial_run = false;
         std::string ip_address;
-        int ip_port, requested_thread_num;
+        int ip_port, requested_thread_num, max_query_time, parallel_leg_threshold, leaf_cache_size,
+            compression_level, compression_threshold;
 
         ServerPaths server_paths;
 
@@ -83,6 +84,11 @@ int main(int argc, const char *argv[])
                                                                   ip_address,
                                                                   ip_port,
                                                                   requested_thread_num,
+                                                                  max_query_time,
+                                                                  parallel_leg_threshold,
+                                                                  leaf_cache_size,
+                                                                  compression_level,
+                                                                  compression_threshold,
                                                                   use_shared_memory,
                                                                   trial_run);
         if (init_result == INIT_OK_DO_NOT_START_ENGINE)
@@ -116,11 +122,19 @@ int main(int argc, const char *argv[])
             SimpleLogger().Write(logDEBUG) << "Geometry file:\t" << server_paths["geometries"];
             SimpleLogger().Write(logDEBUG) << "RAM file:\t" << server_paths["ramindex"];
             SimpleLogger().Write(logDEBUG) << "Index file:\t" << server_paths["fileindex"];
+            SimpleLogger().Write(logDEBUG) << "Segment file:\t" << server_paths["segmentdata"];
             SimpleLogger().Write(logDEBUG) << "Names file:\t" << server_paths["namesdata"];
             SimpleLogger().Write(logDEBUG) << "Timestamp file:\t" << server_paths["timestamp"];
+            SimpleLogger().Write(logDEBUG) << "Levels file:\t" << server_paths["levels"];
+            SimpleLogger().Write(logDEBUG) << "Hub label file:\t" << server_paths["hublabels"];
             SimpleLogger().Write(logDEBUG) << "Threads:\t" << requested_thread_num;
             SimpleLogger().Write(logDEBUG) << "IP address:\t" << ip_address;
             SimpleLogger().Write(logDEBUG) << "IP port:\t" << ip_port;
+            SimpleLogger().Write(logDEBUG) << "Query timeout:\t" << max_query_time;
+            SimpleLogger().Write(logDEBUG) << "Parallel legs:\t" << parallel_leg_threshold;
+            SimpleLogger().Write(logDEBUG) << "Leaf cache:\t" << leaf_cache_size << " MB";
+            SimpleLogger().Write(logDEBUG) << "Compression:\tlevel " << compression_level
+                                           << ", threshold " << compression_threshold;
         }
 #ifndef _WIN32
         int sig = 0;
@@ -130,9 +144,17 @@ int main(int argc, const char *argv[])
         pthread_sigmask(SIG_BLOCK, &new_mask, &old_mask);
 #endif
 
-        OSRM osrm_lib(server_paths, use_shared_memory);
+        OSRM osrm_lib(server_paths,
+                      use_shared_memory,
+                      max_query_time,
+                      parallel_leg_threshold,
+                      leaf_cache_size);
         Server *routing_server =
-            ServerFactory::CreateServer(ip_address, ip_port, requested_thread_num);
+            ServerFactory::CreateServer(ip_address,
+                                        ip_port,
+                                        requested_thread_num,
+                                        http::CompressionSettings(compression_level,
+                                                                  compression_threshold));
 
         routing_server->GetRequestHandlerPtr().RegisterRoutingMachine(&osrm_lib);
 